@@ -288,6 +288,59 @@ BOOL GFX_PIPErecv(u8 *cmd, u32 *param)
 	return (TRUE);
 }
 
+//commands which change GXSTAT (or stall the geometry engine) when they execute
+static bool IsSyncCommand(u8 cmd)
+{
+	return IsMatrixStackCommand(cmd) || cmd == 0x50 || cmd == 0x70 || cmd == 0x71 || cmd == 0x72;
+}
+
+// this function used ONLY in gxFIFO
+//pulls up to maxCount commands which can be executed back to back, since nothing the cpu can see changes until the last of them.
+//endOfRun is set when the caller should give the cpu a chance to run: the fifo ran dry, it fell to the low threshold
+//(which needs the gxfifo dma to refill it) or a command which changes GXSTAT was handed out.
+//the fifo status is only updated once, at the end, which gives the same result as updating it after every command.
+u32 GFX_PIPErecvRun(u8 *cmd, u32 *param, u32 maxCount, bool &endOfRun)
+{
+	u32 count = 0;
+	endOfRun = false;
+
+	while (count < maxCount)
+	{
+		if (gxFIFO.size == 0)
+		{
+			endOfRun = true;
+			break;
+		}
+
+		const u8 currCmd = gxFIFO.cmd[gxFIFO.head];
+		cmd[count] = currCmd;
+		param[count] = gxFIFO.param[gxFIFO.head];
+		count++;
+
+		//see the associated increment in another function
+		if(IsMatrixStackCommand(currCmd))
+		{
+			gxFIFO.matrix_stack_op_size--;
+			if(gxFIFO.matrix_stack_op_size>0x10000000)
+				printf("bad news disaster in matrix_stack_op_size\n");
+		}
+
+		gxFIFO.head++;
+		gxFIFO.size--;
+		if (gxFIFO.head > HACK_GXIFO_SIZE-1) gxFIFO.head = 0;
+
+		if (IsSyncCommand(currCmd) || gxFIFO.size == 127 || gxFIFO.size == 0)
+		{
+			endOfRun = true;
+			break;
+		}
+	}
+
+	GXF_FIFO_handleEvents();
+
+	return count;
+}
+
 void GFX_FIFOcnt(u32 val)
 {
 	////INFO("gxFIFO: write cnt 0x%08X (prev 0x%08X) FIFO size %03i PIPE size %03i\n", val, gxstat, gxFIFO.size, gxPIPE.size);
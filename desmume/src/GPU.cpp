@@ -35,6 +35,7 @@
 #include "gfx3d.h"
 #include "debug.h"
 #include "GPU_osd.h"
+#include "GPU_spritespan.h"
 #include "NDSSystem.h"
 #include "readwrite.h"
 #include "matrix.h"
@@ -243,6 +244,8 @@ bool gpu_loadstate(EMUFILE* is, int size)
 	
 	mainEngine->ParseAllRegisters();
 	subEngine->ParseAllRegisters();
+	mainEngine->InvalidateLineCache();
+	subEngine->InvalidateLineCache();
 	
 	return !is->fail();
 }
@@ -401,6 +404,7 @@ void GPUEngineBase::_Reset_Base()
 	memset(this->_h_win[1], 0, sizeof(this->_h_win[1]));
 	memset(&this->_mosaicColors, 0, sizeof(MosaicColor));
 	memset(this->_itemsForPriority, 0, sizeof(this->_itemsForPriority));
+	this->InvalidateLineCache();
 	
 	memset(this->_internalRenderLineTargetNative, 0, GPU_FRAMEBUFFER_NATIVE_WIDTH * sizeof(FragmentColor));
 	
@@ -469,6 +473,7 @@ void GPUEngineBase::_Reset_Base()
 	
 	this->_needUpdateWINH[0] = true;
 	this->_needUpdateWINH[1] = true;
+	this->_needUpdateSpriteLists = true;
 	
 	this->vramBlockOBJIndex = VRAM_NO_3D_USAGE;
 	
@@ -1166,6 +1171,9 @@ void GPUEngineBase::ParseReg_DISPCNT()
 	else
 		renderState.spriteBMPBoundary = 7;
 	
+	// The sprite tile addresses depend on the mapping mode.
+	this->_needUpdateSpriteLists = true;
+	
 	this->ParseReg_BGnCNT(GPULayerID_BG3);
 	this->ParseReg_BGnCNT(GPULayerID_BG2);
 	this->ParseReg_BGnCNT(GPULayerID_BG1);
@@ -2805,6 +2813,40 @@ void GPUEngineBase::_RenderPixelsCustomVRAM(GPUEngineCompositorInfo &compInfo)
 /*****************************************************************************/
 //			BACKGROUND RENDERING -TEXT-
 /*****************************************************************************/
+static FORCEINLINE u64 _ReverseTileRow(u64 row)
+{
+	row = ((row & 0x00FF00FF00FF00FFULL) <<  8) | ((row >>  8) & 0x00FF00FF00FF00FFULL);
+	row = ((row & 0x0000FFFF0000FFFFULL) << 16) | ((row >> 16) & 0x0000FFFF0000FFFFULL);
+	return (row << 32) | (row >> 32);
+}
+
+// Unpacks one row of a 4bpp tile into one palette index per byte, with the
+// leftmost pixel in the lowest byte.
+static FORCEINLINE u64 _DecodeTileRow4bpp(const u32 packedRow, const bool hFlip)
+{
+	u64 row = packedRow;
+	row = (row | (row << 16)) & 0x0000FFFF0000FFFFULL;
+	row = (row | (row <<  8)) & 0x00FF00FF00FF00FFULL;
+	row = (row | (row <<  4)) & 0x0F0F0F0F0F0F0F0FULL;
+	
+	if (hFlip)
+	{
+		row = _ReverseTileRow(row);
+	}
+	
+	return row;
+}
+
+static FORCEINLINE u64 _DecodeTileRow8bpp(u64 row, const bool hFlip)
+{
+	if (hFlip)
+	{
+		row = _ReverseTileRow(row);
+	}
+	
+	return row;
+}
+
 // render a text background to the combined pixelbuffer
 template<NDSColorFormat OUTPUTFORMAT, bool ISDEBUGRENDER, bool MOSAIC, bool WILLPERFORMWINDOWTEST, bool COLOREFFECTDISABLEDHINT, bool ISCUSTOMRENDERINGNEEDED>
 void GPUEngineBase::_RenderLine_BGText(GPUEngineCompositorInfo &compInfo, const u16 XBG, const u16 YBG)
@@ -2826,176 +2868,68 @@ void GPUEngineBase::_RenderLine_BGText(GPUEngineCompositorInfo &compInfo, const
 	if (tmp > 31)
 		map += ADDRESS_STEP_512B << compInfo.renderState.selectedBGLayer->BGnCNT.ScreenSize;
 	
-	if (compInfo.renderState.selectedBGLayer->BGnCNT.PaletteMode == PaletteMode_16x16) // color: 16 palette entries
+	// A decoded tile row only depends on the VRAM it was read from, so the rows decoded on
+	// earlier lines can be reused until VRAM is written or remapped.
+	if (this->_tileRowCacheGeneration != MMU.VRAMGeneration)
 	{
-		const u16 *__restrict pal = this->_paletteBG;
-		const u16 yoff = (YBG & 0x0007) << 2;
-		u8 index;
-		u16 color;
-		
-		for (size_t xfin = pixCountLo; x < lineWidth; xfin = std::min<u16>(x+8, lineWidth))
-		{
-			const TILEENTRY tileEntry = this->_GetTileEntry(map, xoff, wmask);
-			const u16 tilePalette = tileEntry.bits.Palette * 16;
-			u8 *__restrict tileColorIdx = (u8 *)MMU_gpu_map(tile + (tileEntry.bits.TileNum * 0x20) + ((tileEntry.bits.VFlip) ? (7*4)-yoff : yoff));
-			
-			if (tileEntry.bits.HFlip)
-			{
-				tileColorIdx += 3 - ((xoff & 0x0007) >> 1);
-				
-				if (xoff & 1)
-				{
-					if (ISCUSTOMRENDERINGNEEDED)
-					{
-						this->_bgLayerIndex[x] = *tileColorIdx & 0x0F;
-						this->_bgLayerColor[x] = LE_TO_LOCAL_16(pal[this->_bgLayerIndex[x] + tilePalette]);
-					}
-					else
-					{
-						index = *tileColorIdx & 0x0F;
-						color = LE_TO_LOCAL_16(pal[index + tilePalette]);
-						this->_RenderPixelSingle<OUTPUTFORMAT, ISDEBUGRENDER, MOSAIC, WILLPERFORMWINDOWTEST, COLOREFFECTDISABLEDHINT>(compInfo, x, color, (index != 0));
-					}
-					
-					x++;
-					xoff++;
-					tileColorIdx--;
-				}
-				
-				for (; x < xfin; tileColorIdx--)
-				{
-					if (ISCUSTOMRENDERINGNEEDED)
-					{
-						this->_bgLayerIndex[x] = *tileColorIdx >> 4;
-						this->_bgLayerColor[x] = LE_TO_LOCAL_16(pal[this->_bgLayerIndex[x] + tilePalette]);
-					}
-					else
-					{
-						index = *tileColorIdx >> 4;
-						color = LE_TO_LOCAL_16(pal[index + tilePalette]);
-						this->_RenderPixelSingle<OUTPUTFORMAT, ISDEBUGRENDER, MOSAIC, WILLPERFORMWINDOWTEST, COLOREFFECTDISABLEDHINT>(compInfo, x, color, (index != 0));
-					}
-					
-					x++;
-					xoff++;
-					
-					if (x < xfin)
-					{
-						if (ISCUSTOMRENDERINGNEEDED)
-						{
-							this->_bgLayerIndex[x] = *tileColorIdx & 0x0F;
-							this->_bgLayerColor[x] = LE_TO_LOCAL_16(pal[this->_bgLayerIndex[x] + tilePalette]);
-						}
-						else
-						{
-							index = *tileColorIdx & 0x0F;
-							color = LE_TO_LOCAL_16(pal[index + tilePalette]);
-							this->_RenderPixelSingle<OUTPUTFORMAT, ISDEBUGRENDER, MOSAIC, WILLPERFORMWINDOWTEST, COLOREFFECTDISABLEDHINT>(compInfo, x, color, (index != 0));
-						}
-						
-						x++;
-						xoff++;
-					}
-				}
-			}
-			else
-			{
-				tileColorIdx += ((xoff & 0x0007) >> 1);
-				
-				if (xoff & 1)
-				{
-					if (ISCUSTOMRENDERINGNEEDED)
-					{
-						this->_bgLayerIndex[x] = *tileColorIdx >> 4;
-						this->_bgLayerColor[x] = LE_TO_LOCAL_16(pal[this->_bgLayerIndex[x] + tilePalette]);
-					}
-					else
-					{
-						index = *tileColorIdx >> 4;
-						color = LE_TO_LOCAL_16(pal[index + tilePalette]);
-						this->_RenderPixelSingle<OUTPUTFORMAT, ISDEBUGRENDER, MOSAIC, WILLPERFORMWINDOWTEST, COLOREFFECTDISABLEDHINT>(compInfo, x, color, (index != 0));
-					}
-					
-					x++;
-					xoff++;
-					tileColorIdx++;
-				}
-				
-				for (; x < xfin; tileColorIdx++)
-				{
-					if (ISCUSTOMRENDERINGNEEDED)
-					{
-						this->_bgLayerIndex[x] = *tileColorIdx & 0x0F;
-						this->_bgLayerColor[x] = LE_TO_LOCAL_16(pal[this->_bgLayerIndex[x] + tilePalette]);
-					}
-					else
-					{
-						index = *tileColorIdx & 0x0F;
-						color = LE_TO_LOCAL_16(pal[index + tilePalette]);
-						this->_RenderPixelSingle<OUTPUTFORMAT, ISDEBUGRENDER, MOSAIC, WILLPERFORMWINDOWTEST, COLOREFFECTDISABLEDHINT>(compInfo, x, color, (index != 0));
-					}
-					
-					x++;
-					xoff++;
-					
-					if (x < xfin)
-					{
-						if (ISCUSTOMRENDERINGNEEDED)
-						{
-							this->_bgLayerIndex[x] = *tileColorIdx >> 4;
-							this->_bgLayerColor[x] = LE_TO_LOCAL_16(pal[this->_bgLayerIndex[x] + tilePalette]);
-						}
-						else
-						{
-							index = *tileColorIdx >> 4;
-							color = LE_TO_LOCAL_16(pal[index + tilePalette]);
-							this->_RenderPixelSingle<OUTPUTFORMAT, ISDEBUGRENDER, MOSAIC, WILLPERFORMWINDOWTEST, COLOREFFECTDISABLEDHINT>(compInfo, x, color, (index != 0));
-						}
-						
-						x++;
-						xoff++;
-					}
-				}
-			}
-		}
+		memset(this->_tileRowCacheKey, 0, sizeof(this->_tileRowCacheKey));
+		this->_tileRowCacheGeneration = MMU.VRAMGeneration;
+	}
+	
+	const bool is16Color = (compInfo.renderState.selectedBGLayer->BGnCNT.PaletteMode == PaletteMode_16x16);
+	const u16 *__restrict pal;
+	u32 extPalMask = 0;
+	u16 yoff;
+	
+	if (is16Color) // color: 16 palette entries
+	{
+		pal = this->_paletteBG;
+		yoff = (YBG & 0x0007) << 2;
 	}
 	else //256-color BG
 	{
-		const u16 *__restrict pal = (DISPCNT.ExBGxPalette_Enable) ? *(compInfo.renderState.selectedBGLayer->extPalette) : this->_paletteBG;
-		const u32 extPalMask = -DISPCNT.ExBGxPalette_Enable;
-		const u16 yoff = (YBG & 0x0007) << 3;
-		size_t line_dir;
+		pal = (DISPCNT.ExBGxPalette_Enable) ? *(compInfo.renderState.selectedBGLayer->extPalette) : this->_paletteBG;
+		extPalMask = -DISPCNT.ExBGxPalette_Enable;
+		yoff = (YBG & 0x0007) << 3;
+	}
+	
+	for (size_t xfin = pixCountLo; x < lineWidth; xfin = std::min<u16>(x+8, lineWidth))
+	{
+		const TILEENTRY tileEntry = this->_GetTileEntry(map, xoff, wmask);
+		const u32 rowAddress = (is16Color) ? tile + (tileEntry.bits.TileNum * 0x20) + ((tileEntry.bits.VFlip) ? (7*4)-yoff : yoff)
+		                                   : tile + (tileEntry.bits.TileNum * 0x40) + ((tileEntry.bits.VFlip) ? (7*8)-yoff : yoff);
+		
+		// Rows are at least 4-byte aligned, which leaves the low bits free for the flip and
+		// color depth. (The palette bits don't affect the indices.)
+		const u32 rowKey = rowAddress | tileEntry.bits.HFlip | ((is16Color) ? 0 : 2);
+		const size_t rowSlot = (rowAddress >> 2) & (GPU_TILEROW_CACHE_SIZE - 1);
 		
-		for (size_t xfin = pixCountLo; x < lineWidth; xfin = std::min<u16>(x+8, lineWidth))
+		if (this->_tileRowCacheKey[rowSlot] != rowKey)
 		{
-			const TILEENTRY tileEntry = this->_GetTileEntry(map, xoff, wmask);
-			const u16 *__restrict tilePal = (u16 *)((u8 *)pal + ((tileEntry.bits.Palette<<9) & extPalMask));
-			const u8 *__restrict tileColorIdx = (u8 *)MMU_gpu_map(tile + (tileEntry.bits.TileNum * 0x40) + ((tileEntry.bits.VFlip) ? (7*8)-yoff : yoff));
+			this->_tileRowCacheKey[rowSlot] = rowKey;
 			
-			if (tileEntry.bits.HFlip)
+			const u8 *__restrict tileColorIdx = (u8 *)MMU_gpu_map(rowAddress);
+			this->_tileRowCacheIndices[rowSlot] = (is16Color) ? _DecodeTileRow4bpp(LE_TO_LOCAL_32(*(u32 *)tileColorIdx), tileEntry.bits.HFlip)
+			                                                  : _DecodeTileRow8bpp(LE_TO_LOCAL_64(*(u64 *)tileColorIdx), tileEntry.bits.HFlip);
+		}
+		
+		CACHE_ALIGN u8 tileRow[8];
+		*(u64 *)tileRow = LOCAL_TO_LE_64(this->_tileRowCacheIndices[rowSlot]);
+		
+		const u16 *__restrict tilePal = (is16Color) ? pal + (tileEntry.bits.Palette * 16) : (u16 *)((u8 *)pal + ((tileEntry.bits.Palette<<9) & extPalMask));
+		
+		for (size_t i = (xoff & 0x0007); x < xfin; x++, xoff++, i++)
+		{
+			if (ISCUSTOMRENDERINGNEEDED)
 			{
-				tileColorIdx += (7 - (xoff & 0x0007));
-				line_dir = -1;
+				this->_bgLayerIndex[x] = tileRow[i];
+				this->_bgLayerColor[x] = LE_TO_LOCAL_16(tilePal[tileRow[i]]);
 			}
 			else
 			{
-				tileColorIdx += (xoff & 0x0007);
-				line_dir = 1;
-			}
-			
-			for (; x < xfin; x++, xoff++, tileColorIdx += line_dir)
-			{
-				if (ISCUSTOMRENDERINGNEEDED)
-				{
-					this->_bgLayerIndex[x] = *tileColorIdx;
-					this->_bgLayerColor[x] = LE_TO_LOCAL_16(tilePal[this->_bgLayerIndex[x]]);
-				}
-				else
-				{
-					const u8 index = *tileColorIdx;
-					const u16 color = LE_TO_LOCAL_16(tilePal[index]);
-					this->_RenderPixelSingle<OUTPUTFORMAT, ISDEBUGRENDER, MOSAIC, WILLPERFORMWINDOWTEST, COLOREFFECTDISABLEDHINT>(compInfo, x, color, (index != 0));
-				}
+				const u8 index = tileRow[i];
+				const u16 color = LE_TO_LOCAL_16(tilePal[index]);
+				this->_RenderPixelSingle<OUTPUTFORMAT, ISDEBUGRENDER, MOSAIC, WILLPERFORMWINDOWTEST, COLOREFFECTDISABLEDHINT>(compInfo, x, color, (index != 0));
 			}
 		}
 	}
@@ -3253,68 +3187,63 @@ void GPUEngineBase::_RenderSpriteBMP(GPUEngineCompositorInfo &compInfo, const u8
 	}
 }
 
-template<bool ISDEBUGRENDER>
-void GPUEngineBase::_RenderSprite256(GPUEngineCompositorInfo &compInfo, const u8 spriteNum, u16 *__restrict dst, const u32 srcadr, const u16 *__restrict pal, u8 *__restrict dst_alpha, u8 *__restrict typeTab, u8 *__restrict prioTab, const u8 prio, const size_t lg, size_t sprX, size_t x, const s32 xdir, const u8 alpha)
+// Fetches the palette indices of a span of one row of a non-rotated sprite, in screen order.
+// The row is read a whole tile at a time, since each tile row is contiguous in VRAM.
+static FORCEINLINE void _SpriteFetchRowIndices(u8 *__restrict outIndex, const u32 srcadr, const bool is256Color, const size_t lg, const size_t x, const s32 xdir)
 {
-	for (size_t i = 0; i < lg; i++, ++sprX, x += xdir)
+	// Non-rotated sprites are at most 64 pixels wide.
+	CACHE_ALIGN u8 rowIndex[64];
+	
+	if (lg == 0)
 	{
-		const u32 adr = srcadr + (x & 0x7) + ((x & 0xFFF8) << 3);
-		const u8 *__restrict src = (u8 *)MMU_gpu_map(adr);
-		const u8 palette_entry = *src;
-
-		//a zero value suppresses the pixel from processing entirely; it doesnt exist
-		if (ISDEBUGRENDER)
+		return;
+	}
+	
+	const size_t xFirst = (xdir == 1) ? x : x - (lg - 1);
+	const size_t tileFirst = xFirst >> 3;
+	const size_t tileLast = (xFirst + lg - 1) >> 3;
+	
+	for (size_t tile = tileFirst; tile <= tileLast; tile++)
+	{
+		if (is256Color)
 		{
-			if (palette_entry > 0)
-			{
-				dst[sprX] = LE_TO_LOCAL_16(pal[palette_entry]);
-			}
+			const u8 *__restrict src = (u8 *)MMU_gpu_map(srcadr + (tile << 6));
+			*(u64 *)(rowIndex + (tile << 3)) = LOCAL_TO_LE_64( _DecodeTileRow8bpp(LE_TO_LOCAL_64(*(u64 *)src), false) );
 		}
 		else
 		{
-			if ((palette_entry > 0) && (prio < prioTab[sprX]))
-			{
-				dst[sprX] = LE_TO_LOCAL_16(pal[palette_entry]);
-				dst_alpha[sprX] = 0xFF;
-				typeTab[sprX] = (alpha ? OBJMode_Transparent : OBJMode_Normal);
-				prioTab[sprX] = prio;
-				this->_sprNum[sprX] = spriteNum;
-			}
+			const u8 *__restrict src = (u8 *)MMU_gpu_map(srcadr + (tile << 5));
+			*(u64 *)(rowIndex + (tile << 3)) = LOCAL_TO_LE_64( _DecodeTileRow4bpp(LE_TO_LOCAL_32(*(u32 *)src), false) );
 		}
 	}
+	
+	if (xdir == 1)
+	{
+		memcpy(outIndex, rowIndex + x, lg);
+	}
+	else
+	{
+		for (size_t i = 0; i < lg; i++)
+		{
+			outIndex[i] = rowIndex[x - i];
+		}
+	}
+}
+
+template<bool ISDEBUGRENDER>
+void GPUEngineBase::_RenderSprite256(GPUEngineCompositorInfo &compInfo, const u8 spriteNum, u16 *__restrict dst, const u32 srcadr, const u16 *__restrict pal, u8 *__restrict dst_alpha, u8 *__restrict typeTab, u8 *__restrict prioTab, const u8 prio, const size_t lg, size_t sprX, size_t x, const s32 xdir, const u8 alpha)
+{
+	CACHE_ALIGN u8 palIndex[64];
+	_SpriteFetchRowIndices(palIndex, srcadr, true, lg, x, xdir);
+	SpriteSpan_Merge<ISDEBUGRENDER>(spriteNum, dst, palIndex, pal, dst_alpha, typeTab, prioTab, this->_sprNum, prio, lg, sprX, (alpha) ? OBJMode_Transparent : OBJMode_Normal);
 }
 
 template<bool ISDEBUGRENDER>
 void GPUEngineBase::_RenderSprite16(GPUEngineCompositorInfo &compInfo, const u8 spriteNum, u16 *__restrict dst, const u32 srcadr, const u16 *__restrict pal, u8 *__restrict dst_alpha, u8 *__restrict typeTab, u8 *__restrict prioTab, const u8 prio, const size_t lg, size_t sprX, size_t x, const s32 xdir, const u8 alpha)
 {
-	for (size_t i = 0; i < lg; i++, ++sprX, x += xdir)
-	{
-		const u16 x1 = x >> 1;
-		const u32 adr = srcadr + (x1 & 0x3) + ((x1 & 0xFFFC) << 3);
-		const u8 *__restrict src = (u8 *)MMU_gpu_map(adr);
-		const u8 palette = *src;
-		const u8 palette_entry = (x & 1) ? palette >> 4 : palette & 0xF;
-		
-		//a zero value suppresses the pixel from processing entirely; it doesnt exist
-		if (ISDEBUGRENDER)
-		{
-			if (palette_entry > 0)
-			{
-				dst[sprX] = LE_TO_LOCAL_16(pal[palette_entry]);
-			}
-		}
-		else
-		{
-			if ((palette_entry > 0) && (prio < prioTab[sprX]))
-			{
-				dst[sprX] = LE_TO_LOCAL_16(pal[palette_entry]);
-				dst_alpha[sprX] = 0xFF;
-				typeTab[sprX] = (alpha ? OBJMode_Transparent : OBJMode_Normal);
-				prioTab[sprX] = prio;
-				this->_sprNum[sprX] = spriteNum;
-			}
-		}
-	}
+	CACHE_ALIGN u8 palIndex[64];
+	_SpriteFetchRowIndices(palIndex, srcadr, false, lg, x, xdir);
+	SpriteSpan_Merge<ISDEBUGRENDER>(spriteNum, dst, palIndex, pal, dst_alpha, typeTab, prioTab, this->_sprNum, prio, lg, sprX, (alpha) ? OBJMode_Transparent : OBJMode_Normal);
 }
 
 void GPUEngineBase::_RenderSpriteWin(const u8 *src, const bool col256, const size_t lg, size_t sprX, size_t x, const s32 xdir)
@@ -3426,13 +3355,126 @@ u32 GPUEngineBase::_SpriteAddressBMP(GPUEngineCompositorInfo &compInfo, const OA
 	}
 }
 
+// Decodes a single OAM entry. Returns false if the sprite can't show up on any line.
+bool GPUEngineBase::_SpriteDecode(const GPUEngineRenderState &renderState, const size_t spriteIndex, SpriteDecodedInfo &outInfo)
+{
+	OAMAttributes &spriteInfo = outInfo.attr;
+	spriteInfo = this->_oamList[spriteIndex];
+	
+	// Check if sprite is disabled before everything
+	if (spriteInfo.RotScale == 0 && spriteInfo.Disable != 0)
+		return false;
+	
+	// Must explicitly convert endianness with attributes 1 and 2.
+	spriteInfo.attr[1] = LOCAL_TO_LE_16(spriteInfo.attr[1]);
+	spriteInfo.attr[2] = LOCAL_TO_LE_16(spriteInfo.attr[2]);
+	
+	outInfo.size = GPUEngineBase::_sprSizeTab[spriteInfo.Size][spriteInfo.Shape];
+	outInfo.fieldWidth = outInfo.size.width;
+	outInfo.fieldHeight = outInfo.size.height;
+	
+	if (spriteInfo.RotScale != 0)
+	{
+		// If we are using double size mode, double our control vars
+		if (spriteInfo.DoubleSize != 0)
+		{
+			outInfo.fieldWidth <<= 1;
+			outInfo.fieldHeight <<= 1;
+		}
+		
+		// Get which four parameter block is assigned to this sprite
+		const u8 blockparameter = (spriteInfo.RotScaleIndex + (spriteInfo.HFlip << 3) + (spriteInfo.VFlip << 4)) * 4;
+		
+		// Get rotation/scale parameters
+		outInfo.dx  = LE_TO_LOCAL_16((s16)this->_oamList[blockparameter+0].attr3);
+		outInfo.dmx = LE_TO_LOCAL_16((s16)this->_oamList[blockparameter+1].attr3);
+		outInfo.dy  = LE_TO_LOCAL_16((s16)this->_oamList[blockparameter+2].attr3);
+		outInfo.dmy = LE_TO_LOCAL_16((s16)this->_oamList[blockparameter+3].attr3);
+	}
+	else
+	{
+		outInfo.dx  = 0;
+		outInfo.dmx = 0;
+		outInfo.dy  = 0;
+		outInfo.dmy = 0;
+	}
+	
+	// spriteBoundary is always 5 in 2D mapping mode, so this works for both mapping modes.
+	outInfo.tileAddress = this->_sprMem + (spriteInfo.TileIndex << renderState.spriteBoundary);
+	
+	// A sprite that is off the screen x-wise stays off the screen on every line.
+	const s32 sprX = spriteInfo.X;
+	if ((sprX == GPU_FRAMEBUFFER_NATIVE_WIDTH) || (sprX + (s32)outInfo.fieldWidth <= 0))
+		return false;
+	
+	return true;
+}
+
+// Rebuilds the decoded sprite attributes and, for each line, the list of sprites that cross it.
+// This only needs to happen again once OAM or the sprite mapping mode changes.
+void GPUEngineBase::_SpriteUpdateLineLists(const GPUEngineRenderState &renderState)
+{
+	memset(this->_sprLineCount, 0, sizeof(this->_sprLineCount));
+	
+	// Walk the sprites in OAM order, so that each line's list stays in the order the sprites need to be drawn in.
+	for (size_t i = 0; i < 128; i++)
+	{
+		SpriteDecodedInfo &sprInfo = this->_sprDecoded[i];
+		if (!this->_SpriteDecode(renderState, i, sprInfo))
+			continue;
+		
+		// Sprites wrap around vertically at line 256.
+		for (size_t y = 0; y < sprInfo.fieldHeight; y++)
+		{
+			const size_t l = (sprInfo.attr.Y + y) & 0xFF;
+			if (l >= GPU_FRAMEBUFFER_NATIVE_HEIGHT)
+				continue;
+			
+			this->_sprLineList[l][this->_sprLineCount[l]++] = (u8)i;
+		}
+	}
+	
+	this->_needUpdateSpriteLists = false;
+}
+
 template <bool ISDEBUGRENDER>
 void GPUEngineBase::_SpriteRender(GPUEngineCompositorInfo &compInfo, u16 *__restrict dst, u8 *__restrict dst_alpha, u8 *__restrict typeTab, u8 *__restrict prioTab)
 {
+	const SpriteDecodedInfo *sprInfoList;
+	const u8 *sprIndexList;
+	size_t sprCount;
+	
+	SpriteDecodedInfo debugInfoList[128];
+	u8 debugIndexList[128];
+	
+	if (ISDEBUGRENDER)
+	{
+		// The debug viewer can ask for any line at any time, so decode OAM separately instead of
+		// touching the line lists that the emulation is using.
+		sprCount = 0;
+		for (size_t i = 0; i < 128; i++)
+		{
+			if (this->_SpriteDecode(compInfo.renderState, i, debugInfoList[i]))
+				debugIndexList[sprCount++] = (u8)i;
+		}
+		
+		sprInfoList = debugInfoList;
+		sprIndexList = debugIndexList;
+	}
+	else
+	{
+		if (this->_needUpdateSpriteLists)
+			this->_SpriteUpdateLineLists(compInfo.renderState);
+		
+		sprInfoList = this->_sprDecoded;
+		sprIndexList = this->_sprLineList[compInfo.line.indexNative];
+		sprCount = this->_sprLineCount[compInfo.line.indexNative];
+	}
+	
 	if (compInfo.renderState.spriteRenderMode == SpriteRenderMode_Sprite1D)
-		this->_SpriteRenderPerform<SpriteRenderMode_Sprite1D, ISDEBUGRENDER>(compInfo, dst, dst_alpha, typeTab, prioTab);
+		this->_SpriteRenderPerform<SpriteRenderMode_Sprite1D, ISDEBUGRENDER>(compInfo, sprInfoList, sprIndexList, sprCount, dst, dst_alpha, typeTab, prioTab);
 	else
-		this->_SpriteRenderPerform<SpriteRenderMode_Sprite2D, ISDEBUGRENDER>(compInfo, dst, dst_alpha, typeTab, prioTab);
+		this->_SpriteRenderPerform<SpriteRenderMode_Sprite2D, ISDEBUGRENDER>(compInfo, sprInfoList, sprIndexList, sprCount, dst, dst_alpha, typeTab, prioTab);
 }
 
 void GPUEngineBase::SpriteRenderDebug(const u16 lineIndex, u16 *dst)
@@ -3473,33 +3515,15 @@ void GPUEngineBase::SpriteRenderDebug(const u16 lineIndex, u16 *dst)
 }
 
 template <SpriteRenderMode MODE, bool ISDEBUGRENDER>
-void GPUEngineBase::_SpriteRenderPerform(GPUEngineCompositorInfo &compInfo, u16 *__restrict dst, u8 *__restrict dst_alpha, u8 *__restrict typeTab, u8 *__restrict prioTab)
+void GPUEngineBase::_SpriteRenderPerform(GPUEngineCompositorInfo &compInfo, const SpriteDecodedInfo *__restrict sprInfoList, const u8 *__restrict sprIndexList, const size_t sprCount, u16 *__restrict dst, u8 *__restrict dst_alpha, u8 *__restrict typeTab, u8 *__restrict prioTab)
 {
 	const IOREG_DISPCNT &DISPCNT = this->_IORegisterMap->DISPCNT;
-	size_t cost = 0;
 	
-	for (size_t i = 0; i < 128; i++)
+	for (size_t n = 0; n < sprCount; n++)
 	{
-		OAMAttributes spriteInfo = this->_oamList[i];
-
-		//for each sprite:
-		if (cost >= 2130)
-		{
-			//out of sprite rendering time
-			//printf("sprite overflow!\n");
-			//return;		
-		}
-
-		//do we incur a cost if a sprite is disabled?? we guess so.
-		cost += 2;
-		
-		// Check if sprite is disabled before everything
-		if (spriteInfo.RotScale == 0 && spriteInfo.Disable != 0)
-			continue;
-		
-		// Must explicitly convert endianness with attributes 1 and 2.
-		spriteInfo.attr[1] = LOCAL_TO_LE_16(spriteInfo.attr[1]);
-		spriteInfo.attr[2] = LOCAL_TO_LE_16(spriteInfo.attr[2]);
+		const size_t i = sprIndexList[n];
+		const SpriteDecodedInfo &sprInfo = sprInfoList[i];
+		const OAMAttributes &spriteInfo = sprInfo.attr;
 		
 		const OBJMode objMode = (OBJMode)spriteInfo.Mode;
 
@@ -3517,49 +3541,31 @@ void GPUEngineBase::_SpriteRenderPerform(GPUEngineCompositorInfo &compInfo, u16
 		
 		if (spriteInfo.RotScale != 0)
 		{
-			s32		fieldX, fieldY, auxX, auxY, realX, realY, offset;
-			u8		blockparameter;
-			s16		dx, dmx, dy, dmy;
+			s32		auxX, auxY, realX, realY, offset;
 			u16		colour;
 
 			// Get sprite positions and size
 			sprX = spriteInfo.X;
 			sprY = spriteInfo.Y;
-			sprSize = GPUEngineBase::_sprSizeTab[spriteInfo.Size][spriteInfo.Shape];
+			sprSize = sprInfo.size;
 
-			// Copy sprite size, to check change it if needed
-			fieldX = sprSize.width;
-			fieldY = sprSize.height;
-			lg = sprSize.width;
-
-			// If we are using double size mode, double our control vars
-			if (spriteInfo.DoubleSize != 0)
-			{
-				fieldX <<= 1;
-				fieldY <<= 1;
-				lg <<= 1;
-			}
+			// Field size, which is already doubled in double size mode
+			const s32 fieldX = sprInfo.fieldWidth;
+			const s32 fieldY = sprInfo.fieldHeight;
+			lg = fieldX;
 
 			//check if the sprite is visible y-wise. unfortunately our logic for x and y is different due to our scanline based rendering
 			//tested thoroughly by many large sprites in Super Robot Wars K which wrap around the screen
+			//(the line lists already did this, but the debug renderer still relies on it)
 			y = (compInfo.line.indexNative - sprY) & 0xFF;
 			if (y >= fieldY)
 				continue;
 
-			//check if sprite is visible x-wise.
-			if ((sprX == GPU_FRAMEBUFFER_NATIVE_WIDTH) || (sprX + fieldX <= 0))
-				continue;
-
-			cost += (sprSize.width * 2) + 10;
-
-			// Get which four parameter block is assigned to this sprite
-			blockparameter = (spriteInfo.RotScaleIndex + (spriteInfo.HFlip << 3) + (spriteInfo.VFlip << 4)) * 4;
-
 			// Get rotation/scale parameters
-			dx  = LE_TO_LOCAL_16((s16)this->_oamList[blockparameter+0].attr3);
-			dmx = LE_TO_LOCAL_16((s16)this->_oamList[blockparameter+1].attr3);
-			dy  = LE_TO_LOCAL_16((s16)this->_oamList[blockparameter+2].attr3);
-			dmy = LE_TO_LOCAL_16((s16)this->_oamList[blockparameter+3].attr3);
+			const s16 dx  = sprInfo.dx;
+			const s16 dmx = sprInfo.dmx;
+			const s16 dy  = sprInfo.dy;
+			const s16 dmy = sprInfo.dmy;
 			
 			// Calculate fixed point 8.8 start offsets
 			realX = (sprSize.width  << 7) - (fieldX >> 1)*dx - (fieldY >> 1)*dmx + y*dmx;
@@ -3582,46 +3588,58 @@ void GPUEngineBase::_SpriteRenderPerform(GPUEngineCompositorInfo &compInfo, u16
 				if (sprX + fieldX > GPU_FRAMEBUFFER_NATIVE_WIDTH)
 					lg = GPU_FRAMEBUFFER_NATIVE_WIDTH - sprX;
 			}
+			
+			// The texture coordinates move linearly along the line, so work out up front which part of the
+			// line lands inside the sprite instead of bounds checking every pixel.
+			s32 jBegin = 0;
+			s32 jEnd = lg;
+			SpriteSpan_ClipAffine(realX, dx, sprSize.width << 8, jBegin, jEnd);
+			SpriteSpan_ClipAffine(realY, dy, sprSize.height << 8, jBegin, jEnd);
+			
+			if (jBegin >= jEnd)
+				continue;
+			
+			realX += jBegin * dx;
+			realY += jBegin * dy;
+			sprX += jBegin;
+			lg = jEnd - jBegin;
 
 			// If we are using 1 palette of 256 colours
 			if (spriteInfo.PaletteMode == PaletteMode_1x256)
 			{
-				src = (u8 *)MMU_gpu_map(this->_sprMem + (spriteInfo.TileIndex << compInfo.renderState.spriteBoundary));
+				src = (u8 *)MMU_gpu_map(sprInfo.tileAddress);
 
 				// If extended palettes are set, use them
 				pal = (DISPCNT.ExOBJPalette_Enable) ? (u16 *)(MMU.ObjExtPal[this->_engineID][0]+(spriteInfo.PaletteIndex*ADDRESS_STEP_512B)) : this->_paletteOBJ;
 
 				for (size_t j = 0; j < lg; ++j, ++sprX)
 				{
-					// Get the integer part of the fixed point 8.8, and check if it lies inside the sprite data
+					// Get the integer part of the fixed point 8.8
 					auxX = (realX >> 8);
 					auxY = (realY >> 8);
 
-					if (auxX >= 0 && auxY >= 0 && auxX < sprSize.width && auxY < sprSize.height)
-					{
-						if (MODE == SpriteRenderMode_Sprite2D)
-							offset = (auxX&0x7) + ((auxX&0xFFF8)<<3) + ((auxY>>3)<<10) + ((auxY&0x7)*8);
-						else
-							offset = (auxX&0x7) + ((auxX&0xFFF8)<<3) + ((auxY>>3)*sprSize.width*8) + ((auxY&0x7)*8);
+					if (MODE == SpriteRenderMode_Sprite2D)
+						offset = (auxX&0x7) + ((auxX&0xFFF8)<<3) + ((auxY>>3)<<10) + ((auxY&0x7)*8);
+					else
+						offset = (auxX&0x7) + ((auxX&0xFFF8)<<3) + ((auxY>>3)*sprSize.width*8) + ((auxY&0x7)*8);
 
-						colour = src[offset];
-						
-						if (ISDEBUGRENDER)
+					colour = src[offset];
+					
+					if (ISDEBUGRENDER)
+					{
+						if (colour)
 						{
-							if (colour)
-							{
-								dst[sprX] = LE_TO_LOCAL_16(pal[colour]);
-							}
+							dst[sprX] = LE_TO_LOCAL_16(pal[colour]);
 						}
-						else
+					}
+					else
+					{
+						if (colour && (prio < prioTab[sprX]))
 						{
-							if (colour && (prio < prioTab[sprX]))
-							{
-								dst[sprX] = LE_TO_LOCAL_16(pal[colour]);
-								dst_alpha[sprX] = 0xFF;
-								typeTab[sprX] = objMode;
-								prioTab[sprX] = prio;
-							}
+							dst[sprX] = LE_TO_LOCAL_16(pal[colour]);
+							dst_alpha[sprX] = 0xFF;
+							typeTab[sprX] = objMode;
+							prioTab[sprX] = prio;
 						}
 					}
 
@@ -3641,42 +3659,39 @@ void GPUEngineBase::_SpriteRenderPerform(GPUEngineCompositorInfo &compInfo, u16
 
 				for (size_t j = 0; j < lg; ++j, ++sprX)
 				{
-					// Get the integer part of the fixed point 8.8, and check if it lies inside the sprite data
+					// Get the integer part of the fixed point 8.8
 					auxX = realX >> 8;
 					auxY = realY >> 8;
 
 					//this is all very slow, and so much dup code with other rotozoomed modes.
 					//dont bother fixing speed until this whole thing gets reworked
 
-					if (auxX >= 0 && auxY >= 0 && auxX < sprSize.width && auxY < sprSize.height)
-					{
-						if (DISPCNT.OBJ_BMP_2D_dim)
-							//tested by knights in the nightmare
-							offset = (this->_SpriteAddressBMP(compInfo, spriteInfo, sprSize, auxY)-srcadr)/2+auxX;
-						else //tested by lego indiana jones (somehow?)
-							//tested by buffy sacrifice damage blood splatters in corner
-							offset = auxX + (auxY*sprSize.width);
+					if (DISPCNT.OBJ_BMP_2D_dim)
+						//tested by knights in the nightmare
+						offset = (this->_SpriteAddressBMP(compInfo, spriteInfo, sprSize, auxY)-srcadr)/2+auxX;
+					else //tested by lego indiana jones (somehow?)
+						//tested by buffy sacrifice damage blood splatters in corner
+						offset = auxX + (auxY*sprSize.width);
 
 
-						u16* mem = (u16*)MMU_gpu_map(srcadr + (offset<<1));
-						colour = LE_TO_LOCAL_16(*mem);
-						
-						if (ISDEBUGRENDER)
+					u16* mem = (u16*)MMU_gpu_map(srcadr + (offset<<1));
+					colour = LE_TO_LOCAL_16(*mem);
+					
+					if (ISDEBUGRENDER)
+					{
+						if (colour & 0x8000)
 						{
-							if (colour & 0x8000)
-							{
-								dst[sprX] = colour;
-							}
+							dst[sprX] = colour;
 						}
-						else
+					}
+					else
+					{
+						if ((colour & 0x8000) && (prio < prioTab[sprX]))
 						{
-							if ((colour & 0x8000) && (prio < prioTab[sprX]))
-							{
-								dst[sprX] = colour;
-								dst_alpha[sprX] = spriteInfo.PaletteIndex;
-								typeTab[sprX] = objMode;
-								prioTab[sprX] = prio;
-							}
+							dst[sprX] = colour;
+							dst_alpha[sprX] = spriteInfo.PaletteIndex;
+							typeTab[sprX] = objMode;
+							prioTab[sprX] = prio;
 						}
 					}
 
@@ -3688,58 +3703,47 @@ void GPUEngineBase::_SpriteRenderPerform(GPUEngineCompositorInfo &compInfo, u16
 			// Rotozoomed 16/16 palette
 			else
 			{
-				if (MODE == SpriteRenderMode_Sprite2D)
-				{
-					src = (u8 *)MMU_gpu_map(this->_sprMem + (spriteInfo.TileIndex << 5));
-				}
-				else
-				{
-					src = (u8 *)MMU_gpu_map(this->_sprMem + (spriteInfo.TileIndex << compInfo.renderState.spriteBoundary));
-				}
-				
+				src = (u8 *)MMU_gpu_map(sprInfo.tileAddress);
 				pal = this->_paletteOBJ + (spriteInfo.PaletteIndex << 4);
 
 				for (size_t j = 0; j < lg; ++j, ++sprX)
 				{
-					// Get the integer part of the fixed point 8.8, and check if it lies inside the sprite data
+					// Get the integer part of the fixed point 8.8
 					auxX = realX >> 8;
 					auxY = realY >> 8;
 
-					if (auxX >= 0 && auxY >= 0 && auxX < sprSize.width && auxY < sprSize.height)
-					{
-						if (MODE == SpriteRenderMode_Sprite2D)
-							offset = ((auxX>>1)&0x3) + (((auxX>>1)&0xFFFC)<<3) + ((auxY>>3)<<10) + ((auxY&0x7)*4);
-						else
-							offset = ((auxX>>1)&0x3) + (((auxX>>1)&0xFFFC)<<3) + ((auxY>>3)*sprSize.width)*4 + ((auxY&0x7)*4);
-						
-						colour = src[offset];
+					if (MODE == SpriteRenderMode_Sprite2D)
+						offset = ((auxX>>1)&0x3) + (((auxX>>1)&0xFFFC)<<3) + ((auxY>>3)<<10) + ((auxY&0x7)*4);
+					else
+						offset = ((auxX>>1)&0x3) + (((auxX>>1)&0xFFFC)<<3) + ((auxY>>3)*sprSize.width)*4 + ((auxY&0x7)*4);
+					
+					colour = src[offset];
 
-						// Get 4bits value from the readed 8bits
-						if (auxX&1)	colour >>= 4;
-						else		colour &= 0xF;
-						
-						if (ISDEBUGRENDER)
+					// Get 4bits value from the readed 8bits
+					if (auxX&1)	colour >>= 4;
+					else		colour &= 0xF;
+					
+					if (ISDEBUGRENDER)
+					{
+						if (colour)
 						{
-							if (colour)
-							{
-								dst[sprX] = LE_TO_LOCAL_16(pal[colour]);
-							}
+							dst[sprX] = LE_TO_LOCAL_16(pal[colour]);
 						}
-						else
+					}
+					else
+					{
+						if (colour && (prio < prioTab[sprX]))
 						{
-							if (colour && (prio < prioTab[sprX]))
+							if (objMode == OBJMode_Window)
 							{
-								if (objMode == OBJMode_Window)
-								{
-									this->_sprWin[sprX] = 1;
-								}
-								else
-								{
-									dst[sprX] = LE_TO_LOCAL_16(pal[colour]);
-									dst_alpha[sprX] = 0xFF;
-									typeTab[sprX] = objMode;
-									prioTab[sprX] = prio;
-								}
+								this->_sprWin[sprX] = 1;
+							}
+							else
+							{
+								dst[sprX] = LE_TO_LOCAL_16(pal[colour]);
+								dst_alpha[sprX] = 0xFF;
+								typeTab[sprX] = objMode;
+								prioTab[sprX] = prio;
 							}
 						}
 					}
@@ -3755,23 +3759,21 @@ void GPUEngineBase::_SpriteRenderPerform(GPUEngineCompositorInfo &compInfo, u16
 			if (!this->_ComputeSpriteVars(compInfo, spriteInfo, sprSize, sprX, sprY, x, y, lg, xdir))
 				continue;
 
-			cost += sprSize.width;
-
 			if (objMode == OBJMode_Window)
 			{
 				if (MODE == SpriteRenderMode_Sprite2D)
 				{
 					if (spriteInfo.PaletteMode == PaletteMode_1x256)
-						src = (u8 *)MMU_gpu_map(this->_sprMem + ((spriteInfo.TileIndex)<<5) + ((y>>3)<<10) + ((y&0x7)*8));
+						src = (u8 *)MMU_gpu_map(sprInfo.tileAddress + ((y>>3)<<10) + ((y&0x7)*8));
 					else
-						src = (u8 *)MMU_gpu_map(this->_sprMem + ((spriteInfo.TileIndex)<<5) + ((y>>3)<<10) + ((y&0x7)*4));
+						src = (u8 *)MMU_gpu_map(sprInfo.tileAddress + ((y>>3)<<10) + ((y&0x7)*4));
 				}
 				else
 				{
 					if (spriteInfo.PaletteMode == PaletteMode_1x256)
-						src = (u8 *)MMU_gpu_map(this->_sprMem + (spriteInfo.TileIndex<<compInfo.renderState.spriteBoundary) + ((y>>3)*sprSize.width*8) + ((y&0x7)*8));
+						src = (u8 *)MMU_gpu_map(sprInfo.tileAddress + ((y>>3)*sprSize.width*8) + ((y&0x7)*8));
 					else
-						src = (u8 *)MMU_gpu_map(this->_sprMem + (spriteInfo.TileIndex<<compInfo.renderState.spriteBoundary) + ((y>>3)*sprSize.width*4) + ((y&0x7)*4));
+						src = (u8 *)MMU_gpu_map(sprInfo.tileAddress + ((y>>3)*sprSize.width*4) + ((y&0x7)*4));
 				}
 
 				this->_RenderSpriteWin(src, (spriteInfo.PaletteMode == PaletteMode_1x256), lg, sprX, x, xdir);
@@ -3788,9 +3790,9 @@ void GPUEngineBase::_SpriteRenderPerform(GPUEngineCompositorInfo &compInfo, u16
 			else if (spriteInfo.PaletteMode == PaletteMode_1x256) //256 colors
 			{
 				if (MODE == SpriteRenderMode_Sprite2D)
-					srcadr = this->_sprMem + ((spriteInfo.TileIndex)<<5) + ((y>>3)<<10) + ((y&0x7)*8);
+					srcadr = sprInfo.tileAddress + ((y>>3)<<10) + ((y&0x7)*8);
 				else
-					srcadr = this->_sprMem + (spriteInfo.TileIndex<<compInfo.renderState.spriteBoundary) + ((y>>3)*sprSize.width*8) + ((y&0x7)*8);
+					srcadr = sprInfo.tileAddress + ((y>>3)*sprSize.width*8) + ((y&0x7)*8);
 				
 				pal = (DISPCNT.ExOBJPalette_Enable) ? (u16 *)(MMU.ObjExtPal[this->_engineID][0]+(spriteInfo.PaletteIndex*ADDRESS_STEP_512B)) : this->_paletteOBJ;
 				this->_RenderSprite256<ISDEBUGRENDER>(compInfo, i, dst, srcadr, pal, dst_alpha, typeTab, prioTab, prio, lg, sprX, x, xdir, (objMode == OBJMode_Transparent));
@@ -3799,11 +3801,11 @@ void GPUEngineBase::_SpriteRenderPerform(GPUEngineCompositorInfo &compInfo, u16
 			{
 				if (MODE == SpriteRenderMode_Sprite2D)
 				{
-					srcadr = this->_sprMem + ((spriteInfo.TileIndex)<<5) + ((y>>3)<<10) + ((y&0x7)*4);
+					srcadr = sprInfo.tileAddress + ((y>>3)<<10) + ((y&0x7)*4);
 				}
 				else
 				{
-					srcadr = this->_sprMem + (spriteInfo.TileIndex<<compInfo.renderState.spriteBoundary) + ((y>>3)*sprSize.width*4) + ((y&0x7)*4);
+					srcadr = sprInfo.tileAddress + ((y>>3)*sprSize.width*4) + ((y&0x7)*4);
 				}
 				
 				pal = this->_paletteOBJ + (spriteInfo.PaletteIndex << 4);
@@ -3840,6 +3842,30 @@ void GPUEngineBase::_RenderLine_Layers(const size_t l)
 	compInfo.target.lineColor32 = (FragmentColor *)compInfo.target.lineColorHeadNative;
 	compInfo.target.lineLayerID = compInfo.target.lineLayerIDHead;
 	
+	// Optimization: If nothing that this line depends on has changed since the last time it was rendered, then just
+	// reuse the pixels from back then. Only lines that go straight to the native output buffer are eligible. Mosaic
+	// carries state from one line to the next, and the 3D layer and display capture bring in data from outside the
+	// 2D engine, so lines using those always get rendered.
+	const bool isLineCacheable = (compInfo.renderState.displayOutputMode == GPUDisplayMode_Normal) &&
+	                             !compInfo.renderState.isBGMosaicSet &&
+	                             !compInfo.renderState.isOBJMosaicSet &&
+	                             ( (this->_engineID != GPUEngineID_Main) || (!GPU->GetEngineMain()->WillRender3DLayer() && !GPU->GetEngineMain()->WillDisplayCapture(l)) );
+	const size_t lineBytes = GPU_FRAMEBUFFER_NATIVE_WIDTH * dispInfo.pixelBytes;
+	u8 *lineCache = this->_lineCacheNative + (l * GPU_FRAMEBUFFER_NATIVE_WIDTH * sizeof(FragmentColor));
+	GPUEngineLineSignature lineSignature;
+	
+	if (isLineCacheable)
+	{
+		this->_MakeLineSignature(lineSignature);
+		
+		if ( this->_isLineSignatureValid[l] && (memcmp(&lineSignature, &this->_lineSignature[l], sizeof(GPUEngineLineSignature)) == 0) )
+		{
+			memcpy(compInfo.target.lineColorHeadNative, lineCache, lineBytes);
+			this->UpdatePropertiesWithoutRender(l);
+			return;
+		}
+	}
+	
 	this->_RenderLine_Clear<OUTPUTFORMAT>(compInfo);
 	
 	// for all the pixels in the line
@@ -3900,6 +3926,18 @@ void GPUEngineBase::_RenderLine_Layers(const size_t l)
 			this->_RenderLine_LayerOBJ<OUTPUTFORMAT, WILLPERFORMWINDOWTEST>(compInfo, item);
 		}
 	}
+	
+	// Lines that needed custom rendering can't be restored from a native copy.
+	if (isLineCacheable && this->isLineRenderNative[l])
+	{
+		memcpy(lineCache, compInfo.target.lineColorHeadNative, lineBytes);
+		this->_lineSignature[l] = lineSignature;
+		this->_isLineSignatureValid[l] = true;
+	}
+	else
+	{
+		this->_isLineSignatureValid[l] = false;
+	}
 }
 
 void GPUEngineBase::_RenderLine_SetupSprites(GPUEngineCompositorInfo &compInfo)
@@ -4797,6 +4835,7 @@ void GPUEngineBase::SetCustomFramebufferSize(size_t w, size_t h)
 	u16 *newBGLayerColorCustom = (u16 *)malloc_alignedCacheLine(w * sizeof(u16));
 	u8 *newDidPassWindowTestCustomMasterPtr = (u8 *)malloc_alignedCacheLine(w * 10 * sizeof(u8));
 	
+	this->InvalidateLineCache();
 	this->_internalRenderLineTargetCustom = newWorkingLineColor;
 	this->_renderLineLayerIDCustom = newWorkingLineLayerID;
 	this->nativeBuffer = GPU->GetDisplayInfo().nativeBuffer[this->_targetDisplayID];
@@ -4997,6 +5036,35 @@ void GPUEngineBase::ParseAllRegisters()
 	this->ParseReg_MASTER_BRIGHT();
 }
 
+// Called whenever this engine's half of OAM is written to. The sprite line lists are rebuilt
+// before the next line with sprites is rendered.
+void GPUEngineBase::InvalidateSpriteLists()
+{
+	this->_needUpdateSpriteLists = true;
+}
+
+void GPUEngineBase::InvalidateLineCache()
+{
+	memset(this->_isLineSignatureValid, 0, sizeof(this->_isLineSignatureValid));
+	
+	// No VRAM address is 0, so a zeroed key never matches.
+	memset(this->_tileRowCacheKey, 0, sizeof(this->_tileRowCacheKey));
+	this->_tileRowCacheGeneration = MMU.VRAMGeneration;
+}
+
+void GPUEngineBase::_MakeLineSignature(GPUEngineLineSignature &outSignature) const
+{
+	// Clear the whole struct first so that the padding bytes always compare equal.
+	memset(&outSignature, 0, sizeof(GPUEngineLineSignature));
+	
+	memcpy(outSignature.IORegisters, this->_IORegisterMap, sizeof(outSignature.IORegisters));
+	memcpy(outSignature.enableLayer, this->_enableLayer, sizeof(outSignature.enableLayer));
+	outSignature.colorFormat = GPU->GetDisplayInfo().colorFormat;
+	outSignature.paletteGeneration = MMU.paletteGeneration;
+	outSignature.OAMGeneration = MMU.OAMGeneration;
+	outSignature.VRAMGeneration = MMU.VRAMGeneration;
+}
+
 GPUEngineA::GPUEngineA()
 {
 	_engineID = GPUEngineID_Main;
@@ -5275,6 +5343,9 @@ void GPUEngineA::RenderLine(const u16 l)
 		{
 			this->_RenderLine_DisplayCapture<OUTPUTFORMAT, GPU_FRAMEBUFFER_NATIVE_WIDTH>(l);
 		}
+		
+		// The capture wrote to VRAM, which any line might be reading from.
+		MMU.VRAMGeneration++;
 	}
 }
 
@@ -5486,6 +5557,7 @@ void GPUEngineA::_RenderLine_DisplayCapture(const u16 l)
 	
 	const u16 *cap_src = (this->isLineCaptureNative[vramReadBlock][readLineIndexWithOffset]) ? (u16 *)MMU.blank_memory : GPU->GetCustomVRAMBlankBuffer();
 	u16 *cap_dst = this->_VRAMNativeBlockPtr[vramWriteBlock] + cap_dst_adr;
+	StateHash_MarkHost(cap_dst, CAPTURELENGTH * sizeof(u16));
 	
 	if (vramConfiguration.banks[vramReadBlock].purpose == VramConfiguration::LCDC)
 	{
@@ -963,6 +963,17 @@ typedef struct
 typedef GPUSize_u16 SpriteSize;
 typedef GPUSize_u16 BGLayerSize;
 
+// OAM entry with everything that doesn't depend on the current line already worked out.
+typedef struct
+{
+	OAMAttributes attr;					// Copy of the OAM entry, with attributes 1 and 2 already converted to native endianness.
+	SpriteSize size;					// Size of the sprite graphic.
+	u16 fieldWidth;						// Size of the area the sprite covers on screen. This is twice the sprite
+	u16 fieldHeight;					// size for double-sized rotozoomed sprites.
+	s16 dx, dmx, dy, dmy;				// Rotation/scaling parameters. Only valid for rotozoomed sprites.
+	u32 tileAddress;					// Address of the first tile. Not used for bitmap sprites.
+} SpriteDecodedInfo;
+
 typedef u8 TBlendTable[32][32];
 
 #define NB_PRIORITIES	4
@@ -1218,6 +1229,20 @@ typedef struct
 	GPUEngineTargetState target;
 } GPUEngineCompositorInfo;
 
+#define GPU_TILEROW_CACHE_SIZE 1024 // Must be a power of 2
+
+// Everything that a native scanline rendered by _RenderLine_Layers() depends on. If a line's signature
+// matches the one it was last rendered with, then the previously rendered pixels can be reused as-is.
+typedef struct
+{
+	u8 IORegisters[0x56];			// DISPCNT through BLDY, including the current affine reference points
+	bool enableLayer[5];
+	NDSColorFormat colorFormat;
+	u32 paletteGeneration;
+	u32 OAMGeneration;
+	u32 VRAMGeneration;
+} GPUEngineLineSignature;
+
 class GPUEngineBase
 {
 protected:
@@ -1300,6 +1325,11 @@ protected:
 	CACHE_ALIGN u8 _sprNum[256];
 	CACHE_ALIGN u8 _h_win[2][GPU_FRAMEBUFFER_NATIVE_WIDTH];
 	
+	SpriteDecodedInfo _sprDecoded[128];
+	u8 _sprLineList[GPU_FRAMEBUFFER_NATIVE_HEIGHT][128];
+	u8 _sprLineCount[GPU_FRAMEBUFFER_NATIVE_HEIGHT];
+	bool _needUpdateSpriteLists;
+	
 	NDSDisplayID _targetDisplayID;
 	bool _isMasterBrightFullIntensity;
 	
@@ -1310,9 +1340,20 @@ protected:
 	u8 *_renderLineLayerIDCustom;
 	bool _needUpdateWINH[2];
 	
+	GPUEngineLineSignature _lineSignature[GPU_FRAMEBUFFER_NATIVE_HEIGHT];
+	bool _isLineSignatureValid[GPU_FRAMEBUFFER_NATIVE_HEIGHT];
+	CACHE_ALIGN u8 _lineCacheNative[GPU_FRAMEBUFFER_NATIVE_WIDTH * GPU_FRAMEBUFFER_NATIVE_HEIGHT * sizeof(FragmentColor)];
+	
+	// Decoded text BG tile rows, keyed by the row's VRAM address and flip bits. These stay
+	// valid across lines and frames for as long as MMU.VRAMGeneration doesn't change.
+	u32 _tileRowCacheGeneration;
+	CACHE_ALIGN u32 _tileRowCacheKey[GPU_TILEROW_CACHE_SIZE];
+	CACHE_ALIGN u64 _tileRowCacheIndices[GPU_TILEROW_CACHE_SIZE];
+	
 	void _InitLUTs();
 	void _Reset_Base();
 	void _ResortBGLayers();
+	void _MakeLineSignature(GPUEngineLineSignature &outSignature) const;
 	
 	template<bool NATIVEDST, bool NATIVESRC, bool USELINEINDEX, bool NEEDENDIANSWAP, size_t PIXELBYTES> void _LineColorCopy(void *__restrict dstBuffer, const void *__restrict srcBuffer, const size_t l);
 	template<bool NATIVEDST, bool NATIVESRC> void _LineLayerIDCopy(u8 *__restrict dstBuffer, const u8 *__restrict srcBuffer, const size_t l);
@@ -1389,8 +1430,11 @@ protected:
 	
 	u32 _SpriteAddressBMP(GPUEngineCompositorInfo &compInfo, const OAMAttributes &spriteInfo, const SpriteSize sprSize, const s32 y);
 	
+	bool _SpriteDecode(const GPUEngineRenderState &renderState, const size_t spriteIndex, SpriteDecodedInfo &outInfo);
+	void _SpriteUpdateLineLists(const GPUEngineRenderState &renderState);
+	
 	template<bool ISDEBUGRENDER> void _SpriteRender(GPUEngineCompositorInfo &compInfo, u16 *__restrict dst, u8 *__restrict dst_alpha, u8 *__restrict typeTab, u8 *__restrict prioTab);
-	template<SpriteRenderMode MODE, bool ISDEBUGRENDER> void _SpriteRenderPerform(GPUEngineCompositorInfo &compInfo, u16 *__restrict dst, u8 *__restrict dst_alpha, u8 *__restrict typeTab, u8 *__restrict prioTab);
+	template<SpriteRenderMode MODE, bool ISDEBUGRENDER> void _SpriteRenderPerform(GPUEngineCompositorInfo &compInfo, const SpriteDecodedInfo *__restrict sprInfoList, const u8 *__restrict sprIndexList, const size_t sprCount, u16 *__restrict dst, u8 *__restrict dst_alpha, u8 *__restrict typeTab, u8 *__restrict prioTab);
 	
 public:
 	GPUEngineBase();
@@ -1418,6 +1462,8 @@ public:
 	void ParseReg_MASTER_BRIGHT();
 	
 	void ParseAllRegisters();
+	void InvalidateSpriteLists();
+	void InvalidateLineCache();
 	
 	void UpdatePropertiesWithoutRender(const u16 l);
 	void FramebufferPostprocess();
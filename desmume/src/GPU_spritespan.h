@@ -0,0 +1,134 @@
+/*
+	Copyright (C) 2016 DeSmuME team
+
+	This file is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the this software.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GPU_SPRITESPAN_H
+#define GPU_SPRITESPAN_H
+
+#include "GPU.h"
+
+// Narrows [begin, end) down to the steps j for which 0 <= start + j*step < limit.
+static FORCEINLINE void SpriteSpan_ClipAffine(const s32 start, const s32 step, const s32 limit, s32 &begin, s32 &end)
+{
+	s32 lo;
+	s32 hi;
+
+	if (step > 0)
+	{
+		lo = (start >= 0)     ? 0 : ((-start) + step - 1) / step;
+		hi = (start >= limit) ? 0 : ((limit - start) + step - 1) / step;
+	}
+	else if (step < 0)
+	{
+		lo = (start < limit) ? 0 : ((start - limit) / -step) + 1;
+		hi = (start < 0)     ? 0 : (start / -step) + 1;
+	}
+	else
+	{
+		lo = 0;
+		hi = ((start >= 0) && (start < limit)) ? end : 0;
+	}
+
+	if (lo > begin) begin = lo;
+	if (hi < end) end = hi;
+}
+
+// Merges lg pixels of a sprite row, given as palette indices in screen order, into the sprite line
+// starting at sprX, one pixel at a time.
+template<bool ISDEBUGRENDER>
+static FORCEINLINE void SpriteSpan_MergeScalar(const u8 spriteNum, u16 *__restrict dst, const u8 *__restrict palIndex, const u16 *__restrict pal, u8 *__restrict dst_alpha, u8 *__restrict typeTab, u8 *__restrict prioTab, u8 *__restrict sprNum, const u8 prio, const size_t lg, size_t sprX, const u8 objMode)
+{
+	for (size_t i = 0; i < lg; i++, sprX++)
+	{
+		const u8 palette_entry = palIndex[i];
+
+		//a zero value suppresses the pixel from processing entirely; it doesnt exist
+		if (ISDEBUGRENDER)
+		{
+			if (palette_entry > 0)
+			{
+				dst[sprX] = LE_TO_LOCAL_16(pal[palette_entry]);
+			}
+		}
+		else
+		{
+			if ((palette_entry > 0) && (prio < prioTab[sprX]))
+			{
+				dst[sprX] = LE_TO_LOCAL_16(pal[palette_entry]);
+				dst_alpha[sprX] = 0xFF;
+				typeTab[sprX] = objMode;
+				prioTab[sprX] = prio;
+				sprNum[sprX] = spriteNum;
+			}
+		}
+	}
+}
+
+// The same merge, 16 pixels at a time where SSE2 is available. The span is at most 64 pixels wide.
+// prioTab only ever holds 0-3, or 0x7F where no sprite is yet, so comparing it signed is fine.
+template<bool ISDEBUGRENDER>
+static FORCEINLINE void SpriteSpan_Merge(const u8 spriteNum, u16 *__restrict dst, const u8 *__restrict palIndex, const u16 *__restrict pal, u8 *__restrict dst_alpha, u8 *__restrict typeTab, u8 *__restrict prioTab, u8 *__restrict sprNum, const u8 prio, const size_t lg, size_t sprX, const u8 objMode)
+{
+	size_t i = 0;
+
+#ifdef ENABLE_SSE2
+	// Do the palette lookups up front, since SSE2 has no gather. A palette index of 0 is transparent, so
+	// whatever gets looked up for those pixels is masked out below.
+	CACHE_ALIGN u16 color[64];
+	for (size_t j = 0; j < lg; j++)
+	{
+		color[j] = LE_TO_LOCAL_16(pal[palIndex[j]]);
+	}
+
+	const __m128i prio_vec128 = _mm_set1_epi8(prio);
+	const size_t ssePixCount = lg - (lg % 16);
+
+	for (; i < ssePixCount; i += 16, sprX += 16)
+	{
+		const __m128i index_vec128 = _mm_loadu_si128((__m128i *)(palIndex + i));
+		__m128i combinedPackedCompare = _mm_xor_si128( _mm_cmpeq_epi8(index_vec128, _mm_setzero_si128()), _mm_set1_epi8(0xFF) );
+
+		if (!ISDEBUGRENDER)
+		{
+			const __m128i prioTab_vec128 = _mm_loadu_si128((__m128i *)(prioTab + sprX));
+			combinedPackedCompare = _mm_and_si128(combinedPackedCompare, _mm_cmplt_epi8(prio_vec128, prioTab_vec128));
+		}
+
+		if (_mm_movemask_epi8(combinedPackedCompare) == 0)
+		{
+			continue;
+		}
+
+		const __m128i combinedLoCompare = _mm_unpacklo_epi8(combinedPackedCompare, combinedPackedCompare);
+		const __m128i combinedHiCompare = _mm_unpackhi_epi8(combinedPackedCompare, combinedPackedCompare);
+
+		_mm_storeu_si128( (__m128i *)(dst + sprX + 0), _mm_blendv_epi8(_mm_loadu_si128((__m128i *)(dst + sprX + 0)), _mm_load_si128((__m128i *)(color + i + 0)), combinedLoCompare) );
+		_mm_storeu_si128( (__m128i *)(dst + sprX + 8), _mm_blendv_epi8(_mm_loadu_si128((__m128i *)(dst + sprX + 8)), _mm_load_si128((__m128i *)(color + i + 8)), combinedHiCompare) );
+
+		if (!ISDEBUGRENDER)
+		{
+			_mm_storeu_si128( (__m128i *)(dst_alpha + sprX), _mm_blendv_epi8(_mm_loadu_si128((__m128i *)(dst_alpha + sprX)), _mm_set1_epi8(0xFF), combinedPackedCompare) );
+			_mm_storeu_si128( (__m128i *)(typeTab + sprX),   _mm_blendv_epi8(_mm_loadu_si128((__m128i *)(typeTab + sprX)), _mm_set1_epi8(objMode), combinedPackedCompare) );
+			_mm_storeu_si128( (__m128i *)(prioTab + sprX),   _mm_blendv_epi8(_mm_loadu_si128((__m128i *)(prioTab + sprX)), prio_vec128, combinedPackedCompare) );
+			_mm_storeu_si128( (__m128i *)(sprNum + sprX),    _mm_blendv_epi8(_mm_loadu_si128((__m128i *)(sprNum + sprX)), _mm_set1_epi8(spriteNum), combinedPackedCompare) );
+		}
+	}
+#endif
+
+	SpriteSpan_MergeScalar<ISDEBUGRENDER>(spriteNum, dst, palIndex + i, pal, dst_alpha, typeTab, prioTab, sprNum, prio, lg - i, sprX, objMode);
+}
+
+#endif
@@ -803,6 +803,7 @@ static inline void MMU_VRAMmapControl(u8 block, u8 VRAMBankCnt)
 
 	//write the new value to the reg
 	T1WriteByte(MMU.ARM9_REG, 0x240 + block, VRAMBankCnt);
+	MMU.VRAMGeneration++;
 
 	//refresh all bank settings
 	//zero XX-XX-200X (long before jun 2012)
@@ -1383,6 +1384,31 @@ u32 MMU_readFromGC()
 	return val;
 }
 
+//reads count words from GCDATAIN in one go, exactly as count calls to MMU_readFromGC() would
+template<int PROCNUM>
+static void MMU_readFromGCBlock(u32 *buf, u32 count)
+{
+	GCBUS_Controller& card = MMU.dscard[PROCNUM];
+
+	u32 avail = (card.transfer_count > 0) ? ((u32)card.transfer_count >> 2) : 0;
+	if(avail > count) avail = count;
+
+	if(avail > 0)
+	{
+		slot1_device->read_GCDATAIN_block(PROCNUM, buf, avail);
+
+		card.transfer_count -= (avail << 2);
+		if(card.transfer_count <= 0)
+		{
+			MMU_GC_endTransfer(PROCNUM);
+		}
+	}
+
+	//anything past the end of the transfer reads as 0
+	if(avail < count)
+		memset(buf + avail, 0, (count - avail) << 2);
+}
+
 template<int PROCNUM>
 void MMU_writeToGC(u32 val)
 {
@@ -2295,7 +2321,36 @@ void DmaController::doCopy()
 	//we might make another function to do just the raw copy op which can use them with checks
 	//outside the loop
 	int time_elapsed = 0;
-	if(sz==4) {
+
+	//card dmas drain GCDATAIN into an incrementing destination. when that destination is plain host memory,
+	//pull the whole block from the slot-1 device in one go and drop it straight in place.
+	//the timing is still accumulated word by word so that the cost of the dma doesn't change
+	u32 hostSize = 0;
+	u8 *hostDst = NULL;
+	if(startmode == EDMAMode_Card && sz == 4 && todo > 0 && src == REG_GCDATAIN && srcinc == 0 && dstinc == 4 && (dst & 3) == 0)
+	{
+		hostDst = MMU_GetHostRange<PROCNUM>(dst, hostSize, false);
+		if(hostSize < (todo << 2))
+			hostDst = NULL;
+	}
+
+	if(hostDst != NULL) {
+		const u32 dststart = dst;
+		for(s32 i=(s32)todo; i>0; i--)
+		{
+			time_elapsed += _MMU_accesstime<PROCNUM,MMU_AT_DMA,32,MMU_AD_READ,TRUE>(src,true);
+			time_elapsed += _MMU_accesstime<PROCNUM,MMU_AT_DMA,32,MMU_AD_WRITE,TRUE>(dst,true);
+			dst += dstinc;
+		}
+
+		u32 *block = (u32*)hostDst;
+		MMU_readFromGCBlock<PROCNUM>(block, todo);
+#ifdef WORDS_BIGENDIAN
+		for(u32 i = 0; i < todo; i++)
+			block[i] = LOCAL_TO_LE_32(block[i]);
+#endif
+		MMU_HostRangeWritten<PROCNUM>(dststart, todo << 2);
+	} else if(sz==4) {
 		for(s32 i=(s32)todo; i>0; i--)
 		{
 			time_elapsed += _MMU_accesstime<PROCNUM,MMU_AT_DMA,32,MMU_AD_READ,TRUE>(src,true);
@@ -3176,6 +3231,17 @@ bool validateIORegsRead(u32 addr, u8 size)
 #define VALIDATE_IO_REGS_READ(PROC, SIZE) ;
 #endif
 
+//the first 1KB of OAM belongs to the main engine, the second to the sub engine
+static FORCEINLINE void MMU_OAMWritten(const u32 adr)
+{
+	MMU.OAMGeneration++;
+
+	if (adr & 0x400)
+		GPU->GetEngineSub()->InvalidateSpriteLists();
+	else
+		GPU->GetEngineMain()->InvalidateSpriteLists();
+}
+
 //================================================================================================== ARM9 *
 //=========================================================================================================
 //=========================================================================================================
@@ -3193,6 +3259,7 @@ void FASTCALL _MMU_ARM9_write08(u32 adr, u8 val)
 		JIT_COMPILED_FUNC_KNOWNBANK(adr, ARM9_ITCM, 0x7FFF, 0) = 0;
 #endif
 		T1WriteByte(MMU.ARM9_ITCM, adr & 0x7FFF, val);
+		StateHash_MarkHost(MMU.ARM9_ITCM + (adr & 0x7FFF));
 		return;
 	}
 
@@ -3658,6 +3725,9 @@ void FASTCALL _MMU_ARM9_write08(u32 adr, u8 val)
 	if(unmapped) return;
 	if(restricted) return; //block 8bit vram writes
 
+	if (adrBank == 0x06)
+		MMU.VRAMGeneration++;
+
 #ifdef HAVE_JIT
 	if (JIT_MAPPED(adr, ARMCPU_ARM9))
 		JIT_COMPILED_FUNC_PREMASKED(adr, ARMCPU_ARM9, 0) = 0;
@@ -3665,6 +3735,7 @@ void FASTCALL _MMU_ARM9_write08(u32 adr, u8 val)
 
 	// Removed the &0xFF as they are implicit with the adr&0x0FFFFFFF [shash]
 	MMU.MMU_MEM[ARMCPU_ARM9][adr>>20][adr&MMU.MMU_MASK[ARMCPU_ARM9][adr>>20]]=val;
+	StateHash_MarkHost(&MMU.MMU_MEM[ARMCPU_ARM9][adr>>20][adr&MMU.MMU_MASK[ARMCPU_ARM9][adr>>20]]);
 }
 
 //================================================= MMU ARM9 write 16
@@ -3681,6 +3752,7 @@ void FASTCALL _MMU_ARM9_write16(u32 adr, u16 val)
 		JIT_COMPILED_FUNC_KNOWNBANK(adr, ARM9_ITCM, 0x7FFF, 0) = 0;
 #endif
 		T1WriteWord(MMU.ARM9_ITCM, adr & 0x7FFF, val);
+		StateHash_MarkHost(MMU.ARM9_ITCM + (adr & 0x7FFF));
 		return;
 	}
 
@@ -4227,6 +4299,7 @@ void FASTCALL _MMU_ARM9_write16(u32 adr, u16 val)
 			
 		case 0x07: // OAM attributes
 			T1WriteWord(MMU.ARM9_OAM, adr & 0x07FF, val);
+			MMU_OAMWritten(adr);
 			return;
 	}
 	
@@ -4234,6 +4307,11 @@ void FASTCALL _MMU_ARM9_write16(u32 adr, u16 val)
 	adr = MMU_LCDmap<ARMCPU_ARM9>(adr, unmapped, restricted);
 	if(unmapped) return;
 
+	if (adrBank == 0x05)
+		MMU.paletteGeneration++;
+	else if (adrBank == 0x06)
+		MMU.VRAMGeneration++;
+
 #ifdef HAVE_JIT
 	if (JIT_MAPPED(adr, ARMCPU_ARM9))
 		JIT_COMPILED_FUNC_PREMASKED(adr, ARMCPU_ARM9, 0) = 0;
@@ -4241,6 +4319,7 @@ void FASTCALL _MMU_ARM9_write16(u32 adr, u16 val)
 
 	// Removed the &0xFF as they are implicit with the adr&0x0FFFFFFF [shash]
 	T1WriteWord(MMU.MMU_MEM[ARMCPU_ARM9][adr>>20], adr&MMU.MMU_MASK[ARMCPU_ARM9][adr>>20], val);
+	StateHash_MarkHost(&MMU.MMU_MEM[ARMCPU_ARM9][adr>>20][adr&MMU.MMU_MASK[ARMCPU_ARM9][adr>>20]], 2);
 } 
 
 //================================================= MMU ARM9 write 32
@@ -4258,6 +4337,7 @@ void FASTCALL _MMU_ARM9_write32(u32 adr, u32 val)
 		JIT_COMPILED_FUNC_KNOWNBANK(adr, ARM9_ITCM, 0x7FFF, 1) = 0;
 #endif
 		T1WriteLong(MMU.ARM9_ITCM, adr & 0x7FFF, val);
+		StateHash_MarkHost(MMU.ARM9_ITCM + (adr & 0x7FFF));
 		return ;
 	}
 
@@ -4734,6 +4814,7 @@ void FASTCALL _MMU_ARM9_write32(u32 adr, u32 val)
 			
 		case 0x07: // OAM attributes
 			T1WriteLong(MMU.ARM9_OAM, adr & 0x07FF, val);
+			MMU_OAMWritten(adr);
 			return;
 	}
 
@@ -4741,6 +4822,11 @@ void FASTCALL _MMU_ARM9_write32(u32 adr, u32 val)
 	adr = MMU_LCDmap<ARMCPU_ARM9>(adr, unmapped, restricted);
 	if(unmapped) return;
 
+	if (adrBank == 0x05)
+		MMU.paletteGeneration++;
+	else if (adrBank == 0x06)
+		MMU.VRAMGeneration++;
+
 #ifdef HAVE_JIT
 	if (JIT_MAPPED(adr, ARMCPU_ARM9))
 	{
@@ -4751,6 +4837,7 @@ void FASTCALL _MMU_ARM9_write32(u32 adr, u32 val)
 
 	// Removed the &0xFF as they are implicit with the adr&0x0FFFFFFF [shash]
 	T1WriteLong(MMU.MMU_MEM[ARMCPU_ARM9][adr>>20], adr&MMU.MMU_MASK[ARMCPU_ARM9][adr>>20], val);
+	StateHash_MarkHost(&MMU.MMU_MEM[ARMCPU_ARM9][adr>>20][adr&MMU.MMU_MASK[ARMCPU_ARM9][adr>>20]], 4);
 }
 
 //================================================= MMU ARM9 read 08
@@ -5218,6 +5305,7 @@ void FASTCALL _MMU_ARM7_write08(u32 adr, u8 val)
 	
 	// Removed the &0xFF as they are implicit with the adr&0x0FFFFFFF [shash]
 	MMU.MMU_MEM[ARMCPU_ARM7][adr>>20][adr&MMU.MMU_MASK[ARMCPU_ARM7][adr>>20]]=val;
+	StateHash_MarkHost(&MMU.MMU_MEM[ARMCPU_ARM7][adr>>20][adr&MMU.MMU_MASK[ARMCPU_ARM7][adr>>20]]);
 }
 
 //================================================= MMU ARM7 write 16
@@ -5400,6 +5488,7 @@ void FASTCALL _MMU_ARM7_write16(u32 adr, u16 val)
 
 	// Removed the &0xFF as they are implicit with the adr&0x0FFFFFFF [shash]
 	T1WriteWord(MMU.MMU_MEM[ARMCPU_ARM7][adr>>20], adr&MMU.MMU_MASK[ARMCPU_ARM7][adr>>20], val);
+	StateHash_MarkHost(&MMU.MMU_MEM[ARMCPU_ARM7][adr>>20][adr&MMU.MMU_MASK[ARMCPU_ARM7][adr>>20]], 2);
 }
 //================================================= MMU ARM7 write 32
 void FASTCALL _MMU_ARM7_write32(u32 adr, u32 val)
@@ -5502,6 +5591,7 @@ void FASTCALL _MMU_ARM7_write32(u32 adr, u32 val)
 
 	// Removed the &0xFF as they are implicit with the adr&0x0FFFFFFF [shash]
 	T1WriteLong(MMU.MMU_MEM[ARMCPU_ARM7][adr>>20], adr&MMU.MMU_MASK[ARMCPU_ARM7][adr>>20], val);
+	StateHash_MarkHost(&MMU.MMU_MEM[ARMCPU_ARM7][adr>>20][adr&MMU.MMU_MASK[ARMCPU_ARM7][adr>>20]], 4);
 }
 
 //================================================= MMU ARM7 read 08
@@ -5815,10 +5905,134 @@ void FASTCALL MMU_DumpMemBlock(u8 proc, u32 address, u32 size, u8 *buffer)
 	}
 }
 
+static FORCEINLINE bool MMU_HostRangeAllowed()
+{
+	//anything which needs to observe individual accesses forces the caller onto the regular MMU path
+#ifdef HAVE_LUA
+	if(hookedRegions[LUAMEMHOOK_READ].NotEmpty() || hookedRegions[LUAMEMHOOK_WRITE].NotEmpty())
+		return false;
+#endif
+	if(CheckDebugEvent(DEBUG_EVENT_READ) || CheckDebugEvent(DEBUG_EVENT_WRITE))
+		return false;
+	return true;
+}
+
+template<int PROCNUM>
+static FORCEINLINE u8* MMU_HostPage(u32 adr, bool byteWrites)
+{
+	bool unmapped, restricted;
+	const u32 mapped = MMU_LCDmap<PROCNUM>(adr, unmapped, restricted);
+	if(unmapped) return NULL;
+	if(restricted && byteWrites) return NULL;
+	return MMU.MMU_MEM[PROCNUM][mapped>>20] + (mapped & MMU.MMU_MASK[PROCNUM][mapped>>20]);
+}
+
+template<int PROCNUM>
+u8* MMU_GetHostRange(u32 adr, u32 &contiguous, bool byteWrites)
+{
+	u8 *ptr = NULL;
+	contiguous = 0;
+
+	if(adr & 0xF0000000)
+		return NULL;
+	if(!MMU_HostRangeAllowed())
+		return NULL;
+
+	const u32 region = adr >> 24;
+	if(region == 0x02)
+	{
+		const u32 ofs = adr & _MMU_MAIN_MEM_MASK;
+		ptr = MMU.MAIN_MEM + ofs;
+		contiguous = (_MMU_MAIN_MEM_MASK + 1) - ofs;
+	}
+	else if(region == 0x03 || region == 0x06)
+	{
+		//vram and shared wram are mapped in 16KB pages.
+		//walk them for as long as they land on consecutive host memory
+		ptr = MMU_HostPage<PROCNUM>(adr, byteWrites);
+		if(ptr == NULL) return NULL;
+		contiguous = 0x4000 - (adr & 0x3FFF);
+		for(;;)
+		{
+			const u32 next = adr + contiguous;
+			if((next >> 24) != region) break;
+			if(MMU_HostPage<PROCNUM>(next, byteWrites) != ptr + contiguous) break;
+			contiguous += 0x4000;
+		}
+	}
+	else
+		return NULL;
+
+	//dtcm is patched on top of everything else for the arm9; stop short of it
+	if(PROCNUM == ARMCPU_ARM9)
+	{
+		const u32 dtcm = MMU.DTCMRegion;
+		if(adr >= dtcm && adr < dtcm + 0x4000)
+		{
+			contiguous = 0;
+			return NULL;
+		}
+		if(dtcm > adr && dtcm - adr < contiguous)
+			contiguous = dtcm - adr;
+	}
+
+	return ptr;
+}
+
+template<int PROCNUM>
+void MMU_HostRangeWritten(u32 adr, u32 size)
+{
+	for(u32 done = 0; statehash_enabled && done < size; )
+	{
+		u32 contiguous;
+		const u8 *ptr = MMU_GetHostRange<PROCNUM>(adr + done, contiguous, false);
+		if(ptr == NULL) break;
+		contiguous = std::min(contiguous, size - done);
+		StateHash_MarkHost(ptr, contiguous);
+		done += contiguous;
+	}
+
+	//the GPU keeps rendered lines and decoded tiles around until one of these changes
+	const u32 lastBank = (adr + size - 1) >> 24;
+	for(u32 bank = adr >> 24; size != 0 && bank <= lastBank; bank++)
+	{
+		if(bank == 0x06)
+			MMU.VRAMGeneration++;
+		else if(PROCNUM == ARMCPU_ARM9 && bank == 0x05)
+			MMU.paletteGeneration++;
+		else if(PROCNUM == ARMCPU_ARM9 && bank == 0x07)
+		{
+			MMU_OAMWritten(0x07000000);
+			MMU_OAMWritten(0x07000400);
+		}
+	}
+
+#ifdef HAVE_JIT
+	adr &= ~1;
+	for(u32 i = 0; i < size; i += 2, adr += 2)
+	{
+		if((adr >> 24) == 0x02)
+		{
+			JIT_COMPILED_FUNC_KNOWNBANK(adr, MAIN_MEM, _MMU_MAIN_MEM_MASK16, 0) = 0;
+			continue;
+		}
+
+		bool unmapped, restricted;
+		const u32 mapped = MMU_LCDmap<PROCNUM>(adr, unmapped, restricted);
+		if(!unmapped && JIT_MAPPED(mapped, PROCNUM))
+			JIT_COMPILED_FUNC_PREMASKED(mapped, PROCNUM, 0) = 0;
+	}
+#endif
+}
+
 
 //these templates needed to be instantiated manually
 template u32 MMU_struct::gen_IF<ARMCPU_ARM9>();
 template u32 MMU_struct::gen_IF<ARMCPU_ARM7>();
+template u8* MMU_GetHostRange<ARMCPU_ARM9>(u32 adr, u32 &contiguous, bool byteWrites);
+template u8* MMU_GetHostRange<ARMCPU_ARM7>(u32 adr, u32 &contiguous, bool byteWrites);
+template void MMU_HostRangeWritten<ARMCPU_ARM9>(u32 adr, u32 size);
+template void MMU_HostRangeWritten<ARMCPU_ARM7>(u32 adr, u32 size);
 
 ////////////////////////////////////////////////////////////
 //function pointer handlers for gdb stub stuff
@@ -24,6 +24,7 @@
 #include "firmware.h"
 #include "mc.h"
 #include "mem.h"
+#include "statehash.h"
 
 #ifdef HAVE_LUA
 #include "lua-engine.h"
@@ -398,6 +399,12 @@ struct MMU_struct
 	u32 LCD_VRAM_ADDR[10];
 	u8 LCDCenable[10];
 
+	//bumped whenever something the 2D engines draw from changes, so that they can tell
+	//when a previously rendered scanline can be reused as-is
+	u32 paletteGeneration;
+	u32 OAMGeneration;
+	u32 VRAMGeneration;
+
 	//32KB of shared WRAM - can be switched between ARM7 & ARM9 in two blocks
 	u8 SWIRAM[0x8000];
 
@@ -841,6 +848,7 @@ FORCEINLINE void _MMU_write08(const int PROCNUM, const MMU_ACCESS_TYPE AT, const
 		if((addr&(~0x3FFF)) == MMU.DTCMRegion)
 		{
 			T1WriteByte(MMU.ARM9_DTCM, addr & 0x3FFF, val);
+			StateHash_MarkDTCM(addr & 0x3FFF);
 #ifdef HAVE_LUA
 			CallRegisteredLuaMemHook(addr, 1, val, LUAMEMHOOK_WRITE);
 #endif
@@ -852,6 +860,7 @@ FORCEINLINE void _MMU_write08(const int PROCNUM, const MMU_ACCESS_TYPE AT, const
 		JIT_COMPILED_FUNC_KNOWNBANK(addr, MAIN_MEM, _MMU_MAIN_MEM_MASK, 0) = 0;
 #endif
 		T1WriteByte( MMU.MAIN_MEM, addr & _MMU_MAIN_MEM_MASK, val);
+		StateHash_MarkMainMem(addr & _MMU_MAIN_MEM_MASK);
 #ifdef HAVE_LUA
 		CallRegisteredLuaMemHook(addr, 1, val, LUAMEMHOOK_WRITE);
 #endif
@@ -880,6 +889,7 @@ FORCEINLINE void _MMU_write16(const int PROCNUM, const MMU_ACCESS_TYPE AT, const
 		if((addr&(~0x3FFF)) == MMU.DTCMRegion)
 		{
 			T1WriteWord(MMU.ARM9_DTCM, addr & 0x3FFE, val);
+			StateHash_MarkDTCM(addr & 0x3FFE);
 #ifdef HAVE_LUA
 			CallRegisteredLuaMemHook(addr, 2, val, LUAMEMHOOK_WRITE);
 #endif
@@ -891,6 +901,7 @@ FORCEINLINE void _MMU_write16(const int PROCNUM, const MMU_ACCESS_TYPE AT, const
 		JIT_COMPILED_FUNC_KNOWNBANK(addr, MAIN_MEM, _MMU_MAIN_MEM_MASK16, 0) = 0;
 #endif
 		T1WriteWord( MMU.MAIN_MEM, addr & _MMU_MAIN_MEM_MASK16, val);
+		StateHash_MarkMainMem(addr & _MMU_MAIN_MEM_MASK16);
 #ifdef HAVE_LUA
 		CallRegisteredLuaMemHook(addr, 2, val, LUAMEMHOOK_WRITE);
 #endif
@@ -919,6 +930,7 @@ FORCEINLINE void _MMU_write32(const int PROCNUM, const MMU_ACCESS_TYPE AT, const
 		if((addr&(~0x3FFF)) == MMU.DTCMRegion)
 		{
 			T1WriteLong(MMU.ARM9_DTCM, addr & 0x3FFC, val);
+			StateHash_MarkDTCM(addr & 0x3FFC);
 #ifdef HAVE_LUA
 			CallRegisteredLuaMemHook(addr, 4, val, LUAMEMHOOK_WRITE);
 #endif
@@ -931,6 +943,7 @@ FORCEINLINE void _MMU_write32(const int PROCNUM, const MMU_ACCESS_TYPE AT, const
 		JIT_COMPILED_FUNC_KNOWNBANK(addr, MAIN_MEM, _MMU_MAIN_MEM_MASK32, 1) = 0;
 #endif
 		T1WriteLong( MMU.MAIN_MEM, addr & _MMU_MAIN_MEM_MASK32, val);
+		StateHash_MarkMainMem(addr & _MMU_MAIN_MEM_MASK32);
 #ifdef HAVE_LUA
 		CallRegisteredLuaMemHook(addr, 4, val, LUAMEMHOOK_WRITE);
 #endif
@@ -998,4 +1011,13 @@ FORCEINLINE void _MMU_write32(u32 addr, u32 val) { _MMU_write32(PROCNUM, AT, add
 
 void FASTCALL MMU_DumpMemBlock(u8 proc, u32 address, u32 size, u8 *buffer);
 
+//resolves a guest address to host memory, for routines which want to move big blocks without going through the accessors.
+//returns NULL if the address isn't backed by plain ram (main memory, shared wram or mapped vram), or if something is
+//watching individual accesses (lua hooks, debug events). otherwise returns the host pointer and the number of bytes
+//which can be accessed contiguously from it. byteWrites excludes memory which ignores 8bit writes (vram).
+template<int PROCNUM> u8* MMU_GetHostRange(u32 adr, u32 &contiguous, bool byteWrites);
+
+//must be called after writing to memory obtained from MMU_GetHostRange, so that stale jit blocks get dropped
+template<int PROCNUM> void MMU_HostRangeWritten(u32 adr, u32 size);
+
 #endif
@@ -22,6 +22,7 @@
 #include <algorithm>
 #include <math.h>
 #include <zlib.h>
+#include <sys/stat.h>
 
 #include "utils/decrypt/decrypt.h"
 #include "utils/decrypt/crc.h"
@@ -54,6 +55,11 @@
 #include "slot2.h"
 #include "SPU.h"
 #include "wifi.h"
+#include "saves.h"
+#include "emufile.h"
+#include "batchstep.h"
+#include "statehash.h"
+#include "frameskip.h"
 
 #ifdef GDB_STUB
 #include "gdbstub.h"
@@ -99,7 +105,9 @@ TSCalInfo TSCal;
 
 namespace DLDI
 {
+	int findPatch(const void* data, size_t size);
 	bool tryPatch(void* data, size_t size, unsigned int device);
+	bool tryPatch(void* data, size_t size, unsigned int device, int patchOffset);
 }
 
 void Desmume_InitOnce()
@@ -642,6 +650,34 @@ u32 GameInfo::readROM(u32 pos)
 	return (LE_TO_LOCAL_32(data) & ~pad) | pad;
 }
 
+//reads count consecutive words, the same as calling readROM() for each of them
+void GameInfo::readROMBlock(u32 pos, u32 *buf, u32 count)
+{
+	const u32 size = count << 2;
+	u32 num;
+	if (!romdata)
+	{
+		if (lastReadPos != pos)
+			reader->Seek(fROM, pos + headerOffset, SEEK_SET);
+		num = reader->Read(fROM, buf, size);
+		lastReadPos = (pos + num);
+	}
+	else
+	{
+		num = (pos < romsize) ? std::min(size, romsize - pos) : 0;
+		memcpy(buf, romdata + pos, num);
+	}
+
+	//in case we didn't read enough data, pad the remainder with 0xFF
+	if (num < size)
+		memset((u8*)buf + num, 0xFF, size - num);
+
+#ifdef WORDS_BIGENDIAN
+	for (u32 i = 0; i < count; i++)
+		buf[i] = LE_TO_LOCAL_32(buf[i]);
+#endif
+}
+
 bool GameInfo::isDSiEnhanced()
 {
 	return _isDSiEnhanced;
@@ -691,6 +727,268 @@ static int rom_init_path(const char *filename, const char *physicalName, const c
 	return 1;
 }
 
+#define ROMSCAN_MAX_TASKS 16
+#define ROMSCAN_MIN_CHUNK (4*1024*1024)
+#define ROMSCAN_DLDI_UNKNOWN (-2)
+
+struct ROMScanWork
+{
+	const u8 *data;
+	u32 size;
+	u32 crc;
+	int dldiOffset;
+};
+
+static void* ROMScan_CRC(void *arg)
+{
+	ROMScanWork *work = (ROMScanWork *)arg;
+	work->crc = crc32(0, work->data, work->size);
+	return NULL;
+}
+
+static void* ROMScan_DLDI(void *arg)
+{
+	ROMScanWork *work = (ROMScanWork *)arg;
+	work->dldiOffset = DLDI::findPatch(work->data, work->size);
+	return NULL;
+}
+
+//crcs the rom in chunks on several threads and joins them with crc32_combine.
+//the DLDI search (if wanted) only reads the rom too, so it runs on its own thread alongside
+static void NDS_ScanROM(const u8 *data, u32 size, bool findDLDI, u32 &outCRC, int &outDLDIOffset)
+{
+	int chunks = std::max(1, std::min(getOnlineCores(), ROMSCAN_MAX_TASKS));
+	chunks = std::min<u32>(chunks, std::max<u32>(1, size / ROMSCAN_MIN_CHUNK));
+	const int taskCount = (chunks - 1) + (findDLDI ? 1 : 0);
+
+	ROMScanWork work[ROMSCAN_MAX_TASKS + 1];
+	const u32 chunkSize = (size / chunks) & ~3;
+	for (int i = 0; i < chunks; i++)
+	{
+		work[i].data = data + i * chunkSize;
+		work[i].size = (i == chunks - 1) ? (size - i * chunkSize) : chunkSize;
+	}
+	work[chunks].data = data;
+	work[chunks].size = size;
+	work[chunks].dldiOffset = -1;
+
+	Task *task = (taskCount > 0) ? new Task[taskCount] : NULL;
+	for (int i = 0; i < taskCount; i++)
+	{
+		task[i].start(false);
+		if (i < chunks - 1)
+			task[i].execute(&ROMScan_CRC, &work[i + 1]);
+		else
+			task[i].execute(&ROMScan_DLDI, &work[chunks]);
+	}
+
+	ROMScan_CRC(&work[0]);
+
+	for (int i = 0; i < taskCount; i++)
+	{
+		task[i].finish();
+		task[i].shutdown();
+	}
+	delete [] task;
+
+	u32 crc = work[0].crc;
+	for (int i = 1; i < chunks; i++)
+		crc = crc32_combine(crc, work[i].crc, work[i].size);
+
+	outCRC = crc;
+	outDLDIOffset = findDLDI ? work[chunks].dldiOffset : ROMSCAN_DLDI_UNKNOWN;
+}
+
+static std::string NDS_ROMScanCachePath()
+{
+	char buf[MAX_PATH];
+	path.getpathnoext(path.BATTERY, buf);
+	return std::string(buf) + ".crc";
+}
+
+//the cache entry is only good for the same file with the same size and modification time
+static bool NDS_LoadROMScanCache(const char *romFile, u32 &outCRC, int &outDLDIOffset)
+{
+	struct stat sb;
+	if (stat(romFile, &sb) == -1)
+		return false;
+
+	FILE *fp = fopen(NDS_ROMScanCachePath().c_str(), "r");
+	if (!fp)
+		return false;
+
+	char name[MAX_PATH];
+	unsigned long long size = 0, mtime = 0;
+	unsigned int crc = 0;
+	int dldiOffset = ROMSCAN_DLDI_UNKNOWN;
+	bool ok = (fgets(name, sizeof(name), fp) != NULL)
+		&& (fscanf(fp, "%llu %llu %08X %d", &size, &mtime, &crc, &dldiOffset) == 4);
+	fclose(fp);
+	if (!ok)
+		return false;
+
+	name[strcspn(name, "\r\n")] = 0;
+	if (strcmp(name, romFile) || size != (unsigned long long)sb.st_size || mtime != (unsigned long long)sb.st_mtime)
+		return false;
+
+	outCRC = crc;
+	outDLDIOffset = dldiOffset;
+	return true;
+}
+
+static void NDS_SaveROMScanCache(const char *romFile, u32 crc, int dldiOffset)
+{
+	struct stat sb;
+	if (stat(romFile, &sb) == -1)
+		return;
+
+	FILE *fp = fopen(NDS_ROMScanCachePath().c_str(), "w");
+	if (!fp)
+		return;
+
+	fprintf(fp, "%s\n%llu %llu %08X %d\n", romFile, (unsigned long long)sb.st_size, (unsigned long long)sb.st_mtime, crc, dldiOffset);
+	fclose(fp);
+}
+
+//----boot snapshot cache
+//the snapshot file is a small key followed by an ordinary savestate. the key covers everything which decides how
+//the boot goes, so any change to those just means booting normally once more and replacing the snapshot.
+#define BOOTSNAPSHOT_VERSION 1
+#define BOOTSNAPSHOT_MAX_FRAMES (60*60)
+static const u32 kBootSnapshot = 0x53425344; //'DSBS'
+
+struct BootSnapshotKey
+{
+	u32 romCRC;
+	u32 arm7BiosCRC;
+	u32 arm9BiosCRC;
+	u32 firmwareCRC;
+	u32 backupCRC;
+	u32 settingsCRC;
+};
+
+static BootSnapshotKey bootSnapshotKey;
+static bool bootSnapshotPending = false; //firmware boot in progress; waiting for the ARM9 to reach the game's entrypoint
+static bool bootSnapshotReached = false; //it got there; snapshot at the end of this frame
+static u32 bootSnapshotEntry = 0;
+static int bootSnapshotFrames = 0;
+
+//set around resets which must really boot (movies count frames from power-on)
+bool _HACK_NO_BOOT_SNAPSHOT = false;
+
+static std::string NDS_BootSnapshotPath()
+{
+	char buf[MAX_PATH];
+	path.getpathnoext(path.STATES, buf);
+	return std::string(buf) + ".dsboot";
+}
+
+static void NDS_MakeBootSnapshotKey(bool bootFromFirmware, BootSnapshotKey &key)
+{
+	key.romCRC = gameInfo.crc;
+	key.arm7BiosCRC = crc32(0, MMU.ARM7_BIOS, sizeof(MMU.ARM7_BIOS));
+	key.arm9BiosCRC = crc32(0, MMU.ARM9_BIOS, sizeof(MMU.ARM9_BIOS));
+	key.firmwareCRC = crc32(0, MMU.fw.data, MMU.fw.size);
+
+	//the snapshot carries the save memory along with it, so it must not roll back a save file which changed since
+	key.backupCRC = 0;
+	MMU_new.backupDevice.flushBackup();
+	EMUFILE_FILE backup(MMU_new.backupDevice.getFilename(), "rb");
+	if (!backup.fail() && backup.size() > 0)
+	{
+		std::vector<u8> buf(backup.size());
+		backup.fread(&buf[0], buf.size());
+		key.backupCRC = crc32(0, &buf[0], buf.size());
+	}
+
+	const u32 settings[] = {
+		EMU_DESMUME_VERSION_NUMERIC(),
+		(u32)CommonSettings.ConsoleType,
+		CommonSettings.DebugConsole,
+		CommonSettings.EnsataEmulation,
+		CommonSettings.UseExtBIOS,
+		CommonSettings.SWIFromBIOS,
+		CommonSettings.PatchSWI3,
+		CommonSettings.UseExtFirmware,
+		CommonSettings.UseExtFirmwareSettings,
+		bootFromFirmware,
+		CommonSettings.advanced_timing,
+		CommonSettings.rigorous_timing,
+		CommonSettings.use_jit,
+		CommonSettings.jit_max_block_size,
+		(u32)slot1_GetCurrentType(),
+		(u32)slot2_GetCurrentType(),
+		gameInfo.romsize,
+	};
+	//the firmware user settings go in field by field, since the struct's padding bytes are whatever was there before
+	const NDS_fw_config_data &fw = CommonSettings.fw_config;
+	EMUFILE_MEMORY fwSettings;
+	fwSettings.write32le((u32)fw.ds_type);
+	fwSettings.write8le(fw.fav_colour);
+	fwSettings.write8le(fw.birth_month);
+	fwSettings.write8le(fw.birth_day);
+	fwSettings.write8le(fw.nickname_len);
+	for (int i = 0; i < std::min<int>(fw.nickname_len, MAX_FW_NICKNAME_LENGTH); i++)
+		fwSettings.write16le(fw.nickname[i]);
+	fwSettings.write8le(fw.message_len);
+	for (int i = 0; i < std::min<int>(fw.message_len, MAX_FW_MESSAGE_LENGTH); i++)
+		fwSettings.write16le(fw.message[i]);
+	fwSettings.write8le(fw.language);
+	for (int i = 0; i < 2; i++)
+	{
+		fwSettings.write16le(fw.touch_cal[i].adc_x);
+		fwSettings.write16le(fw.touch_cal[i].adc_y);
+		fwSettings.write8le(fw.touch_cal[i].screen_x);
+		fwSettings.write8le(fw.touch_cal[i].screen_y);
+	}
+
+	u32 crc = crc32(0, (const u8*)settings, sizeof(settings));
+	crc = crc32(crc, fwSettings.buf(), fwSettings.size());
+	crc = crc32(crc, (const u8*)path.RomName.c_str(), path.RomName.size()); //fake boot puts it in the homebrew argv
+	key.settingsCRC = crc;
+}
+
+enum BootSnapshotResult
+{
+	BootSnapshot_None,		//no usable snapshot; nothing was touched
+	BootSnapshot_Loaded,
+	BootSnapshot_Failed,	//savestate_load failed, after it may have reset the emulator and loaded part of the state
+};
+
+static BootSnapshotResult NDS_RestoreBootSnapshot(const BootSnapshotKey &key)
+{
+	EMUFILE_FILE fp(NDS_BootSnapshotPath(), "rb");
+	if (fp.fail() || fp.size() <= 0)
+		return BootSnapshot_None;
+
+	std::vector<u8> buf(fp.size());
+	fp.fread(&buf[0], buf.size());
+	EMUFILE_MEMORY ms(&buf);
+	BootSnapshotKey fileKey;
+	if (ms.read32le() != kBootSnapshot || ms.read32le() != BOOTSNAPSHOT_VERSION)
+		return BootSnapshot_None;
+	if (ms.fread(&fileKey, sizeof(fileKey)) != sizeof(fileKey) || memcmp(&fileKey, &key, sizeof(key)))
+		return BootSnapshot_None;
+
+	return savestate_load(&ms) ? BootSnapshot_Loaded : BootSnapshot_Failed;
+}
+
+static void NDS_SaveBootSnapshot()
+{
+	EMUFILE_MEMORY ms;
+	if (!savestate_save(&ms, Z_BEST_SPEED))
+		return;
+
+	EMUFILE_FILE fp(NDS_BootSnapshotPath(), "wb");
+	if (fp.fail())
+		return;
+
+	fp.write32le(kBootSnapshot);
+	fp.write32le((u32)BOOTSNAPSHOT_VERSION);
+	fp.fwrite(&bootSnapshotKey, sizeof(bootSnapshotKey));
+	fp.fwrite(ms.buf(), ms.size());
+}
+
 int NDS_LoadROM(const char *filename, const char *physicalName, const char *logicalFilename)
 {
 	int	ret;
@@ -715,10 +1013,33 @@ int NDS_LoadROM(const char *filename, const char *physicalName, const char *logi
 	
 	gameInfo.populate();
 	
+	//for homebrew, try auto-patching DLDI. the search for its section is done along with the crc
+	int dldiDevice = -1;
+	if (gameInfo.isHomebrew())
+	{
+		if (slot1_GetCurrentType() == NDS_SLOT1_R4)
+			dldiDevice = 1;
+		else
+			if (slot2_GetCurrentType() == NDS_SLOT2_CFLASH)
+				dldiDevice = 0;
+	}
+
+	int dldiOffset = ROMSCAN_DLDI_UNKNOWN;
+	gameInfo.crc = 0;
 	if (CommonSettings.loadToMemory)
-		gameInfo.crc = crc32(0, (u8*)gameInfo.romdata, gameInfo.romsize);
-	else
-		gameInfo.crc = 0;
+	{
+		const char *romFile = physicalName ? physicalName : path.path.c_str();
+		bool cached = CommonSettings.cacheROMScans && NDS_LoadROMScanCache(romFile, gameInfo.crc, dldiOffset);
+		if (cached && dldiDevice != -1 && dldiOffset == ROMSCAN_DLDI_UNKNOWN)
+			cached = false;
+
+		if (!cached)
+		{
+			NDS_ScanROM(gameInfo.romdata, gameInfo.romsize, dldiDevice != -1, gameInfo.crc, dldiOffset);
+			if (CommonSettings.cacheROMScans)
+				NDS_SaveROMScanCache(romFile, gameInfo.crc, dldiOffset);
+		}
+	}
 
 	gameInfo.chipID  = 0xC2;														// The Manufacturer ID is defined by JEDEC (C2h = Macronix)
 	if (!gameInfo.isHomebrew())
@@ -784,12 +1105,8 @@ int NDS_LoadROM(const char *filename, const char *physicalName, const char *logi
 	{
 		if(!CommonSettings.loadToMemory)
 			msgbox->warn("Sorry.. right now, you can't use the default (stream rom from disk) with homebrew due to a bug with DLDI-autopatching");
-		if (slot1_GetCurrentType() == NDS_SLOT1_R4)
-			DLDI::tryPatch((void*)gameInfo.romdata, gameInfo.romsize, 1);
-		else
-			if (slot2_GetCurrentType() == NDS_SLOT2_CFLASH)
-				DLDI::tryPatch((void*)gameInfo.romdata, gameInfo.romsize, 0);
-
+		if (dldiDevice != -1 && dldiOffset != ROMSCAN_DLDI_UNKNOWN)
+			DLDI::tryPatch((void*)gameInfo.romdata, gameInfo.romsize, dldiDevice, dldiOffset);
 	}
 
 	if (cheats != NULL)
@@ -820,93 +1137,6 @@ void NDS_TriggerCardEjectIRQ()
 }
 
 
-class FrameSkipper
-{
-public:
-	void RequestSkip()
-	{
-		nextSkip = true;
-	}
-	void OmitSkip(bool force, bool forceEvenIfCapturing=false)
-	{
-		nextSkip = false;
-		if((force && consecutiveNonCaptures > 30) || forceEvenIfCapturing)
-		{
-			SkipCur2DFrame = false;
-			SkipCur3DFrame = false;
-			SkipNext2DFrame = false;
-			if(forceEvenIfCapturing)
-				consecutiveNonCaptures = 0;
-		}
-	}
-	void Advance()
-	{
-		const GPUEngineA *mainEngine = GPU->GetEngineMain();
-		const IOREG_DISPCAPCNT &DISPCAPCNT = mainEngine->GetIORegisterMap().DISPCAPCNT;
-		const bool capturing = (DISPCAPCNT.CaptureEnable != 0);
-
-		if(capturing && consecutiveNonCaptures > 30)
-		{
-			// the worst-looking graphics corruption problems from frameskip
-			// are the result of skipping the capture on first frame it turns on.
-			// so we do this to handle the capture immediately,
-			// despite the risk of 1 frame of 2d/3d mismatch or wrong screen display.
-			SkipNext2DFrame = false;
-			nextSkip = false;
-		}
-		else if((lastDisplayTarget != mainEngine->GetDisplayByID()) && lastSkip && !skipped)
-		{
-			// if we're switching from not skipping to skipping
-			// and the screens are also switching around this frame,
-			// go for 1 extra frame without skipping.
-			// this avoids the scenario where we only draw one of the two screens
-			// when a game is switching screens every frame.
-			nextSkip = false;
-		}
-
-		if(capturing)
-			consecutiveNonCaptures = 0;
-		else if(!(consecutiveNonCaptures > 9000)) // arbitrary cap to avoid eventual wrap
-			consecutiveNonCaptures++;
-		
-		lastDisplayTarget = mainEngine->GetDisplayByID();
-		lastSkip = skipped;
-		skipped = nextSkip;
-		nextSkip = false;
-
-		SkipCur2DFrame = SkipNext2DFrame;
-		SkipCur3DFrame = skipped;
-		SkipNext2DFrame = skipped;
-	}
-	FORCEINLINE bool ShouldSkip2D()
-	{
-		return SkipCur2DFrame;
-	}
-	FORCEINLINE bool ShouldSkip3D()
-	{
-		return SkipCur3DFrame;
-	}
-	FrameSkipper()
-	{
-		nextSkip = false;
-		skipped = false;
-		lastSkip = false;
-		lastDisplayTarget = NDSDisplayID_Main;
-		SkipCur2DFrame = false;
-		SkipCur3DFrame = false;
-		SkipNext2DFrame = false;
-		consecutiveNonCaptures = 0;
-	}
-private:
-	bool nextSkip;
-	bool skipped;
-	bool lastSkip;
-	NDSDisplayID lastDisplayTarget;
-	int consecutiveNonCaptures;
-	bool SkipCur2DFrame;
-	bool SkipCur3DFrame;
-	bool SkipNext2DFrame;
-};
 static FrameSkipper frameSkipper;
 
 
@@ -1372,7 +1602,11 @@ static void execHardware_hblank()
 	//even though it sounds more reasonable to do it at hstart
 	SPU_Emulate_core();
 	driver->AVI_SoundUpdate(SPU_core->outbuf,spu_core_samples);
+	if(driver->SND_IsExporting())
+		driver->SND_ExportUpdate(SPU_core->outbuf,spu_core_samples);
 	WAV_WavSoundUpdate(SPU_core->outbuf,spu_core_samples);
+	if(batchstep_listening)
+		BatchStep_SoundUpdate(SPU_core->outbuf,spu_core_samples);
 }
 
 static void execHardware_hstart_vblankEnd()
@@ -1385,7 +1619,8 @@ static void execHardware_hstart_vblankEnd()
 	T1WriteWord(MMU.ARM7_REG, 4, T1ReadWord(MMU.ARM7_REG, 4) & ~1);
 
 	//some emulation housekeeping
-	frameSkipper.Advance();
+	const GPUEngineA *mainEngine = GPU->GetEngineMain();
+	frameSkipper.Advance(mainEngine->GetIORegisterMap().DISPCAPCNT.CaptureEnable != 0, mainEngine->GetDisplayByID());
 }
 
 static void execHardware_hstart_vblankStart()
@@ -1839,6 +2074,11 @@ static /*donotinline*/ std::pair<s32,s32> armInnerLoop(
 			{
 				arm9log();
 				debug();
+				if(bootSnapshotPending && NDS_ARM9.instruct_adr == bootSnapshotEntry)
+				{
+					bootSnapshotPending = false;
+					bootSnapshotReached = true;
+				}
 #ifdef HAVE_JIT
 				arm9 += armcpu_exec<ARMCPU_ARM9,jit>();
 #else
@@ -2059,6 +2299,21 @@ void NDS_exec(s32 nb)
 	DEBUG_Notify.NextFrame();
 	if(cheats) cheats->process(CHEAT_TYPE_INTERNAL);
 
+	if(statehash_enabled)
+	{
+		StateHash_EndFrame();
+		FCEUMOV_HandleStateHash();
+	}
+
+	//a firmware boot reached the game during this frame, so this frame boundary is as close as we can snapshot it
+	if(bootSnapshotReached)
+	{
+		bootSnapshotReached = false;
+		NDS_SaveBootSnapshot();
+	}
+	else if(bootSnapshotPending && ++bootSnapshotFrames > BOOTSNAPSHOT_MAX_FRAMES)
+		bootSnapshotPending = false; //probably sitting in the firmware menu; give up
+
         #ifdef GDB_STUB
         gdbstub_mutex_unlock();
         #endif
@@ -2519,6 +2774,7 @@ void NDS_Reset()
 
 	resetUserInput();
 
+	bootSnapshotPending = bootSnapshotReached = false;
 	
 	singleStep = false;
 	nds_debug_continuing[0] = nds_debug_continuing[1] = false;
@@ -2550,6 +2806,8 @@ void NDS_Reset()
 	MMU_Reset();
 	SetupMMU(nds.Is_DebugConsole(),nds.Is_DSI());
 	JumbleMemory();
+	//the bios, firmware and rom loading below write memory directly
+	StateHash_Invalidate();
 
 	#ifdef HAVE_JIT
 		arm_jit_reset(CommonSettings.use_jit);
@@ -2581,6 +2839,29 @@ void NDS_Reset()
 	//2. firmware is available
 	//3. user has requested booting from firmware
 	bool canBootFromFirmware = (NDS_ARM7.BIOS_loaded && NDS_ARM9.BIOS_loaded && CommonSettings.BootFromFirmware && firmware->loaded());
+
+	//the loadstate's own reset mustn't go looking for a snapshot, and neither may a movie's power-on.
+	//without a crc we can't tell whether the rom changed, so streamed roms can't use the cache either
+	bool useBootSnapshot = CommonSettings.cacheBootSnapshot && gameInfo.crc != 0
+		&& movieMode == MOVIEMODE_INACTIVE && !_HACK_DONT_STOPMOVIE && !_HACK_NO_BOOT_SNAPSHOT;
+	if(useBootSnapshot)
+	{
+		NDS_MakeBootSnapshotKey(canBootFromFirmware, bootSnapshotKey);
+		const BootSnapshotResult result = NDS_RestoreBootSnapshot(bootSnapshotKey);
+		if(result == BootSnapshot_Loaded)
+			return;
+		if(result == BootSnapshot_Failed)
+		{
+			//whatever half of the snapshot got loaded is in the way, so it's a full cold reset from the top.
+			//that boots normally and writes a new snapshot, unless the bad one can't even be removed
+			if(remove(NDS_BootSnapshotPath().c_str()) != 0)
+				_HACK_NO_BOOT_SNAPSHOT = true;
+			NDS_Reset();
+			_HACK_NO_BOOT_SNAPSHOT = false;
+			return;
+		}
+	}
+
 	bool bootResult = false;
 	if(canBootFromFirmware)
 		bootResult = NDS_LegitBoot();
@@ -2600,6 +2881,19 @@ void NDS_Reset()
 
 	//this needs to happen last, pretty much, since it establishes the correct scheduling state based on all of the above initialization
 	initSchedule();
+
+	if(useBootSnapshot && bootResult)
+	{
+		if(canBootFromFirmware)
+		{
+			//the firmware takes a while to get to the game; armInnerLoop watches for it
+			bootSnapshotEntry = gameInfo.header.ARM9exe;
+			bootSnapshotFrames = 0;
+			bootSnapshotPending = true;
+		}
+		else
+			NDS_SaveBootSnapshot(); //fake boot leaves us sitting on the game's first instruction already
+	}
 }
 
 static std::string MakeInputDisplayString(u16 pad, const std::string* Buttons, int count) {
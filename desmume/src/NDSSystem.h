@@ -355,6 +355,7 @@ struct GameInfo
 	bool loadROM(std::string fname, u32 type = ROM_NDS);
 	void closeROM();
 	u32 readROM(u32 pos);
+	void readROMBlock(u32 pos, u32 *buf, u32 count);
 	bool ValidateHeader();
 	void populate();
 	bool isDSiEnhanced();
@@ -486,10 +487,13 @@ extern struct TCommonSettings {
 		, GFX3D_Renderer_TextureScalingFactor(1) // Possible values: 1, 2, 4
 		, GFX3D_Renderer_TextureDeposterize(false)
 		, GFX3D_Renderer_TextureSmoothing(false)
+		, GFX3D_Renderer_DeferredTexturing(true)
 		, GFX3D_TXTHack(false)
 		, GFX3D_PrescaleHD(1)
 		, jit_max_block_size(100)
 		, loadToMemory(false)
+		, cacheROMScans(false)
+		, cacheBootSnapshot(false)
 		, UseExtBIOS(false)
 		, SWIFromBIOS(false)
 		, PatchSWI3(false)
@@ -511,6 +515,7 @@ extern struct TCommonSettings {
 		, ConsoleType(NDS_CONSOLE_TYPE_FAT)
 		, StylusJitter(false)
 		, backupSave(false)
+		, movieStateHashing(false)
 		, SPU_sync_mode(0)
 		, SPU_sync_method(0)
 	{
@@ -549,12 +554,20 @@ extern struct TCommonSettings {
 	int GFX3D_Renderer_TextureScalingFactor;
 	bool GFX3D_Renderer_TextureDeposterize;
 	bool GFX3D_Renderer_TextureSmoothing;
+	//SoftRasterizer: texture and shade opaque polys only where they end up visible. the output is the same either way
+	bool GFX3D_Renderer_DeferredTexturing;
 	bool GFX3D_TXTHack;
 
 	//may not want this on OSX port
 	int GFX3D_PrescaleHD;
 
 	bool loadToMemory;
+	//remember the rom crc and DLDI offset in a small file next to the battery save,
+	//so that booting the same untouched rom again doesn't scan all of it
+	bool cacheROMScans;
+	//keep a savestate of the machine as it reaches the game's first instruction, and restore it
+	//instead of booting whenever the rom, bioses, firmware, save file and boot settings all still match
+	bool cacheBootSnapshot;
 
 	bool UseExtBIOS;
 	char ARM9BIOS[256];
@@ -612,6 +625,9 @@ extern struct TCommonSettings {
 	int manualBackupType;
 	bool backupSave;
 
+	//keep a hash of the emulated state for every frame of a movie being recorded, so playback can tell where it desyncs
+	bool movieStateHashing;
+
 	int SPU_sync_mode;
 	int SPU_sync_method;
 
@@ -40,6 +40,7 @@
 #include "armcpu.h"
 #include "NDSSystem.h"
 #include "matrix.h"
+#include "batchstep.h"
 
 
 static inline s16 read16(u32 addr) { return (s16)_MMU_read16<ARMCPU_ARM7,MMU_AT_DEBUG>(addr); }
@@ -1665,7 +1666,7 @@ void SPU_Emulate_core()
 	// However, recording still needs to mix the audio, so make sure we're also
 	// not recording before we disable mixing.
 	if ( synchmode == ESynchMode_DualSynchAsynch &&
-		!(driver->AVI_IsRecording() || driver->WAV_IsRecording()) )
+		!(driver->AVI_IsRecording() || driver->WAV_IsRecording() || driver->SND_IsExporting() || batchstep_listening) )
 	{
 		needToMix = false;
 	}
@@ -89,6 +89,10 @@ public:
 	{
 		return protocol.read_GCDATAIN(PROCNUM);
 	}
+	virtual void read_GCDATAIN_block(u8 PROCNUM, u32 *buf, u32 count)
+	{
+		protocol.read_GCDATAIN_block(PROCNUM, buf, count);
+	}
 
 	virtual void slot1client_startOperation(eSlot1Operation operation)
 	{
@@ -149,6 +153,18 @@ public:
 		return val;
 	}
 
+	virtual void slot1client_read_GCDATAIN_block(eSlot1Operation operation, u32 *buf, u32 count)
+	{
+		//sector reads come straight out of the image
+		if(operation == eSlot1Operation_Unknown && protocol.command.bytes[0] == 0xBA)
+		{
+			img->fread(buf, count*4);
+			return;
+		}
+
+		ISlot1Comp_Protocol_Client::slot1client_read_GCDATAIN_block(operation, buf, count);
+	}
+
 	void slot1client_write_GCDATAIN(eSlot1Operation operation, u32 val)
 	{
 		if(operation != eSlot1Operation_Unknown)
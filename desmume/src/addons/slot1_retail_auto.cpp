@@ -73,6 +73,11 @@ public:
 		return mSelectedImplementation->read_GCDATAIN(PROCNUM);
 	}
 
+	virtual void read_GCDATAIN_block(u8 PROCNUM, u32 *buf, u32 count)
+	{
+		mSelectedImplementation->read_GCDATAIN_block(PROCNUM, buf, count);
+	}
+
 	virtual u8 auxspi_transaction(int PROCNUM, u8 value)
 	{
 		return mSelectedImplementation->auxspi_transaction(PROCNUM, value);
@@ -87,6 +87,10 @@ public:
 	{
 		return protocol.read_GCDATAIN(PROCNUM);
 	}
+	virtual void read_GCDATAIN_block(u8 PROCNUM, u32 *buf, u32 count)
+	{
+		protocol.read_GCDATAIN_block(PROCNUM, buf, count);
+	}
 
 	virtual void slot1client_startOperation(eSlot1Operation operation)
 	{
@@ -241,6 +245,26 @@ public:
 		return val;
 	}
 
+	virtual void slot1client_read_GCDATAIN_block(eSlot1Operation operation, u32 *buf, u32 count)
+	{
+		//rom reads can be streamed by the rom component; saves and status reads go word by word
+		switch(operation)
+		{
+			case eSlot1Operation_00_ReadHeader_Unencrypted:
+			case eSlot1Operation_2x_SecureAreaLoad:
+				rom.readBlock(buf, count);
+				return;
+		}
+
+		if(protocol.command.bytes[0] == 0xB7 && !handle_save)
+		{
+			rom.readBlock(buf, count);
+			return;
+		}
+
+		ISlot1Comp_Protocol_Client::slot1client_read_GCDATAIN_block(operation, buf, count);
+	}
+
 	virtual void slot1client_write_GCDATAIN(eSlot1Operation operation, u32 val)
 	{
 		//pass the normal rom operations along to the rom component
@@ -228,6 +228,28 @@ u32 Slot1Comp_Protocol::read_GCDATAIN(u8 PROCNUM)
 	return 0xFFFFFFFF;
 }
 
+void Slot1Comp_Protocol::read_GCDATAIN_block(u8 PROCNUM, u32 *buf, u32 count)
+{
+	switch(operation)
+	{
+		default:
+			client->slot1client_read_GCDATAIN_block(operation, buf, count);
+			return;
+
+		case eSlot1Operation_9F_Dummy:
+		case eSlot1Operation_1x_ChipID:
+		case eSlot1Operation_90_ChipID:
+		case eSlot1Operation_B8_ChipID:
+		{
+			//these return the same word for as long as the transfer lasts
+			const u32 val = read_GCDATAIN(PROCNUM);
+			for(u32 i = 0; i < count; i++)
+				buf[i] = val;
+			return;
+		}
+	}
+}
+
 void Slot1Comp_Protocol::savestate(EMUFILE* os)
 {
 	s32 version = 0;
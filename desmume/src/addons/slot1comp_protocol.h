@@ -61,6 +61,11 @@ class ISlot1Comp_Protocol_Client
 public:
 	virtual void slot1client_startOperation(eSlot1Operation operation) {}
 	virtual u32 slot1client_read_GCDATAIN(eSlot1Operation operation) = 0;
+	virtual void slot1client_read_GCDATAIN_block(eSlot1Operation operation, u32 *buf, u32 count)
+	{
+		for(u32 i = 0; i < count; i++)
+			buf[i] = slot1client_read_GCDATAIN(operation);
+	}
 	virtual void slot1client_write_GCDATAIN(eSlot1Operation operation, u32 val) {}
 };
 
@@ -79,6 +84,7 @@ public:
 	void write_command(GC_Command command);
 	void write_GCDATAIN(u8 PROCNUM, u32 val);
 	u32 read_GCDATAIN(u8 PROCNUM);
+	void read_GCDATAIN_block(u8 PROCNUM, u32 *buf, u32 count);
 
 	//helpers for write_command()
 	void write_command_RAW(GC_Command command);
@@ -93,6 +93,36 @@ u32 Slot1Comp_Rom::read()
 	} //switch(operation)
 } //Slot1Comp_Rom::read()
 
+void Slot1Comp_Rom::readBlock(u32 *buf, u32 count)
+{
+	//only plain B7 reads are worth streaming. everything else is tiny and goes word by word
+	while(count > 0 && operation == eSlot1Operation_B7_Read)
+	{
+		//same address sanitizing as read()
+		address &= gameInfo.mask;
+		if(address < 0x8000)
+			address = (0x8000 + (address & 0x1FF));
+
+		//misaligned streams and reads off the end of the rom need the careful path
+		if(address & 3)
+			break;
+
+		//the datastream wraps inside the current 4K block, so a run can't go past its end
+		u32 run = (0x1000 - (address & 0xFFF)) >> 2;
+		if(run > count) run = count;
+		if(address + (run << 2) > gameInfo.romsize)
+			break;
+
+		gameInfo.readROMBlock(address, buf, run);
+		address = (address&~0xFFF) + ((address + (run << 2))&0xFFF);
+		buf += run;
+		count -= run;
+	}
+
+	for(u32 i = 0; i < count; i++)
+		buf[i] = read();
+} //Slot1Comp_Rom::readBlock()
+
 u32 Slot1Comp_Rom::getAddress()
 {
 	return address & gameInfo.mask;
@@ -31,6 +31,7 @@ class Slot1Comp_Rom
 public:
 	void start(eSlot1Operation operation, u32 addr);
 	u32 read();
+	void readBlock(u32 *buf, u32 count);
 	u32 getAddress();
 	u32 incAddress();
 
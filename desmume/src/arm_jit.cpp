@@ -2178,6 +2178,13 @@ static FORCEINLINE FASTCALL u32 OP_LDM_STM_main(u32 adr, u64 regs, int n, u8 *pt
 #undef ADV_CYCLES
 }
 
+// the fast paths below store straight into host memory
+template <int dir>
+static FORCEINLINE void OP_STM_MarkWritten(u8 *ptr, int n)
+{
+	StateHash_MarkHost((dir > 0) ? ptr : ptr - (n-1)*4, n*4);
+}
+
 template <int PROCNUM, bool store, int dir>
 static u32 FASTCALL OP_LDM_STM(u32 adr, u64 regs, int n)
 {
@@ -2197,12 +2204,17 @@ static u32 FASTCALL OP_LDM_STM(u32 adr, u64 regs, int n)
 		ptr = MMU.ARM9_DTCM + (adr & 0x3FFC);
 		cycles = n * MMU_memAccessCycles<PROCNUM,32,store?MMU_AD_WRITE:MMU_AD_READ>(adr);
 		if(store)
+		{
+			OP_STM_MarkWritten<dir>(ptr, n);
 			return OP_LDM_STM_main<PROCNUM, store, dir, 0>(adr, regs, n, ptr, cycles);
+		}
 	}
 	else if((adr & 0x0F000000) == 0x02000000)
 	{
 		ptr = MMU.MAIN_MEM + (adr & _MMU_MAIN_MEM_MASK32);
 		cycles = n * ((PROCNUM==ARMCPU_ARM9) ? 4 : 2);
+		if(store)
+			OP_STM_MarkWritten<dir>(ptr, n);
 	}
 	else if(PROCNUM==ARMCPU_ARM7 && !store && (adr & 0xFF800000) == 0x03800000)
 	{
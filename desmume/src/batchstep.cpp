@@ -0,0 +1,255 @@
+/*
+	Copyright (C) 2016 DeSmuME team
+
+	This file is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the this software.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "batchstep.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#include "types.h"
+#include "NDSSystem.h"
+#include "MMU.h"
+#include "GPU.h"
+#include "movie.h"
+
+bool batchstep_listening = false;
+static double audioSumSquares;
+static u64 audioSampleCount;
+
+void BatchStep_SoundUpdate(void *soundData, int numSamples)
+{
+	const s16 *samples = (const s16 *)soundData;
+	double sum = 0;
+	for (int i = 0; i < numSamples * 2; i++)
+		sum += (double)samples[i] * samples[i];
+	audioSumSquares += sum;
+	audioSampleCount += numSamples * 2;
+}
+
+//reads a pixel of each output format as r,g,b out of MAX
+template<NDSColorFormat FORMAT> struct StepPixel;
+template<> struct StepPixel<NDSColorFormat_BGR555_Rev>
+{
+	enum { MAX = 31 };
+	static FORCEINLINE void get(const void *buf, size_t i, u32 &r, u32 &g, u32 &b)
+	{
+		const u16 c = LE_TO_LOCAL_16(((const u16 *)buf)[i]);
+		r = c & 0x1F; g = (c >> 5) & 0x1F; b = (c >> 10) & 0x1F;
+	}
+};
+template<> struct StepPixel<NDSColorFormat_BGR666_Rev>
+{
+	enum { MAX = 63 };
+	static FORCEINLINE void get(const void *buf, size_t i, u32 &r, u32 &g, u32 &b)
+	{
+		const u32 c = LE_TO_LOCAL_32(((const u32 *)buf)[i]);
+		r = c & 0xFF; g = (c >> 8) & 0xFF; b = (c >> 16) & 0xFF;
+	}
+};
+template<> struct StepPixel<NDSColorFormat_BGR888_Rev>
+{
+	enum { MAX = 255 };
+	static FORCEINLINE void get(const void *buf, size_t i, u32 &r, u32 &g, u32 &b)
+	{
+		const u32 c = LE_TO_LOCAL_32(((const u32 *)buf)[i]);
+		r = c & 0xFF; g = (c >> 8) & 0xFF; b = (c >> 16) & 0xFF;
+	}
+};
+
+//box filters one display down to outW x outH
+template<NDSColorFormat FORMAT>
+static u8* DownscaleDisplay(const void *src, size_t srcW, size_t srcH, size_t outW, size_t outH, bool gray, u8 *dst)
+{
+	//custom framebuffer sizes needn't be an exact multiple of the output, so the boxes are placed proportionally
+	const size_t boxW = std::max<size_t>(1, srcW / outW);
+	const size_t boxH = std::max<size_t>(1, srcH / outH);
+	const u64 scale = (u64)boxW * boxH * StepPixel<FORMAT>::MAX;
+
+	for (size_t y = 0; y < outH; y++)
+	{
+		const size_t sy = y * srcH / outH;
+		for (size_t x = 0; x < outW; x++)
+		{
+			const size_t sx = x * srcW / outW;
+			u64 sumR = 0, sumG = 0, sumB = 0;
+			for (size_t by = 0; by < boxH; by++)
+			{
+				const size_t row = (sy + by) * srcW + sx;
+				for (size_t bx = 0; bx < boxW; bx++)
+				{
+					u32 r, g, b;
+					StepPixel<FORMAT>::get(src, row + bx, r, g, b);
+					sumR += r; sumG += g; sumB += b;
+				}
+			}
+
+			const u32 r = (u32)(sumR * 255 / scale);
+			const u32 g = (u32)(sumG * 255 / scale);
+			const u32 b = (u32)(sumB * 255 / scale);
+			if (gray)
+				*dst++ = (u8)((r * 77 + g * 150 + b * 29) >> 8);
+			else
+			{
+				*dst++ = (u8)r;
+				*dst++ = (u8)g;
+				*dst++ = (u8)b;
+			}
+		}
+	}
+
+	return dst;
+}
+
+static void ObserveFrame(const NDS_StepObservationSpec &spec)
+{
+	const NDSDisplayInfo &info = GPU->GetDisplayInfo();
+	const size_t outW = GPU_FRAMEBUFFER_NATIVE_WIDTH / spec.frameScale;
+	const size_t outH = GPU_FRAMEBUFFER_NATIVE_HEIGHT / spec.frameScale;
+	const bool gray = (spec.frameFormat == NDS_STEP_FRAME_GRAY8);
+
+	NDSColorFormat format = info.colorFormat;
+	if (format == NDSColorFormat_BGR666_Rev && GPU->GetWillAutoConvertRGB666ToRGB888())
+		format = NDSColorFormat_BGR888_Rev;
+
+	u8 *dst = spec.frame;
+	for (int i = 0; i < 2; i++)
+	{
+		const void *src = info.renderedBuffer[i];
+		const size_t srcW = info.renderedWidth[i];
+		const size_t srcH = info.renderedHeight[i];
+		switch (format)
+		{
+			case NDSColorFormat_BGR555_Rev: dst = DownscaleDisplay<NDSColorFormat_BGR555_Rev>(src, srcW, srcH, outW, outH, gray, dst); break;
+			case NDSColorFormat_BGR666_Rev: dst = DownscaleDisplay<NDSColorFormat_BGR666_Rev>(src, srcW, srcH, outW, outH, gray, dst); break;
+			case NDSColorFormat_BGR888_Rev: dst = DownscaleDisplay<NDSColorFormat_BGR888_Rev>(src, srcW, srcH, outW, outH, gray, dst); break;
+		}
+	}
+}
+
+static void ObserveRAM(const NDS_StepObservationSpec &spec)
+{
+	for (u32 i = 0; i < spec.ramSliceCount; i++)
+	{
+		u32 address = spec.ramSlices[i].address;
+		u32 length = spec.ramSlices[i].size;
+		u8 *dst = spec.ramSlices[i].dst;
+
+		//plain memory goes a run at a time, everything else through the MMU
+		while (length > 0)
+		{
+			u32 contiguous;
+			const u8 *src = MMU_GetHostRange<ARMCPU_ARM9>(address, contiguous, false);
+			if (src)
+			{
+				const u32 todo = std::min(contiguous, length);
+				memcpy(dst, src, todo);
+				address += todo;
+				dst += todo;
+				length -= todo;
+			}
+			else
+			{
+				*dst++ = _MMU_read08<ARMCPU_ARM9>(address++);
+				length--;
+			}
+		}
+	}
+}
+
+static bool ValidateSpec(const NDS_StepObservationSpec &spec)
+{
+	if (spec.observations & NDS_STEP_OBS_FRAME)
+	{
+		switch (spec.frameScale)
+		{
+			case 1: case 2: case 4: case 8: case 16: break;
+			default: return false;
+		}
+		if (spec.frameFormat != NDS_STEP_FRAME_RGB888 && spec.frameFormat != NDS_STEP_FRAME_GRAY8)
+			return false;
+		if (spec.frame == NULL)
+			return false;
+	}
+
+	if (spec.observations & NDS_STEP_OBS_RAM)
+	{
+		if (spec.ramSliceCount > 0 && spec.ramSlices == NULL)
+			return false;
+		for (u32 i = 0; i < spec.ramSliceCount; i++)
+			if (spec.ramSlices[i].size > 0 && spec.ramSlices[i].dst == NULL)
+				return false;
+	}
+
+	if ((spec.observations & NDS_STEP_OBS_AUDIO) && spec.audioEnergy == NULL)
+		return false;
+
+	return true;
+}
+
+int NDS_Step(int frameCount, const NDS_StepInput *inputs, const NDS_StepObservationSpec *spec)
+{
+	if (frameCount < 0)
+		return -1;
+	if (spec != NULL && !ValidateSpec(*spec))
+		return -1;
+
+	const u32 observations = (spec != NULL) ? spec->observations : 0;
+	const bool wantFrame = (observations & NDS_STEP_OBS_FRAME) != 0;
+
+	//the core normally only mixes sound when something is going to hear it
+	batchstep_listening = (observations & NDS_STEP_OBS_AUDIO) != 0;
+	audioSumSquares = 0;
+	audioSampleCount = 0;
+
+	for (int i = 0; i < frameCount; i++)
+	{
+		NDS_beginProcessingInput();
+		if (inputs != NULL)
+		{
+			MovieRecord rec;
+			rec.clear();
+			rec.pad = inputs[i].pad;
+			rec.touch.x = inputs[i].touchX;
+			rec.touch.y = inputs[i].touchY;
+			rec.touch.touch = inputs[i].touch;
+			rec.commands = inputs[i].commands;
+			ReplayRecToDesmumeInput(rec, &NDS_getProcessingUserInput());
+		}
+		NDS_endProcessingInput();
+
+		//only the last frame can be looked at, so don't bother drawing the ones before it
+		switch (BatchStep_SkipFor(i, frameCount, wantFrame))
+		{
+			case BatchStepSkip_Request: NDS_SkipNextFrame(); break;
+			case BatchStepSkip_None: break;
+			case BatchStepSkip_Omit: NDS_OmitFrameSkip(2); break;
+		}
+		NDS_exec<false>();
+	}
+
+	batchstep_listening = false;
+
+	if (wantFrame)
+		ObserveFrame(*spec);
+	if (observations & NDS_STEP_OBS_RAM)
+		ObserveRAM(*spec);
+	if (observations & NDS_STEP_OBS_AUDIO)
+		*spec->audioEnergy = (audioSampleCount > 0) ? (float)(sqrt(audioSumSquares / audioSampleCount) / 32768.0) : 0.0f;
+
+	return frameCount;
+}
@@ -0,0 +1,119 @@
+/*
+	Copyright (C) 2016 DeSmuME team
+
+	This file is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the this software.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//a plain C entry point for driving the emulator in bulk (bots, training agents, etc.)
+//NDS_Step() runs a batch of frames from a prepared input sequence, the same way movie playback feeds input,
+//and hands back only the observations that were asked for. frames nobody is going to look at aren't rendered.
+//it expects a rom to be loaded already, and it replaces whatever input the frontend or a movie would have supplied.
+
+#ifndef _BATCHSTEP_H_
+#define _BATCHSTEP_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+#include <algorithm>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//one frame of input, in the same terms as a movie record
+typedef struct
+{
+	uint16_t pad;			//buttons, as MovieRecord::pad (bit 12 to 0: R L D U T S B A Y X W E G)
+	uint8_t touchX;			//stylus position in touch screen pixels
+	uint8_t touchY;
+	uint8_t touch;			//nonzero while the stylus is down
+	uint8_t commands;		//MOVIECMD_* (reset, microphone, lid)
+} NDS_StepInput;
+
+//a range of the ARM9's address space to copy out after the last frame
+typedef struct
+{
+	uint32_t address;
+	uint32_t size;
+	uint8_t *dst;
+} NDS_StepRAMSlice;
+
+enum NDS_StepObservation
+{
+	NDS_STEP_OBS_FRAME	= 1,	//a downscaled copy of both screens, main on top
+	NDS_STEP_OBS_RAM	= 2,	//the RAM slices
+	NDS_STEP_OBS_AUDIO	= 4		//the loudness of the sound produced over the whole batch
+};
+
+enum NDS_StepFrameFormat
+{
+	NDS_STEP_FRAME_RGB888	= 0,	//3 bytes per pixel
+	NDS_STEP_FRAME_GRAY8	= 1		//1 byte per pixel
+};
+
+typedef struct
+{
+	uint32_t observations;			//NDS_STEP_OBS_* bits
+
+	//NDS_STEP_OBS_FRAME: (256 / frameScale) x (384 / frameScale) pixels, box filtered.
+	//frameScale must be 1, 2, 4, 8 or 16
+	uint32_t frameScale;
+	uint32_t frameFormat;			//NDS_StepFrameFormat
+	uint8_t *frame;
+
+	//NDS_STEP_OBS_RAM
+	uint32_t ramSliceCount;
+	const NDS_StepRAMSlice *ramSlices;
+
+	//NDS_STEP_OBS_AUDIO: RMS of all samples, 0 (silence) to 1 (full scale)
+	float *audioEnergy;
+} NDS_StepObservationSpec;
+
+//runs frameCount frames. inputs holds one entry per frame; if it is NULL the current input is held.
+//the observed frame shows the last frame's 2D, and the 3D that was rendered for it if frameCount is at least 2.
+//spec may be NULL if nothing needs to be observed.
+//returns the number of frames run, or -1 if the arguments don't make sense.
+int NDS_Step(int frameCount, const NDS_StepInput *inputs, const NDS_StepObservationSpec *spec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+//the core feeds mixed sound through here while a batch wants to measure it
+extern bool batchstep_listening;
+void BatchStep_SoundUpdate(void *soundData, int numSamples);
+
+enum BatchStepSkip
+{
+	BatchStepSkip_Request,		//NDS_SkipNextFrame()
+	BatchStepSkip_None,
+	BatchStepSkip_Omit			//NDS_OmitFrameSkip(2), throwing out any skips still on their way
+};
+
+//what NDS_Step does with the frame skipper before running frame i of a batch.
+//a frame shows the 2D and 3D of skip requests made two frames earlier, so when the last frame is going to
+//be observed the last two frames are drawn, starting from a clean frame skipper.
+inline BatchStepSkip BatchStep_SkipFor(int i, int frameCount, bool wantFrame)
+{
+	const int firstDrawn = wantFrame ? std::max(frameCount - 2, 0) : frameCount;
+	if (i < firstDrawn) return BatchStepSkip_Request;
+	if (i == firstDrawn) return BatchStepSkip_Omit;
+	return BatchStepSkip_None;
+}
+#endif
+
+#endif
@@ -23,6 +23,7 @@
 #include "armcpu.h"
 #include "cp15.h"
 #include <math.h>
+#include <string.h>
 #include "MMU.h"
 #include "debug.h"
 #include "registers.h"
@@ -326,7 +327,158 @@ TEMPLATE static u32 divide()
      return 6;
 }
 
-TEMPLATE static u32 copy()
+//the decompression and copy routines below are written against a small memory interface, so that they can run either
+//through the regular MMU accessors or straight on host memory. when the source and destination resolve to plain ram/vram
+//up front, BiosHostMemory serves every access landing in those ranges natively and only sends the rest (windows reaching
+//back before the destination, ranges running into i/o, and so on) through the MMU. both paths must behave identically,
+//including the values returned to the caller.
+TEMPLATE struct BiosMMUMemory
+{
+	FORCEINLINE u8 read08(u32 adr) { return _MMU_read08<PROCNUM>(adr); }
+	FORCEINLINE u16 read16(u32 adr) { return _MMU_read16<PROCNUM>(adr); }
+	FORCEINLINE u32 read32(u32 adr) { return _MMU_read32<PROCNUM>(adr); }
+	FORCEINLINE void write08(u32 adr, u8 val) { _MMU_write08<PROCNUM>(adr, val); }
+	FORCEINLINE void write16(u32 adr, u16 val) { _MMU_write16<PROCNUM>(adr, val); }
+	FORCEINLINE void write32(u32 adr, u32 val) { _MMU_write32<PROCNUM>(adr, val); }
+
+	void copy08(u32 dst, u32 src, u32 cnt) { for(; cnt; cnt--, dst++, src++) write08(dst, read08(src)); }
+	void copy16(u32 dst, u32 src, u32 cnt) { for(; cnt; cnt--, dst+=2, src+=2) write16(dst, read16(src)); }
+	void copy32(u32 dst, u32 src, u32 cnt) { for(; cnt; cnt--, dst+=4, src+=4) write32(dst, read32(src)); }
+	void fill08(u32 dst, u8 val, u32 cnt) { for(; cnt; cnt--, dst++) write08(dst, val); }
+	void fill16(u32 dst, u16 val, u32 cnt) { for(; cnt; cnt--, dst+=2) write16(dst, val); }
+	void fill32(u32 dst, u32 val, u32 cnt) { for(; cnt; cnt--, dst+=4) write32(dst, val); }
+};
+
+TEMPLATE struct BiosHostMemory
+{
+	BiosHostMemory(u32 source, u32 dest, bool byteWrites)
+		: srcAdr(source)
+		, dstAdr(dest)
+		, dirtyBegin(0xFFFFFFFF)
+		, dirtyEnd(0)
+	{
+		src = MMU_GetHostRange<PROCNUM>(srcAdr, srcSize, false);
+		dst = MMU_GetHostRange<PROCNUM>(dstAdr, dstSize, byteWrites);
+		if(!src) srcSize = 0;
+		if(!dst) dstSize = 0;
+	}
+
+	bool valid() const { return src || dst; }
+
+	//lets the jit know about everything we wrote behind the MMU's back
+	u32 finish(u32 ret)
+	{
+		if(dirtyBegin < dirtyEnd)
+			MMU_HostRangeWritten<PROCNUM>(dirtyBegin, dirtyEnd - dirtyBegin);
+		return ret;
+	}
+
+	FORCEINLINE u8 read08(u32 adr)
+	{
+		if(u8 *p = mapRead(adr, 1)) return T1ReadByte(p, 0);
+		return _MMU_read08<PROCNUM>(adr);
+	}
+	FORCEINLINE u16 read16(u32 adr)
+	{
+		if(u8 *p = mapRead(adr & ~1, 2)) return T1ReadWord(p, 0);
+		return _MMU_read16<PROCNUM>(adr);
+	}
+	FORCEINLINE u32 read32(u32 adr)
+	{
+		if(u8 *p = mapRead(adr & ~3, 4)) return T1ReadLong(p, 0);
+		return _MMU_read32<PROCNUM>(adr);
+	}
+	FORCEINLINE void write08(u32 adr, u8 val)
+	{
+		if(u8 *p = mapWrite(adr, 1)) T1WriteByte(p, 0, val);
+		else _MMU_write08<PROCNUM>(adr, val);
+	}
+	FORCEINLINE void write16(u32 adr, u16 val)
+	{
+		if(u8 *p = mapWrite(adr & ~1, 2)) T1WriteWord(p, 0, val);
+		else _MMU_write16<PROCNUM>(adr, val);
+	}
+	FORCEINLINE void write32(u32 adr, u32 val)
+	{
+		if(u8 *p = mapWrite(adr & ~3, 4)) T1WriteLong(p, 0, val);
+		else _MMU_write32<PROCNUM>(adr, val);
+	}
+
+	void copy08(u32 dst, u32 src, u32 cnt)
+	{
+		if(!copyBlock(dst, src, cnt))
+			for(; cnt; cnt--, dst++, src++) write08(dst, read08(src));
+	}
+	void copy16(u32 dst, u32 src, u32 cnt)
+	{
+		if(!copyBlock(dst, src, cnt*2))
+			for(; cnt; cnt--, dst+=2, src+=2) write16(dst, read16(src));
+	}
+	void copy32(u32 dst, u32 src, u32 cnt)
+	{
+		if(!copyBlock(dst, src, cnt*4))
+			for(; cnt; cnt--, dst+=4, src+=4) write32(dst, read32(src));
+	}
+	void fill08(u32 dst, u8 val, u32 cnt)
+	{
+		if(u8 *p = mapWrite(dst, cnt)) memset(p, val, cnt);
+		else for(; cnt; cnt--, dst++) write08(dst, val);
+	}
+	void fill16(u32 dst, u16 val, u32 cnt)
+	{
+		if(u8 *p = mapWrite(dst, cnt*2)) for(u32 i = 0; i < cnt; i++) T1WriteWord(p, i*2, val);
+		else for(; cnt; cnt--, dst+=2) write16(dst, val);
+	}
+	void fill32(u32 dst, u32 val, u32 cnt)
+	{
+		if(u8 *p = mapWrite(dst, cnt*4)) for(u32 i = 0; i < cnt; i++) T1WriteLong(p, i*4, val);
+		else for(; cnt; cnt--, dst+=4) write32(dst, val);
+	}
+
+private:
+	u32 srcAdr, srcSize, dstAdr, dstSize;
+	u8 *src, *dst;
+	u32 dirtyBegin, dirtyEnd;
+
+	static FORCEINLINE u8* map(u8 *base, u32 baseAdr, u32 baseSize, u32 adr, u32 size)
+	{
+		const u32 ofs = adr - baseAdr;
+		if(ofs < baseSize && size <= baseSize - ofs) return base + ofs;
+		return NULL;
+	}
+	FORCEINLINE u8* mapRead(u32 adr, u32 size)
+	{
+		if(u8 *p = map(dst, dstAdr, dstSize, adr, size)) return p;
+		return map(src, srcAdr, srcSize, adr, size);
+	}
+	FORCEINLINE u8* mapWrite(u32 adr, u32 size)
+	{
+		u8 *p = map(dst, dstAdr, dstSize, adr, size);
+		if(p)
+		{
+			if(adr < dirtyBegin) dirtyBegin = adr;
+			if(adr + size > dirtyEnd) dirtyEnd = adr + size;
+		}
+		return p;
+	}
+
+	//moves a block in the same order as the per-unit loops would, so overlapping lz77 windows replicate correctly
+	bool copyBlock(u32 to_adr, u32 from_adr, u32 size)
+	{
+		if(size == 0) return true;
+		u8 *from = mapRead(from_adr, size);
+		if(!from) return false;
+		u8 *to = mapWrite(to_adr, size);
+		if(!to) return false;
+		if(to <= from || to >= from + size)
+			memmove(to, from, size);
+		else
+			for(u32 i = 0; i < size; i++) to[i] = from[i];
+		return true;
+	}
+};
+
+template<int PROCNUM, class MEM> static u32 DoCopy(MEM &mem)
 {
      u32 src = cpu->R[0];
      u32 dst = cpu->R[1];
@@ -342,26 +494,10 @@ TEMPLATE static u32 copy()
                switch(BIT24(cnt))
                {
                     case 0:
-                         cnt &= 0x1FFFFF;
-                         while(cnt)
-                         {
-                              _MMU_write16<PROCNUM>(dst, _MMU_read16<PROCNUM>(src));
-                              cnt--;
-                              dst+=2;
-                              src+=2;
-                         }
+                         mem.copy16(dst, src, cnt & 0x1FFFFF);
                          break;
                     case 1:
-                         {
-                              u16 val = _MMU_read16<PROCNUM>(src);
-                              cnt &= 0x1FFFFF;
-                              while(cnt)
-                              {
-                                   _MMU_write16<PROCNUM>(dst, val);
-                                   cnt--;
-                                   dst+=2;
-                              }
-                         }
+                         mem.fill16(dst, mem.read16(src), cnt & 0x1FFFFF);
                          break;
                }
                break;
@@ -371,26 +507,10 @@ TEMPLATE static u32 copy()
                switch(BIT24(cnt))
                {
                     case 0:
-                         cnt &= 0x1FFFFF;
-                         while(cnt)
-                         {
-                              _MMU_write32<PROCNUM>(dst, _MMU_read32<PROCNUM>(src));
-                              cnt--;
-                              dst+=4;
-                              src+=4;
-                         }
+                         mem.copy32(dst, src, cnt & 0x1FFFFF);
                          break;
                     case 1:
-                         {
-                              u32 val = _MMU_read32<PROCNUM>(src);
-                              cnt &= 0x1FFFFF;
-                              while(cnt)
-                              {
-                                   _MMU_write32<PROCNUM>(dst, val);
-                                   cnt--;
-                                   dst+=4;
-                              }
-                         }
+                         mem.fill32(dst, mem.read32(src), cnt & 0x1FFFFF);
                          break;
                }
                break;
@@ -398,7 +518,7 @@ TEMPLATE static u32 copy()
      return 1;
 }
 
-TEMPLATE static u32 fastCopy()
+template<int PROCNUM, class MEM> static u32 DoFastCopy(MEM &mem)
 {
      u32 src = cpu->R[0] & 0xFFFFFFFC;
      u32 dst = cpu->R[1] & 0xFFFFFFFC;
@@ -409,32 +529,16 @@ TEMPLATE static u32 fastCopy()
      switch(BIT24(cnt))
      {
           case 0:
-               cnt &= 0x1FFFFF;
-               while(cnt)
-               {
-                    _MMU_write32<PROCNUM>(dst, _MMU_read32<PROCNUM>(src));
-                    cnt--;
-                    dst+=4;
-                    src+=4;
-               }
+               mem.copy32(dst, src, cnt & 0x1FFFFF);
                break;
           case 1:
-               {
-                    u32 val = _MMU_read32<PROCNUM>(src);
-                    cnt &= 0x1FFFFF;
-                    while(cnt)
-                    {
-                         _MMU_write32<PROCNUM>(dst, val);
-                         cnt--;
-                         dst+=4;
-                    }
-               }
+               mem.fill32(dst, mem.read32(src), cnt & 0x1FFFFF);
                break;
      }
      return 1;
 }
 
-TEMPLATE static u32 LZ77UnCompVram()
+template<int PROCNUM, class MEM> static u32 DoLZ77UnCompVram(MEM &mem)
 {
   int i1, i2;
   int byteCount;
@@ -443,7 +547,7 @@ TEMPLATE static u32 LZ77UnCompVram()
   int len;
   u32 source = cpu->R[0];
   u32 dest = cpu->R[1];
-  u32 header = _MMU_read32<PROCNUM>(source);
+  u32 header = mem.read32(source);
   source += 4;
 
   //INFO("swi lz77uncompvram\n");
@@ -459,7 +563,7 @@ TEMPLATE static u32 LZ77UnCompVram()
   len = header >> 8;
 
   while(len > 0) {
-    u8 d = _MMU_read08<PROCNUM>(source++);
+    u8 d = mem.read08(source++);
 
     if(d) {
       for(i1 = 0; i1 < 8; i1++) {
@@ -467,18 +571,18 @@ TEMPLATE static u32 LZ77UnCompVram()
           int length;
           int offset;
           u32 windowOffset;
-          u16 data = _MMU_read08<PROCNUM>(source++) << 8;
-          data |= _MMU_read08<PROCNUM>(source++);
+          u16 data = mem.read08(source++) << 8;
+          data |= mem.read08(source++);
           length = (data >> 12) + 3;
           offset = (data & 0x0FFF);
           windowOffset = dest + byteCount - offset - 1;
           for(i2 = 0; i2 < length; i2++) {
-            writeValue |= (_MMU_read08<PROCNUM>(windowOffset++) << byteShift);
+            writeValue |= (mem.read08(windowOffset++) << byteShift);
             byteShift += 8;
             byteCount++;
 
             if(byteCount == 2) {
-              _MMU_write16<PROCNUM>(dest, writeValue);
+              mem.write16(dest, writeValue);
               dest += 2;
               byteCount = 0;
               byteShift = 0;
@@ -489,11 +593,11 @@ TEMPLATE static u32 LZ77UnCompVram()
               return 0;
           }
         } else {
-          writeValue |= (_MMU_read08<PROCNUM>(source++) << byteShift);
+          writeValue |= (mem.read08(source++) << byteShift);
           byteShift += 8;
           byteCount++;
           if(byteCount == 2) {
-            _MMU_write16<PROCNUM>(dest, writeValue);
+            mem.write16(dest, writeValue);
             dest += 2;
             byteCount = 0;
             byteShift = 0;
@@ -507,11 +611,11 @@ TEMPLATE static u32 LZ77UnCompVram()
       }
     } else {
       for(i1 = 0; i1 < 8; i1++) {
-        writeValue |= (_MMU_read08<PROCNUM>(source++) << byteShift);
+        writeValue |= (mem.read08(source++) << byteShift);
         byteShift += 8;
         byteCount++;
         if(byteCount == 2) {
-          _MMU_write16<PROCNUM>(dest, writeValue);
+          mem.write16(dest, writeValue);
           dest += 2;      
           byteShift = 0;
           byteCount = 0;
@@ -526,14 +630,14 @@ TEMPLATE static u32 LZ77UnCompVram()
   return 1;
 }
 
-TEMPLATE static u32 LZ77UnCompWram()
+template<int PROCNUM, class MEM> static u32 DoLZ77UnCompWram(MEM &mem)
 {
-  int i1, i2;
+  int i1;
   int len;
   u32 source = cpu->R[0];
   u32 dest = cpu->R[1];
 
-  u32 header = _MMU_read32<PROCNUM>(source);
+  u32 header = mem.read32(source);
   source += 4;
 
   //INFO("swi lz77uncompwram\n");
@@ -545,7 +649,7 @@ TEMPLATE static u32 LZ77UnCompWram()
   len = header >> 8;
 
   while(len > 0) {
-    u8 d = _MMU_read08<PROCNUM>(source++);
+    u8 d = mem.read08(source++);
 
     if(d) {
       for(i1 = 0; i1 < 8; i1++) {
@@ -553,19 +657,20 @@ TEMPLATE static u32 LZ77UnCompWram()
           int length;
           int offset;
           u32 windowOffset;
-          u16 data = _MMU_read08<PROCNUM>(source++) << 8;
-          data |= _MMU_read08<PROCNUM>(source++);
+          u16 data = mem.read08(source++) << 8;
+          data |= mem.read08(source++);
           length = (data >> 12) + 3;
           offset = (data & 0x0FFF);
           windowOffset = dest - offset - 1;
-          for(i2 = 0; i2 < length; i2++) {
-            _MMU_write08<PROCNUM>(dest++, _MMU_read08<PROCNUM>(windowOffset++));
-            len--;
-            if(len == 0)
-              return 0;
-          }
+          if(length > len)
+            length = len;
+          mem.copy08(dest, windowOffset, length);
+          dest += length;
+          len -= length;
+          if(len == 0)
+            return 0;
         } else {
-          _MMU_write08<PROCNUM>(dest++, _MMU_read08<PROCNUM>(source++));
+          mem.write08(dest++, mem.read08(source++));
           len--;
           if(len == 0)
             return 0;
@@ -573,18 +678,19 @@ TEMPLATE static u32 LZ77UnCompWram()
         d <<= 1;
       }
     } else {
-      for(i1 = 0; i1 < 8; i1++) {
-        _MMU_write08<PROCNUM>(dest++, _MMU_read08<PROCNUM>(source++));
-        len--;
-        if(len == 0)
-          return 0;
-      }
+      int length = (len < 8) ? len : 8;
+      mem.copy08(dest, source, length);
+      dest += length;
+      source += length;
+      len -= length;
+      if(len == 0)
+        return 0;
     }
   }
   return 1;
 }
 
-TEMPLATE static u32 RLUnCompVram()
+template<int PROCNUM, class MEM> static u32 DoRLUnCompVram(MEM &mem)
 {
   int i;
   int len;
@@ -594,7 +700,7 @@ TEMPLATE static u32 RLUnCompVram()
   u32 source = cpu->R[0];
   u32 dest = cpu->R[1];
 
-  u32 header = _MMU_read32<PROCNUM>(source);
+  u32 header = mem.read32(source);
   source += 4;
 
   //INFO("swi rluncompvram\n");
@@ -609,10 +715,10 @@ TEMPLATE static u32 RLUnCompVram()
   writeValue = 0;
 
   while(len > 0) {
-    u8 d = _MMU_read08<PROCNUM>(source++);
+    u8 d = mem.read08(source++);
     int l = d & 0x7F;
     if(d & 0x80) {
-      u8 data = _MMU_read08<PROCNUM>(source++);
+      u8 data = mem.read08(source++);
       l += 3;
       for(i = 0;i < l; i++) {
         writeValue |= (data << byteShift);
@@ -620,7 +726,7 @@ TEMPLATE static u32 RLUnCompVram()
         byteCount++;
 
         if(byteCount == 2) {
-          _MMU_write16<PROCNUM>(dest, writeValue);
+          mem.write16(dest, writeValue);
           dest += 2;
           byteCount = 0;
           byteShift = 0;
@@ -633,11 +739,11 @@ TEMPLATE static u32 RLUnCompVram()
     } else {
       l++;
       for(i = 0; i < l; i++) {
-        writeValue |= (_MMU_read08<PROCNUM>(source++) << byteShift);
+        writeValue |= (mem.read08(source++) << byteShift);
         byteShift += 8;
         byteCount++;
         if(byteCount == 2) {
-          _MMU_write16<PROCNUM>(dest, writeValue);
+          mem.write16(dest, writeValue);
           dest += 2;
           byteCount = 0;
           byteShift = 0;
@@ -652,18 +758,17 @@ TEMPLATE static u32 RLUnCompVram()
   return 1;
 }
 
-TEMPLATE static u32 RLUnCompWram()
+template<int PROCNUM, class MEM> static u32 DoRLUnCompWram(MEM &mem)
 {
 	//this routine is used by yoshi touch&go from the very beginning
 
 	//printf("RLUnCompWram\n");
 
-  int i;
   int len;
   u32 source = cpu->R[0];
   u32 dest = cpu->R[1];
 
-  u32 header = _MMU_read32<PROCNUM>(source);
+  u32 header = mem.read32(source);
   source += 4;
 
   //INFO("swi rluncompwram\n");
@@ -675,31 +780,31 @@ TEMPLATE static u32 RLUnCompWram()
   len = header >> 8;
 
   while(len > 0) {
-    u8 d = _MMU_read08<PROCNUM>(source++);
+    u8 d = mem.read08(source++);
     int l = d & 0x7F;
     if(d & 0x80) {
-      u8 data = _MMU_read08<PROCNUM>(source++);
+      u8 data = mem.read08(source++);
       l += 3;
-      for(i = 0;i < l; i++) {
-        _MMU_write08<PROCNUM>(dest++, data);
-        len--;
-        if(len == 0)
-          return 0;
-      }
+      if(l > len)
+        l = len;
+      mem.fill08(dest, data, l);
+      dest += l;
     } else {
       l++;
-      for(i = 0; i < l; i++) {
-        _MMU_write08<PROCNUM>(dest++,  _MMU_read08<PROCNUM>(source++));
-        len--;
-        if(len == 0)
-          return 0;
-      }
+      if(l > len)
+        l = len;
+      mem.copy08(dest, source, l);
+      dest += l;
+      source += l;
     }
+    len -= l;
+    if(len == 0)
+      return 0;
   }
   return 1;
 }
 
-TEMPLATE static u32 UnCompHuffman()
+template<int PROCNUM, class MEM> static u32 DoUnCompHuffman(MEM &mem)
 {
 	//this routine is used by the nintendo logo in the firmware boot screen
 
@@ -712,7 +817,7 @@ TEMPLATE static u32 UnCompHuffman()
   source = cpu->R[0];
   dest = cpu->R[1];
 
-  header = _MMU_read32<PROCNUM>(source);
+  header = mem.read32(source);
   source += 4;
 
   //INFO("swi uncomphuffman\n");
@@ -721,7 +826,7 @@ TEMPLATE static u32 UnCompHuffman()
      ((source + ((header >> 8) & 0x1fffff)) & 0xe000000) == 0)
     return 0;  
   
-  treeSize = _MMU_read08<PROCNUM>(source++);
+  treeSize = mem.read08(source++);
 
   treeStart = source;
 
@@ -730,11 +835,11 @@ TEMPLATE static u32 UnCompHuffman()
   len = header >> 8;
 
   mask = 0x80000000;
-  data = _MMU_read32<PROCNUM>(source);
+  data = mem.read32(source);
   source += 4;
 
   pos = 0;
-  rootNode = _MMU_read08<PROCNUM>(treeStart);
+  rootNode = mem.read08(treeStart);
   currentNode = rootNode;
   writeData = 0;
   byteShift = 0;
@@ -753,12 +858,12 @@ TEMPLATE static u32 UnCompHuffman()
         // right
         if(currentNode & 0x40)
           writeData = 1;
-        currentNode = _MMU_read08<PROCNUM>(treeStart+pos+1);
+        currentNode = mem.read08(treeStart+pos+1);
       } else {
         // left
         if(currentNode & 0x80)
           writeData = 1;
-        currentNode = _MMU_read08<PROCNUM>(treeStart+pos);
+        currentNode = mem.read08(treeStart+pos);
       }
       
       if(writeData) {
@@ -773,7 +878,7 @@ TEMPLATE static u32 UnCompHuffman()
         if(byteCount == 4) {
           byteCount = 0;
           byteShift = 0;
-          _MMU_write32<PROCNUM>(dest, writeValue);
+          mem.write32(dest, writeValue);
           writeValue = 0;
           dest += 4;
           len -= 4;
@@ -782,7 +887,7 @@ TEMPLATE static u32 UnCompHuffman()
       mask >>= 1;
       if(mask == 0) {
         mask = 0x80000000;
-        data = _MMU_read32<PROCNUM>(source);
+        data = mem.read32(source);
         source += 4;
       }
     }
@@ -800,12 +905,12 @@ TEMPLATE static u32 UnCompHuffman()
         // right
         if(currentNode & 0x40)
           writeData = 1;
-        currentNode = _MMU_read08<PROCNUM>(treeStart+pos+1);
+        currentNode = mem.read08(treeStart+pos+1);
       } else {
         // left
         if(currentNode & 0x80)
           writeData = 1;
-        currentNode = _MMU_read08<PROCNUM>(treeStart+pos);
+        currentNode = mem.read08(treeStart+pos);
       }
       
       if(writeData) {
@@ -826,7 +931,7 @@ TEMPLATE static u32 UnCompHuffman()
           if(byteCount == 4) {
             byteCount = 0;
             byteShift = 0;
-            _MMU_write32<PROCNUM>(dest, writeValue);
+            mem.write32(dest, writeValue);
             dest += 4;
             writeValue = 0;
             len -= 4;
@@ -839,14 +944,14 @@ TEMPLATE static u32 UnCompHuffman()
       mask >>= 1;
       if(mask == 0) {
         mask = 0x80000000;
-        data = _MMU_read32<PROCNUM>(source);
+        data = mem.read32(source);
         source += 4;
       }
     }    
   }
   return 1;
 }
-TEMPLATE static u32 BitUnPack()
+template<int PROCNUM, class MEM> static u32 DoBitUnPack(MEM &mem)
 {
 	u32 source,dest,header,base,temp;
 	int len,bits,revbits,dataSize,data,bitwritecount,mask,bitcount,addBase;
@@ -856,8 +961,8 @@ TEMPLATE static u32 BitUnPack()
 	dest = cpu->R[1];
 	header = cpu->R[2];
 
-	len = _MMU_read16<PROCNUM>(header);
-	bits = _MMU_read08<PROCNUM>(header+2);
+	len = mem.read16(header);
+	bits = mem.read08(header+2);
 	switch (bits)
 	{
 	case 1:
@@ -868,7 +973,7 @@ TEMPLATE static u32 BitUnPack()
 	default: 
 		return (0);	// error
 	}
-	dataSize = _MMU_read08<PROCNUM>(header+3);
+	dataSize = mem.read08(header+3);
 	switch (dataSize)
 	{
 	case 1:
@@ -883,7 +988,7 @@ TEMPLATE static u32 BitUnPack()
 	}
 
 	revbits = 8 - bits; 
-	base = _MMU_read32<PROCNUM>(header+4);
+	base = mem.read32(header+4);
 	addBase = (base & 0x80000000) ? 1 : 0;
 	base &= 0x7fffffff;
 
@@ -896,7 +1001,7 @@ TEMPLATE static u32 BitUnPack()
 		if(len < 0)
 			break;
 		mask = 0xff >> revbits; 
-		b = _MMU_read08<PROCNUM>(source); 
+		b = mem.read08(source); 
 		source++;
 		bitcount = 0;
 		while(1) {
@@ -916,7 +1021,7 @@ TEMPLATE static u32 BitUnPack()
 			data |= temp << bitwritecount;
 			bitwritecount += dataSize;
 			if(bitwritecount >= 32) {
-				_MMU_write32<PROCNUM>(dest, data);
+				mem.write32(dest, data);
 				dest += 4;
 				data = 0;
 				bitwritecount = 0;
@@ -928,64 +1033,145 @@ TEMPLATE static u32 BitUnPack()
 	return 1;
 }
 
-TEMPLATE static u32 Diff8bitUnFilterWram() //this one might be different on arm7 and needs checking
+template<int PROCNUM, class MEM> static u32 DoDiff8bitUnFilterWram(MEM &mem) //this one might be different on arm7 and needs checking
 {
 	//INFO("swi Diff8bitUnFilterWram\n");
 
 	u32 source = cpu->R[0];
 	u32 dest = cpu->R[1];
 
-	CompressionHeader header(_MMU_read32<PROCNUM>(source));
+	CompressionHeader header(mem.read32(source));
 	source += 4;
 
 	if(header.DataSize() != 1) printf("WARNING: incorrect header passed to Diff8bitUnFilterWram\n");
 	if(header.Type() != 8) printf("WARNING: incorrect header passed to Diff8bitUnFilterWram\n");
 	u32 len = header.DecompressedSize();
 
-	u8 data = _MMU_read08<PROCNUM>(source++);
-	_MMU_write08<PROCNUM>(dest++, data);
+	u8 data = mem.read08(source++);
+	mem.write08(dest++, data);
 	len--;
 
 	while(len > 0) {
-		u8 diff = _MMU_read08<PROCNUM>(source++);
+		u8 diff = mem.read08(source++);
 		data += diff;
-		_MMU_write08<PROCNUM>(dest++, data);
+		mem.write08(dest++, data);
 		len--;
 	}
 	return 1;
 }
 
-TEMPLATE static u32 Diff16bitUnFilter()
+template<int PROCNUM, class MEM> static u32 DoDiff16bitUnFilter(MEM &mem)
 {
 	//INFO("swi Diff16bitUnFilter\n");
 
 	u32 source = cpu->R[0];
 	u32 dest = cpu->R[1];
 
-	CompressionHeader header(_MMU_read32<PROCNUM>(source));
+	CompressionHeader header(mem.read32(source));
 	source += 4;
 
 	if(header.DataSize() != 2) printf("WARNING: incorrect header passed to Diff16bitUnFilter\n");
 	if(header.Type() != 8) printf("WARNING: incorrect header passed to Diff16bitUnFilter\n");
 	u32 len = header.DecompressedSize();
 
-	u16 data = _MMU_read16<PROCNUM>(source);
+	u16 data = mem.read16(source);
 	source += 2;
-	_MMU_write16<PROCNUM>(dest, data);
+	mem.write16(dest, data);
 	dest += 2;
 	len -= 2;
 
 	while(len >= 2) {
-		u16 diff = _MMU_read16<PROCNUM>(source);
+		u16 diff = mem.read16(source);
 		source += 2;
 		data += diff;
-		_MMU_write16<PROCNUM>(dest, data);
+		mem.write16(dest, data);
 		dest += 2;
 		len -= 2;
 	}
 	return 1;
 }
 
+TEMPLATE static u32 copy()
+{
+	const u32 align = BIT26(cpu->R[2]) ? 0xFFFFFFFC : 0xFFFFFFFE;
+	BiosHostMemory<PROCNUM> host(cpu->R[0] & align, cpu->R[1] & align, false);
+	if(host.valid()) return host.finish(DoCopy<PROCNUM>(host));
+	BiosMMUMemory<PROCNUM> mmu;
+	return DoCopy<PROCNUM>(mmu);
+}
+
+TEMPLATE static u32 fastCopy()
+{
+	BiosHostMemory<PROCNUM> host(cpu->R[0] & 0xFFFFFFFC, cpu->R[1] & 0xFFFFFFFC, false);
+	if(host.valid()) return host.finish(DoFastCopy<PROCNUM>(host));
+	BiosMMUMemory<PROCNUM> mmu;
+	return DoFastCopy<PROCNUM>(mmu);
+}
+
+TEMPLATE static u32 LZ77UnCompVram()
+{
+	BiosHostMemory<PROCNUM> host(cpu->R[0], cpu->R[1], false);
+	if(host.valid()) return host.finish(DoLZ77UnCompVram<PROCNUM>(host));
+	BiosMMUMemory<PROCNUM> mmu;
+	return DoLZ77UnCompVram<PROCNUM>(mmu);
+}
+
+TEMPLATE static u32 LZ77UnCompWram()
+{
+	BiosHostMemory<PROCNUM> host(cpu->R[0], cpu->R[1], true);
+	if(host.valid()) return host.finish(DoLZ77UnCompWram<PROCNUM>(host));
+	BiosMMUMemory<PROCNUM> mmu;
+	return DoLZ77UnCompWram<PROCNUM>(mmu);
+}
+
+TEMPLATE static u32 RLUnCompVram()
+{
+	BiosHostMemory<PROCNUM> host(cpu->R[0], cpu->R[1], false);
+	if(host.valid()) return host.finish(DoRLUnCompVram<PROCNUM>(host));
+	BiosMMUMemory<PROCNUM> mmu;
+	return DoRLUnCompVram<PROCNUM>(mmu);
+}
+
+TEMPLATE static u32 RLUnCompWram()
+{
+	BiosHostMemory<PROCNUM> host(cpu->R[0], cpu->R[1], true);
+	if(host.valid()) return host.finish(DoRLUnCompWram<PROCNUM>(host));
+	BiosMMUMemory<PROCNUM> mmu;
+	return DoRLUnCompWram<PROCNUM>(mmu);
+}
+
+TEMPLATE static u32 UnCompHuffman()
+{
+	BiosHostMemory<PROCNUM> host(cpu->R[0], cpu->R[1], false);
+	if(host.valid()) return host.finish(DoUnCompHuffman<PROCNUM>(host));
+	BiosMMUMemory<PROCNUM> mmu;
+	return DoUnCompHuffman<PROCNUM>(mmu);
+}
+
+TEMPLATE static u32 BitUnPack()
+{
+	BiosHostMemory<PROCNUM> host(cpu->R[0], cpu->R[1], false);
+	if(host.valid()) return host.finish(DoBitUnPack<PROCNUM>(host));
+	BiosMMUMemory<PROCNUM> mmu;
+	return DoBitUnPack<PROCNUM>(mmu);
+}
+
+TEMPLATE static u32 Diff8bitUnFilterWram()
+{
+	BiosHostMemory<PROCNUM> host(cpu->R[0], cpu->R[1], true);
+	if(host.valid()) return host.finish(DoDiff8bitUnFilterWram<PROCNUM>(host));
+	BiosMMUMemory<PROCNUM> mmu;
+	return DoDiff8bitUnFilterWram<PROCNUM>(mmu);
+}
+
+TEMPLATE static u32 Diff16bitUnFilter()
+{
+	BiosHostMemory<PROCNUM> host(cpu->R[0], cpu->R[1], false);
+	if(host.valid()) return host.finish(DoDiff16bitUnFilter<PROCNUM>(host));
+	BiosMMUMemory<PROCNUM> mmu;
+	return DoDiff16bitUnFilter<PROCNUM>(mmu);
+}
+
 TEMPLATE static u32 bios_sqrt()
 {
      cpu->R[0] = (u32)sqrt((double)(cpu->R[0]));
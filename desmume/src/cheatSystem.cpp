@@ -24,11 +24,16 @@
 #include "MMU.h"
 #include "debug.h"
 #include "utils/xstring.h"
+#include "utils/task.h"
 
 #ifndef _MSC_VER 
 #include <stdint.h>
 #endif
 
+#ifdef ENABLE_SSE2
+#include <emmintrin.h>
+#endif
+
 CHEATS *cheats = NULL;
 CHEATSEARCH *cheatSearch = NULL;
 
@@ -36,6 +41,7 @@ void CHEATS::clear()
 {
 	list.resize(0);
 	currentGet = 0;
+	listChanged();
 }
 
 void CHEATS::init(char *path)
@@ -48,6 +54,7 @@ void CHEATS::init(char *path)
 
 BOOL CHEATS::add(u8 size, u32 address, u32 val, char *description, BOOL enabled)
 {
+	listChanged();
 	size_t num = list.size();
 	list.push_back(CHEATS_LIST());
 	list[num].code[0][0] = address & 0x0FFFFFFF;
@@ -63,6 +70,7 @@ BOOL CHEATS::add(u8 size, u32 address, u32 val, char *description, BOOL enabled)
 BOOL CHEATS::update(u8 size, u32 address, u32 val, char *description, BOOL enabled, u32 pos)
 {
 	if (pos >= list.size()) return FALSE;
+	listChanged();
 	list[pos].code[0][0] = address & 0x0FFFFFFF;
 	list[pos].code[0][1] = val;
 	list[pos].num = 1;
@@ -73,36 +81,196 @@ BOOL CHEATS::update(u8 size, u32 address, u32 val, char *description, BOOL enabl
 	return TRUE;
 }
 
-void CHEATS::ARparser(CHEATS_LIST& list)
+enum
+{
+	AR_OP_END = 0,
+	AR_OP_WRITE32,			// 0XXXXXXX YYYYYYYY
+	AR_OP_WRITE16,			// 1XXXXXXX 0000YYYY
+	AR_OP_WRITE08,			// 2XXXXXXX 000000YY
+	AR_OP_IF_GT32,			// 3XXXXXXX YYYYYYYY
+	AR_OP_IF_LT32,			// 4XXXXXXX YYYYYYYY
+	AR_OP_IF_EQ32,			// 5XXXXXXX YYYYYYYY
+	AR_OP_IF_NE32,			// 6XXXXXXX YYYYYYYY
+	AR_OP_IF_GT16,			// 7XXXXXXX ZZZZYYYY
+	AR_OP_IF_LT16,			// 8XXXXXXX ZZZZYYYY
+	AR_OP_IF_EQ16,			// 9XXXXXXX ZZZZYYYY
+	AR_OP_IF_NE16,			// AXXXXXXX ZZZZYYYY
+	AR_OP_LOAD_OFFSET,		// BXXXXXXX 00000000
+	AR_OP_FOR,				// C0000000 YYYYYYYY
+	AR_OP_IF_COUNTER,		// C5000000 XXXXYYYY
+	AR_OP_STORE_OFFSET,		// C6000000 XXXXXXXX
+	AR_OP_ENDIF,			// D0000000 00000000
+	AR_OP_NEXT,				// D1000000 00000000
+	AR_OP_NEXT_FLUSH,		// D2000000 00000000
+	AR_OP_SET_OFFSET,		// D3000000 XXXXXXXX
+	AR_OP_ADD_DATA,			// D4000000 XXXXXXXX
+	AR_OP_SET_DATA,			// D5000000 XXXXXXXX
+	AR_OP_STORE_DATA32,		// D6000000 XXXXXXXX
+	AR_OP_STORE_DATA16,		// D7000000 XXXXXXXX
+	AR_OP_STORE_DATA08,		// D8000000 XXXXXXXX
+	AR_OP_LOAD_DATA32,		// D9000000 XXXXXXXX
+	AR_OP_LOAD_DATA16,		// DA000000 XXXXXXXX
+	AR_OP_LOAD_DATA08,		// DB000000 XXXXXXXX
+	AR_OP_ADD_OFFSET,		// DC000000 XXXXXXXX
+	AR_OP_WRITE_PARAMS,		// EXXXXXXX YYYYYYYY
+	AR_OP_COPY				// FXXXXXXX YYYYYYYY
+};
+
+static void AR_pushOp(std::vector<CHEATS_AR_OP> &ops, u8 op, u32 addr, u32 val, u32 mask = 0, u8 useOffset = 0)
+{
+	CHEATS_AR_OP item;
+	item.op = op;
+	item.useOffset = useOffset;
+	item.addr = addr;
+	item.val = val;
+	item.mask = mask;
+	ops.push_back(item);
+}
+
+// the E and F codes move whole blocks, so they go straight to host memory when the ranges allow it
+static void AR_writeBlock(u32 addr, const u8 *data, u32 len)
+{
+	u32 contiguous;
+	u8 *dst = MMU_GetHostRange<ARMCPU_ARM7>(addr, contiguous, true);
+	if (dst != NULL && contiguous >= len)
+	{
+		memcpy(dst, data, len);
+		MMU_HostRangeWritten<ARMCPU_ARM7>(addr, len);
+		return;
+	}
+
+	for (u32 t = 0; t < len; t++)
+		_MMU_write08<ARMCPU_ARM7,MMU_AT_DEBUG>(addr + t, data[t]);
+}
+
+static void AR_copyBlock(u32 dstAddr, u32 srcAddr, u32 len)
+{
+	u32 dstContiguous, srcContiguous;
+	u8 *dst = MMU_GetHostRange<ARMCPU_ARM7>(dstAddr, dstContiguous, true);
+	u8 *src = MMU_GetHostRange<ARMCPU_ARM7>(srcAddr, srcContiguous, false);
+	if (dst != NULL && src != NULL && dstContiguous >= len && srcContiguous >= len)
+	{
+		// same result as the byte loop below, including for overlapping ranges
+		if (dst <= src || dst >= src + len)
+			memmove(dst, src, len);
+		else
+			for (u32 t = 0; t < len; t++) dst[t] = src[t];
+		MMU_HostRangeWritten<ARMCPU_ARM7>(dstAddr, len);
+		return;
+	}
+
+	for (u32 t = 0; t < len; t++)
+	{
+		u8 tmp = _MMU_read08<ARMCPU_ARM7,MMU_AT_DEBUG>(srcAddr + t);
+		_MMU_write08<ARMCPU_ARM7,MMU_AT_DEBUG>(dstAddr + t, tmp);
+	}
+}
+
+static void AR_compile(const CHEATS_LIST &cheat, std::vector<CHEATS_AR_OP> &ops, std::vector<u8> &data)
+{
+	for (int i = 0; i < cheat.num; i++)
+	{
+		const u8 type = cheat.code[i][0] >> 28;
+		const u8 subtype = (cheat.code[i][0] >> 24) & 0x0F;
+		const u32 hi = cheat.code[i][0] & 0x0FFFFFFF;
+		const u32 lo = cheat.code[i][1];
+
+		switch (type)
+		{
+			case 0x00:
+				if (hi == 0) break;								// manual hook
+				if ((hi == 0x0000AA99) && (lo == 0)) break;		// parameter bytes 9..10 for above code (padded with 00s)
+				AR_pushOp(ops, AR_OP_WRITE32, hi, lo);
+				break;
+
+			case 0x01: AR_pushOp(ops, AR_OP_WRITE16, hi, lo); break;
+			case 0x02: AR_pushOp(ops, AR_OP_WRITE08, hi, lo); break;
+			case 0x03: AR_pushOp(ops, AR_OP_IF_GT32, hi, lo, 0, (hi == 0)); break;
+
+			case 0x04:
+				if ((hi == 0x04332211) && (lo == 88776655)) break;	//44332211 88776655   parameter bytes 1..8 for above code  (example)
+				AR_pushOp(ops, AR_OP_IF_LT32, hi, lo, 0, (hi == 0));
+				break;
+
+			case 0x05: AR_pushOp(ops, AR_OP_IF_EQ32, hi, lo, 0, (hi == 0)); break;
+			case 0x06: AR_pushOp(ops, AR_OP_IF_NE32, hi, lo, 0, (hi == 0)); break;
+			case 0x07: AR_pushOp(ops, AR_OP_IF_GT16, hi, lo & 0xFFFF, (~(lo >> 16)) & 0xFFFF, (hi == 0)); break;
+			case 0x08: AR_pushOp(ops, AR_OP_IF_LT16, hi, lo & 0xFFFF, (~(lo >> 16)) & 0xFFFF, (hi == 0)); break;
+			case 0x09: AR_pushOp(ops, AR_OP_IF_EQ16, hi, lo & 0xFFFF, (~(lo >> 16)) & 0xFFFF, (hi == 0)); break;
+			case 0x0A: AR_pushOp(ops, AR_OP_IF_NE16, hi, lo & 0xFFFF, (~(lo >> 16)) & 0xFFFF, (hi == 0)); break;
+			case 0x0B: AR_pushOp(ops, AR_OP_LOAD_OFFSET, hi, 0); break;
+
+			case 0x0C:
+				switch (subtype)
+				{
+					case 0x0: AR_pushOp(ops, AR_OP_FOR, 0, lo + 1); break;
+					case 0x4: printf("AR: untested code C4\n"); break;
+					case 0x5: AR_pushOp(ops, AR_OP_IF_COUNTER, 0, (lo >> 8) & 0xFFFF, lo & 0xFFFF); break;
+					case 0x6: AR_pushOp(ops, AR_OP_STORE_OFFSET, lo, 0); break;
+				}
+				break;
+
+			case 0x0D:
+				switch (subtype)
+				{
+					case 0x0: AR_pushOp(ops, AR_OP_ENDIF, 0, 0); break;
+					case 0x1: AR_pushOp(ops, AR_OP_NEXT, 0, 0); break;
+					case 0x2: AR_pushOp(ops, AR_OP_NEXT_FLUSH, 0, 0); break;
+					case 0x3: AR_pushOp(ops, AR_OP_SET_OFFSET, 0, lo); break;
+					case 0x4: AR_pushOp(ops, AR_OP_ADD_DATA, 0, lo); break;
+					case 0x5: AR_pushOp(ops, AR_OP_SET_DATA, 0, lo); break;
+					case 0x6: AR_pushOp(ops, AR_OP_STORE_DATA32, lo, 0); break;
+					case 0x7: AR_pushOp(ops, AR_OP_STORE_DATA16, lo, 0); break;
+					case 0x8: AR_pushOp(ops, AR_OP_STORE_DATA08, lo, 0); break;
+					case 0x9: AR_pushOp(ops, AR_OP_LOAD_DATA32, lo, 0); break;
+					case 0xA: AR_pushOp(ops, AR_OP_LOAD_DATA16, lo, 0); break;
+					case 0xB: AR_pushOp(ops, AR_OP_LOAD_DATA08, lo, 0); break;
+					case 0xC: AR_pushOp(ops, AR_OP_ADD_OFFSET, 0, lo); break;
+				}
+				break;
+
+			case 0x0E:		// EXXXXXXX YYYYYYYY   Copy YYYYYYYY parameter bytes to [XXXXXXXX+offset...]
+			{
+				u32 maxByteReadLocation = ((2 * 4) * (MAX_XX_CODE - i - 1)) - 1; // 2 = 2 array dimensions, 4 = 4 bytes per array element
+				if (lo <= maxByteReadLocation)
+				{
+					const u8 *tmp_code = (const u8 *)(cheat.code[i+1]);
+					AR_pushOp(ops, AR_OP_WRITE_PARAMS, hi, lo, (u32)data.size());
+					data.insert(data.end(), tmp_code, tmp_code + lo);
+				}
+
+				// the parameter lines are never run as codes, whether the condition holds or not
+				i += ((lo + 7) / 8);
+				break;
+			}
+
+			case 0x0F: AR_pushOp(ops, AR_OP_COPY, hi, lo); break;
+		}
+	}
+
+	AR_pushOp(ops, AR_OP_END, 0, 0);
+}
+
+void CHEATS::runAR(size_t begin)
 {
-	u8	type = 0;
-	u8	subtype = 0;
-	u32	hi = 0;
-	u32	lo = 0;
-	u32	addr = 0;
-	u32	val = 0;
 	// AR temporary vars & flags
 	u32	offset = 0;
 	u32	datareg = 0;
 	u32	loopcount = 0;
 	u32	counter = 0;
 	u32	if_flag = 0;
-	s32 loopbackline = 0;
+	size_t loopbackline = begin;
 	u32 loop_flag = 0;
-	
-	for (int i=0; i < list.num; i++)
-	{
-		type = list.code[i][0] >> 28;
-		subtype = (list.code[i][0] >> 24) & 0x0F;
 
-		hi = list.code[i][0] & 0x0FFFFFFF;
-		lo = list.code[i][1];
+	for (size_t i = begin; ; i++)
+	{
+		const CHEATS_AR_OP &op = compiledAR[i];
+		if (op.op == AR_OP_END) break;
 
-		if (if_flag > 0) 
+		if (if_flag > 0)
 		{
-			if ((type == 0x0E)) i += ((lo + 7) / 8);
-			if ( (type == 0x0D) && (subtype == 0)) if_flag--;	// ENDIF
-			if ( (type == 0x0D) && (subtype == 2))				// NEXT & Flush
+			if (op.op == AR_OP_ENDIF) if_flag--;
+			if (op.op == AR_OP_NEXT_FLUSH)
 			{
 				if (loop_flag)
 					i = (loopbackline-1);
@@ -119,296 +287,126 @@ void CHEATS::ARparser(CHEATS_LIST& list)
 			continue;
 		}
 
-		switch (type)
-		{
-			case 0x00:
-			{
-				if (hi==0)
-				{
-					//manual hook
-				}
-				else
-				if ((hi==0x0000AA99) && (lo==0))	// 0000AA99 00000000   parameter bytes 9..10 for above code (padded with 00s)
-				{
-					//parameter bytes 9..10 for above code (padded with 00s)
-				}
-				else	// 0XXXXXXX YYYYYYYY   word[XXXXXXX+offset] = YYYYYYYY
-				{
-					addr = hi + offset;
-					_MMU_write32<ARMCPU_ARM7,MMU_AT_DEBUG>(addr, lo);
-				}
-			}
-			break;
-
-			case 0x01:	// 1XXXXXXX 0000YYYY   half[XXXXXXX+offset] = YYYY
-				addr = hi + offset;
-				_MMU_write16<ARMCPU_ARM7,MMU_AT_DEBUG>(addr, lo);
-			break;
+		// conditionals only ever get to run with if_flag == 0, so a failed condition just opens a new skipped block
+		const u32 condAddr = op.useOffset ? offset : op.addr;
 
-			case 0x02:	// 2XXXXXXX 000000YY   byte[XXXXXXX+offset] = YY
-				addr = hi + offset;
-				_MMU_write08<ARMCPU_ARM7,MMU_AT_DEBUG>(addr, lo);
-			break;
-
-			case 0x03:	// 3XXXXXXX YYYYYYYY   IF YYYYYYYY > word[XXXXXXX]   ;unsigned
-				if (hi == 0) hi = offset;	// V1.54+
-				val = _MMU_read32<ARMCPU_ARM7,MMU_AT_DEBUG>(hi);
-				if ( lo > val )
-				{
-					if (if_flag > 0) if_flag--;
-				}
-				else
-				{
-					if_flag++;
-				}
-			break;
-
-			case 0x04:	// 4XXXXXXX YYYYYYYY   IF YYYYYYYY < word[XXXXXXX]   ;unsigned
-				if ((hi == 0x04332211) && (lo == 88776655))	//44332211 88776655   parameter bytes 1..8 for above code  (example)
-				{
-					break;
-				}
-				if (hi == 0) hi = offset;	// V1.54+
-				val = _MMU_read32<ARMCPU_ARM7,MMU_AT_DEBUG>(hi);
-				if ( lo < val )
-				{
-					if (if_flag > 0) if_flag--;
-				}
-				else
-				{
-					if_flag++;
-				}
-			break;
-
-			case 0x05:	// 5XXXXXXX YYYYYYYY   IF YYYYYYYY = word[XXXXXXX]
-				if (hi == 0) hi = offset;	// V1.54+
-				val = _MMU_read32<ARMCPU_ARM7,MMU_AT_DEBUG>(hi);
-				if ( lo == val )
-				{
-					if (if_flag > 0) if_flag--;
-				}
-				else
-				{
-					if_flag++;
-				}
-			break;
+		switch (op.op)
+		{
+			case AR_OP_WRITE32: _MMU_write32<ARMCPU_ARM7,MMU_AT_DEBUG>(op.addr + offset, op.val); break;
+			case AR_OP_WRITE16: _MMU_write16<ARMCPU_ARM7,MMU_AT_DEBUG>(op.addr + offset, op.val); break;
+			case AR_OP_WRITE08: _MMU_write08<ARMCPU_ARM7,MMU_AT_DEBUG>(op.addr + offset, op.val); break;
+
+			case AR_OP_IF_GT32: if (!(op.val > _MMU_read32<ARMCPU_ARM7,MMU_AT_DEBUG>(condAddr))) if_flag++; break;
+			case AR_OP_IF_LT32: if (!(op.val < _MMU_read32<ARMCPU_ARM7,MMU_AT_DEBUG>(condAddr))) if_flag++; break;
+			case AR_OP_IF_EQ32: if (!(op.val == _MMU_read32<ARMCPU_ARM7,MMU_AT_DEBUG>(condAddr))) if_flag++; break;
+			case AR_OP_IF_NE32: if (!(op.val != _MMU_read32<ARMCPU_ARM7,MMU_AT_DEBUG>(condAddr))) if_flag++; break;
+			case AR_OP_IF_GT16: if (!(op.val > (op.mask & _MMU_read16<ARMCPU_ARM7,MMU_AT_DEBUG>(condAddr)))) if_flag++; break;
+			case AR_OP_IF_LT16: if (!(op.val < (op.mask & _MMU_read16<ARMCPU_ARM7,MMU_AT_DEBUG>(condAddr)))) if_flag++; break;
+			case AR_OP_IF_EQ16: if (!(op.val == (op.mask & _MMU_read16<ARMCPU_ARM7,MMU_AT_DEBUG>(condAddr)))) if_flag++; break;
+			case AR_OP_IF_NE16: if (!(op.val != (op.mask & _MMU_read16<ARMCPU_ARM7,MMU_AT_DEBUG>(condAddr)))) if_flag++; break;
+
+			case AR_OP_LOAD_OFFSET: offset = _MMU_read32<ARMCPU_ARM7,MMU_AT_DEBUG>(op.addr + offset); break;
+
+			case AR_OP_FOR:
+				loop_flag = (loopcount < op.val) ? 1 : 0;
+				loopcount++;
+				loopbackline = i;
+				break;
 
-			case 0x06:	// 6XXXXXXX YYYYYYYY   IF YYYYYYYY <> word[XXXXXXX]
-				if (hi == 0) hi = offset;	// V1.54+
-				val = _MMU_read32<ARMCPU_ARM7,MMU_AT_DEBUG>(hi);
-				if ( lo != val )
-				{
-					if (if_flag > 0) if_flag--;
-				}
-				else
-				{
-					if_flag++;
-				}
-			break;
+			case AR_OP_IF_COUNTER:
+				counter++;
+				if ((counter & op.mask) != op.val) if_flag++;
+				break;
 
-			case 0x07:	// 7XXXXXXX ZZZZYYYY   IF YYYY > ((not ZZZZ) AND half[XXXXXXX])
-				if (hi == 0) hi = offset;	// V1.54+
-				val = _MMU_read16<ARMCPU_ARM7,MMU_AT_DEBUG>(hi);
-				if ( (lo & 0xFFFF) > ( (~(lo >> 16)) & val) )
-				{
-					if (if_flag > 0) if_flag--;
-				}
-				else
-				{
-					if_flag++;
-				}
-			break;
+			case AR_OP_STORE_OFFSET: _MMU_write32<ARMCPU_ARM7,MMU_AT_DEBUG>(op.addr, offset); break;
 
-			case 0x08:	// 8XXXXXXX ZZZZYYYY   IF YYYY < ((not ZZZZ) AND half[XXXXXXX])
-				if (hi == 0) hi = offset;	// V1.54+
-				val = _MMU_read16<ARMCPU_ARM7,MMU_AT_DEBUG>(hi);
-				if ( (lo & 0xFFFF) < ( (~(lo >> 16)) & val) )
-				{
-					if (if_flag > 0) if_flag--;
-				}
-				else
-				{
-					if_flag++;
-				}
-			break;
+			case AR_OP_ENDIF: break;
 
-			case 0x09:	// 9XXXXXXX ZZZZYYYY   IF YYYY = ((not ZZZZ) AND half[XXXXXXX])
-				if (hi == 0) hi = offset;	// V1.54+
-				val = _MMU_read16<ARMCPU_ARM7,MMU_AT_DEBUG>(hi);
-				if ( (lo & 0xFFFF) == ( (~(lo >> 16)) & val) )
-				{
-					if (if_flag > 0) if_flag--;
-				}
-				else
-				{
-					if_flag++;
-				}
-			break;
+			case AR_OP_NEXT:
+				if (loop_flag)
+					i = (loopbackline-1);
+				break;
 
-			case 0x0A:	// AXXXXXXX ZZZZYYYY   IF YYYY <> ((not ZZZZ) AND half[XXXXXXX])
-				if (hi == 0) hi = offset;	// V1.54+
-				val = _MMU_read16<ARMCPU_ARM7,MMU_AT_DEBUG>(hi);
-				if ( (lo & 0xFFFF) != ( (~(lo >> 16)) & val) )
-				{
-					if (if_flag > 0) if_flag--;
-				}
+			case AR_OP_NEXT_FLUSH:
+				if (loop_flag)
+					i = (loopbackline-1);
 				else
 				{
-					if_flag++;
-				}
-			break;
-
-			case 0x0B:	// BXXXXXXX 00000000   offset = word[XXXXXXX+offset]
-				addr = hi + offset;
-				offset = _MMU_read32<ARMCPU_ARM7,MMU_AT_DEBUG>(addr);;
-			break;
-
-			case 0x0C:
-				switch (subtype)
-				{
-					case 0x0:	// C0000000 YYYYYYYY   FOR loopcount=0 to YYYYYYYY  ;execute Y+1 times
-						if (loopcount < (lo+1))
-							loop_flag = 1;
-						else
-							loop_flag = 0;
-						loopcount++;
-						loopbackline = i;
-					break;
-
-					case 0x4:	// C4000000 00000000   offset = address of the C4000000 code ; V1.54
-						printf("AR: untested code C4\n");
-					break;
-
-					case 0x5:	// C5000000 XXXXYYYY   counter=counter+1, IF (counter AND YYYY) = XXXX ; V1.54
-						counter++;
-						if ( (counter & (lo & 0xFFFF)) == ((lo >> 8) & 0xFFFF) )
-						{
-							if (if_flag > 0) if_flag--;
-						}
-						else
-						{
-							if_flag++;
-						}
-					break;
-
-					case 0x6:	// C6000000 XXXXXXXX   [XXXXXXXX]=offset ; V1.54
-						_MMU_write32<ARMCPU_ARM7,MMU_AT_DEBUG>(lo, offset);
-					break;
+					offset = 0;
+					datareg = 0;
+					loopcount = 0;
+					counter = 0;
+					if_flag = 0;
+					loop_flag = 0;
 				}
-			break;
-
-			case 0x0D:
-			{
-				switch (subtype)
-				{
-					case 0x0:	// D0000000 00000000   ENDIF
-					break;
-
-					case 0x1:	// D1000000 00000000   NEXT loopcount
-						if (loop_flag)
-							i = (loopbackline-1);
-					break;
-
-					case 0x2:	// D2000000 00000000   NEXT loopcount, and then FLUSH everything
-						if (loop_flag)
-							i = (loopbackline-1);
-						else
-						{
-							offset = 0;
-							datareg = 0;
-							loopcount = 0;
-							counter = 0;
-							if_flag = 0;
-							loop_flag = 0;
-						}
-					break;
-
-					case 0x3:	// D3000000 XXXXXXXX   offset = XXXXXXXX
-						offset = lo;
-					break;
-
-					case 0x4:	// D4000000 XXXXXXXX   datareg = datareg + XXXXXXXX
-						datareg += lo;
-					break;
+				break;
 
-					case 0x5:	// D5000000 XXXXXXXX   datareg = XXXXXXXX
-						datareg = lo;
-					break;
+			case AR_OP_SET_OFFSET: offset = op.val; break;
+			case AR_OP_ADD_DATA: datareg += op.val; break;
+			case AR_OP_SET_DATA: datareg = op.val; break;
 
-					case 0x6:	// D6000000 XXXXXXXX   word[XXXXXXXX+offset]=datareg, offset=offset+4
-						addr = lo + offset;
-						_MMU_write32<ARMCPU_ARM7,MMU_AT_DEBUG>(addr, datareg);
-						offset += 4;
-					break;
+			case AR_OP_STORE_DATA32:
+				_MMU_write32<ARMCPU_ARM7,MMU_AT_DEBUG>(op.addr + offset, datareg);
+				offset += 4;
+				break;
 
-					case 0x7:	// D7000000 XXXXXXXX   half[XXXXXXXX+offset]=datareg, offset=offset+2
-						addr = lo + offset;
-						_MMU_write16<ARMCPU_ARM7,MMU_AT_DEBUG>(addr, datareg);
-						offset += 2;
-					break;
+			case AR_OP_STORE_DATA16:
+				_MMU_write16<ARMCPU_ARM7,MMU_AT_DEBUG>(op.addr + offset, datareg);
+				offset += 2;
+				break;
 
-					case 0x8:	// D8000000 XXXXXXXX   byte[XXXXXXXX+offset]=datareg, offset=offset+1
-						addr = lo + offset;
-						_MMU_write08<ARMCPU_ARM7,MMU_AT_DEBUG>(addr, datareg);
-						offset += 1;
-					break;
+			case AR_OP_STORE_DATA08:
+				_MMU_write08<ARMCPU_ARM7,MMU_AT_DEBUG>(op.addr + offset, datareg);
+				offset += 1;
+				break;
 
-					case 0x9:	// D9000000 XXXXXXXX   datareg = word[XXXXXXXX+offset]
-						addr = lo + offset;
-						datareg = _MMU_read32<ARMCPU_ARM7,MMU_AT_DEBUG>(addr);
-					break;
+			case AR_OP_LOAD_DATA32: datareg = _MMU_read32<ARMCPU_ARM7,MMU_AT_DEBUG>(op.addr + offset); break;
+			case AR_OP_LOAD_DATA16: datareg = _MMU_read16<ARMCPU_ARM7,MMU_AT_DEBUG>(op.addr + offset); break;
+			case AR_OP_LOAD_DATA08: datareg = _MMU_read08<ARMCPU_ARM7,MMU_AT_DEBUG>(op.addr + offset); break;
+			case AR_OP_ADD_OFFSET: offset += op.val; break;
 
-					case 0xA:	// DA000000 XXXXXXXX   datareg = half[XXXXXXXX+offset]
-						addr = lo + offset;
-						datareg = _MMU_read16<ARMCPU_ARM7,MMU_AT_DEBUG>(addr);
-					break;
+			case AR_OP_WRITE_PARAMS: AR_writeBlock(op.addr + offset, &compiledARData[op.mask], op.val); break;
+			case AR_OP_COPY: AR_copyBlock(op.addr, offset, op.val); break;
+		}
+	}
+}
 
-					case 0xB:	// DB000000 XXXXXXXX   datareg = byte[XXXXXXXX+offset] ;bugged on pre-v1.54
-						addr = lo + offset;
-						datareg = _MMU_read08<ARMCPU_ARM7,MMU_AT_DEBUG>(addr);
-					break;
+void CHEATS::compile()
+{
+	compiledStale = false;
+	compiledInternal.clear();
+	compiledAR.clear();
+	compiledARStart.clear();
+	compiledARData.clear();
 
-					case 0xC:	// DC000000 XXXXXXXX   offset = offset + XXXXXXXX
-						offset += lo;
-					break;
-				}
-			}
-			break;
+	for (size_t i = 0; i < list.size(); i++)
+	{
+		const CHEATS_LIST &cheat = list[i];
+		if (!cheat.enabled) continue;
 
-			case 0xE:		// EXXXXXXX YYYYYYYY   Copy YYYYYYYY parameter bytes to [XXXXXXXX+offset...]
+		switch (cheat.type)
+		{
+			case CHEAT_TYPE_INTERNAL:
 			{
-				u8	*tmp_code = (u8*)(list.code[i+1]);
-				u32 addr = hi+offset;
-				u32 maxByteReadLocation = ((2 * 4) * (MAX_XX_CODE - i - 1)) - 1; // 2 = 2 array dimensions, 4 = 4 bytes per array element
-				
-				if (lo <= maxByteReadLocation)
-				{
-					for (u32 t = 0; t < lo; t++)
-					{
-						u8	tmp = tmp_code[t];
-						_MMU_write08<ARMCPU_ARM7,MMU_AT_DEBUG>(addr, tmp);
-						addr++;
-					}
-				}
-				
-				i += ((lo + 7) / 8);
+				CHEATS_INTERNAL_WRITE write;
+				write.addr = cheat.code[0][0];
+				write.val = cheat.code[0][1];
+				write.size = cheat.size;
+				compiledInternal.push_back(write);
+				break;
 			}
-			break;
 
-			case 0xF:		// FXXXXXXX YYYYYYYY   Copy YYYYYYYY bytes from [offset..] to [XXXXXXX...]
-				for (u32 t = 0; t < lo; t++)
-				{
-					u8 tmp = _MMU_read08<ARMCPU_ARM7,MMU_AT_DEBUG>(offset+t);
-					_MMU_write08<ARMCPU_ARM7,MMU_AT_DEBUG>(hi+t, tmp);
-				}
-			break;
-			default: PROGINFO("AR: ERROR unknown command 0x%2X at %08X:%08X\n", type, hi, lo); break;
+			case CHEAT_TYPE_AR:
+				compiledARStart.push_back((u32)compiledAR.size());
+				AR_compile(cheat, compiledAR, compiledARData);
+				break;
 		}
 	}
 }
 
 BOOL CHEATS::add_AR_Direct(CHEATS_LIST cheat)
 {
+	listChanged();
 	size_t num = list.size();
 	list.push_back(cheat);
 	list[num].type = 1;
@@ -417,6 +415,7 @@ BOOL CHEATS::add_AR_Direct(CHEATS_LIST cheat)
 
 BOOL CHEATS::add_AR(char *code, char *description, BOOL enabled)
 {
+	listChanged();
 	//if (num == MAX_CHEAT_LIST) return FALSE;
 	size_t num = list.size();
 
@@ -435,6 +434,7 @@ BOOL CHEATS::add_AR(char *code, char *description, BOOL enabled)
 BOOL CHEATS::update_AR(char *code, char *description, BOOL enabled, u32 pos)
 {
 	if (pos >= list.size()) return FALSE;
+	listChanged();
 
 	if (code != NULL)
 	{
@@ -449,6 +449,7 @@ BOOL CHEATS::update_AR(char *code, char *description, BOOL enabled, u32 pos)
 
 BOOL CHEATS::add_CB(char *code, char *description, BOOL enabled)
 {
+	listChanged();
 	//if (num == MAX_CHEAT_LIST) return FALSE;
 	size_t num = list.size();
 
@@ -464,6 +465,7 @@ BOOL CHEATS::add_CB(char *code, char *description, BOOL enabled)
 BOOL CHEATS::update_CB(char *code, char *description, BOOL enabled, u32 pos)
 {
 	if (pos >= list.size()) return FALSE;
+	listChanged();
 
 	if (code != NULL)
 	{
@@ -481,6 +483,7 @@ BOOL CHEATS::remove(u32 pos)
 	if (list.size() == 0) return FALSE;
 
 	list.erase(list.begin()+pos);
+	listChanged();
 
 	return TRUE;
 }
@@ -735,6 +738,7 @@ BOOL CHEATS::load()
 		}
 
 		list.push_back(tmp_cht);
+		listChanged();
 		last++;
 	}
 	
@@ -751,53 +755,46 @@ void CHEATS::process(int targetType)
 {
 	if (CommonSettings.cheatsDisable) return;
 	if (list.size() == 0) return;
-	size_t num = list.size();
-	for (size_t i = 0; i < num; i++)
-	{
-		if (!list[i].enabled) continue;
+	if (compiledStale) compile();
 
-		int type = list[i].type;
-		
-		if(type != targetType)
-		continue;
-
-		switch(type)
+	switch (targetType)
+	{
+		case CHEAT_TYPE_INTERNAL:
 		{
-			case 0:		// internal cheat system
+			for (size_t i = 0; i < compiledInternal.size(); i++)
 			{
-				//INFO("list at 0x0|%07X value %i (size %i)\n",list[i].code[0], list[i].lo[0], list[i].size);
-				u32 addr = list[i].code[0][0];
-				u32 val = list[i].code[0][1];
-				switch (list[i].size)
+				const CHEATS_INTERNAL_WRITE &write = compiledInternal[i];
+				switch (write.size)
 				{
 				case 0: 
-					_MMU_write08<ARMCPU_ARM9,MMU_AT_DEBUG>(addr,val);
+					_MMU_write08<ARMCPU_ARM9,MMU_AT_DEBUG>(write.addr,write.val);
 					break;
 				case 1: 
-					_MMU_write16<ARMCPU_ARM9,MMU_AT_DEBUG>(addr,val);
+					_MMU_write16<ARMCPU_ARM9,MMU_AT_DEBUG>(write.addr,write.val);
 					break;
 				case 2:
 					{
-						u32 tmp = _MMU_read32<ARMCPU_ARM9,MMU_AT_DEBUG>(addr);
+						u32 tmp = _MMU_read32<ARMCPU_ARM9,MMU_AT_DEBUG>(write.addr);
 						tmp &= 0xFF000000;
-						tmp |= (val & 0x00FFFFFF);
-						_MMU_write32<ARMCPU_ARM9,MMU_AT_DEBUG>(addr,tmp);
+						tmp |= (write.val & 0x00FFFFFF);
+						_MMU_write32<ARMCPU_ARM9,MMU_AT_DEBUG>(write.addr,tmp);
 						break;
 					}
 				case 3: 
-					_MMU_write32<ARMCPU_ARM9,MMU_AT_DEBUG>(addr,val);
+					_MMU_write32<ARMCPU_ARM9,MMU_AT_DEBUG>(write.addr,write.val);
 					break;
 				}
-				break;
-			} //end case 0 internal cheat system
-
-			case 1:		// Action Replay
-				ARparser(list[i]);
-				break;
-			case 2:		// Codebreaker
-				break;
-			default: continue;
+			}
+			break;
 		}
+
+		case CHEAT_TYPE_AR:
+			for (size_t i = 0; i < compiledARStart.size(); i++)
+				runAR(compiledARStart[i]);
+			break;
+
+		case CHEAT_TYPE_CODEBREAKER:
+			break;
 	}
 }
 
@@ -869,243 +866,348 @@ BOOL CHEATS::XXCodeFromString(CHEATS_LIST *cheatItem, const char *codeString)
 }
 
 // ========================================== search
+// comparison used for exact value searches, next to the comparative ones (0 '>', 1 '<', 2 '==', 3 '!=')
+#define CHEATSEARCH_COMP_EXACT			4
+// once this few candidates are left, they are kept as a sorted address list instead of the slot bitmap
+#define CHEATSEARCH_SPARSE_THRESHOLD	0x10000
+#define CHEATSEARCH_MAX_TASKS			8
+
+static FORCEINLINE u32 CheatSearch_Read(const u8 *src, const u32 addr, const u32 size)
+{
+	switch (size)
+	{
+		case 0: return T1ReadByte((u8 *)src, addr);
+		case 1: return T1ReadWord((u8 *)src, addr);
+		case 2: return (u32)src[addr] | ((u32)src[addr+1] << 8) | ((u32)src[addr+2] << 16);
+		default: return T1ReadLong((u8 *)src, addr);
+	}
+}
+
+static FORCEINLINE bool CheatSearch_Compare(const u32 cur, const u32 ref, const u8 comp)
+{
+	switch (comp)
+	{
+		case 0: return (cur > ref);
+		case 1: return (cur < ref);
+		case 2: return (cur == ref);
+		case 3: return (cur != ref);
+		case CHEATSEARCH_COMP_EXACT: return (cur == ref);
+		default: return false;
+	}
+}
+
+struct CheatSearchWork
+{
+	const u8	*ram;
+	const u8	*prev;
+	u32			*bits;
+	u32			wordBegin;
+	u32			wordEnd;
+	u32			size;
+	u8			comp;
+	u32			val;
+	u32			amount;
+};
+
+static FORCEINLINE u32 CheatSearch_PopCount(u32 v)
+{
+	v = v - ((v >> 1) & 0x55555555);
+	v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+	return (((v + (v >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+}
+
+static u32 CheatSearch_FilterWordScalar(const CheatSearchWork &work, const u32 w)
+{
+	const u32 step = work.size + 1;
+	u32 bits = work.bits[w];
+	u32 result = 0;
+
+	for (u32 b = 0; bits != 0; b++, bits >>= 1)
+	{
+		if (!(bits & 1)) continue;
+
+		const u32 addr = ((w << 5) + b) * step;
+		const u32 ref = (work.comp == CHEATSEARCH_COMP_EXACT) ? work.val : CheatSearch_Read(work.prev, addr, work.size);
+		if (CheatSearch_Compare(CheatSearch_Read(work.ram, addr, work.size), ref, work.comp))
+			result |= (1 << b);
+	}
+
+	return result;
+}
+
+#ifdef ENABLE_SSE2
+
+// compares a, b as unsigned lanes of the search width, returning all-ones lanes where the comparison holds
+// (the != case is returned as ==, and inverted by the caller)
+template <u32 SIZE>
+static FORCEINLINE __m128i CheatSearch_CompareSSE2(__m128i a, __m128i b, const u8 comp)
+{
+	const __m128i bias = (SIZE == 0) ? _mm_set1_epi8((char)0x80) : (SIZE == 1) ? _mm_set1_epi16((short)0x8000) : _mm_set1_epi32((int)0x80000000);
+
+	switch (comp)
+	{
+		case 0:
+		case 1:
+			a = _mm_xor_si128(a, bias);
+			b = _mm_xor_si128(b, bias);
+			if (comp == 1)
+			{
+				const __m128i tmp = a;
+				a = b;
+				b = tmp;
+			}
+			return (SIZE == 0) ? _mm_cmpgt_epi8(a, b) : (SIZE == 1) ? _mm_cmpgt_epi16(a, b) : _mm_cmpgt_epi32(a, b);
+
+		default:
+			return (SIZE == 0) ? _mm_cmpeq_epi8(a, b) : (SIZE == 1) ? _mm_cmpeq_epi16(a, b) : _mm_cmpeq_epi32(a, b);
+	}
+}
+
+// compares the 16 slots starting at addr and returns one bit per slot
+template <u32 SIZE>
+static FORCEINLINE u32 CheatSearch_Compare16SSE2(const CheatSearchWork &work, const u32 addr)
+{
+	const u32 vecCount = (SIZE == 0) ? 1 : (SIZE == 1) ? 2 : 4;
+	__m128i cmp[4];
+
+	for (u32 v = 0; v < vecCount; v++)
+	{
+		const __m128i cur = _mm_loadu_si128((__m128i *)(work.ram + addr + (v * 16)));
+		const __m128i ref = (work.comp == CHEATSEARCH_COMP_EXACT) ?
+			((SIZE == 0) ? _mm_set1_epi8((char)work.val) : (SIZE == 1) ? _mm_set1_epi16((short)work.val) : _mm_set1_epi32((int)work.val)) :
+			_mm_loadu_si128((__m128i *)(work.prev + addr + (v * 16)));
+		cmp[v] = CheatSearch_CompareSSE2<SIZE>(cur, ref, work.comp);
+	}
+
+	u32 result;
+	if (SIZE == 0)
+		result = _mm_movemask_epi8(cmp[0]);
+	else if (SIZE == 1)
+		result = _mm_movemask_epi8(_mm_packs_epi16(cmp[0], cmp[1]));
+	else
+		result = _mm_movemask_epi8(_mm_packs_epi16(_mm_packs_epi32(cmp[0], cmp[1]), _mm_packs_epi32(cmp[2], cmp[3])));
+
+	if (work.comp == 3)
+		result = ~result & 0xFFFF;
+
+	return result;
+}
+
+template <u32 SIZE>
+static u32 CheatSearch_FilterSSE2(CheatSearchWork &work)
+{
+	u32 amount = 0;
+
+	for (u32 w = work.wordBegin; w < work.wordEnd; w++)
+	{
+		if (work.bits[w] == 0) continue;
+
+		const u32 addr = (w << 5) << SIZE;
+		const u32 result = CheatSearch_Compare16SSE2<SIZE>(work, addr) | (CheatSearch_Compare16SSE2<SIZE>(work, addr + (16 << SIZE)) << 16);
+		work.bits[w] &= result;
+		amount += CheatSearch_PopCount(work.bits[w]);
+	}
+
+	return amount;
+}
+
+#endif
+
+static void* CheatSearch_RunFilter(void *arg)
+{
+	CheatSearchWork &work = *(CheatSearchWork *)arg;
+	work.amount = 0;
+
+#ifdef ENABLE_SSE2
+	// the vector kernels cover the power of two widths; 3 byte values aren't lane aligned
+	switch (work.size)
+	{
+		case 0: work.amount = CheatSearch_FilterSSE2<0>(work); return NULL;
+		case 1: work.amount = CheatSearch_FilterSSE2<1>(work); return NULL;
+		case 3: work.amount = CheatSearch_FilterSSE2<2>(work); return NULL;
+	}
+#endif
+
+	for (u32 w = work.wordBegin; w < work.wordEnd; w++)
+	{
+		if (work.bits[w] == 0) continue;
+		work.bits[w] &= CheatSearch_FilterWordScalar(work, w);
+		work.amount += CheatSearch_PopCount(work.bits[w]);
+	}
+
+	return NULL;
+}
+
 BOOL CHEATSEARCH::start(u8 type, u8 size, u8 sign)
 {
-	if (statMem) return FALSE;
 	if (mem) return FALSE;
 
-	statMem = new u8 [ ( 4 * 1024 * 1024 ) / 8 ];
-	memset(statMem, 0xFF, ( 4 * 1024 * 1024 ) / 8);
+	// search the whole configured main memory (4MB retail, 8MB debug, 16MB dsi)
+	memSize = _MMU_MAIN_MEM_MASK + 1;
 
-	// comparative search type (need 8Mb RAM !!! (4+4))
-	mem = new u8 [ ( 4 * 1024 * 1024 ) ];
-	memcpy(mem, MMU.MMU_MEM[0][0x20], ( 4 * 1024 * 1024 ) );
+	// comparative search type keeps a copy of main memory
+	mem = new u8 [memSize];
+	memcpy(mem, MMU.MAIN_MEM, memSize);
 
 	_type = type;
-	_size = size;
+	_size = std::min<u8>(size, 3);
 	_sign = sign;
 	amount = 0;
 	lastRecord = 0;
-	
+
+	// start out with every slot (the slot size is the value size, like the original bitmap search) as a candidate
+	const u32 slotCount = memSize / (_size + 1);
+	candidateBits.assign((slotCount + 31) / 32, 0xFFFFFFFF);
+	if (slotCount & 31)
+		candidateBits.back() = (1 << (slotCount & 31)) - 1;
+	candidateList.clear();
+	sparse = false;
+
+	// the calling thread filters the first slice itself, so one task fewer than slices
+	searchTaskCount = std::max(1, std::min(getOnlineCores(), CHEATSEARCH_MAX_TASKS));
+	if (searchTaskCount > 1)
+	{
+		searchTask = new Task[searchTaskCount - 1];
+		for (int i = 0; i < searchTaskCount - 1; i++)
+			searchTask[i].start(false);
+	}
+
 	//INFO("Cheat search system is inited (type %s)\n", type?"comparative":"exact");
 	return TRUE;
 }
 
 BOOL CHEATSEARCH::close()
 {
-	if (statMem)
+	if (searchTask)
 	{
-		delete [] statMem;
-		statMem = NULL;
+		for (int i = 0; i < searchTaskCount - 1; i++)
+			searchTask[i].shutdown();
+		delete [] searchTask;
+		searchTask = NULL;
 	}
+	searchTaskCount = 0;
 
 	if (mem)
 	{
 		delete [] mem;
 		mem = NULL;
 	}
+
+	candidateBits.clear();
+	candidateList.clear();
+	sparse = false;
+	memSize = 0;
 	amount = 0;
 	lastRecord = 0;
 	//INFO("Cheat search system is closed\n");
 	return FALSE;
 }
 
-u32 CHEATSEARCH::search(u32 val)
+void CHEATSEARCH::makeSparse()
 {
-	amount = 0;
+	const u32 step = _size + 1;
 
-	switch (_size)
+	candidateList.clear();
+	candidateList.reserve(amount);
+	for (u32 w = 0; w < candidateBits.size(); w++)
 	{
-		case 0:		// 1 byte
-			for (u32 i = 0; i < (4 * 1024 * 1024); i++)
-			{
-				u32	addr = (i >> 3);
-				u32	offs = (i % 8);
-				if (statMem[addr] & (1<<offs))
-				{
-					if ( T1ReadByte(MMU.MMU_MEM[ARMCPU_ARM9][0x20], i) == val )
-					{
-						statMem[addr] |= (1<<offs);
-						amount++;
-						continue;
-					}
-					statMem[addr] &= ~(1<<offs);
-				}
-			}
-		break;
-
-		case 1:		// 2 bytes
-			for (u32 i = 0; i < (4 * 1024 * 1024); i+=2)
-			{
-				u32	addr = (i >> 3);
-				u32	offs = (i % 8);
-				if (statMem[addr] & (3<<offs))
-				{
-					if ( T1ReadWord(MMU.MMU_MEM[ARMCPU_ARM9][0x20], i) == val )
-					{
-						statMem[addr] |= (3<<offs);
-						amount++;
-						continue;
-					}
-					statMem[addr] &= ~(3<<offs);
-				}
-			}
-		break;
-
-		case 2:		// 3 bytes
-			for (u32 i = 0; i < (4 * 1024 * 1024); i+=3)
-			{
-				u32	addr = (i >> 3);
-				u32	offs = (i % 8);
-				if (statMem[addr] & (0x7<<offs))
-				{
-					if ( (T1ReadLong(MMU.MMU_MEM[ARMCPU_ARM9][0x20], i) & 0x00FFFFFF) == val )
-					{
-						statMem[addr] |= (0x7<<offs);
-						amount++;
-						continue;
-					}
-					statMem[addr] &= ~(0x7<<offs);
-				}
-			}
-		break;
-
-		case 3:		// 4 bytes
-			for (u32 i = 0; i < (4 * 1024 * 1024); i+=4)
-			{
-				u32	addr = (i >> 3);
-				u32	offs = (i % 8);
-				if (statMem[addr] & (0xF<<offs))
-				{
-					if ( T1ReadLong(MMU.MMU_MEM[ARMCPU_ARM9][0x20], i) == val )
-					{
-						statMem[addr] |= (0xF<<offs);
-						amount++;
-						continue;
-					}
-					statMem[addr] &= ~(0xF<<offs);
-				}
-			}
-		break;
+		for (u32 bits = candidateBits[w], b = 0; bits != 0; b++, bits >>= 1)
+		{
+			if (bits & 1)
+				candidateList.push_back(((w << 5) + b) * step);
+		}
 	}
 
-	return (amount);
+	candidateBits.clear();
+	sparse = true;
 }
 
-u32 CHEATSEARCH::search(u8 comp)
+u32 CHEATSEARCH::filter(u8 comp, u32 val)
 {
-	BOOL	res = FALSE;
+	if (mem == NULL) return 0;
 
+	lastRecord = 0;
 	amount = 0;
-	
-	switch (_size)
+
+	// unknown comparisons and values which don't fit in the searched size never match
+	static const u32 sizeMask[4] = { 0xFF, 0xFFFF, 0xFFFFFF, 0xFFFFFFFF };
+	if ((comp > CHEATSEARCH_COMP_EXACT) || ((comp == CHEATSEARCH_COMP_EXACT) && (val & ~sizeMask[_size])))
 	{
-		case 0:		// 1 byte
-			for (u32 i = 0; i < (4 * 1024 * 1024); i++)
-			{
-				u32	addr = (i >> 3);
-				u32	offs = (i % 8);
-				if (statMem[addr] & (1<<offs))
-				{
-					switch (comp)
-					{
-						case 0: res=(T1ReadByte(MMU.MMU_MEM[ARMCPU_ARM9][0x20], i) > T1ReadByte(mem, i)); break;
-						case 1: res=(T1ReadByte(MMU.MMU_MEM[ARMCPU_ARM9][0x20], i) < T1ReadByte(mem, i)); break;
-						case 2: res=(T1ReadByte(MMU.MMU_MEM[ARMCPU_ARM9][0x20], i) == T1ReadByte(mem, i)); break;
-						case 3: res=(T1ReadByte(MMU.MMU_MEM[ARMCPU_ARM9][0x20], i) != T1ReadByte(mem, i)); break;
-						default: res = FALSE; break;
-					}
-					if ( res )
-					{
-						statMem[addr] |= (1<<offs);
-						amount++;
-						continue;
-					}
-					statMem[addr] &= ~(1<<offs);
-				}
-			}
-		break;
+		candidateBits.clear();
+		candidateList.clear();
+		sparse = true;
+		return amount;
+	}
 
-		case 1:		// 2 bytes
-			for (u32 i = 0; i < (4 * 1024 * 1024); i+=2)
-			{
-				u32	addr = (i >> 3);
-				u32	offs = (i % 8);
-				if (statMem[addr] & (3<<offs))
-				{
-					switch (comp)
-					{
-						case 0: res=(T1ReadWord(MMU.MMU_MEM[ARMCPU_ARM9][0x20], i) > T1ReadWord(mem, i)); break;
-						case 1: res=(T1ReadWord(MMU.MMU_MEM[ARMCPU_ARM9][0x20], i) < T1ReadWord(mem, i)); break;
-						case 2: res=(T1ReadWord(MMU.MMU_MEM[ARMCPU_ARM9][0x20], i) == T1ReadWord(mem, i)); break;
-						case 3: res=(T1ReadWord(MMU.MMU_MEM[ARMCPU_ARM9][0x20], i) != T1ReadWord(mem, i)); break;
-						default: res = FALSE; break;
-					}
-					if ( res )
-					{
-						statMem[addr] |= (3<<offs);
-						amount++;
-						continue;
-					}
-					statMem[addr] &= ~(3<<offs);
-				}
-			}
-		break;
+	if (sparse)
+	{
+		size_t kept = 0;
+		for (size_t i = 0; i < candidateList.size(); i++)
+		{
+			const u32 addr = candidateList[i];
+			const u32 ref = (comp == CHEATSEARCH_COMP_EXACT) ? val : CheatSearch_Read(mem, addr, _size);
+			if (CheatSearch_Compare(CheatSearch_Read(MMU.MAIN_MEM, addr, _size), ref, comp))
+				candidateList[kept++] = addr;
+		}
+		candidateList.resize(kept);
+		amount = (u32)kept;
+		return amount;
+	}
 
-		case 2:		// 3 bytes
-			for (u32 i = 0; i < (4 * 1024 * 1024); i+=3)
-			{
-				u32	addr = (i >> 3);
-				u32	offs = (i % 8);
-				if (statMem[addr] & (7<<offs))
-				{
-					switch (comp)
-					{
-						case 0: res=((T1ReadLong(MMU.MMU_MEM[ARMCPU_ARM9][0x20], i) & 0x00FFFFFF) > (T1ReadLong(mem, i) & 0x00FFFFFF) ); break;
-						case 1: res=((T1ReadLong(MMU.MMU_MEM[ARMCPU_ARM9][0x20], i) & 0x00FFFFFF) < (T1ReadLong(mem, i) & 0x00FFFFFF) ); break;
-						case 2: res=((T1ReadLong(MMU.MMU_MEM[ARMCPU_ARM9][0x20], i) & 0x00FFFFFF) == (T1ReadLong(mem, i) & 0x00FFFFFF) ); break;
-						case 3: res=((T1ReadLong(MMU.MMU_MEM[ARMCPU_ARM9][0x20], i) & 0x00FFFFFF) != (T1ReadLong(mem, i) & 0x00FFFFFF) ); break;
-						default: res = FALSE; break;
-					}
-					if ( res )
-					{
-						statMem[addr] |= (7<<offs);
-						amount++;
-						continue;
-					}
-					statMem[addr] &= ~(7<<offs);
-				}
-			}
-		break;
+	CheatSearchWork work[CHEATSEARCH_MAX_TASKS];
+	const u32 wordCount = (u32)candidateBits.size();
+	// the tail word may be partial; it stays on the scalar path so the vector kernels never read past the end
+	const bool partialTail = ((memSize / (_size + 1)) & 31) != 0;
+	const u32 denseWords = partialTail ? wordCount - 1 : wordCount;
+	const u32 wordsPerTask = (denseWords + searchTaskCount - 1) / searchTaskCount;
 
-		case 3:		// 4 bytes
-			for (u32 i = 0; i < (4 * 1024 * 1024); i+=4)
-			{
-				u32	addr = (i >> 3);
-				u32	offs = (i % 8);
-				if (statMem[addr] & (0xF<<offs))
-				{
-					switch (comp)
-					{
-						case 0: res=(T1ReadLong(MMU.MMU_MEM[ARMCPU_ARM9][0x20], i) > T1ReadLong(mem, i)); break;
-						case 1: res=(T1ReadLong(MMU.MMU_MEM[ARMCPU_ARM9][0x20], i) < T1ReadLong(mem, i)); break;
-						case 2: res=(T1ReadLong(MMU.MMU_MEM[ARMCPU_ARM9][0x20], i) == T1ReadLong(mem, i)); break;
-						case 3: res=(T1ReadLong(MMU.MMU_MEM[ARMCPU_ARM9][0x20], i) != T1ReadLong(mem, i)); break;
-						default: res = FALSE; break;
-					}
-					if ( res )
-					{
-						statMem[addr] |= (0xF<<offs);
-						amount++;
-						continue;
-					}
-					statMem[addr] &= ~(0xF<<offs);
-				}
-			}
-		break;
+	for (int i = 0; i < searchTaskCount; i++)
+	{
+		work[i].ram = MMU.MAIN_MEM;
+		work[i].prev = mem;
+		work[i].bits = &candidateBits[0];
+		work[i].wordBegin = std::min<u32>(i * wordsPerTask, denseWords);
+		work[i].wordEnd = std::min<u32>(work[i].wordBegin + wordsPerTask, denseWords);
+		work[i].size = _size;
+		work[i].comp = comp;
+		work[i].val = val;
+		work[i].amount = 0;
+	}
+
+	for (int i = 1; i < searchTaskCount; i++)
+		searchTask[i - 1].execute(&CheatSearch_RunFilter, &work[i]);
+	CheatSearch_RunFilter(&work[0]);
+	amount = work[0].amount;
+	for (int i = 1; i < searchTaskCount; i++)
+	{
+		searchTask[i - 1].finish();
+		amount += work[i].amount;
+	}
+
+	if (partialTail)
+	{
+		candidateBits[denseWords] &= CheatSearch_FilterWordScalar(work[0], denseWords);
+		amount += CheatSearch_PopCount(candidateBits[denseWords]);
 	}
 
-	memcpy(mem, MMU.MMU_MEM[0][0x20], ( 4 * 1024 * 1024 ) );
+	if (amount <= CHEATSEARCH_SPARSE_THRESHOLD)
+		makeSparse();
+
+	return amount;
+}
+
+u32 CHEATSEARCH::search(u32 val)
+{
+	return filter(CHEATSEARCH_COMP_EXACT, val);
+}
+
+u32 CHEATSEARCH::search(u8 comp)
+{
+	if (comp > 3) comp = 0xFF;
+	filter(comp, 0);
+
+	if (mem)
+		memcpy(mem, MMU.MAIN_MEM, memSize);
 
 	return (amount);
 }
@@ -1117,36 +1219,50 @@ u32 CHEATSEARCH::getAmount()
 
 BOOL CHEATSEARCH::getList(u32 *address, u32 *curVal)
 {
-	u8	step = (_size+1);
-	u8	stepMem = 1;
-	switch (_size)
+	return (getListBlock(address, curVal, 1) == 1) ? TRUE : FALSE;
+}
+
+// hands out up to count results, continuing from where the previous call stopped, so that
+// a frontend can fill its list a page at a time. returns 0 (and rewinds) once everything was returned
+u32 CHEATSEARCH::getListBlock(u32 *address, u32 *curVal, u32 count)
+{
+	u32 n = 0;
+
+	if (sparse)
 	{
-		case 1: stepMem = 0x3; break;
-		case 2: stepMem = 0x7; break;
-		case 3: stepMem = 0xF; break;
+		for (; (n < count) && (lastRecord < candidateList.size()); n++, lastRecord++)
+		{
+			address[n] = candidateList[lastRecord];
+			curVal[n] = CheatSearch_Read(MMU.MAIN_MEM, address[n], _size);
+		}
 	}
-
-	for (u32 i = lastRecord; i < (4 * 1024 * 1024); i+=step)
+	else
 	{
-		u32	addr = (i >> 3);
-		u32	offs = (i % 8);
-		if (statMem[addr] & (stepMem<<offs))
+		// lastRecord is the next slot to look at
+		const u32 step = _size + 1;
+		const u32 slotCount = (u32)candidateBits.size() * 32;
+		while ((n < count) && (lastRecord < slotCount))
 		{
-			*address = i;
-			lastRecord = i+step;
-			
-			switch (_size)
+			const u32 bits = candidateBits[lastRecord >> 5] >> (lastRecord & 31);
+			if (bits == 0)
 			{
-				case 0: *curVal=(u32)T1ReadByte(MMU.MMU_MEM[ARMCPU_ARM9][0x20], i); return TRUE;
-				case 1: *curVal=(u32)T1ReadWord(MMU.MMU_MEM[ARMCPU_ARM9][0x20], i); return TRUE;
-				case 2: *curVal=(u32)T1ReadLong(MMU.MMU_MEM[ARMCPU_ARM9][0x20], i) & 0x00FFFFFF; return TRUE;
-				case 3: *curVal=(u32)T1ReadLong(MMU.MMU_MEM[ARMCPU_ARM9][0x20], i); return TRUE;
-				default: return TRUE;
+				lastRecord = (lastRecord | 31) + 1;
+				continue;
 			}
+			if (bits & 1)
+			{
+				address[n] = lastRecord * step;
+				curVal[n] = CheatSearch_Read(MMU.MAIN_MEM, address[n], _size);
+				n++;
+			}
+			lastRecord++;
 		}
 	}
-	lastRecord = 0;
-	return FALSE;
+
+	if (n == 0)
+		lastRecord = 0;
+
+	return n;
 }
 
 void CHEATSEARCH::getListReset()
@@ -53,6 +53,25 @@ struct CHEATS_LIST
 	u8		size;
 };
 
+// an internal cheat, as kept in the batch write list built by CHEATS::compile()
+struct CHEATS_INTERNAL_WRITE
+{
+	u32		addr;
+	u32		val;
+	u8		size;
+};
+
+// a decoded Action Replay code line. the raw code words are decoded once by CHEATS::compileAR()
+// so that process() doesn't have to pick them apart again every frame
+struct CHEATS_AR_OP
+{
+	u8		op;					// one of the AR_OP_* values in cheatSystem.cpp
+	u8		useOffset;			// conditionals: compare against word[offset] instead of word[addr] (V1.54+)
+	u32		addr;
+	u32		val;
+	u32		mask;				// 16bit conditionals: (not ZZZZ), C5: YYYY
+};
+
 class CHEATS
 {
 private:
@@ -60,13 +79,23 @@ private:
 	u8					filename[MAX_PATH];
 	u32					currentGet;
 
+	// compiled form of the list, which process() runs from. it is rebuilt on the next process()
+	// after listChanged(); the mutators call that themselves
+	bool						compiledStale;
+	std::vector<CHEATS_INTERNAL_WRITE> compiledInternal;
+	std::vector<CHEATS_AR_OP>	compiledAR;			// one program per enabled AR cheat, each terminated by AR_OP_END
+	std::vector<u32>			compiledARStart;	// index of the first op of each program
+	std::vector<u8>				compiledARData;		// parameter bytes of type E codes
+
 	void	clear();
-	void	ARparser(CHEATS_LIST& cheat);
+	void	compile();
+	void	runAR(size_t begin);
 	char	*clearCode(char *s);
 
 public:
 	CHEATS()
 		: currentGet(0)
+		, compiledStale(true)
 	{
 		memset(filename, 0, sizeof(filename));
 	}
@@ -92,17 +121,21 @@ public:
 	BOOL	save();
 	BOOL	load();
 	void	process(int targetType);
+	// for frontends which edit items in place through getListPtr() or getItemByIndex()
+	void	listChanged() { compiledStale = true; }
 	void	getXXcodeString(CHEATS_LIST cheat, char *res_buf);
 	
 	static BOOL XXCodeFromString(CHEATS_LIST *cheatItem, const std::string codeString);
 	static BOOL XXCodeFromString(CHEATS_LIST *cheatItem, const char *codeString);
 };
 
+class Task;
+
 class CHEATSEARCH
 {
 private:
-	u8	*statMem;
-	u8	*mem;
+	u8	*mem;				// main memory as of the last comparative search
+	u32	memSize;			// size of the configured main memory when the search was started
 	u32	amount;
 	u32	lastRecord;
 
@@ -110,9 +143,21 @@ private:
 	u32	_size;
 	u32	_sign;
 
+	// surviving candidates are kept as one bit per aligned slot of main memory,
+	// until few enough remain to keep them as a sorted address list instead
+	std::vector<u32>	candidateBits;
+	std::vector<u32>	candidateList;
+	bool				sparse;
+
+	Task				*searchTask;		// searchTaskCount - 1 workers; the caller filters the first slice
+	int					searchTaskCount;
+
+	u32 filter(u8 comp, u32 val);
+	void makeSparse();
+
 public:
 	CHEATSEARCH()
-			: statMem(0), mem(0), amount(0), lastRecord(0), _type(0), _size(0), _sign(0) 
+			: mem(0), memSize(0), amount(0), lastRecord(0), _type(0), _size(0), _sign(0), sparse(false), searchTask(0), searchTaskCount(0)
 	{}
 	~CHEATSEARCH() { close(); }
 	BOOL start(u8 type, u8 size, u8 sign);
@@ -121,6 +166,7 @@ public:
 	u32 search(u8 comp);
 	u32 getAmount();
 	BOOL getList(u32 *address, u32 *curVal);
+	u32 getListBlock(u32 *address, u32 *curVal, u32 count);
 	void getListReset();
 };
 
@@ -30,6 +30,16 @@ static NSImage *iconInternalCheat = nil;
 static NSImage *iconActionReplay = nil;
 static NSImage *iconCodeBreaker = nil;
 
+// Items point straight into the core's cheat list, so tell the core to recompile it
+// whenever one of the fields it runs from is edited.
+static void CheatItemChanged()
+{
+	if (cheats != NULL)
+	{
+		cheats->listChanged();
+	}
+}
+
 @dynamic data;
 @synthesize willAdd;
 @dynamic enabled;
@@ -175,6 +185,7 @@ static NSImage *iconCodeBreaker = nil;
 - (void) setEnabled:(BOOL)theState
 {
 	data->enabled = theState;
+	CheatItemChanged();
 	
 	if (workingCopy != nil)
 	{
@@ -217,6 +228,7 @@ static NSImage *iconCodeBreaker = nil;
 - (void) setCheatType:(NSInteger)theType
 {
 	data->type = (u8)theType;
+	CheatItemChanged();
 	
 	switch (theType)
 	{
@@ -325,6 +337,7 @@ static NSImage *iconCodeBreaker = nil;
 - (void) setBytes:(UInt8)byteSize
 {
 	data->size = (u8)(byteSize - 1);
+	CheatItemChanged();
 	
 	if (workingCopy != nil)
 	{
@@ -374,6 +387,7 @@ static NSImage *iconCodeBreaker = nil;
 	[theCode getCString:codeCString maxLength:codeCStringSize encoding:NSUTF8StringEncoding];
 	
 	CHEATS::XXCodeFromString(data, codeCString);
+	CheatItemChanged();
 	
 	free(codeCString);
 	codeCString = NULL;
@@ -407,6 +421,7 @@ static NSImage *iconCodeBreaker = nil;
 	theAddress &= 0x00FFFFFF;
 	theAddress |= 0x02000000;
 	data->code[0][0] = theAddress;
+	CheatItemChanged();
 	
 	if (workingCopy != nil)
 	{
@@ -464,6 +479,7 @@ static NSImage *iconCodeBreaker = nil;
 	}
 	
 	data->code[0][1] = (u32)theValue;
+	CheatItemChanged();
 	
 	if (workingCopy != nil)
 	{
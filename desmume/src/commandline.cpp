@@ -51,6 +51,7 @@ CommandLine::CommandLine()
 , _num_cores(-1)
 , _rigorous_timing(0)
 , _advanced_timing(-1)
+, _movie_statehash(0)
 , _slot1(NULL)
 , _slot1_fat_dir(NULL)
 , _slot1_fat_dir_type(false)
@@ -138,6 +139,7 @@ ENDL
 " --load-slot N              loads savestate from slot N (0-9)" ENDL
 " --play-movie DSM_FILE      automatically plays movie" ENDL
 " --record-movie DSM_FILE    begin recording a movie" ENDL
+" --movie-statehash          Store state hashes in recorded movies to find desyncs" ENDL
 ENDL
 "Arguments affecting video filters:" ENDL
 " --scanline-filter-a N      Fadeout intensity (N/16) (topleft) (default 0)" ENDL
@@ -247,6 +249,7 @@ bool CommandLine::parse(int argc,char **argv)
 			{ "load-slot", required_argument, NULL, OPT_LOAD_SLOT},
 			{ "play-movie", required_argument, NULL, OPT_PLAY_MOVIE},
 			{ "record-movie", required_argument, NULL, OPT_RECORD_MOVIE},
+			{ "movie-statehash", no_argument, &_movie_statehash, 1},
 
 			//video filters
 			{ "scanline-filter-a", required_argument, NULL, OPT_SCANLINES_A},
@@ -328,6 +331,7 @@ bool CommandLine::parse(int argc,char **argv)
 	if(_num_cores != -1) CommonSettings.num_cores = _num_cores;
 	if(_rigorous_timing) CommonSettings.rigorous_timing = true;
 	if(_advanced_timing != -1) CommonSettings.advanced_timing = _advanced_timing==1;
+	if(_movie_statehash) CommonSettings.movieStateHashing = true;
 
 #ifdef HAVE_JIT
 	if(_cpu_mode != -1) CommonSettings.use_jit = (_cpu_mode==1);
@@ -97,6 +97,7 @@ private:
 	int _num_cores;
 	int _rigorous_timing;
 	int _advanced_timing;
+	int _movie_statehash;
 #ifdef HAVE_JIT
 	int _cpu_mode;
 	int _jit_size;
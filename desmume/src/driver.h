@@ -39,6 +39,10 @@ public:
 	virtual bool AVI_IsRecording() { return FALSE; }
 	virtual bool WAV_IsRecording() { return FALSE; }
 
+	//every sample, like AVI_SoundUpdate, for consumers which shouldn't change how frames are skipped the way recording does
+	virtual void SND_ExportUpdate(void* soundData, int soundLen) {}
+	virtual bool SND_IsExporting() { return FALSE; }
+
 	virtual void USR_InfoMessage(const char *message);
 	virtual void USR_RefreshScreen() {}
 	virtual void USR_SetDisplayPostpone(int milliseconds, bool drawNextFrame) {} // -1 == indefinitely, 0 == don't pospone, 500 == don't draw for 0.5 seconds
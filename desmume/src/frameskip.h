@@ -0,0 +1,112 @@
+/*
+	Copyright (C) 2008-2016 DeSmuME team
+
+	This file is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the this software.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//decides which frames skip their 2D and 3D rendering. a requested skip reaches the 3D a frame
+//before it reaches the 2D, since a frame shows the 3D which was rendered at the end of the frame before it.
+
+#ifndef _FRAMESKIP_H_
+#define _FRAMESKIP_H_
+
+#include "types.h"
+#include "GPU.h"
+
+class FrameSkipper
+{
+public:
+	void RequestSkip()
+	{
+		nextSkip = true;
+	}
+	void OmitSkip(bool force, bool forceEvenIfCapturing=false)
+	{
+		nextSkip = false;
+		if((force && consecutiveNonCaptures > 30) || forceEvenIfCapturing)
+		{
+			SkipCur2DFrame = false;
+			SkipCur3DFrame = false;
+			SkipNext2DFrame = false;
+			if(forceEvenIfCapturing)
+				consecutiveNonCaptures = 0;
+		}
+	}
+	//called at the end of every vblank, with whether the main engine is capturing and which screen it drives
+	void Advance(const bool capturing, const NDSDisplayID displayTarget)
+	{
+		if(capturing && consecutiveNonCaptures > 30)
+		{
+			// the worst-looking graphics corruption problems from frameskip
+			// are the result of skipping the capture on first frame it turns on.
+			// so we do this to handle the capture immediately,
+			// despite the risk of 1 frame of 2d/3d mismatch or wrong screen display.
+			SkipNext2DFrame = false;
+			nextSkip = false;
+		}
+		else if((lastDisplayTarget != displayTarget) && lastSkip && !skipped)
+		{
+			// if we're switching from not skipping to skipping
+			// and the screens are also switching around this frame,
+			// go for 1 extra frame without skipping.
+			// this avoids the scenario where we only draw one of the two screens
+			// when a game is switching screens every frame.
+			nextSkip = false;
+		}
+
+		if(capturing)
+			consecutiveNonCaptures = 0;
+		else if(!(consecutiveNonCaptures > 9000)) // arbitrary cap to avoid eventual wrap
+			consecutiveNonCaptures++;
+		
+		lastDisplayTarget = displayTarget;
+		lastSkip = skipped;
+		skipped = nextSkip;
+		nextSkip = false;
+
+		SkipCur2DFrame = SkipNext2DFrame;
+		SkipCur3DFrame = skipped;
+		SkipNext2DFrame = skipped;
+	}
+	FORCEINLINE bool ShouldSkip2D()
+	{
+		return SkipCur2DFrame;
+	}
+	FORCEINLINE bool ShouldSkip3D()
+	{
+		return SkipCur3DFrame;
+	}
+	FrameSkipper()
+	{
+		nextSkip = false;
+		skipped = false;
+		lastSkip = false;
+		lastDisplayTarget = NDSDisplayID_Main;
+		SkipCur2DFrame = false;
+		SkipCur3DFrame = false;
+		SkipNext2DFrame = false;
+		consecutiveNonCaptures = 0;
+	}
+private:
+	bool nextSkip;
+	bool skipped;
+	bool lastSkip;
+	NDSDisplayID lastDisplayTarget;
+	int consecutiveNonCaptures;
+	bool SkipCur2DFrame;
+	bool SkipCur3DFrame;
+	bool SkipNext2DFrame;
+};
+
+#endif
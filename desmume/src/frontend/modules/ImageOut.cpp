@@ -17,27 +17,35 @@
 
 #include <stdio.h>
 #include <zlib.h>
+#include <string>
+#include <vector>
+#include <algorithm>
 #include "types.h"
 #include "ImageOut.h"
 #include "formats/rpng.h"
 #include "formats/rbmp.h"
 #include "GPU.h"
+#include "utils/task.h"
+
+#define SCREENSHOT_MAX_TASKS 4
 
 static u8* Convert15To24(const u16* src, int width, int height)
 {
-	u8 *tmp_buffer;
-	u8 *tmp_inc;
-	tmp_inc = tmp_buffer = (u8 *)malloc(width * height * 3);
+	const size_t pixCount = width * height;
+	u32 *tmp_buffer = (u32 *)malloc(pixCount * sizeof(u32));
+	ColorspaceConvertBuffer555To8888Opaque<true, true>(src, tmp_buffer, pixCount);
 
-	for (int i = 0; i < width*height; i++)
+	//squeeze out the alpha in place. each pixel only ever moves down, so nothing gets overwritten before it's read
+	u8 *tmp_inc = (u8 *)tmp_buffer;
+	for (size_t i = 0; i < pixCount; i++)
 	{
-		u32 dst = ColorspaceConvert555To8888Opaque<true>(*src++);
+		u32 dst = LE_TO_LOCAL_32(tmp_buffer[i]);
 		*tmp_inc++ = dst & 0xFF;
 		*tmp_inc++ = (dst >> 8) & 0xFF;
 		*tmp_inc++ = (dst >> 16) & 0xFF;
 	}
 
-	return tmp_buffer;
+	return (u8 *)tmp_buffer;
 }
 
 int NDS_WritePNG_15bpp(int width, int height, const u16 *data, const char *filename)
@@ -60,4 +68,110 @@ int NDS_WriteBMP_32bppBuffer(int width, int height, const void* buf, const char
 {
 	bool ok = rbmp_save_image(filename,buf,width,height,width*4,RBMP_SOURCE_TYPE_ARGB8888); 
 	return ok?1:0;
-}
\ No newline at end of file
+}
+
+struct ScreenshotJob
+{
+	std::vector<u16> pixels;
+	int width, height;
+	std::string filename;
+	ImageOutFormat format;
+	ImageOutCallback callback;
+	void *param;
+	bool busy;
+};
+
+static Task *screenshotTask = NULL;
+static ScreenshotJob *screenshotJob = NULL;
+static int screenshotTaskCount = 0;
+static int screenshotNext = 0;
+
+static void* Screenshot_Work(void *arg)
+{
+	ScreenshotJob &job = *(ScreenshotJob *)arg;
+	const int width = job.width;
+	const int height = job.height;
+
+	u8* tmp = Convert15To24(&job.pixels[0], width, height);
+	const u32 hash = (u32)crc32(0, tmp, width * height * 3);
+
+	bool ok = true;
+	switch (job.format)
+	{
+		case ImageOutFormat_PNG: ok = rpng_save_image_bgr24(job.filename.c_str(), tmp, width, height, width*3); break;
+		case ImageOutFormat_PNGFast: ok = rpng_save_image_bgr24_level(job.filename.c_str(), tmp, width, height, width*3, 1); break;
+		case ImageOutFormat_PNGStored: ok = rpng_save_image_bgr24_level(job.filename.c_str(), tmp, width, height, width*3, 0); break;
+		case ImageOutFormat_BMP: ok = rbmp_save_image(job.filename.c_str(), tmp, width, height, width*3, RBMP_SOURCE_TYPE_BGR24); break;
+		case ImageOutFormat_HashOnly: break;
+	}
+	free(tmp);
+
+	if (job.callback)
+		job.callback(job.param, job.filename.c_str(), ok, hash);
+
+	return NULL;
+}
+
+void NDS_QueueScreenshot_15bpp(int width, int height, const u16 *data, const char *filename, ImageOutFormat format, ImageOutCallback callback, void *param)
+{
+	//nothing to encode
+	if (width <= 0 || height <= 0)
+		return;
+
+	if (screenshotTask == NULL)
+	{
+		//leave a core for the emulator
+		screenshotTaskCount = std::max(1, std::min(getOnlineCores() - 1, SCREENSHOT_MAX_TASKS));
+		screenshotTask = new Task[screenshotTaskCount];
+		screenshotJob = new ScreenshotJob[screenshotTaskCount];
+		for (int i = 0; i < screenshotTaskCount; i++)
+		{
+			screenshotTask[i].start(false);
+			screenshotJob[i].busy = false;
+		}
+	}
+
+	//the queue is one job per worker. when it's full, wait on the oldest one
+	const int i = screenshotNext;
+	screenshotNext = (screenshotNext + 1) % screenshotTaskCount;
+	if (screenshotJob[i].busy)
+		screenshotTask[i].finish();
+
+	ScreenshotJob &job = screenshotJob[i];
+	job.pixels.assign(data, data + width * height);
+	job.width = width;
+	job.height = height;
+	job.filename = filename ? filename : "";
+	job.format = format;
+	job.callback = callback;
+	job.param = param;
+	job.busy = true;
+	screenshotTask[i].execute(&Screenshot_Work, &job);
+}
+
+void NDS_FlushScreenshots()
+{
+	for (int i = 0; i < screenshotTaskCount; i++)
+	{
+		if (screenshotJob[i].busy)
+		{
+			screenshotTask[i].finish();
+			screenshotJob[i].busy = false;
+		}
+	}
+}
+
+void NDS_ShutdownScreenshots()
+{
+	NDS_FlushScreenshots();
+
+	for (int i = 0; i < screenshotTaskCount; i++)
+		screenshotTask[i].shutdown();
+
+	delete[] screenshotTask;
+	delete[] screenshotJob;
+	screenshotTask = NULL;
+	screenshotJob = NULL;
+	screenshotTaskCount = 0;
+	screenshotNext = 0;
+}
@@ -24,4 +24,24 @@ int NDS_WritePNG_15bpp(int width, int height, const u16 *data, const char *fname
 int NDS_WriteBMP_15bpp(int width, int height, const u16 *data, const char *filename);
 int NDS_WriteBMP_32bppBuffer(int width, int height, const void* buf, const char *filename);
 
+enum ImageOutFormat
+{
+	ImageOutFormat_PNG,			//smallest files
+	ImageOutFormat_PNGFast,		//light compression, for capturing a lot of frames
+	ImageOutFormat_PNGStored,	//no compression at all
+	ImageOutFormat_BMP,
+	ImageOutFormat_HashOnly		//no file, just the hash passed to the callback
+};
+
+//called from a worker thread once the image is written. hash is the crc32 of the 24bpp pixels
+typedef void (*ImageOutCallback)(void *param, const char *filename, bool ok, u32 hash);
+
+//copies the image and encodes it in the background. if every worker is busy this waits for the oldest one.
+//an empty image is ignored, without calling the callback
+void NDS_QueueScreenshot_15bpp(int width, int height, const u16 *data, const char *filename, ImageOutFormat format, ImageOutCallback callback = NULL, void *param = NULL);
+//waits for all queued screenshots to be written
+void NDS_FlushScreenshots();
+//writes out anything still queued and stops the workers. call this before exiting
+void NDS_ShutdownScreenshots();
+
 #endif
\ No newline at end of file
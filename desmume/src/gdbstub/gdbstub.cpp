@@ -560,6 +560,87 @@ make_stop_packet( uint8_t *ptr, enum stop_type type, uint32_t stop_address) {
   return stop_size;
 }
 
+/*
+ * Breakpoint sets
+ */
+INLINE static uint32_t
+hash_breakpoint_gdb( uint32_t addr) {
+  /* multiplicative hashing, so that nearby (aligned) addresses spread out */
+  return (addr * 2654435761U) >> (32 - BREAKPOINT_HASH_BITS);
+}
+
+static void
+init_breakpoint_set_gdb( struct breakpoint_set_gdb *set) {
+  memset( set, 0, sizeof( struct breakpoint_set_gdb));
+}
+
+static void
+add_breakpoint_gdb( struct breakpoint_set_gdb *set, struct breakpoint_gdb *bpoint) {
+  uint32_t page = bpoint->addr >> BREAKPOINT_PAGE_SHIFT;
+  struct breakpoint_gdb **chain = &set->hash[hash_breakpoint_gdb( bpoint->addr)];
+
+  bpoint->next = *chain;
+  *chain = bpoint;
+  set->page_bits[page >> 5] |= 1U << (page & 31);
+  set->count++;
+}
+
+/**
+ * Unlinks the first breakpoint at addr from the set and returns it, or NULL
+ * if there was none.
+ */
+static struct breakpoint_gdb *
+remove_breakpoint_gdb( struct breakpoint_set_gdb *set, uint32_t addr) {
+  uint32_t page = addr >> BREAKPOINT_PAGE_SHIFT;
+  struct breakpoint_gdb **link = &set->hash[hash_breakpoint_gdb( addr)];
+  struct breakpoint_gdb *bpoint;
+  int i;
+
+  while ( *link != NULL && (*link)->addr != addr) {
+    link = &(*link)->next;
+  }
+
+  bpoint = *link;
+  if ( bpoint == NULL)
+    return NULL;
+
+  *link = bpoint->next;
+  set->count--;
+
+  /* only drop the page bit if nothing else lives in that page. removing is
+   * rare and the set is small, so just look through all of it */
+  for ( i = 0; i < (1 << BREAKPOINT_HASH_BITS); i++) {
+    struct breakpoint_gdb *other;
+
+    for ( other = set->hash[i]; other != NULL; other = other->next) {
+      if ( (other->addr >> BREAKPOINT_PAGE_SHIFT) == page)
+        return bpoint;
+    }
+  }
+  set->page_bits[page >> 5] &= ~(1U << (page & 31));
+
+  return bpoint;
+}
+
+INLINE static int
+find_breakpoint_gdb( const struct breakpoint_set_gdb *set, uint32_t addr) {
+  uint32_t page = addr >> BREAKPOINT_PAGE_SHIFT;
+  const struct breakpoint_gdb *bpoint;
+
+  if ( set->count == 0)
+    return 0;
+
+  if ( !(set->page_bits[page >> 5] & (1U << (page & 31))))
+    return 0;
+
+  for ( bpoint = set->hash[hash_breakpoint_gdb( addr)]; bpoint != NULL; bpoint = bpoint->next) {
+    if ( bpoint->addr == addr)
+      return 1;
+  }
+
+  return 0;
+}
+
 /**
  * Returns -1 if there is a socket error.
  */
@@ -754,24 +835,24 @@ processPacket_gdb( SOCKET_TYPE sock, const uint8_t *packet,
 	uint32_t addr = 0;
 	uint32_t length = 0;
 	int error01 = 1;
-        struct breakpoint_gdb **bpoint_list;
+        struct breakpoint_set_gdb *bpoint_set;
 
         switch ( packet[1]) {
         case '0':
         case '1':
-          bpoint_list = &stub->instr_breakpoints;
+          bpoint_set = &stub->instr_breakpoints;
           break;
 
         case '2':
-          bpoint_list = &stub->write_breakpoints;
+          bpoint_set = &stub->write_breakpoints;
           break;
 
         case '3':
-          bpoint_list = &stub->read_breakpoints;
+          bpoint_set = &stub->read_breakpoints;
           break;
 
         case '4':
-          bpoint_list = &stub->access_breakpoints;
+          bpoint_set = &stub->access_breakpoints;
           break;
         }
 
@@ -784,26 +865,12 @@ processPacket_gdb( SOCKET_TYPE sock, const uint8_t *packet,
 
               if ( hexToInt( &rx_ptr, &length)) {
                 if ( remove_flag) {
-                  int removed = 0;
-                  struct breakpoint_gdb *last_bpoint = NULL;
-                  struct breakpoint_gdb *bpoint = *bpoint_list;
-
-                  while ( bpoint != NULL && !removed) {
-                    if ( bpoint->addr == addr) {
-                      DEBUG_LOG("Breakpoint(%c) at %08x removed\n", packet[1], addr);
-                      removed = 1;
-
-                      if ( last_bpoint == NULL) {
-                        *bpoint_list = bpoint->next;
-                      }
-                      else {
-                        last_bpoint->next = bpoint->next;
-                      }
-                      bpoint->next = stub->free_breakpoints;
-                      stub->free_breakpoints = bpoint;
-                    }
-                    last_bpoint = bpoint;
-                    bpoint = bpoint->next;
+                  struct breakpoint_gdb *bpoint = remove_breakpoint_gdb( bpoint_set, addr);
+
+                  if ( bpoint != NULL) {
+                    DEBUG_LOG("Breakpoint(%c) at %08x removed\n", packet[1], addr);
+                    bpoint->next = stub->free_breakpoints;
+                    stub->free_breakpoints = bpoint;
                   }
 
                   strcpy( (char *)out_ptr, "OK");
@@ -823,8 +890,7 @@ processPacket_gdb( SOCKET_TYPE sock, const uint8_t *packet,
                     bpoint->addr = addr;
                     bpoint->size = length;
 
-                    bpoint->next = *bpoint_list;
-                    *bpoint_list = bpoint;
+                    add_breakpoint_gdb( bpoint_set, bpoint);
 
                     strcpy( (char *)out_ptr, "OK");
                     send_size = 2;
@@ -1024,31 +1090,25 @@ createSocket ( int port) {
  */
 INLINE static int
 check_breaks_gdb( struct gdb_stub_state *gdb_state,
-                  struct breakpoint_gdb *bpoint_list,
+                  const struct breakpoint_set_gdb *bpoint_set,
                   uint32_t addr,
                   UNUSED_PARM(uint32_t size),
                   enum stop_type stop_type) {
   int found_break = 0;
 
-  if ( gdb_state->active) {
-    struct breakpoint_gdb *bpoint = bpoint_list;
+  if ( gdb_state->active && find_breakpoint_gdb( bpoint_set, addr)) {
+    DEBUG_LOG("Breakpoint hit at %08x\n", addr);
+    found_break = 1;
 
-    while ( bpoint != NULL && !found_break) {
-      if ( addr == bpoint->addr) {
-        DEBUG_LOG("Breakpoint hit at %08x\n", addr);
-
-        /* stall the processor */
-        gdb_state->cpu_ctrl->stall( gdb_state->cpu_ctrl->data);
-		NDS_debug_break();
+    /* stall the processor */
+    gdb_state->cpu_ctrl->stall( gdb_state->cpu_ctrl->data);
+    NDS_debug_break();
 
 
-        /* indicate the break to the GDB stub thread */
-        gdb_state->stop_type = stop_type;
-        gdb_state->stop_address = addr;
-        indicateCPUStop_gdb( gdb_state);
-      }
-      bpoint = bpoint->next;
-    }
+    /* indicate the break to the GDB stub thread */
+    gdb_state->stop_type = stop_type;
+    gdb_state->stop_address = addr;
+    indicateCPUStop_gdb( gdb_state);
   }
 
   return found_break;
@@ -1308,7 +1368,7 @@ static uint32_t FASTCALL gdb_prefetch32( void *data, uint32_t adr) {
   struct gdb_stub_state *stub = (struct gdb_stub_state *)data;
   int breakpoint;
 
-  breakpoint = check_breaks_gdb( stub, stub->instr_breakpoints, adr, 4,
+  breakpoint = check_breaks_gdb( stub, &stub->instr_breakpoints, adr, 4,
                                  STOP_BREAKPOINT);
 
     //return stub->real_cpu_memio->prefetch32( stub->real_cpu_memio->data, adr);
@@ -1319,7 +1379,7 @@ static uint16_t FASTCALL gdb_prefetch16( void *data, uint32_t adr) {
   struct gdb_stub_state *stub = (struct gdb_stub_state *)data;
   int breakpoint;
 
-  breakpoint = check_breaks_gdb( stub, stub->instr_breakpoints, adr, 2,
+  breakpoint = check_breaks_gdb( stub, &stub->instr_breakpoints, adr, 2,
                                  STOP_BREAKPOINT);
 
     //return stub->real_cpu_memio->prefetch16( stub->real_cpu_memio->data, adr);
@@ -1336,10 +1396,10 @@ gdb_read8( void *data, uint32_t adr) {
   /* pass down to the CPU's memory interface */
   value = stub->cpu_memio->read8( stub->cpu_memio->data, adr);
 
-  breakpoint = check_breaks_gdb( stub, stub->read_breakpoints, adr, 1,
+  breakpoint = check_breaks_gdb( stub, &stub->read_breakpoints, adr, 1,
                                  STOP_RWATCHPOINT);
   if ( !breakpoint)
-    check_breaks_gdb( stub, stub->access_breakpoints, adr, 1,
+    check_breaks_gdb( stub, &stub->access_breakpoints, adr, 1,
                       STOP_AWATCHPOINT);
 
   return value;
@@ -1355,10 +1415,10 @@ gdb_read16( void *data, uint32_t adr) {
   /* pass down to the CPU's memory interface */
   value = stub->cpu_memio->read16( stub->cpu_memio->data, adr);
 
-  breakpoint = check_breaks_gdb( stub, stub->read_breakpoints, adr, 2,
+  breakpoint = check_breaks_gdb( stub, &stub->read_breakpoints, adr, 2,
                                  STOP_RWATCHPOINT);
   if ( !breakpoint)
-    check_breaks_gdb( stub, stub->access_breakpoints, adr, 2,
+    check_breaks_gdb( stub, &stub->access_breakpoints, adr, 2,
                       STOP_AWATCHPOINT);
 
   return value;
@@ -1373,10 +1433,10 @@ gdb_read32( void *data, uint32_t adr) {
   /* pass down to the CPU's memory interface */
   value = stub->cpu_memio->read32( stub->cpu_memio->data, adr);
 
-  breakpoint = check_breaks_gdb( stub, stub->read_breakpoints, adr, 4,
+  breakpoint = check_breaks_gdb( stub, &stub->read_breakpoints, adr, 4,
                                  STOP_RWATCHPOINT);
   if ( !breakpoint)
-    check_breaks_gdb( stub, stub->access_breakpoints, adr, 4,
+    check_breaks_gdb( stub, &stub->access_breakpoints, adr, 4,
                       STOP_AWATCHPOINT);
 
   return value;
@@ -1391,10 +1451,10 @@ gdb_write8( void *data, uint32_t adr, uint8_t val) {
   /* pass down to the CPU's memory interface */
   stub->cpu_memio->write8( stub->cpu_memio->data, adr, val);
 
-  breakpoint = check_breaks_gdb( stub, stub->write_breakpoints, adr, 1,
+  breakpoint = check_breaks_gdb( stub, &stub->write_breakpoints, adr, 1,
                                  STOP_WATCHPOINT);
   if ( !breakpoint)
-    check_breaks_gdb( stub, stub->access_breakpoints, adr, 1,
+    check_breaks_gdb( stub, &stub->access_breakpoints, adr, 1,
                       STOP_AWATCHPOINT);
 }
 
@@ -1407,10 +1467,10 @@ gdb_write16( void *data, uint32_t adr, uint16_t val) {
   /* pass down to the CPU's memory interface */
   stub->cpu_memio->write16( stub->cpu_memio->data, adr, val);
 
-  breakpoint = check_breaks_gdb( stub, stub->write_breakpoints, adr, 2,
+  breakpoint = check_breaks_gdb( stub, &stub->write_breakpoints, adr, 2,
                                  STOP_WATCHPOINT);
   if ( !breakpoint)
-    check_breaks_gdb( stub, stub->access_breakpoints, adr, 2,
+    check_breaks_gdb( stub, &stub->access_breakpoints, adr, 2,
                       STOP_AWATCHPOINT);
 }
 
@@ -1423,10 +1483,10 @@ gdb_write32( void *data, uint32_t adr, uint32_t val) {
   /* pass down to the CPU's memory interface */
   stub->cpu_memio->write32( stub->cpu_memio->data, adr, val);
 
-  breakpoint = check_breaks_gdb( stub, stub->write_breakpoints, adr, 4,
+  breakpoint = check_breaks_gdb( stub, &stub->write_breakpoints, adr, 4,
                                  STOP_WATCHPOINT);
   if ( !breakpoint)
-    check_breaks_gdb( stub, stub->access_breakpoints, adr, 4,
+    check_breaks_gdb( stub, &stub->access_breakpoints, adr, 4,
                       STOP_AWATCHPOINT);
 }
 
@@ -1522,11 +1582,11 @@ createStub_gdb( uint16_t port,
   }
   stub->breakpoint_pool[i].next = NULL;
   stub->free_breakpoints = &stub->breakpoint_pool[0];
-  stub->instr_breakpoints = NULL;
+  init_breakpoint_set_gdb( &stub->instr_breakpoints);
 
-  stub->read_breakpoints = NULL;
-  stub->write_breakpoints = NULL;
-  stub->access_breakpoints = NULL;
+  init_breakpoint_set_gdb( &stub->read_breakpoints);
+  init_breakpoint_set_gdb( &stub->write_breakpoints);
+  init_breakpoint_set_gdb( &stub->access_breakpoints);
 
 #ifdef WIN32
   /* initialise the winsock library */
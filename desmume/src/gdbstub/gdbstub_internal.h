@@ -58,7 +58,7 @@ struct armcpu_memory_iface;
  * The structure describing a breakpoint.
  */
 struct breakpoint_gdb {
-  /** link them in a list */
+  /** link them in a list (a hash chain while in use, the free list otherwise) */
   struct breakpoint_gdb *next;
 
   /** The address of the breakpoint */
@@ -88,6 +88,29 @@ struct packet_reader_gdb {
 /** The maximum number of breakpoints (of all types) available to the stub */
 #define BREAKPOINT_POOL_SIZE 100
 
+/** log2 of the size of the pages tracked by the breakpoint set bitmap (4KB) */
+#define BREAKPOINT_PAGE_SHIFT 12
+
+/** log2 of the number of hash chains in a breakpoint set */
+#define BREAKPOINT_HASH_BITS 8
+
+/**
+ * A set of breakpoints of one type. Every memory access and instruction fetch
+ * is looked up in here, so lookups must be cheap: a bitmap with one bit per
+ * page rejects almost every address without touching the breakpoints, and the
+ * rest are found by hashing the address.
+ */
+struct breakpoint_set_gdb {
+  /** the number of breakpoints in the set */
+  int count;
+
+  /** one bit for each page holding at least one breakpoint */
+  uint32_t page_bits[(1 << (32 - BREAKPOINT_PAGE_SHIFT)) / 32];
+
+  /** the breakpoints, chained through their next pointers by address hash */
+  struct breakpoint_gdb *hash[1 << BREAKPOINT_HASH_BITS];
+};
+
 
 struct gdb_stub_state {
   /** flag indicating if the stub is active */
@@ -115,17 +138,17 @@ struct gdb_stub_state {
   /** GDB stub's memory interface passed to the CPU */
   armcpu_memory_iface *gdb_memio;
 
-  /** the list of active instruction breakpoints */
-  struct breakpoint_gdb *instr_breakpoints;
+  /** the active instruction breakpoints */
+  struct breakpoint_set_gdb instr_breakpoints;
 
-  /** the list of active read breakpoints */
-  struct breakpoint_gdb *read_breakpoints;
+  /** the active read breakpoints */
+  struct breakpoint_set_gdb read_breakpoints;
 
-  /** the list of active write breakpoints */
-  struct breakpoint_gdb *write_breakpoints;
+  /** the active write breakpoints */
+  struct breakpoint_set_gdb write_breakpoints;
 
-  /** the list of active access breakpoints */
-  struct breakpoint_gdb *access_breakpoints;
+  /** the active access breakpoints */
+  struct breakpoint_set_gdb access_breakpoints;
 
   /** the pointer to the step break point (not NULL if set) */
   //struct breakpoint_gdb *step_breakpoint;
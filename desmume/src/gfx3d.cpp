@@ -53,6 +53,8 @@
 #include "readwrite.h"
 #include "FIFO.h"
 #include "movie.h" //only for currframecounter which really ought to be moved into the core emu....
+#include "utils/radixsort.h"
+#include <rthreads/rthreads.h>
 
 //#define _SHOW_VTX_COUNTERS	// show polygon/vertex counters on screen
 #ifdef _SHOW_VTX_COUNTERS
@@ -368,9 +370,18 @@ VERTLIST* vertlists = NULL;
 VERTLIST* vertlist = NULL;
 int			polygonListCompleted = 0;
 
+//there are three sets of lists: the one being built, the one being rendered, and one more
+//so that a snapshot handed out to an observer can stay put while the other two keep rotating
+#define GFX3D_LIST_SETS 3
 static int listTwiddle = 1;
 static u8 triStripToggle;
 
+static GFX3D_Snapshot snapshots[GFX3D_LIST_SETS];
+static INDEXLIST *snapshotIndexlists = NULL;
+static int snapshotRefs[GFX3D_LIST_SETS] = {0};
+static int latestSnapshot = -1;
+static slock_t *snapshotMutex = NULL;
+
 //list-building state
 struct tmpVertInfo
 {
@@ -383,10 +394,26 @@ struct tmpVertInfo
 } tempVertInfo;
 
 
+//finds a list set which is neither the one given nor held by a snapshot observer.
+//since only one set can be held at a time, there is always one. the caller must hold snapshotMutex,
+//so that nobody can acquire the set between it being picked here and it being wiped.
+static int findFreeListSet(int exclude)
+{
+	int found = 0;
+	for (int i = 1; i <= GFX3D_LIST_SETS; i++)
+	{
+		found = (exclude + i) % GFX3D_LIST_SETS;
+		if (found != exclude && snapshotRefs[found] == 0)
+			break;
+	}
+	return found;
+}
+
+//moves list building on to a free set. the caller must hold snapshotMutex
 static void twiddleLists()
 {
-	listTwiddle++;
-	listTwiddle &= 1;
+	//the lists we were building are the ones being rendered now
+	listTwiddle = findFreeListSet(listTwiddle);
 	polylist = &polylists[listTwiddle];
 	vertlist = &vertlists[listTwiddle];
 	polylist->count = 0;
@@ -490,16 +517,30 @@ void gfx3d_init()
 	// in this case.
 	if(polylists == NULL)
 	{
-		polylists = (POLYLIST *)malloc(sizeof(POLYLIST)*2);
+		polylists = (POLYLIST *)malloc(sizeof(POLYLIST)*GFX3D_LIST_SETS);
 		polylist = &polylists[0];
 	}
 	
 	if(vertlists == NULL)
 	{
-		vertlists = (VERTLIST *)malloc(sizeof(VERTLIST)*2);
+		vertlists = (VERTLIST *)malloc(sizeof(VERTLIST)*GFX3D_LIST_SETS);
 		vertlist = &vertlists[0];
 	}
 	
+	if(snapshotIndexlists == NULL)
+	{
+		snapshotIndexlists = (INDEXLIST *)malloc(sizeof(INDEXLIST)*GFX3D_LIST_SETS);
+		for (size_t i = 0; i < GFX3D_LIST_SETS; i++)
+		{
+			snapshots[i].vertlist = &vertlists[i];
+			snapshots[i].polylist = &polylists[i];
+			snapshots[i].indexlist = &snapshotIndexlists[i];
+		}
+	}
+	
+	if(snapshotMutex == NULL)
+		snapshotMutex = slock_new();
+	
 	gfx3d.state.savedDISP3DCNT.value = 0;
 	gfx3d.state.fogDensityTable = MMU.ARM9_REG+0x0360;
 	gfx3d.state.edgeMarkColorTable = (u16 *)(MMU.ARM9_REG+0x0330);
@@ -521,6 +562,12 @@ void gfx3d_deinit()
 	free(vertlists);
 	vertlists = NULL;
 	vertlist = NULL;
+	
+	free(snapshotIndexlists);
+	snapshotIndexlists = NULL;
+	
+	slock_free(snapshotMutex);
+	snapshotMutex = NULL;
 }
 
 void gfx3d_reset()
@@ -535,6 +582,8 @@ void gfx3d_reset()
 #endif
 
 	reconstruct(&gfx3d);
+	if (viewer3d_state != NULL)
+		gfx3d_ReleaseSnapshot(viewer3d_state->snapshot);
 	delete viewer3d_state;
 	viewer3d_state = new Viewer3d_State();
 	
@@ -542,11 +591,20 @@ void gfx3d_reset()
 
 	drawPending = FALSE;
 	flushPending = FALSE;
-	memset(polylists, 0, sizeof(POLYLIST)*2);
-	memset(vertlists, 0, sizeof(VERTLIST)*2);
-	gfx3d.state.invalidateToon = true;
-	listTwiddle = 1;
+	
+	//a snapshot which is still held keeps its lists; everything else gets wiped
+	slock_lock(snapshotMutex);
+	latestSnapshot = -1;
+	for (size_t i = 0; i < GFX3D_LIST_SETS; i++)
+	{
+		if (snapshotRefs[i] != 0) continue;
+		memset(&polylists[i], 0, sizeof(POLYLIST));
+		memset(&vertlists[i], 0, sizeof(VERTLIST));
+	}
 	twiddleLists();
+	slock_unlock(snapshotMutex);
+	
+	gfx3d.state.invalidateToon = true;
 	gfx3d.polylist = polylist;
 	gfx3d.vertlist = vertlist;
 
@@ -627,51 +685,7 @@ FORCEINLINE s32 vec3dot_fixed32(const s32* a, const s32* b) {
 	return fx32_shiftdown(fx32_mul(a[0],b[0]) + fx32_mul(a[1],b[1]) + fx32_mul(a[2],b[2]));
 }
 
-//---------------
-//I'm going to start name these functions GE for GEOMETRY ENGINE MATH.
-//Pretty much any math function in this file should be explicit about how it's handling precision.
-//Handling that stuff generically globally is not a winning proposition.
-
-FORCEINLINE s64 GEM_Mul32x32To64(const s32 a, const s32 b)
-{
-#ifdef _MSC_VER
-	return __emul(a,b);
-#else
-	return ((s64)a)*((s64)b);
-#endif
-}
-
-static s32 GEM_SaturateAndShiftdown36To32(const s64 val)
-{
-	if(val>(s64)0x000007FFFFFFFFFFULL) return (s32)0x7FFFFFFFU;
-	if(val<(s64)0xFFFFF80000000000ULL) return (s32)0x80000000U;
-
-	return fx32_shiftdown(val);
-}
-
-static void GEM_TransformVertex(const s32 *matrix, s32 *vecPtr)
-{
-	const s32 x = vecPtr[0];
-	const s32 y = vecPtr[1];
-	const s32 z = vecPtr[2];
-	const s32 w = vecPtr[3];
-
-	//saturation logic is most carefully tested by:
-	//+ spectrobes beyond the portals excavation blower and drill tools: sets very large overflowing +x,+y in the modelview matrix to push things offscreen
-	//You can see this happening quite clearly: vertices will get translated to extreme values and overflow from a 7FFF-like to an 8000-like
-	//but if it's done wrongly, you can get bugs in:
-	//+ kingdom hearts re-coded: first conversation with cast characters will place them oddly with something overflowing to about 0xA???????
-	
-	//other test cases that cropped up during this development, but are probably not actually related to this after all
-	//+ SM64: outside castle skybox
-	//+ NSMB: mario head screen wipe
-
-	vecPtr[0] = GEM_SaturateAndShiftdown36To32(GEM_Mul32x32To64(x,matrix[0]) + GEM_Mul32x32To64(y,matrix[4]) + GEM_Mul32x32To64(z,matrix [8]) + GEM_Mul32x32To64(w,matrix[12]));
-	vecPtr[1] = GEM_SaturateAndShiftdown36To32(GEM_Mul32x32To64(x,matrix[1]) + GEM_Mul32x32To64(y,matrix[5]) + GEM_Mul32x32To64(z,matrix[ 9]) + GEM_Mul32x32To64(w,matrix[13]));
-	vecPtr[2] = GEM_SaturateAndShiftdown36To32(GEM_Mul32x32To64(x,matrix[2]) + GEM_Mul32x32To64(y,matrix[6]) + GEM_Mul32x32To64(z,matrix[10]) + GEM_Mul32x32To64(w,matrix[14]));
-	vecPtr[3] = GEM_SaturateAndShiftdown36To32(GEM_Mul32x32To64(x,matrix[3]) + GEM_Mul32x32To64(y,matrix[7]) + GEM_Mul32x32To64(z,matrix[11]) + GEM_Mul32x32To64(w,matrix[15]));
-}
-//---------------
+//the GEM_ (geometry engine math) functions are in matrix.cpp
 
 
 #define SUBMITVERTEX(ii, nn) polylist->list[polylist->count].vertIndexes[ii] = tempVertInfo.map[nn];
@@ -939,12 +953,16 @@ static void gfx3d_glPushMatrix()
 	//this command always works on both pos and vector when either pos or pos-vector are the current mtx mode
 	const MatrixMode mymode = ((mode == MATRIXMODE_POSITION) ? MATRIXMODE_POSITION_VECTOR : mode);
 
-	MatrixStackPushMatrix(&mtxStack[mymode], mtxCurrent[mymode]);
+	if (MatrixStackPushMatrix(&mtxStack[mymode], mtxCurrent[mymode]))
+		MMU_new.gxstat.se = 1;
 
 	GFX_DELAY(17);
 
 	if (mymode == MATRIXMODE_POSITION_VECTOR)
-		MatrixStackPushMatrix(&mtxStack[1], mtxCurrent[1]);
+	{
+		if (MatrixStackPushMatrix(&mtxStack[1], mtxCurrent[1]))
+			MMU_new.gxstat.se = 1;
+	}
 }
 
 static void gfx3d_glPopMatrix(s32 i)
@@ -964,12 +982,16 @@ static void gfx3d_glPopMatrix(s32 i)
 	
 	//please note that our ability to skip treating this as signed is dependent on the modular addressing later. if that ever changes, we need to change this back.
 
-	MatrixStackPopMatrix(mtxCurrent[mymode], &mtxStack[mymode], i);
+	if (MatrixStackPopMatrix(mtxCurrent[mymode], &mtxStack[mymode], i))
+		MMU_new.gxstat.se = 1;
 
 	GFX_DELAY(36);
 
 	if (mymode == MATRIXMODE_POSITION_VECTOR)
-		MatrixStackPopMatrix(mtxCurrent[1], &mtxStack[1], i);
+	{
+		if (MatrixStackPopMatrix(mtxCurrent[1], &mtxStack[1], i))
+			MMU_new.gxstat.se = 1;
+	}
 }
 
 static void gfx3d_glStoreMatrix(u32 v)
@@ -1268,6 +1290,12 @@ static void gfx3d_glNormal(s32 v)
 
 	int vertexColor[3] = { emission[0], emission[1], emission[2] };
 
+	//do the dot products for all four lights at once. the results for disabled lights are just ignored
+	CACHE_ALIGN s32 lightDirDot[4];
+	CACHE_ALIGN s32 halfVectorDot[4];
+	if (lightMask != 0)
+		GEM_LightDotProducts(normal, cacheLightDirection, cacheHalfVector, lightDirDot, halfVectorDot);
+
 	for (size_t i = 0; i < 4; i++)
 	{
 		if (!((lightMask>>i)&1)) continue;
@@ -1279,11 +1307,8 @@ static void gfx3d_glNormal(s32 v)
 
 		//This formula is the one used by the DS
 		//Reference : http://nocash.emubase.de/gbatek.htm#ds3dpolygonlightparameters
-		s32 fixed_diffuse = std::max(0,-vec3dot_fixed32(cacheLightDirection[i],normal));
-		
-		//todo - this could be cached in this form
-		s32 fixedTempNegativeHalf[] = {-cacheHalfVector[i][0],-cacheHalfVector[i][1],-cacheHalfVector[i][2],-cacheHalfVector[i][3]};
-		s32 dot = vec3dot_fixed32(fixedTempNegativeHalf, normal);
+		s32 fixed_diffuse = std::max(0,-lightDirDot[i]);
+		s32 dot = halfVectorDot[i];
 
 		s32 fixedshininess = 0;
 		if (dot > 0) //prevent shininess on opposite side
@@ -2063,45 +2088,49 @@ static void gfx3d_execute(u8 cmd, u32 param)
 
 void gfx3d_execute3D()
 {
-	u8	cmd = 0;
-	u32	param = 0;
+	static const u32 RUN_CHUNK_SIZE = 64;
+	u8	cmd[RUN_CHUNK_SIZE];
+	u32	param[RUN_CHUNK_SIZE];
 
 #ifndef FLUSHMODE_HACK
 	if (isSwapBuffers) return;
 #endif
 
-	//this is a SPEED HACK
-	//fifo is currently emulated more accurately than it probably needs to be.
-	//without this batch size the emuloop will escape way too often to run fast.
-	static const size_t HACK_FIFO_BATCH_SIZE = 64;
-
-	for (size_t i = 0; i < HACK_FIFO_BATCH_SIZE; i++)
+	//the fifo hands out runs of commands which have no effect the cpu could see until the run is over
+	//(vertices, colors, matrix math and so on). so rather than escaping the emuloop every 64 commands,
+	//keep going until the fifo level crosses a threshold or a command changes GXSTAT.
+	u32 executed = 0;
+	bool endOfRun = false;
+	while (!endOfRun)
 	{
-		if (GFX_PIPErecv(&cmd, &param))
+		const u32 count = GFX_PIPErecvRun(cmd, param, RUN_CHUNK_SIZE, endOfRun);
+
+		//these guys will ordinarily set a delay, but multi-param operations won't
+		//for the earlier params.
+		for (u32 i = 0; i < count; i++)
 		{
-			//if (isSwapBuffers) printf("Executing while swapbuffers is pending: %d:%08X\n",cmd,param);
+			//printf("%05d:%03d:%12lld: executed 3d: %02X %08X\n",currFrameCounter, nds.VCount, nds_timer , cmd[i], param[i]);
+			gfx3d_execute(cmd[i], param[i]);
+		}
 
-			//since we did anything at all, incur a pipeline motion cost.
-			//also, we can't let gxfifo sequencer stall until the fifo is empty.
-			//see...
-			GFX_DELAY(1); 
+		executed += count;
+	}
 
-			//..these guys will ordinarily set a delay, but multi-param operations won't
-			//for the earlier params.
-			//printf("%05d:%03d:%12lld: executed 3d: %02X %08X\n",currFrameCounter, nds.VCount, nds_timer , cmd, param);
-			gfx3d_execute(cmd, param);
+	if (executed == 0)
+		return;
 
-			//this is a COMPATIBILITY HACK.
-			//this causes 3d to take virtually no time whatsoever to execute.
-			//this was done for marvel nemesis, but a similar family of 
-			//hacks for ridiculously fast 3d execution has proven necessary for a number of games.
-			//the true answer is probably dma bus blocking.. but lets go ahead and try this and
-			//check the compatibility, at the very least it will be nice to know if any games suffer from
-			//3d running too fast
-			MMU.gfx3dCycles = nds_timer+1;
-		} else break;
-	}
+	//since we did anything at all, incur a pipeline motion cost.
+	//also, we can't let gxfifo sequencer stall until the fifo is empty.
+	NDS_RescheduleGXFIFO(executed);
 
+	//this is a COMPATIBILITY HACK.
+	//this causes 3d to take virtually no time whatsoever to execute.
+	//this was done for marvel nemesis, but a similar family of 
+	//hacks for ridiculously fast 3d execution has proven necessary for a number of games.
+	//the true answer is probably dma bus blocking.. but lets go ahead and try this and
+	//check the compatibility, at the very least it will be nice to know if any games suffer from
+	//3d running too fast
+	MMU.gfx3dCycles = nds_timer+1;
 }
 
 void gfx3d_glFlush(u32 v)
@@ -2171,6 +2200,24 @@ static bool gfx3d_ysort_compare(int num1, int num2)
 	return original;
 }
 
+static CACHE_ALIGN u64 ysortPolyKeys[POLYLIST_SIZE];
+static CACHE_ALIGN u64 ysortKeys[2 * POLYLIST_SIZE];
+static CACHE_ALIGN int ysortIndexes[POLYLIST_SIZE];
+
+//sorts a run of the indexlist into the order gfx3d_ysort_compare would give it.
+//the keys are (maxy,miny) packed into a u64, and since the sort is stable and the run starts out in
+//ascending poly order, ties end up ordered by poly number just like the comparator wants.
+//(tests/ysort_test.cpp checks this against the comparator)
+static void gfx3d_ysort_radix(int *list, const size_t count)
+{
+	RadixSort_Indexes64(list, count, ysortPolyKeys, ysortKeys, ysortIndexes);
+
+#ifndef NDEBUG
+	for (size_t i = 1; i < count; i++)
+		assert(gfx3d_ysort_compare(list[i-1], list[i]));
+#endif
+}
+
 static void gfx3d_doFlush()
 {
 	gfx3d.render3DFrameCount++;
@@ -2184,6 +2231,12 @@ static void gfx3d_doFlush()
 	gfx3d.state.wbuffer = BIT1(gfx3d.state.activeFlushCommand);
 
 	gfx3d.renderState = gfx3d.state;
+
+	//the snapshot of the lists we just finished gets this state too, before the flush command for the
+	//next frame replaces activeFlushCommand. nobody can be holding this set, since it was the one being built
+	const int polylistIndex = listTwiddle;
+	GFX3D_Snapshot &snapshot = snapshots[polylistIndex];
+	snapshot.state = gfx3d.state;
 	
 	// Override render states per user settings
 	if (!CommonSettings.GFX3D_Texture)
@@ -2205,11 +2258,14 @@ static void gfx3d_doFlush()
 	osd->addFixed(180, 35, "%i/%i", max_polys, max_verts);		// max
 #endif
 
-	//find the min and max y values for each poly.
+	//find the min and max y values for each poly, and sort the poly list with alpha polys last.
+	//opaque polys go straight into the indexlist; translucent ones are gathered on the side and appended after.
 	//TODO - this could be a small waste of time if we are manual sorting the translucent polys
 	//TODO - this _MUST_ be moved later in the pipeline, after clipping.
 	//the w-division here is just an approximation to fix the shop in harvest moon island of happiness
 	//also the buttons in the knights in the nightmare frontend depend on this
+	size_t opaqueCount = 0;
+	size_t translucentCount = 0;
 	for (size_t i = 0; i < polycount; i++)
 	{
 		// TODO: Possible divide by zero with the w-coordinate.
@@ -2231,60 +2287,131 @@ static void gfx3d_doFlush()
 			poly.maxy = max(poly.maxy, verty);
 		}
 
-	}
+		ysortPolyKeys[i] = ((u64)RadixSort_FloatKey(poly.maxy) << 32) | RadixSort_FloatKey(poly.miny);
 
-	//we need to sort the poly list with alpha polys last
-	//first, look for opaque polys
-	size_t ctr = 0;
-	for (size_t i = 0; i < polycount; i++)
-	{
-		const POLY &poly = polylist->list[i];
-		if (!poly.isTranslucent())
-			gfx3d.indexlist.list[ctr++] = i;
-	}
-	const size_t opaqueCount = ctr;
-	
-	//then look for translucent polys
-	for (size_t i = 0; i < polycount; i++)
-	{
-		const POLY &poly = polylist->list[i];
 		if (poly.isTranslucent())
-			gfx3d.indexlist.list[ctr++] = i;
+			ysortIndexes[translucentCount++] = i;
+		else
+			gfx3d.indexlist.list[opaqueCount++] = i;
 	}
-	
-	//NOTE: the use of the stable_sort below must be here as a workaround for some compilers on osx and linux.
-	//we're hazy on the exact behaviour of the resulting bug, all thats known is the list gets mangled somehow.
-	//it should not in principle be relevant since the predicate results in no ties.
-	//perhaps the compiler is buggy. perhaps the predicate is wrong.
+
+	memcpy(gfx3d.indexlist.list + opaqueCount, ysortIndexes, translucentCount * sizeof(int));
 
 	//now we have to sort the opaque polys by y-value.
 	//(test case: harvest moon island of happiness character cretor UI)
 	//should this be done after clipping??
-	std::stable_sort(gfx3d.indexlist.list, gfx3d.indexlist.list + opaqueCount, gfx3d_ysort_compare);
+	//this must be a stable sort in gfx3d_ysort_compare order, see the notes there
+	gfx3d_ysort_radix(gfx3d.indexlist.list, opaqueCount);
 	
 	if (!gfx3d.state.sortmode)
 	{
 		//if we are autosorting translucent polys, we need to do this also
 		//TODO - this is unverified behavior. need a test case
-		std::stable_sort(gfx3d.indexlist.list + opaqueCount, gfx3d.indexlist.list + polycount, gfx3d_ysort_compare);
+		gfx3d_ysort_radix(gfx3d.indexlist.list + opaqueCount, translucentCount);
 	}
 
-	//switch to the new lists
+	//fill in the rest of the snapshot
+	snapshot.frameNumber = currFrameCounter;
+	memcpy(snapshot.fogDensityTable, gfx3d.state.fogDensityTable, sizeof(snapshot.fogDensityTable));
+	memcpy(snapshot.edgeMarkColorTable, gfx3d.state.edgeMarkColorTable, sizeof(snapshot.edgeMarkColorTable));
+	snapshot.state.fogDensityTable = snapshot.fogDensityTable;
+	snapshot.state.edgeMarkColorTable = snapshot.edgeMarkColorTable;
+	memcpy(snapshotIndexlists[polylistIndex].list, gfx3d.indexlist.list, polycount * sizeof(int));
+
+	//then publish it and switch to the new lists in one go. the previous snapshot may be the set we
+	//switch to, and it must not be acquirable anymore by the time the set gets wiped
+	slock_lock(snapshotMutex);
+	latestSnapshot = polylistIndex;
 	twiddleLists();
+	slock_unlock(snapshotMutex);
 
 	if (driver->view3d->IsRunning())
 	{
-		viewer3d_state->frameNumber = currFrameCounter;
-		viewer3d_state->state = gfx3d.state;
-		viewer3d_state->polylist = *gfx3d.polylist;
-		viewer3d_state->vertlist = *gfx3d.vertlist;
-		viewer3d_state->indexlist = gfx3d.indexlist;
+		gfx3d_ReleaseSnapshot(viewer3d_state->snapshot);
+		viewer3d_state->snapshot = gfx3d_AcquireSnapshot();
 		driver->view3d->NewFrame();
 	}
 
 	drawPending = TRUE;
 }
 
+const GFX3D_Snapshot* gfx3d_AcquireSnapshot()
+{
+	const GFX3D_Snapshot *snapshot = NULL;
+
+	slock_lock(snapshotMutex);
+	if (latestSnapshot >= 0)
+	{
+		//holding a second set would leave the core with nowhere to build the next frame
+		bool otherHeld = false;
+		for (int i = 0; i < GFX3D_LIST_SETS; i++)
+			if (i != latestSnapshot && snapshotRefs[i] != 0)
+				otherHeld = true;
+
+		if (!otherHeld)
+		{
+			snapshotRefs[latestSnapshot]++;
+			snapshot = &snapshots[latestSnapshot];
+		}
+	}
+	slock_unlock(snapshotMutex);
+
+	return snapshot;
+}
+
+void gfx3d_ReleaseSnapshot(const GFX3D_Snapshot *snapshot)
+{
+	if (snapshot == NULL) return;
+
+	const int index = (int)(snapshot - snapshots);
+	assert(index >= 0 && index < GFX3D_LIST_SETS);
+
+	slock_lock(snapshotMutex);
+	assert(snapshotRefs[index] > 0);
+	snapshotRefs[index]--;
+	slock_unlock(snapshotMutex);
+}
+
+bool gfx3d_SaveSnapshot(const GFX3D_Snapshot *snapshot, EMUFILE *os)
+{
+	if (snapshot == NULL) return false;
+
+	const GFX3D_State &state = snapshot->state;
+	const VERTLIST &verts = *snapshot->vertlist;
+	const POLYLIST &polys = *snapshot->polylist;
+
+	os->fwrite("DS3DSCN", 8);
+	write32le(0,os); //version
+	write32le(snapshot->frameNumber,os);
+
+	//the render state, with the register tables it points at written out in place
+	write32le(state.savedDISP3DCNT.value,os);
+	write32le(state.activeFlushCommand,os);
+	write32le(state.clearColor,os);
+	write32le(state.clearDepth,os);
+	write32le(state.fogColor,os);
+	write32le(state.fogOffset,os);
+	write32le(state.fogShift,os);
+	write8le(state.alphaTestRef,os);
+	for (size_t i = 0; i < ARRAY_SIZE(state.u16ToonTable); i++)
+		write16le(state.u16ToonTable[i],os);
+	os->fwrite(snapshot->fogDensityTable, sizeof(snapshot->fogDensityTable));
+	for (size_t i = 0; i < ARRAY_SIZE(snapshot->edgeMarkColorTable); i++)
+		write16le(snapshot->edgeMarkColorTable[i],os);
+
+	//then the geometry, in the same form the savestates use
+	write32le(verts.count,os);
+	for (size_t i = 0; i < verts.count; i++)
+		((VERT &)verts.list[i]).save(os);
+	write32le(polys.count,os);
+	for (size_t i = 0; i < polys.count; i++)
+		((POLY &)polys.list[i]).save(os);
+	for (size_t i = 0; i < polys.count; i++)
+		write32le(snapshot->indexlist->list[i],os);
+
+	return !os->fail();
+}
+
 void gfx3d_VBlankSignal()
 {
 	if (isSwapBuffers)
@@ -2576,7 +2703,11 @@ bool gfx3d_loadstate(EMUFILE* is, int size)
 	gfx3d_glLightDirection_cache(3);
 
 	//jiggle the lists. and also wipe them. this is clearly not the best thing to be doing.
-	listTwiddle = 0;
+	//(stay clear of any list set that a snapshot observer is holding on to)
+	slock_lock(snapshotMutex);
+	latestSnapshot = -1;
+	listTwiddle = findFreeListSet(listTwiddle);
+	slock_unlock(snapshotMutex);
 	polylist = &polylists[listTwiddle];
 	vertlist = &vertlists[listTwiddle];
 	
@@ -2607,8 +2738,11 @@ bool gfx3d_loadstate(EMUFILE* is, int size)
 		gxf_hardware.loadstate(is);
 	}
 
-	gfx3d.polylist = &polylists[listTwiddle^1];
-	gfx3d.vertlist = &vertlists[listTwiddle^1];
+	slock_lock(snapshotMutex);
+	const int renderListIndex = findFreeListSet(listTwiddle);
+	slock_unlock(snapshotMutex);
+	gfx3d.polylist = &polylists[renderListIndex];
+	gfx3d.vertlist = &vertlists[renderListIndex];
 	gfx3d.polylist->count=0;
 	gfx3d.vertlist->count=0;
 
@@ -2705,15 +2839,15 @@ static FORCEINLINE VERT clipPoint(bool hirez, const VERT *inside, const VERT *ou
 	return ret;
 }
 
-#define MAX_SCRATCH_CLIP_VERTS (4*6 + 40)
-static VERT scratchClipVerts [MAX_SCRATCH_CLIP_VERTS];
-static int numScratchClipVerts = 0;
-
 template <int COORD, int WHICH, class NEXT>
 class ClipperPlane
 {
 public:
-	ClipperPlane(NEXT& next) : m_next(next) {}
+	ClipperPlane(NEXT& next, VERT *scratchClipVerts, int &numScratchClipVerts)
+		: m_next(next)
+		, m_scratchClipVerts(scratchClipVerts)
+		, m_numScratchClipVerts(numScratchClipVerts)
+	{}
 
 	void init(VERT* verts)
 	{
@@ -2742,6 +2876,8 @@ private:
 	VERT* m_prevVert;
 	VERT* m_firstVert;
 	NEXT& m_next;
+	VERT* m_scratchClipVerts;
+	int& m_numScratchClipVerts;
 	
 	FORCEINLINE void clipSegmentVsPlane(bool hirez, const VERT *vert0, const VERT *vert1)
 	{
@@ -2773,18 +2909,18 @@ private:
 		if (!out0 && out1)
 		{
 			CLIPLOG(" exiting\n");
-			assert((u32)numScratchClipVerts < MAX_SCRATCH_CLIP_VERTS);
-			scratchClipVerts[numScratchClipVerts] = clipPoint<COORD, WHICH>(hirez, vert0, vert1);
-			m_next.clipVert(hirez, &scratchClipVerts[numScratchClipVerts++]);
+			assert((u32)m_numScratchClipVerts < MAX_SCRATCH_CLIP_VERTS);
+			m_scratchClipVerts[m_numScratchClipVerts] = clipPoint<COORD, WHICH>(hirez, vert0, vert1);
+			m_next.clipVert(hirez, &m_scratchClipVerts[m_numScratchClipVerts++]);
 		}
 
 		//entering volume: insert clipped point and the next (interior) point
 		if (out0 && !out1)
 		{
 			CLIPLOG(" entering\n");
-			assert((u32)numScratchClipVerts < MAX_SCRATCH_CLIP_VERTS);
-			scratchClipVerts[numScratchClipVerts] = clipPoint<COORD, WHICH>(hirez, vert1, vert0);
-			m_next.clipVert(hirez, &scratchClipVerts[numScratchClipVerts++]);
+			assert((u32)m_numScratchClipVerts < MAX_SCRATCH_CLIP_VERTS);
+			m_scratchClipVerts[m_numScratchClipVerts] = clipPoint<COORD, WHICH>(hirez, vert1, vert0);
+			m_next.clipVert(hirez, &m_scratchClipVerts[m_numScratchClipVerts++]);
 			m_next.clipVert(hirez, vert1);
 		}
 	}
@@ -2818,13 +2954,12 @@ private:
 
 // see "Template juggling with Sutherland-Hodgman" http://www.codeguru.com/cpp/misc/misc/graphics/article.php/c8965__2/
 // for the idea behind setting things up like this.
-static ClipperOutput clipperOut;
-typedef ClipperPlane<2, 1,ClipperOutput> Stage6; static Stage6 clipper6 (clipperOut); // back plane //TODO - we need to parameterize back plane clipping
-typedef ClipperPlane<2,-1,Stage6> Stage5;        static Stage5 clipper5 (clipper6); // front plane
-typedef ClipperPlane<1, 1,Stage5> Stage4;        static Stage4 clipper4 (clipper5); // top plane
-typedef ClipperPlane<1,-1,Stage4> Stage3;        static Stage3 clipper3 (clipper4); // bottom plane
-typedef ClipperPlane<0, 1,Stage3> Stage2;        static Stage2 clipper2 (clipper3); // right plane
-typedef ClipperPlane<0,-1,Stage2> Stage1;        static Stage1 clipper  (clipper2); // left plane
+typedef ClipperPlane<2, 1,ClipperOutput> Stage6; // back plane //TODO - we need to parameterize back plane clipping
+typedef ClipperPlane<2,-1,Stage6> Stage5;        // front plane
+typedef ClipperPlane<1, 1,Stage5> Stage4;        // top plane
+typedef ClipperPlane<1,-1,Stage4> Stage3;        // bottom plane
+typedef ClipperPlane<0, 1,Stage3> Stage2;        // right plane
+typedef ClipperPlane<0,-1,Stage2> Stage1;        // left plane
 
 template<bool USEHIRESINTERPOLATE>
 void GFX3D_Clipper::clipPoly(const POLY &poly, const VERT **verts)
@@ -2834,6 +2969,15 @@ void GFX3D_Clipper::clipPoly(const POLY &poly, const VERT **verts)
 	const PolygonType type = poly.type;
 	numScratchClipVerts = 0;
 
+	//the stages are just a few pointers each, so building the chain here keeps every clipper independent
+	ClipperOutput clipperOut;
+	Stage6 clipper6(clipperOut, scratchClipVerts, numScratchClipVerts);
+	Stage5 clipper5(clipper6, scratchClipVerts, numScratchClipVerts);
+	Stage4 clipper4(clipper5, scratchClipVerts, numScratchClipVerts);
+	Stage3 clipper3(clipper4, scratchClipVerts, numScratchClipVerts);
+	Stage2 clipper2(clipper3, scratchClipVerts, numScratchClipVerts);
+	Stage1 clipper (clipper2, scratchClipVerts, numScratchClipVerts);
+
 	clipper.init(clippedPolys[clippedPolyCounter].clipVerts);
 	for (size_t i = 0; i < type; i++)
 		clipper.clipVert(USEHIRESINTERPOLATE, verts[i]);
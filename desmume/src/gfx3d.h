@@ -564,6 +564,9 @@ struct VIEWPORT {
 //four corners of the hexagon, and you will observe a decagon
 #define MAX_CLIPPED_VERTS 10
 
+//room for the new verts made by every clip plane along the way
+#define MAX_SCRATCH_CLIP_VERTS (4*6 + 40)
+
 class GFX3D_Clipper
 {
 public:
@@ -580,11 +583,14 @@ public:
 
 	//the output of clipping operations goes into here.
 	//be sure you init it before clipping!
+	//all the working state lives in here too, so separate clippers can be used from separate threads.
 	TClippedPoly *clippedPolys;
 	size_t clippedPolyCounter;
 	void reset() { clippedPolyCounter=0; }
 
 private:
+	VERT scratchClipVerts[MAX_SCRATCH_CLIP_VERTS];
+	int numScratchClipVerts;
 	TClippedPoly tempClippedPoly;
 	TClippedPoly outClippedPoly;
 	FORCEINLINE void clipSegmentVsPlane(VERT** verts, const int coord, int which);
@@ -651,13 +657,36 @@ struct GFX3D_State
 	u16 *edgeMarkColorTable;	// Alias to MMU.ARM9_REG+0x0330
 };
 
-struct Viewer3d_State
+//a read-only view of the geometry from one flush, for the 3d viewer and other tools.
+//the core rotates between three sets of lists (building, rendering, observed), so holding one of these
+//never makes the emulator copy or wait. get one with gfx3d_AcquireSnapshot() and give it back with
+//gfx3d_ReleaseSnapshot() when done; it stays valid (and unchanged) until then.
+struct GFX3D_Snapshot
 {
 	int frameNumber;
-	GFX3D_State state;
-	VERTLIST vertlist;
-	POLYLIST polylist;
-	INDEXLIST indexlist;
+	GFX3D_State state;		//its fog and edge mark table pointers point at the copies below
+	u8 fogDensityTable[32];
+	u16 edgeMarkColorTable[8];
+	const VERTLIST *vertlist;
+	const POLYLIST *polylist;
+	const INDEXLIST *indexlist;
+};
+
+//returns the most recently flushed geometry, or NULL if there is none yet.
+//only one flush can be held at a time; if an older one is still held, this returns NULL until it is released.
+const GFX3D_Snapshot* gfx3d_AcquireSnapshot();
+void gfx3d_ReleaseSnapshot(const GFX3D_Snapshot *snapshot);
+//writes the snapshot out in a compact binary form, for replaying the scene through the renderers offline
+bool gfx3d_SaveSnapshot(const GFX3D_Snapshot *snapshot, EMUFILE *os);
+
+struct Viewer3d_State
+{
+	Viewer3d_State()
+		: snapshot(NULL) {
+	}
+
+	//the flush being shown; held until the next one comes along
+	const GFX3D_Snapshot *snapshot;
 };
 
 extern Viewer3d_State* viewer3d_state;
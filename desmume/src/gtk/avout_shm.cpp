@@ -0,0 +1,229 @@
+/*
+	Copyright (C) 2016 DeSmuME team
+
+	This file is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the this software.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include "types.h"
+#include "SPU.h"
+
+#include "avout_shm.h"
+
+static const u32 SLOT_COUNT = 8;
+static const u32 AUDIO_FRAMES_MAX = 2048; // a frame's worth is ~735 at 60fps
+static const u32 ALIGN = 64;
+
+static inline u32 alignUp(u32 v) {
+	return (v + ALIGN - 1) & ~(ALIGN - 1);
+}
+
+AVOutShm::AVOutShm()
+	: colorFormat(NDSColorFormat_BGR888_Rev)
+	, mem(NULL)
+	, memSize(0)
+	, header(NULL)
+	, sequence(0)
+	, audio(AUDIO_FRAMES_MAX * 2)
+	, audioFrames(0)
+{
+}
+
+AVOutShm::~AVOutShm() {
+	this->end();
+}
+
+void AVOutShm::setColorFormat(NDSColorFormat format) {
+	this->colorFormat = format;
+}
+
+bool AVOutShm::begin(const char* name) {
+	if (this->mem != NULL) {
+		return false;
+	}
+
+	// make room for the biggest frame the GPU is set up to render right now
+	const NDSDisplayInfo& info = GPU->GetDisplayInfo();
+	const u32 pixelBytes = (this->colorFormat == NDSColorFormat_BGR555_Rev) ? 2 : 4;
+	const u32 width = std::max<u32>(info.customWidth, GPU_FRAMEBUFFER_NATIVE_WIDTH);
+	const u32 height = std::max<u32>(info.customHeight, GPU_FRAMEBUFFER_NATIVE_HEIGHT);
+	const u32 videoBytesMax = alignUp(width * height * 2 * pixelBytes);
+	const u32 videoOffset = alignUp(sizeof(AVOutShmSlot));
+	const u32 audioOffset = videoOffset + videoBytesMax;
+	const u32 slotSize = alignUp(audioOffset + AUDIO_FRAMES_MAX * 2 * sizeof(s16));
+	const u32 slotsOffset = alignUp(sizeof(AVOutShmHeader));
+	const size_t memSize = slotsOffset + (size_t)slotSize * SLOT_COUNT;
+
+	int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "Fail to open shared memory %s: %d %s\n", name, errno, strerror(errno));
+		return false;
+	}
+	if (ftruncate(fd, memSize) < 0) {
+		fprintf(stderr, "Fail to size shared memory %s: %d %s\n", name, errno, strerror(errno));
+		close(fd);
+		shm_unlink(name);
+		return false;
+	}
+	void* mem = mmap(NULL, memSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mem == MAP_FAILED) {
+		fprintf(stderr, "Fail to map shared memory %s: %d %s\n", name, errno, strerror(errno));
+		shm_unlink(name);
+		return false;
+	}
+
+	this->name = name;
+	this->mem = (u8*)mem;
+	this->memSize = memSize;
+	this->sequence = 0;
+	this->audioFrames = 0;
+
+	memset(this->mem, 0, memSize);
+	for (u32 i = 0; i < SLOT_COUNT; i++) {
+		AVOutShmSlot* slot = (AVOutShmSlot*)(this->mem + slotsOffset + i * slotSize);
+		slot->videoOffset = videoOffset;
+		slot->audioOffset = audioOffset;
+	}
+
+	this->header = (AVOutShmHeader*)this->mem;
+	this->header->version = AVOUT_SHM_VERSION;
+	this->header->colorFormat = this->colorFormat;
+	this->header->pixelBytes = pixelBytes;
+	this->header->slotsOffset = slotsOffset;
+	this->header->slotCount = SLOT_COUNT;
+	this->header->slotSize = slotSize;
+	this->header->videoBytesMax = videoBytesMax;
+	this->header->audioFramesMax = AUDIO_FRAMES_MAX;
+	this->header->audioRate = DESMUME_SAMPLE_RATE;
+	this->header->sequence = 0;
+	// readers should check the magic last
+	__sync_synchronize();
+	this->header->magic = AVOUT_SHM_MAGIC;
+
+	return true;
+}
+
+void AVOutShm::end() {
+	if (this->mem != NULL) {
+		munmap(this->mem, this->memSize);
+		shm_unlink(this->name.c_str());
+		this->mem = NULL;
+		this->header = NULL;
+	}
+}
+
+bool AVOutShm::isRecording() {
+	return this->mem != NULL;
+}
+
+void AVOutShm::updateAudio(void* soundData, int soundLen) {
+	if (this->mem == NULL) {
+		return;
+	}
+	// a slow frame can't make us overrun; the excess is dropped
+	u32 todo = std::min<u32>(soundLen, AUDIO_FRAMES_MAX - this->audioFrames);
+	memcpy(&this->audio[this->audioFrames * 2], soundData, todo * 2 * sizeof(s16));
+	this->audioFrames += todo;
+}
+
+void AVOutShm::DidFrameEnd(bool isFrameSkipped) {
+	if (this->mem != NULL) {
+		this->publish(isFrameSkipped);
+	}
+}
+
+void AVOutShm::convert(const void* src, NDSColorFormat srcFormat, void* dst, size_t pixCount) {
+	if (srcFormat == this->colorFormat) {
+		memcpy(dst, src, pixCount * ((srcFormat == NDSColorFormat_BGR555_Rev) ? 2 : 4));
+		return;
+	}
+
+	switch (srcFormat) {
+	case NDSColorFormat_BGR555_Rev:
+		if (this->colorFormat == NDSColorFormat_BGR666_Rev)
+			ColorspaceConvertBuffer555To6665Opaque<false, false>((const u16*)src, (u32*)dst, pixCount);
+		else
+			ColorspaceConvertBuffer555To8888Opaque<false, false>((const u16*)src, (u32*)dst, pixCount);
+		break;
+	case NDSColorFormat_BGR666_Rev:
+		if (this->colorFormat == NDSColorFormat_BGR555_Rev)
+			ColorspaceConvertBuffer6665To5551<false, false>((const u32*)src, (u16*)dst, pixCount);
+		else
+			ColorspaceConvertBuffer6665To8888<false, false>((const u32*)src, (u32*)dst, pixCount);
+		break;
+	case NDSColorFormat_BGR888_Rev:
+		if (this->colorFormat == NDSColorFormat_BGR555_Rev)
+			ColorspaceConvertBuffer8888To5551<false, false>((const u32*)src, (u16*)dst, pixCount);
+		else
+			ColorspaceConvertBuffer8888To6665<false, false>((const u32*)src, (u32*)dst, pixCount);
+		break;
+	}
+}
+
+void AVOutShm::publish(bool isFrameSkipped) {
+	AVOutShmHeader* header = this->header;
+	u32 seq = this->sequence + 1;
+	if (seq == 0) seq = 1; // 0 is reserved for "being written"
+
+	AVOutShmSlot* slot = (AVOutShmSlot*)(this->mem + header->slotsOffset + (seq % header->slotCount) * header->slotSize);
+	slot->sequence = 0;
+	__sync_synchronize();
+
+	slot->flags = 0;
+	const NDSDisplayInfo& info = GPU->GetDisplayInfo();
+	size_t pixCount[2] = {0, 0};
+	if (isFrameSkipped) {
+		slot->flags |= AVOutShmSlot_VideoSkipped;
+	} else {
+		pixCount[0] = info.renderedWidth[NDSDisplayID_Main] * info.renderedHeight[NDSDisplayID_Main];
+		pixCount[1] = info.renderedWidth[NDSDisplayID_Touch] * info.renderedHeight[NDSDisplayID_Touch];
+		if ((pixCount[0] + pixCount[1]) * header->pixelBytes > header->videoBytesMax) {
+			slot->flags |= AVOutShmSlot_VideoTooBig;
+			pixCount[0] = pixCount[1] = 0;
+		}
+	}
+
+	// this is the only pass over the pixels: straight from the GPU's buffers into the ring
+	NDSColorFormat srcFormat = info.colorFormat;
+	if (srcFormat == NDSColorFormat_BGR666_Rev && GPU->GetWillAutoConvertRGB666ToRGB888()) {
+		srcFormat = NDSColorFormat_BGR888_Rev;
+	}
+	u8* video = (u8*)slot + slot->videoOffset;
+	for (int i = 0; i < 2; i++) {
+		slot->width[i] = pixCount[i] ? info.renderedWidth[i] : 0;
+		slot->height[i] = pixCount[i] ? info.renderedHeight[i] : 0;
+		if (pixCount[i]) {
+			this->convert(info.renderedBuffer[i], srcFormat, video, pixCount[i]);
+			video += pixCount[i] * header->pixelBytes;
+		}
+	}
+
+	memcpy((u8*)slot + slot->audioOffset, &this->audio[0], this->audioFrames * 2 * sizeof(s16));
+	slot->audioFrames = this->audioFrames;
+	this->audioFrames = 0;
+
+	__sync_synchronize();
+	slot->sequence = seq;
+	header->sequence = seq;
+	this->sequence = seq;
+}
@@ -0,0 +1,107 @@
+/*
+	Copyright (C) 2016 DeSmuME team
+
+	This file is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the this software.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _AVOUT_SHM_H_
+#define _AVOUT_SHM_H_
+
+#include <string>
+#include <vector>
+
+#include "avout.h"
+#include "GPU.h"
+
+// Publishes every finished frame and the audio that went with it into a POSIX
+// shared memory ring, for encoders, bots and the like to pick up.
+//
+// The segment starts with an AVOutShmHeader, and slotCount slots of slotSize
+// bytes each follow at slotsOffset. Frame number N lives in slot (N % slotCount). The
+// emulator never waits for readers, so a reader that falls behind just loses
+// frames. To read the newest frame:
+//
+//   1. N = header->sequence (0 means nothing has been published yet)
+//   2. slot = segment + slotsOffset + (N % slotCount) * slotSize
+//   3. check slot->sequence == N, copy out what you need, check it again
+//   4. if either check failed, the slot got reused while you were reading it
+//
+// Each slot holds the pixels of the main display followed by the touch display,
+// tightly packed at their rendered sizes, and the interleaved 16-bit stereo
+// samples produced since the previous slot.
+
+#define AVOUT_SHM_MAGIC 0x4D485344 // "DSHM"
+#define AVOUT_SHM_VERSION 1
+
+struct AVOutShmHeader
+{
+	u32 magic;
+	u32 version;
+	u32 colorFormat;		// NDSColorFormat of the exported pixels
+	u32 pixelBytes;
+	u32 slotsOffset;		// from the start of the segment
+	u32 slotCount;
+	u32 slotSize;			// bytes per slot, slot header included
+	u32 videoBytesMax;		// room for pixels in each slot
+	u32 audioFramesMax;		// room for sample pairs in each slot
+	u32 audioRate;
+	volatile u32 sequence;	// the newest complete slot
+};
+
+enum AVOutShmSlotFlags
+{
+	AVOutShmSlot_VideoSkipped	= 1,	// the emulator skipped this frame; there are no pixels
+	AVOutShmSlot_VideoTooBig	= 2		// the frame outgrew the slot; there are no pixels
+};
+
+struct AVOutShmSlot
+{
+	volatile u32 sequence;	// 0 while the slot is being written
+	u32 flags;
+	u32 width[2];
+	u32 height[2];
+	u32 videoOffset;		// from the start of the slot
+	u32 audioOffset;
+	u32 audioFrames;
+};
+
+class AVOutShm : public AVOut, public GPUEventHandlerDefault {
+public:
+	AVOutShm();
+	~AVOutShm();
+
+	// Call before begin(). Frames are converted to this format on their way into the ring.
+	void setColorFormat(NDSColorFormat format);
+
+	bool begin(const char* name);
+	void end();
+	bool isRecording();
+	void updateAudio(void* soundData, int soundLen);
+
+	virtual void DidFrameEnd(bool isFrameSkipped);
+private:
+	void publish(bool isFrameSkipped);
+	void convert(const void* src, NDSColorFormat srcFormat, void* dst, size_t pixCount);
+
+	std::string name;
+	NDSColorFormat colorFormat;
+	u8* mem;
+	size_t memSize;
+	AVOutShmHeader* header;
+	u32 sequence;
+	std::vector<s16> audio;
+	u32 audioFrames;
+};
+
+#endif
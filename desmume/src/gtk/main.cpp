@@ -55,6 +55,7 @@
 
 #include "avout_x264.h"
 #include "avout_flac.h"
+#include "avout_shm.h"
 
 #include "commandline.h"
 
@@ -115,6 +116,7 @@ gboolean EmuLoop(gpointer data);
 
 static AVOutX264 avout_x264;
 static AVOutFlac avout_flac;
+static AVOutShm avout_shm;
 static void RecordAV_x264();
 static void RecordAV_flac();
 static void RecordAV_stop();
@@ -646,6 +648,9 @@ public:
   int firmware_language;
 
   int timeout;
+
+  char *shm_export;
+  int shm_color_depth;
 };
 
 static void
@@ -660,6 +665,9 @@ init_configured_features( class configured_features *config	)
 
   config->timeout = 0;
 
+  config->shm_export = NULL;
+  config->shm_color_depth = 24;
+
   /* use the default language */
   config->firmware_language = -1; 
 
@@ -697,6 +705,8 @@ fill_configured_features( class configured_features *config,
                                     "\t\t\t\t  5 = Spanish\n",
                                     "LANG"},
     { "timeout", 0, 0, G_OPTION_ARG_INT, &config->timeout, "Quit DeSmuME after the specified seconds for testing purpose.", "SECONDS"},
+    { "shm-export", 0, 0, G_OPTION_ARG_STRING, &config->shm_export, "Publish every frame and its audio to the POSIX shared memory object NAME (e.g. /desmume)", "NAME"},
+    { "shm-color-depth", 0, 0, G_OPTION_ARG_INT, &config->shm_color_depth, "Color depth of the frames published by --shm-export: 15, 18 or 24 (default)", "BITS"},
     { NULL }
   };
 
@@ -716,6 +726,11 @@ fill_configured_features( class configured_features *config,
     goto error;
   }
 
+  if (config->shm_color_depth != 15 && config->shm_color_depth != 18 && config->shm_color_depth != 24) {
+    g_printerr("Shared memory color depth must be 15, 18 or 24.\n");
+    goto error;
+  }
+
   if (config->engine_3d != 0 && config->engine_3d != 1
 #if defined(HAVE_LIBOSMESA) || defined(HAVE_GL_GLX)
            && config->engine_3d != 2
@@ -2358,6 +2373,17 @@ public:
 	virtual void AVI_SoundUpdate(void* soundData, int soundLen) { 
 		avout_flac.updateAudio(soundData, soundLen);
 	}
+
+	// the shared memory export takes whatever frames get rendered, so it stays out of AVI_IsRecording,
+	// which would turn frameskip off
+	virtual bool SND_IsExporting()
+	{
+		return avout_shm.isRecording();
+	}
+
+	virtual void SND_ExportUpdate(void* soundData, int soundLen) {
+		avout_shm.updateAudio(soundData, soundLen);
+	}
 };
 
 static void DoQuit()
@@ -2870,6 +2896,15 @@ common_gtk_main( class configured_features *my_config)
     }
     desmume_init( my_config->disable_sound || !config.audio_enabled);
 
+    if (my_config->shm_export != NULL) {
+        avout_shm.setColorFormat(my_config->shm_color_depth == 15 ? NDSColorFormat_BGR555_Rev :
+                                 my_config->shm_color_depth == 18 ? NDSColorFormat_BGR666_Rev :
+                                 NDSColorFormat_BGR888_Rev);
+        if (avout_shm.begin(my_config->shm_export)) {
+            GPU->SetEventHandler(&avout_shm);
+        }
+    }
+
     /* Init the hud / osd stuff */
 #ifdef HAVE_LIBAGG
     Desmume_InitOnce();
@@ -3220,6 +3255,7 @@ common_gtk_main( class configured_features *my_config)
 	config.save();
 	avout_x264.end();
 	avout_flac.end();
+	avout_shm.end();
 
     desmume_free();
 
@@ -209,7 +209,8 @@ static unsigned filter_paeth(uint8_t *target,
 
 static bool rpng_save_image(const char *path,
       const uint8_t *data,
-      unsigned width, unsigned height, unsigned pitch, unsigned bpp)
+      unsigned width, unsigned height, unsigned pitch, unsigned bpp,
+      int level)
 {
    unsigned h;
    bool ret = true;
@@ -269,13 +270,32 @@ static bool rpng_save_image(const char *path,
       else
          copy_bgr24_line(rgba_line, data, width);
 
-      /* Try every filtering method, and choose the method
-       * which has most entries as zero.
-       *
-       * This is probably not very optimal, but it's very 
-       * simple to implement.
-       */
+      /* Stored output gains nothing from filtering, and fast
+       * output only tries the filter that usually wins. */
+      if (level < 6)
       {
+         if (level == 0)
+         {
+            *encode_target++ = 0;
+            memcpy(encode_target, rgba_line, width * bpp);
+         }
+         else
+         {
+            filter_up(up_filtered, rgba_line, prev_encoded, width, bpp);
+            *encode_target++ = 2;
+            memcpy(encode_target, up_filtered, width * bpp);
+         }
+
+         memcpy(prev_encoded, rgba_line, width * bpp);
+      }
+      else
+      {
+         /* Try every filtering method, and choose the method
+          * which has most entries as zero.
+          *
+          * This is probably not very optimal, but it's very 
+          * simple to implement.
+          */
          unsigned none_score  = count_sad(rgba_line, width * bpp);
          unsigned up_score    = filter_up(up_filtered, rgba_line, prev_encoded, width, bpp);
          unsigned sub_score   = filter_sub(sub_filtered, rgba_line, width, bpp);
@@ -337,7 +357,7 @@ static bool rpng_save_image(const char *path,
          encode_buf,
          deflate_buf + 8);
 
-   stream_backend->stream_compress_init(stream, 9);
+   stream_backend->stream_compress_init(stream, level);
 
    if (stream_backend->stream_compress_data_to_file(stream) != 1)
    {
@@ -374,14 +394,21 @@ bool rpng_save_image_argb(const char *path, const uint32_t *data,
       unsigned width, unsigned height, unsigned pitch)
 {
    return rpng_save_image(path, (const uint8_t*)data,
-         width, height, pitch, sizeof(uint32_t));
+         width, height, pitch, sizeof(uint32_t), 9);
 }
 
 bool rpng_save_image_bgr24(const char *path, const uint8_t *data,
       unsigned width, unsigned height, unsigned pitch)
 {
    return rpng_save_image(path, (const uint8_t*)data,
-         width, height, pitch, 3);
+         width, height, pitch, 3, 9);
+}
+
+bool rpng_save_image_bgr24_level(const char *path, const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch, int level)
+{
+   return rpng_save_image(path, (const uint8_t*)data,
+         width, height, pitch, 3, level);
 }
 
 #endif
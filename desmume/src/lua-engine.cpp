@@ -1842,6 +1842,8 @@ DEFINE_LUA_FUNCTION(vram_writeword, "address,value")
 	int address = luaL_checkinteger(L,1);
 	u16 value = (u16)(luaL_checkinteger(L,2) & 0xFFFF);
 	T1WriteWord(MMU.ARM9_LCD,address,value);
+	StateHash_MarkHost(MMU.ARM9_LCD + address, 2);
+	MMU.VRAMGeneration++;
 	return 0;
 }
 DEFINE_LUA_FUNCTION(memory_writedword, "address,value")
@@ -1852,6 +1854,204 @@ DEFINE_LUA_FUNCTION(memory_writedword, "address,value")
 	return 0;
 }
 
+// resolves the ARM9's view of address to host memory for bulk reads.
+// on top of what MMU_GetHostRange covers, palette memory and OAM are plain (mirrored) 2KB arrays as far as reading goes.
+static const u8* GetReadableHostRange(u32 address, u32 &contiguous)
+{
+	const u8* ptr = MMU_GetHostRange<ARMCPU_ARM9>(address, contiguous, false);
+	if(ptr)
+		return ptr;
+
+	const u32 region = address >> 24;
+	if(region != 0x05 && region != 0x07)
+		return NULL;
+	if(hookedRegions[LUAMEMHOOK_READ].NotEmpty() || CheckDebugEvent(DEBUG_EVENT_READ))
+		return NULL;
+	if((address & ~0x3FFF) == MMU.DTCMRegion)
+		return NULL;
+
+	// dtcm is 16KB aligned, so a run that stays inside one 2KB mirror can't run into it
+	const u32 offset = address & 0x7FF;
+	contiguous = 0x800 - offset;
+	return ((region == 0x05) ? MMU.ARM9_VMEM : MMU.ARM9_OAM) + offset;
+}
+
+// copies length bytes of the ARM9's view of memory into dst.
+// plain memory is copied a run at a time, everything else (I/O, unmapped areas, hooked memory) goes through the MMU byte by byte.
+static void ReadMemoryBlock(u32 address, u32 length, u8* dst)
+{
+	while(length > 0)
+	{
+		u32 contiguous;
+		const u8* src = GetReadableHostRange(address, contiguous);
+		if(src)
+		{
+			const u32 todo = std::min(contiguous, length);
+			memcpy(dst, src, todo);
+			address += todo;
+			dst += todo;
+			length -= todo;
+		}
+		else
+		{
+			*dst++ = _MMU_read08<ARMCPU_ARM9>(address++);
+			length--;
+		}
+	}
+}
+
+// reads of more than this are refused, both to keep a script from asking for gigabytes and so that a huge
+// repeat count in a struct format can't overflow the size
+#define MEMORY_READ_MAX_SIZE (16*1024*1024)
+
+// pushes a string holding length bytes of the ARM9's view of memory. it is built in a luaL_Buffer,
+// so a lua error on the way (like running out of memory) has nothing of ours to leak
+static void PushMemoryBlock(lua_State* L, u32 address, u32 length)
+{
+	luaL_Buffer b;
+	luaL_buffinit(L, &b);
+	while(length > 0)
+	{
+		const u32 todo = std::min<u32>(length, LUAL_BUFFERSIZE);
+		ReadMemoryBlock(address, todo, (u8*)luaL_prepbuffer(&b));
+		luaL_addsize(&b, todo);
+		address += todo;
+		length -= todo;
+	}
+	luaL_pushresult(&b);
+}
+
+// struct formats are a sequence of little-endian fields, each optionally preceded by a repeat count:
+// b/B = signed/unsigned byte, h/H = signed/unsigned halfword, i/I = signed/unsigned word, x = skip a byte
+static int StructFieldSize(lua_State* L, char field)
+{
+	switch(field)
+	{
+		case 'b': case 'B': case 'x': return 1;
+		case 'h': case 'H': return 2;
+		case 'i': case 'I': return 4;
+	}
+	return luaL_error(L, "invalid struct format character '%c'", field);
+}
+
+// returns the number of bytes described by format, and how many values it unpacks to
+static u32 StructFormatSize(lua_State* L, const char* format, int& valueCount)
+{
+	u32 size = 0;
+	valueCount = 0;
+	while(*format)
+	{
+		unsigned long count = 1;
+		if(isdigit((unsigned char)*format))
+			count = strtoul(format, (char**)&format, 10);
+		const int fieldSize = StructFieldSize(L, *format);
+		if(count > (MEMORY_READ_MAX_SIZE - size) / fieldSize)
+			return luaL_error(L, "struct format describes more than %d bytes", MEMORY_READ_MAX_SIZE);
+		size += count * fieldSize;
+		if(*format != 'x')
+			valueCount += count;
+		format++;
+	}
+	return size;
+}
+
+static int PushStructValues(lua_State* L, const char* format, const u8* data, int valueCount)
+{
+	luaL_checkstack(L, valueCount, "too many values in struct format");
+	while(*format)
+	{
+		u32 count = 1;
+		if(isdigit((unsigned char)*format))
+			count = (u32)strtoul(format, (char**)&format, 10);
+		for(u32 i = 0; i < count; i++)
+		{
+			switch(*format)
+			{
+				case 'b': lua_pushinteger(L, (s8)data[0]); break;
+				case 'B': lua_pushinteger(L, data[0]); break;
+				case 'h': lua_pushinteger(L, (s16)(data[0] | (data[1] << 8))); break;
+				case 'H': lua_pushinteger(L, (u16)(data[0] | (data[1] << 8))); break;
+				case 'i': lua_pushinteger(L, (s32)(data[0] | (data[1] << 8) | (data[2] << 16) | ((u32)data[3] << 24))); break;
+				case 'I': lua_pushnumber(L, (u32)(data[0] | (data[1] << 8) | (data[2] << 16) | ((u32)data[3] << 24))); break; // can't use pushinteger in this case (out of range)
+			}
+			data += StructFieldSize(L, *format);
+		}
+		format++;
+	}
+	return valueCount;
+}
+
+DEFINE_LUA_FUNCTION(memory_readbytes, "address,length")
+{
+	u32 address = luaL_checkinteger(L,1);
+	int length = luaL_checkinteger(L,2);
+	if(length < 0)
+		return luaL_error(L, "memory.readbytes: length must not be negative");
+	if(length > MEMORY_READ_MAX_SIZE)
+		return luaL_error(L, "memory.readbytes: can't read more than %d bytes at once", MEMORY_READ_MAX_SIZE);
+
+	lua_settop(L,0);
+	PushMemoryBlock(L, address, length);
+	return 1;
+}
+
+// takes a table of {address,length} pairs and returns a table holding a string for each, so a script can pull
+// everything it watches in a single call
+DEFINE_LUA_FUNCTION(memory_readbytesmulti, "ranges")
+{
+	luaL_checktype(L, 1, LUA_TTABLE);
+	const int rangeCount = (int)lua_objlen(L, 1);
+
+	u32 total = 0;
+	lua_createtable(L, rangeCount, 0);
+	for(int n = 1; n <= rangeCount; n++)
+	{
+		lua_rawgeti(L, 1, n);
+		luaL_checktype(L, -1, LUA_TTABLE);
+		lua_rawgeti(L, -1, 1);
+		lua_rawgeti(L, -2, 2);
+		const u32 address = (u32)luaL_checkinteger(L, -2);
+		const int length = luaL_checkinteger(L, -1);
+		lua_pop(L, 3);
+		if(length < 0)
+			return luaL_error(L, "memory.readbytesmulti: range %d has a negative length", n);
+		if((u32)length > MEMORY_READ_MAX_SIZE - total)
+			return luaL_error(L, "memory.readbytesmulti: can't read more than %d bytes at once", MEMORY_READ_MAX_SIZE);
+		total += length;
+
+		PushMemoryBlock(L, address, length);
+		lua_rawseti(L, -2, n);
+	}
+	return 1;
+}
+
+DEFINE_LUA_FUNCTION(memory_readstruct, "address,format")
+{
+	const u32 address = (u32)luaL_checkinteger(L,1);
+	const char* format = luaL_checkstring(L,2);
+
+	int valueCount;
+	const u32 size = StructFormatSize(L, format, valueCount);
+	std::vector<u8> buffer(size + 1);
+	ReadMemoryBlock(address, size, &buffer[0]);
+	return PushStructValues(L, format, &buffer[0], valueCount);
+}
+
+DEFINE_LUA_FUNCTION(memory_unpack, "format,data[,offset]")
+{
+	const char* format = luaL_checkstring(L,1);
+	size_t dataSize;
+	const char* data = luaL_checklstring(L,2,&dataSize);
+	const int offset = luaL_optinteger(L,3,1) - 1; // 1-based, like string.sub
+
+	int valueCount;
+	const u32 size = StructFormatSize(L, format, valueCount);
+	if(offset < 0 || (size_t)offset + size > dataSize)
+		return luaL_error(L, "memory.unpack: format needs %d bytes but the data is too short", size);
+
+	return PushStructValues(L, format, (const u8*)data + offset, valueCount);
+}
+
 DEFINE_LUA_FUNCTION(memory_readbyterange, "address,length")
 {
 	int address = luaL_checkinteger(L,1);
@@ -1866,13 +2066,15 @@ DEFINE_LUA_FUNCTION(memory_readbyterange, "address,length")
 	// push the array
 	lua_createtable(L, abs(length), 0);
 
+	std::vector<u8> buffer(length + 1);
+	ReadMemoryBlock(address, length, &buffer[0]);
+
 	// put all the values into the (1-based) array
 	for(int a = address, n = 1; n <= length; a++, n++)
 	{
 		if(IsHardwareAddressValid(a))
 		{
-			unsigned char value = (unsigned char)(_MMU_read08<ARMCPU_ARM9>(a) & 0xFF);
-			lua_pushinteger(L, value);
+			lua_pushinteger(L, buffer[n-1]);
 			lua_rawseti(L, -2, n);
 		}
 		// else leave the value nil
@@ -4615,6 +4817,10 @@ static const struct luaL_reg memorylib [] =
 	{"readdword", memory_readdword},
 	{"readdwordsigned", memory_readdwordsigned},
 	{"readbyterange", memory_readbyterange},
+	{"readbytes", memory_readbytes},
+	{"readbytesmulti", memory_readbytesmulti},
+	{"readstruct", memory_readstruct},
+	{"unpack", memory_unpack},
 	{"writebyte", memory_writebyte},
 	{"writeword", memory_writeword},
 	{"writedword", memory_writedword},
@@ -22,7 +22,6 @@
 #include <math.h>
 #include <assert.h>
 #include "matrix.h"
-#include "MMU.h"
 
 void _NOSSE_MatrixMultVec4x4 (const float *matrix, float *vecPtr)
 {
@@ -39,6 +38,11 @@ void _NOSSE_MatrixMultVec4x4 (const float *matrix, float *vecPtr)
 
 void MatrixMultVec4x4 (const s32 *matrix, s32 *vecPtr)
 {
+#ifdef ENABLE_SSE4_1
+	__m128i sumEven, sumOdd;
+	fx32_MatrixMultVec4x4_SSE41(matrix, _mm_loadu_si128((__m128i *)vecPtr), sumEven, sumOdd);
+	_mm_storeu_si128((__m128i *)vecPtr, fx32_shiftdown_SSE41(sumEven, sumOdd));
+#else
 	const s32 x = vecPtr[0];
 	const s32 y = vecPtr[1];
 	const s32 z = vecPtr[2];
@@ -48,6 +52,7 @@ void MatrixMultVec4x4 (const s32 *matrix, s32 *vecPtr)
 	vecPtr[1] = fx32_shiftdown(fx32_mul(x,matrix[1]) + fx32_mul(y,matrix[5]) + fx32_mul(z,matrix[ 9]) + fx32_mul(w,matrix[13]));
 	vecPtr[2] = fx32_shiftdown(fx32_mul(x,matrix[2]) + fx32_mul(y,matrix[6]) + fx32_mul(z,matrix[10]) + fx32_mul(w,matrix[14]));
 	vecPtr[3] = fx32_shiftdown(fx32_mul(x,matrix[3]) + fx32_mul(y,matrix[7]) + fx32_mul(z,matrix[11]) + fx32_mul(w,matrix[15]));
+#endif
 }
 
 void MatrixMultVec3x3_fixed(const s32 *matrix, s32 *vecPtr)
@@ -56,9 +61,136 @@ void MatrixMultVec3x3_fixed(const s32 *matrix, s32 *vecPtr)
 	const s32 y = vecPtr[1];
 	const s32 z = vecPtr[2];
 
+#ifdef ENABLE_SSE4_1
+	//the 4th column is worked out too, but it is never stored
+	__m128i sumEven = _mm_setzero_si128();
+	__m128i sumOdd = _mm_setzero_si128();
+	fx32_mac_SSE41(_mm_loadu_si128((__m128i *)(matrix + 0)), _mm_set1_epi32(x), sumEven, sumOdd);
+	fx32_mac_SSE41(_mm_loadu_si128((__m128i *)(matrix + 4)), _mm_set1_epi32(y), sumEven, sumOdd);
+	fx32_mac_SSE41(_mm_loadu_si128((__m128i *)(matrix + 8)), _mm_set1_epi32(z), sumEven, sumOdd);
+	const __m128i result = fx32_shiftdown_SSE41(sumEven, sumOdd);
+
+	_mm_storel_epi64((__m128i *)vecPtr, result);
+	vecPtr[2] = _mm_extract_epi32(result, 2);
+#else
 	vecPtr[0] = fx32_shiftdown(fx32_mul(x,matrix[0]) + fx32_mul(y,matrix[4]) + fx32_mul(z,matrix[8]));
 	vecPtr[1] = fx32_shiftdown(fx32_mul(x,matrix[1]) + fx32_mul(y,matrix[5]) + fx32_mul(z,matrix[9]));
 	vecPtr[2] = fx32_shiftdown(fx32_mul(x,matrix[2]) + fx32_mul(y,matrix[6]) + fx32_mul(z,matrix[10]));
+#endif
+}
+
+//---------------
+//GEM_ functions: GEOMETRY ENGINE MATH, for gfx3d.cpp.
+//these should be explicit about how they're handling precision.
+//Handling that stuff generically globally is not a winning proposition.
+
+static FORCEINLINE s64 GEM_Mul32x32To64(const s32 a, const s32 b)
+{
+#ifdef _MSC_VER
+	return __emul(a,b);
+#else
+	return ((s64)a)*((s64)b);
+#endif
+}
+
+#ifdef ENABLE_SSE4_1
+//GEM_SaturateAndShiftdown36To32() for each of the four sums made by the fx32_*_SSE41() helpers.
+//a sum is out of range exactly when its high 32bits are out of the -0x800...0x7FF range
+static FORCEINLINE __m128i GEM_SaturateAndShiftdown36To32_SSE41(const __m128i &sumEven, const __m128i &sumOdd)
+{
+	__m128i lo, hi;
+	fx32_split_SSE41(sumEven, sumOdd, lo, hi);
+
+	__m128i result = _mm_or_si128(_mm_srli_epi32(lo, 12), _mm_slli_epi32(hi, 20));
+	result = _mm_blendv_epi8(result, _mm_set1_epi32(0x7FFFFFFF), _mm_cmpgt_epi32(hi, _mm_set1_epi32(0x000007FF)));
+	result = _mm_blendv_epi8(result, _mm_set1_epi32((s32)0x80000000U), _mm_cmplt_epi32(hi, _mm_set1_epi32((s32)0xFFFFF800U)));
+	return result;
+}
+#endif
+
+void GEM_TransformVertex(const s32 *matrix, s32 *vecPtr)
+{
+#ifdef ENABLE_SSE4_1
+	__m128i sumEven, sumOdd;
+	fx32_MatrixMultVec4x4_SSE41(matrix, _mm_loadu_si128((__m128i *)vecPtr), sumEven, sumOdd);
+	_mm_storeu_si128((__m128i *)vecPtr, GEM_SaturateAndShiftdown36To32_SSE41(sumEven, sumOdd));
+#else
+	const s32 x = vecPtr[0];
+	const s32 y = vecPtr[1];
+	const s32 z = vecPtr[2];
+	const s32 w = vecPtr[3];
+
+	//saturation logic is most carefully tested by:
+	//+ spectrobes beyond the portals excavation blower and drill tools: sets very large overflowing +x,+y in the modelview matrix to push things offscreen
+	//You can see this happening quite clearly: vertices will get translated to extreme values and overflow from a 7FFF-like to an 8000-like
+	//but if it's done wrongly, you can get bugs in:
+	//+ kingdom hearts re-coded: first conversation with cast characters will place them oddly with something overflowing to about 0xA???????
+	
+	//other test cases that cropped up during this development, but are probably not actually related to this after all
+	//+ SM64: outside castle skybox
+	//+ NSMB: mario head screen wipe
+
+	vecPtr[0] = GEM_SaturateAndShiftdown36To32(GEM_Mul32x32To64(x,matrix[0]) + GEM_Mul32x32To64(y,matrix[4]) + GEM_Mul32x32To64(z,matrix [8]) + GEM_Mul32x32To64(w,matrix[12]));
+	vecPtr[1] = GEM_SaturateAndShiftdown36To32(GEM_Mul32x32To64(x,matrix[1]) + GEM_Mul32x32To64(y,matrix[5]) + GEM_Mul32x32To64(z,matrix[ 9]) + GEM_Mul32x32To64(w,matrix[13]));
+	vecPtr[2] = GEM_SaturateAndShiftdown36To32(GEM_Mul32x32To64(x,matrix[2]) + GEM_Mul32x32To64(y,matrix[6]) + GEM_Mul32x32To64(z,matrix[10]) + GEM_Mul32x32To64(w,matrix[14]));
+	vecPtr[3] = GEM_SaturateAndShiftdown36To32(GEM_Mul32x32To64(x,matrix[3]) + GEM_Mul32x32To64(y,matrix[7]) + GEM_Mul32x32To64(z,matrix[11]) + GEM_Mul32x32To64(w,matrix[15]));
+#endif
+}
+
+void GEM_LightDotProducts(const s32 *normal, const s32 (*lightDirection)[4], const s32 (*halfVector)[4], s32 *outLightDot, s32 *outHalfDot)
+{
+#ifdef ENABLE_SSE4_1
+	//one light per lane
+	const __m128i nx = _mm_set1_epi32(normal[0]);
+	const __m128i ny = _mm_set1_epi32(normal[1]);
+	const __m128i nz = _mm_set1_epi32(normal[2]);
+
+	//transpose the vectors so that each register holds one component for all four lights
+	__m128i l0 = _mm_loadu_si128((__m128i *)lightDirection[0]);
+	__m128i l1 = _mm_loadu_si128((__m128i *)lightDirection[1]);
+	__m128i l2 = _mm_loadu_si128((__m128i *)lightDirection[2]);
+	__m128i l3 = _mm_loadu_si128((__m128i *)lightDirection[3]);
+	__m128i t0 = _mm_unpacklo_epi32(l0, l1);
+	__m128i t1 = _mm_unpacklo_epi32(l2, l3);
+	__m128i t2 = _mm_unpackhi_epi32(l0, l1);
+	__m128i t3 = _mm_unpackhi_epi32(l2, l3);
+
+	__m128i sumEven = _mm_setzero_si128();
+	__m128i sumOdd = _mm_setzero_si128();
+	fx32_mac_SSE41(_mm_unpacklo_epi64(t0, t1), nx, sumEven, sumOdd);
+	fx32_mac_SSE41(_mm_unpackhi_epi64(t0, t1), ny, sumEven, sumOdd);
+	fx32_mac_SSE41(_mm_unpacklo_epi64(t2, t3), nz, sumEven, sumOdd);
+	_mm_storeu_si128((__m128i *)outLightDot, fx32_shiftdown_SSE41(sumEven, sumOdd));
+
+	//the half vectors get negated with the same 32bit wraparound as the plain C version below
+	const __m128i zero = _mm_setzero_si128();
+	l0 = _mm_sub_epi32(zero, _mm_loadu_si128((__m128i *)halfVector[0]));
+	l1 = _mm_sub_epi32(zero, _mm_loadu_si128((__m128i *)halfVector[1]));
+	l2 = _mm_sub_epi32(zero, _mm_loadu_si128((__m128i *)halfVector[2]));
+	l3 = _mm_sub_epi32(zero, _mm_loadu_si128((__m128i *)halfVector[3]));
+	t0 = _mm_unpacklo_epi32(l0, l1);
+	t1 = _mm_unpacklo_epi32(l2, l3);
+	t2 = _mm_unpackhi_epi32(l0, l1);
+	t3 = _mm_unpackhi_epi32(l2, l3);
+
+	sumEven = _mm_setzero_si128();
+	sumOdd = _mm_setzero_si128();
+	fx32_mac_SSE41(_mm_unpacklo_epi64(t0, t1), nx, sumEven, sumOdd);
+	fx32_mac_SSE41(_mm_unpackhi_epi64(t0, t1), ny, sumEven, sumOdd);
+	fx32_mac_SSE41(_mm_unpacklo_epi64(t2, t3), nz, sumEven, sumOdd);
+	_mm_storeu_si128((__m128i *)outHalfDot, fx32_shiftdown_SSE41(sumEven, sumOdd));
+#else
+	for (size_t i = 0; i < 4; i++)
+	{
+		outLightDot[i] = fx32_shiftdown(fx32_mul(lightDirection[i][0],normal[0]) + fx32_mul(lightDirection[i][1],normal[1]) + fx32_mul(lightDirection[i][2],normal[2]));
+
+		//the half vectors get negated with 32bit wraparound
+		const s32 hx = (s32)(0U - (u32)halfVector[i][0]);
+		const s32 hy = (s32)(0U - (u32)halfVector[i][1]);
+		const s32 hz = (s32)(0U - (u32)halfVector[i][2]);
+		outHalfDot[i] = fx32_shiftdown(fx32_mul(hx,normal[0]) + fx32_mul(hy,normal[1]) + fx32_mul(hz,normal[2]));
+	}
+#endif
 }
 
 //-------------------------
@@ -238,37 +370,39 @@ MatrixStack::MatrixStack(int size, int type)
 	this->type = type;
 }
 
-static void MatrixStackSetStackPosition (MatrixStack *stack, int pos)
+static bool MatrixStackSetStackPosition (MatrixStack *stack, int pos)
 {
 	stack->position += pos;
 
-	if((stack->position < 0) || (stack->position > stack->size))
-		MMU_new.gxstat.se = 1;
+	const bool error = (stack->position < 0) || (stack->position > stack->size);
 
 	//once upon a time, we tried clamping to the size.
 	//this utterly broke sims 2 apartment pets.
 	//changing to wrap around made it work perfectly
 	stack->position = ((u32)stack->position) & stack->size;
+
+	return error;
 }
 
-void MatrixStackPushMatrix (MatrixStack *stack, const s32 *ptr)
+bool MatrixStackPushMatrix (MatrixStack *stack, const s32 *ptr)
 {
 	//printf("Push %i pos %i\n", stack->type, stack->position);
 	if ((stack->type == 0) || (stack->type == 3))
 		MatrixCopy (&stack->matrix[0], ptr);
 	else
 		MatrixCopy (&stack->matrix[stack->position*16], ptr);
-	MatrixStackSetStackPosition (stack, 1);
+	return MatrixStackSetStackPosition (stack, 1);
 }
 
-void MatrixStackPopMatrix (s32 *mtxCurr, MatrixStack *stack, int size)
+bool MatrixStackPopMatrix (s32 *mtxCurr, MatrixStack *stack, int size)
 {
 	//printf("Pop %i pos %i (change %d)\n", stack->type, stack->position, -size);
-	MatrixStackSetStackPosition(stack, -size);
+	const bool error = MatrixStackSetStackPosition(stack, -size);
 	if ((stack->type == 0) || (stack->type == 3))
 		MatrixCopy (mtxCurr, &stack->matrix[0]);
 	else
 		MatrixCopy (mtxCurr, &stack->matrix[stack->position*16]);
+	return error;
 }
 
 s32* MatrixStackGetPos(MatrixStack *stack, const size_t pos)
@@ -382,6 +516,21 @@ void Vector4Copy(float *dst, const float *src)
 
 void MatrixMultiply (s32 *matrix, const s32 *rightMatrix)
 {
+#ifdef ENABLE_SSE4_1
+	//each column of the result is the left matrix times the matching column of the right matrix
+	__m128i sumEven, sumOdd;
+	__m128i col[4];
+	for (size_t i = 0; i < 4; i++)
+	{
+		fx32_MatrixMultVec4x4_SSE41(matrix, _mm_loadu_si128((__m128i *)(rightMatrix + (i * 4))), sumEven, sumOdd);
+		col[i] = fx32_shiftdown_SSE41(sumEven, sumOdd);
+	}
+
+	_mm_storeu_si128((__m128i *)(matrix +  0), col[0]);
+	_mm_storeu_si128((__m128i *)(matrix +  4), col[1]);
+	_mm_storeu_si128((__m128i *)(matrix +  8), col[2]);
+	_mm_storeu_si128((__m128i *)(matrix + 12), col[3]);
+#else
 	s32 tmpMatrix[16];
 
 	tmpMatrix[0]  = fx32_shiftdown(fx32_mul(matrix[0],rightMatrix[0])+fx32_mul(matrix[4],rightMatrix[1])+fx32_mul(matrix[8],rightMatrix[2])+fx32_mul(matrix[12],rightMatrix[3]));
@@ -405,6 +554,7 @@ void MatrixMultiply (s32 *matrix, const s32 *rightMatrix)
 	tmpMatrix[15] = fx32_shiftdown(fx32_mul(matrix[3],rightMatrix[12])+fx32_mul(matrix[7],rightMatrix[13])+fx32_mul(matrix[11],rightMatrix[14])+fx32_mul(matrix[15],rightMatrix[15]));
 
 	memcpy(matrix,tmpMatrix,sizeof(s32)*16);
+#endif
 }
 
 void MatrixScale(s32 *matrix, const s32 *ptr)
@@ -33,6 +33,10 @@
 #include <emmintrin.h>
 #endif
 
+#ifdef ENABLE_SSE4_1
+#include <smmintrin.h>
+#endif
+
 struct MatrixStack
 {
 	MatrixStack(int size, int type);
@@ -58,8 +62,9 @@ void	MatrixIdentity			(s32 *matrix);
 
 void	MatrixStackInit				(MatrixStack *stack);
 void	MatrixStackSetMaxSize		(MatrixStack *stack, int size);
-void	MatrixStackPushMatrix		(MatrixStack *stack, const s32 *ptr);
-void	MatrixStackPopMatrix		(s32 *mtxCurr, MatrixStack *stack, int size);
+//these return true if the stack position went out of range (the geometry engine's stack overflow error)
+bool	MatrixStackPushMatrix		(MatrixStack *stack, const s32 *ptr);
+bool	MatrixStackPopMatrix		(s32 *mtxCurr, MatrixStack *stack, int size);
 s32*	MatrixStackGetPos			(MatrixStack *stack, const size_t pos);
 s32*	MatrixStackGet				(MatrixStack *stack);
 void	MatrixStackLoadMatrix		(MatrixStack *stack, const size_t pos, const s32 *ptr);
@@ -220,6 +225,20 @@ static void memset_u32_fast(void *dst, const u32 val)
 void _NOSSE_MatrixMultVec4x4 (const float *matrix, float *vecPtr);
 void MatrixMultVec3x3_fixed(const s32 *matrix, s32 *vecPtr);
 
+//the geometry engine's 36bit sums saturate to 32bits (after the shift) instead of wrapping
+FORCEINLINE s32 GEM_SaturateAndShiftdown36To32(const s64 val)
+{
+	if(val>(s64)0x000007FFFFFFFFFFULL) return (s32)0x7FFFFFFFU;
+	if(val<(s64)0xFFFFF80000000000ULL) return (s32)0x80000000U;
+
+	return fx32_shiftdown(val);
+}
+
+//transforms a vertex the way the geometry engine does: MatrixMultVec4x4(), but with saturation
+void GEM_TransformVertex(const s32 *matrix, s32 *vecPtr);
+//dot products of the normal with each of the four light directions, and with each of the four negated half vectors
+void GEM_LightDotProducts(const s32 *normal, const s32 (*lightDirection)[4], const s32 (*halfVector)[4], s32 *outLightDot, s32 *outHalfDot);
+
 //---------------------------
 //switched SSE functions
 #ifdef ENABLE_SSE
@@ -357,6 +376,47 @@ FORCEINLINE void vector_fix2float(float* matrix, const float divisor)
 
 #endif //switched SSE functions
 
+//---------------------------
+//SSE4.1 fixed point helpers
+//these keep the full 64bit products just like fx32_mul(), so the results are identical to the plain C versions
+#ifdef ENABLE_SSE4_1
+
+//multiplies the signed 32bit lanes of a and b and adds the 64bit products to the running sums.
+//sums for lanes 0 and 2 are kept in sumEven, and sums for lanes 1 and 3 in sumOdd
+FORCEINLINE void fx32_mac_SSE41(const __m128i &a, const __m128i &b, __m128i &sumEven, __m128i &sumOdd)
+{
+	sumEven = _mm_add_epi64(sumEven, _mm_mul_epi32(a, b));
+	sumOdd  = _mm_add_epi64(sumOdd,  _mm_mul_epi32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32)));
+}
+
+//puts the low and high 32bits of each of the four sums back into lane order
+FORCEINLINE void fx32_split_SSE41(const __m128i &sumEven, const __m128i &sumOdd, __m128i &lo, __m128i &hi)
+{
+	lo = _mm_blend_epi16(sumEven, _mm_slli_epi64(sumOdd, 32), 0xCC);
+	hi = _mm_blend_epi16(_mm_srli_epi64(sumEven, 32), sumOdd, 0xCC);
+}
+
+//fx32_shiftdown() for each of the four sums
+FORCEINLINE __m128i fx32_shiftdown_SSE41(const __m128i &sumEven, const __m128i &sumOdd)
+{
+	__m128i lo, hi;
+	fx32_split_SSE41(sumEven, sumOdd, lo, hi);
+	return _mm_or_si128(_mm_srli_epi32(lo, 12), _mm_slli_epi32(hi, 20));
+}
+
+//multiplies a 4x4 fixed point matrix by a 4 element vector, returning the 64bit sums for fx32_shiftdown_SSE41()
+FORCEINLINE void fx32_MatrixMultVec4x4_SSE41(const s32 *matrix, const __m128i &vec, __m128i &sumEven, __m128i &sumOdd)
+{
+	sumEven = _mm_setzero_si128();
+	sumOdd = _mm_setzero_si128();
+	fx32_mac_SSE41(_mm_loadu_si128((__m128i *)(matrix +  0)), _mm_shuffle_epi32(vec, 0x00), sumEven, sumOdd);
+	fx32_mac_SSE41(_mm_loadu_si128((__m128i *)(matrix +  4)), _mm_shuffle_epi32(vec, 0x55), sumEven, sumOdd);
+	fx32_mac_SSE41(_mm_loadu_si128((__m128i *)(matrix +  8)), _mm_shuffle_epi32(vec, 0xAA), sumEven, sumOdd);
+	fx32_mac_SSE41(_mm_loadu_si128((__m128i *)(matrix + 12)), _mm_shuffle_epi32(vec, 0xFF), sumEven, sumOdd);
+}
+
+#endif //ENABLE_SSE4_1
+
 void MatrixMultVec4x4 (const s32 *matrix, s32 *vecPtr);
 
 void MatrixMultiply(s32* matrix, const s32* rightMatrix);
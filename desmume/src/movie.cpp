@@ -40,15 +40,32 @@
 #include "GPU_osd.h"
 #include "path.h"
 #include "emufile.h"
+#include "saves.h"
+#include "statehash.h"
 
 using namespace std;
 bool freshMovie = false;	  //True when a movie loads, false when movie is altered.  Used to determine if a movie has been altered since opening
 bool autoMovieBackup = true;
+int movieCheckpointInterval = 0; //frames between movie checkpoints for new movies; 0 disables them
 
 #define FCEU_PrintError LOG
 
 #define MOVIE_VERSION 1
 
+//binary movie container (.dsmb). every field is little endian:
+//  0 'DSMB'               4 container version      8 header text length
+// 12 record size         16 frame count           20 checkpoint interval
+// 24 checkpoint count    28 records offset        32 checkpoint index offset
+// 36 state hash count    40 state hashes offset   (version 2)
+//the header text is the same key/value block which starts a text movie, so both formats share installValue().
+//the index is (frame, offset, size) per checkpoint, and each offset points at a plain savestate.
+//the state hashes are a u64 per frame, from the first frame on.
+#define DSMB_VERSION 2
+#define DSMB_HEADER_SIZE 44
+#define DSMB_HEADER_SIZE_V1 36
+#define DSMB_RECORD_SIZE 6
+static const u32 kDSMB = 0x424D5344;
+
 #ifdef WIN32
 #include ".\windows\main.h"
 #endif
@@ -69,6 +86,10 @@ char curMovieFilename[512] = {0};
 MovieData currMovieData;
 int currRerecordCount;
 bool movie_reset_command = false;
+int movieDesyncFrame = -1;
+extern bool _HACK_NO_BOOT_SNAPSHOT; //movies are timed from a real power-on, not a cached one
+//set while a checkpoint savestate is being made, so that mov_savestate leaves the movie out of it
+static bool movie_checkpointing = false;
 //--------------
 
 
@@ -202,6 +223,7 @@ MovieData::MovieData()
 	, romChecksum(0)
 	, rerecordCount(0)
 	, binaryFlag(false)
+	, checkpointInterval(movieCheckpointInterval)
 	, rtcStart(FCEUI_MovieGetRTCDefault())
 {
 }
@@ -210,6 +232,12 @@ void MovieData::truncateAt(int frame)
 {
 	if((int)records.size() > frame)
 		records.resize(frame);
+
+	//a checkpoint past the end would restore a future that no longer exists
+	while(!checkpoints.empty() && checkpoints.back().frame > frame)
+		checkpoints.pop_back();
+	if((int)stateHashes.size() > frame)
+		stateHashes.resize(frame);
 }
 
 void MovieData::installValue(std::string& key, std::string& val)
@@ -279,6 +307,26 @@ void MovieData::installValue(std::string& key, std::string& val)
 
 
 int MovieData::dump(EMUFILE* fp, bool binary)
+{
+	int start = fp->ftell();
+	dumpHeader(fp, binary);
+
+	if(binary)
+	{
+		//put one | to start the binary dump
+		fp->fputc('|');
+		for(int i=0;i<(int)records.size();i++)
+			records[i].dumpBinary(fp);
+	}
+	else
+		for(int i=0;i<(int)records.size();i++)
+			records[i].dump(fp);
+
+	int end = fp->ftell();
+	return end-start;
+}
+
+int MovieData::dumpHeader(EMUFILE* fp, bool binary)
 {
 	int start = fp->ftell();
 	fp->fprintf("version %d\n", version);
@@ -334,17 +382,6 @@ int MovieData::dump(EMUFILE* fp, bool binary)
 	if(sram.size() != 0)
 		fp->fprintf("sram %s\n", BytesToString(&sram[0],sram.size()).c_str());
 
-	if(binary)
-	{
-		//put one | to start the binary dump
-		fp->fputc('|');
-		for(int i=0;i<(int)records.size();i++)
-			records[i].dumpBinary(fp);
-	}
-	else
-		for(int i=0;i<(int)records.size();i++)
-			records[i].dump(fp);
-
 	int end = fp->ftell();
 	return end-start;
 }
@@ -495,6 +532,7 @@ void FCEUI_StopMovie()
 
 	curMovieFilename[0] = 0;
 	freshMovie = false;
+	StateHash_Enable(false);
 }
 
 
@@ -536,7 +574,17 @@ const char* _CDECL_ FCEUI_LoadMovie(const char *fname, bool _read_only, bool tas
 		EMUFILE* fp = new EMUFILE_FILE(fname, "rb");
 //		if(fs.is_open())
 //		{
-			loadedfm2 = LoadFM2(currMovieData, fp, INT_MAX, false);
+			//binary movies announce themselves with a cookie; anything else is the text format
+			u32 cookie = 0;
+			read32le(&cookie,fp);
+			fp->fseek(0,SEEK_SET);
+			if(cookie == kDSMB)
+			{
+				loadedfm2 = LoadDSMB(currMovieData, fp);
+				currMovieData.checkpointFile = fname;
+			}
+			else
+				loadedfm2 = LoadFM2(currMovieData, fp, INT_MAX, false);
 			opened = true;
 //		}
 //		fs.close();
@@ -564,7 +612,9 @@ const char* _CDECL_ FCEUI_LoadMovie(const char *fname, bool _read_only, bool tas
 		NDS_CreateDummyFirmware(&CommonSettings.fw_config);
 	}
 
+	_HACK_NO_BOOT_SNAPSHOT = true;
 	NDS_Reset();
+	_HACK_NO_BOOT_SNAPSHOT = false;
 
 	////WE NEED TO LOAD A SAVESTATE
 	//if(currMovieData.savestate.size() != 0)
@@ -581,6 +631,8 @@ const char* _CDECL_ FCEUI_LoadMovie(const char *fname, bool _read_only, bool tas
 	pauseframe = _pauseframe;
 	movie_readonly = _read_only;
 	movieMode = MOVIEMODE_PLAY;
+	movieDesyncFrame = -1;
+	StateHash_Enable(currMovieData.stateHashes.size() != 0);
 	currRerecordCount = currMovieData.rerecordCount;
 	MMU_new.backupDevice.movie_mode();
 	if(currMovieData.sram.size() != 0)
@@ -601,6 +653,10 @@ const char* _CDECL_ FCEUI_LoadMovie(const char *fname, bool _read_only, bool tas
 
 static void openRecordingMovie(const char* fname)
 {
+	//recording rewrites the file, so pull in any checkpoints still living in it first
+	if(currMovieData.checkpointFile == fname)
+		currMovieData.fetchAllCheckpoints();
+
 	//osRecordingMovie = FCEUD_UTF8_fstream(fname, "wb");
 	osRecordingMovie = new EMUFILE_FILE(fname, "wb");
 	/*if(!osRecordingMovie)
@@ -679,7 +735,9 @@ void FCEUI_SaveMovie(const char *fname, std::wstring author, int flag, std::stri
 		NDS_CreateDummyFirmware(&CommonSettings.fw_config);
 	}
 
+	_HACK_NO_BOOT_SNAPSHOT = true;
 	NDS_Reset();
+	_HACK_NO_BOOT_SNAPSHOT = false;
 
 	//todo ?
 	//poweron(true);
@@ -701,6 +759,7 @@ void FCEUI_SaveMovie(const char *fname, std::wstring author, int flag, std::stri
 	movieMode = MOVIEMODE_RECORD;
 	movie_readonly = false;
 	currRerecordCount = 0;
+	StateHash_Enable(CommonSettings.movieStateHashing);
 	MMU_new.backupDevice.movie_mode();
 
 	if(currMovieData.sram.size() != 0)
@@ -722,8 +781,42 @@ void FCEUI_SaveMovie(const char *fname, std::wstring author, int flag, std::stri
 	 FCEUMOV_HandleRecording();
  }
 
+ //takes a checkpoint at the start of every checkpointInterval'th frame, before its input is applied
+ static void FCEUMOV_TakeCheckpoint()
+ {
+	 const int interval = currMovieData.checkpointInterval;
+	 if(interval <= 0 || (currFrameCounter % interval) != 0)
+		 return;
+	 if(currFrameCounter > (int)currMovieData.records.size())
+		 return;
+
+	 MovieData::Checkpoint* prev = currMovieData.findCheckpoint(currFrameCounter);
+	 if(prev && prev->frame == currFrameCounter)
+		 return;
+
+	 //the fastest zlib level keeps this cheap enough to do while playing; it is ignored without zlib
+	 EMUFILE_MEMORY ms;
+	 movie_checkpointing = true;
+	 bool ok = savestate_save(&ms, 1);
+	 movie_checkpointing = false;
+	 if(!ok)
+		 return;
+
+	 MovieData::Checkpoint cp;
+	 cp.frame = currFrameCounter;
+	 cp.offset = 0;
+	 cp.size = ms.size();
+	 cp.state.assign(ms.buf(), ms.buf() + ms.size());
+
+	 int at = prev ? (int)(prev - &currMovieData.checkpoints[0]) + 1 : 0;
+	 currMovieData.checkpoints.insert(currMovieData.checkpoints.begin() + at, cp);
+ }
+
  void FCEUMOV_HandlePlayback()
  {
+	 if(movieMode == MOVIEMODE_PLAY || movieMode == MOVIEMODE_RECORD)
+		 FCEUMOV_TakeCheckpoint();
+
 	 if(movieMode == MOVIEMODE_PLAY)
 	 {
 		 //stop when we run out of frames
@@ -768,6 +861,7 @@ void FCEUI_SaveMovie(const char *fname, std::wstring author, int flag, std::stri
 	 if(movieMode == MOVIEMODE_RECORD)
 	 {
 		 MovieRecord mr;
+		 mr.clear();
 		 const UserInput &input = NDS_getFinalUserInput();
 		 DesmumeInputToReplayRec(input, &mr);
 
@@ -790,6 +884,35 @@ void FCEUI_SaveMovie(const char *fname, std::wstring author, int flag, std::stri
 	 memcpy(&cur_input_display,joy,4);*/
  }
 
+ //called at the end of each frame while state hashing is on: records the frame's hash, or checks it
+ void FCEUMOV_HandleStateHash()
+ {
+	 const int frame = currFrameCounter - 1;
+	 if(frame < 0)
+		 return;
+	 const u64 hash = StateHash_Get();
+
+	 if(movieMode == MOVIEMODE_RECORD)
+	 {
+		 if((int)currMovieData.stateHashes.size() <= frame)
+			 currMovieData.stateHashes.resize(frame+1, 0);
+		 currMovieData.stateHashes[frame] = hash;
+	 }
+	 else if(movieMode == MOVIEMODE_PLAY && movieDesyncFrame < 0)
+	 {
+		 if(frame >= (int)currMovieData.stateHashes.size())
+			 return;
+		 const u64 expected = currMovieData.stateHashes[frame];
+		 if(expected == 0 || expected == hash)
+			 return;
+
+		 movieDesyncFrame = frame;
+		 char msg[64];
+		 sprintf(msg, "Movie desynced at frame %d.", frame);
+		 driver->USR_InfoMessage(msg);
+	 }
+ }
+
 
 //TODO 
 static void FCEUMOV_AddCommand(int cmd)
@@ -807,6 +930,7 @@ static void FCEUMOV_AddCommand(int cmd)
 //little endian 4-byte cookies
 static const int kMOVI = 0x49564F4D;
 static const int kNOMO = 0x4F4D4F4E;
+static const int kCKPT = 0x54504B43;
 
 void mov_savestate(EMUFILE* fp)
 {
@@ -814,7 +938,12 @@ void mov_savestate(EMUFILE* fp)
 	//if(movieMode == MOVIEMODE_RECORD || movieMode == MOVIEMODE_PLAY)
 	//	return currMovieData.dump(os, true);
 	//else return 0;
-	if(movieMode != MOVIEMODE_INACTIVE)
+	if(movie_checkpointing)
+	{
+		//a checkpoint is stored inside the movie it belongs to, so it doesn't need another copy of it
+		write32le(kCKPT,fp);
+	}
+	else if(movieMode != MOVIEMODE_INACTIVE)
 	{
 		write32le(kMOVI,fp);
 		currMovieData.dump(fp, true);
@@ -867,6 +996,12 @@ bool mov_loadstate(EMUFILE* fp, int size)
 			FinishPlayback();
 		return true;
 	}
+	else if(cookie == kCKPT)
+	{
+		//only FCEUI_MovieSeek loads these, and it keeps the current movie and mode as they are
+		load_successful = true;
+		return true;
+	}
 	else if(cookie != kMOVI)
 		return false;
 
@@ -972,6 +1107,7 @@ bool mov_loadstate(EMUFILE* fp, int size)
 
 		if(!movie_readonly)
 		{
+			tempMovieData.adoptCheckpoints(currMovieData);
 			currMovieData = tempMovieData;
 			currMovieData.rerecordCount = currRerecordCount;
 		}
@@ -1076,7 +1212,7 @@ bool FCEUI_MovieGetInfo(EMUFILE* fp, MOVIE_INFO& info, bool skipFrameCount)
 bool MovieRecord::parseBinary(EMUFILE* fp)
 {
 	commands=fp->fgetc();
-	fp->fread((char *) &pad, sizeof pad);
+	fp->read16le(&pad);
 	fp->fread((char *) &touch.x, sizeof touch.x);
 	fp->fread((char *) &touch.y, sizeof touch.y);
 	fp->fread((char *) &touch.touch, sizeof touch.touch);
@@ -1087,19 +1223,41 @@ bool MovieRecord::parseBinary(EMUFILE* fp)
 void MovieRecord::dumpBinary(EMUFILE* fp)
 {
 	fp->fputc(this->commands);
-	fp->fwrite((char *) &this->pad, sizeof(this->pad));
+	fp->write16le(this->pad);
 	fp->fwrite((char *) &this->touch.x, sizeof(this->touch.x));
 	fp->fwrite((char *) &this->touch.y, sizeof(this->touch.y));
 	fp->fwrite((char *) &this->touch.touch, sizeof(this->touch.touch));
 }
 
+//one binary record: the commands, the pad as a little endian u16, then the touch x, y and flag.
+//the binary chunk of a text movie and the records of a .dsmb file are both laid out this way
+static void packRecordDSMB(u8* dst, const MovieRecord& mr)
+{
+	dst[0] = mr.commands;
+	dst[1] = mr.pad & 0xFF;
+	dst[2] = mr.pad >> 8;
+	dst[3] = mr.touch.x;
+	dst[4] = mr.touch.y;
+	dst[5] = mr.touch.touch;
+}
+
+static void unpackRecordDSMB(const u8* src, MovieRecord& mr)
+{
+	mr.clear();
+	mr.commands = src[0];
+	mr.pad = src[1] | (src[2] << 8);
+	mr.touch.x = src[3];
+	mr.touch.y = src[4];
+	mr.touch.touch = src[5];
+}
+
 void LoadFM2_binarychunk(MovieData& movieData, EMUFILE* fp, int size)
 {
 	int recordsize = 1; //1 for the command
 
 	recordsize = 6;
 
-	assert(size%6==0);
+	//size is only a limit (FCEUI_LoadMovie passes INT_MAX less the header), so it needn't be a whole number of records
 
 	//find out how much remains in the file
 	int curr = fp->ftell();
@@ -1114,10 +1272,300 @@ void LoadFM2_binarychunk(MovieData& movieData, EMUFILE* fp, int size)
 	int numRecords = todo/recordsize;
 	//printf("LOADED MOVIE: %d records; currFrameCounter: %d\n",numRecords,currFrameCounter);
 	movieData.records.resize(numRecords);
+	if(numRecords == 0)
+		return;
+
+	//read the whole chunk at once and split it up here; one fread per field is far too slow for long movies.
+	//this is the same layout parseBinary() reads
+	std::vector<u8> buf(numRecords*recordsize);
+	numRecords = fp->fread(&buf[0],buf.size()) / recordsize;
+	movieData.records.resize(numRecords);
 	for(int i=0;i<numRecords;i++)
+		unpackRecordDSMB(&buf[i*recordsize], movieData.records[i]);
+}
+
+int MovieData::dumpBinaryMovie(EMUFILE* fp)
+{
+	int start = fp->ftell();
+
+	//the fixed header is filled in last, once the offsets are known
+	fp->fseek(start+DSMB_HEADER_SIZE,SEEK_SET);
+	u32 textSize = dumpHeader(fp, false);
+
+	u32 recordsOffset = fp->ftell() - start;
+	if(records.size() != 0)
+	{
+		std::vector<u8> buf(records.size()*DSMB_RECORD_SIZE);
+		for(int i=0;i<(int)records.size();i++)
+			packRecordDSMB(&buf[i*DSMB_RECORD_SIZE], records[i]);
+		fp->fwrite(&buf[0],buf.size());
+	}
+
+	u32 hashesOffset = fp->ftell() - start;
+	if(stateHashes.size() != 0)
 	{
-		movieData.records[i].parseBinary(fp);
+		std::vector<u8> buf(stateHashes.size()*8);
+		for(int i=0;i<(int)stateHashes.size();i++)
+			for(int b=0;b<8;b++)
+				buf[i*8+b] = (u8)(stateHashes[i] >> (b*8));
+		fp->fwrite(&buf[0],buf.size());
 	}
+
+	//checkpoints we can't get at anymore are simply left out
+	std::vector<Checkpoint*> keep;
+	for(int i=0;i<(int)checkpoints.size();i++)
+		if(fetchCheckpoint(checkpoints[i]))
+			keep.push_back(&checkpoints[i]);
+
+	u32 indexOffset = fp->ftell() - start;
+	u32 stateOffset = indexOffset + keep.size()*12;
+	for(int i=0;i<(int)keep.size();i++)
+	{
+		fp->write32le((u32)keep[i]->frame);
+		fp->write32le(stateOffset);
+		fp->write32le((u32)keep[i]->state.size());
+		stateOffset += keep[i]->state.size();
+	}
+	for(int i=0;i<(int)keep.size();i++)
+		fp->fwrite(&keep[i]->state[0],keep[i]->state.size());
+
+	int end = fp->ftell();
+
+	fp->fseek(start,SEEK_SET);
+	fp->write32le(kDSMB);
+	fp->write32le((u32)DSMB_VERSION);
+	fp->write32le(textSize);
+	fp->write32le((u32)DSMB_RECORD_SIZE);
+	fp->write32le((u32)records.size());
+	fp->write32le((u32)std::max(checkpointInterval,0));
+	fp->write32le((u32)keep.size());
+	fp->write32le(recordsOffset);
+	fp->write32le(indexOffset);
+	fp->write32le((u32)stateHashes.size());
+	fp->write32le(hashesOffset);
+	fp->fseek(end,SEEK_SET);
+
+	return end-start;
+}
+
+bool LoadDSMB(MovieData& movieData, EMUFILE* fp)
+{
+	int start = fp->ftell();
+	u32 header[DSMB_HEADER_SIZE/4] = {0};
+	for(int i=0;i<DSMB_HEADER_SIZE_V1/4;i++)
+		if(read32le(&header[i],fp) != 1)
+			return false;
+
+	if(header[0] != kDSMB || header[1] < 1 || header[1] > DSMB_VERSION || header[3] != DSMB_RECORD_SIZE)
+		return false;
+
+	//version 1 had no state hashes
+	if(header[1] >= 2)
+		for(int i=DSMB_HEADER_SIZE_V1/4;i<DSMB_HEADER_SIZE/4;i++)
+			if(read32le(&header[i],fp) != 1)
+				return false;
+
+	const u32 textSize = header[2];
+	const u32 numRecords = header[4];
+	const u32 numCheckpoints = header[6];
+	const u32 recordsOffset = header[7];
+	const u32 indexOffset = header[8];
+	const u32 numHashes = header[9];
+	const u32 hashesOffset = header[10];
+	const u64 avail = fp->size() - start;
+	const u32 headerSize = (header[1] >= 2) ? DSMB_HEADER_SIZE : DSMB_HEADER_SIZE_V1;
+	if((u64)headerSize + textSize > avail
+		|| (u64)recordsOffset + (u64)numRecords*DSMB_RECORD_SIZE > avail
+		|| (u64)indexOffset + (u64)numCheckpoints*12 > avail
+		|| (u64)hashesOffset + (u64)numHashes*8 > avail)
+		return false;
+
+	//the header text is an ordinary text movie header
+	if(!LoadFM2(movieData, fp, textSize, true))
+		return false;
+
+	//the records are fixed size, so they come in with a single read
+	movieData.records.resize(numRecords);
+	if(numRecords != 0)
+	{
+		std::vector<u8> buf(numRecords*DSMB_RECORD_SIZE);
+		fp->fseek(start+recordsOffset,SEEK_SET);
+		if(fp->fread(&buf[0],buf.size()) != buf.size())
+			return false;
+		for(u32 i=0;i<numRecords;i++)
+			unpackRecordDSMB(&buf[i*DSMB_RECORD_SIZE], movieData.records[i]);
+	}
+
+	movieData.stateHashes.resize(numHashes);
+	if(numHashes != 0)
+	{
+		std::vector<u8> buf(numHashes*8);
+		fp->fseek(start+hashesOffset,SEEK_SET);
+		if(fp->fread(&buf[0],buf.size()) != buf.size())
+			return false;
+		for(u32 i=0;i<numHashes;i++)
+		{
+			u64 hash = 0;
+			for(int b=7;b>=0;b--)
+				hash = (hash << 8) | buf[i*8+b];
+			movieData.stateHashes[i] = hash;
+		}
+	}
+
+	//only the index is read here. the savestates stay in the file until a seek needs one
+	movieData.checkpointInterval = header[5];
+	movieData.checkpoints.clear();
+	fp->fseek(start+indexOffset,SEEK_SET);
+	for(u32 i=0;i<numCheckpoints;i++)
+	{
+		MovieData::Checkpoint cp;
+		u32 frame;
+		read32le(&frame,fp);
+		read32le(&cp.offset,fp);
+		read32le(&cp.size,fp);
+		cp.frame = frame;
+		cp.offset += start;
+		if((u64)cp.offset + cp.size > start + avail || frame > numRecords)
+			return false;
+		if(!movieData.checkpoints.empty() && movieData.checkpoints.back().frame >= cp.frame)
+			return false;
+		movieData.checkpoints.push_back(cp);
+	}
+
+	return true;
+}
+
+MovieData::Checkpoint* MovieData::findCheckpoint(int frame)
+{
+	//the last checkpoint at or before frame
+	int lo = 0, hi = checkpoints.size();
+	while(lo < hi)
+	{
+		int mid = (lo+hi)/2;
+		if(checkpoints[mid].frame <= frame)
+			lo = mid+1;
+		else
+			hi = mid;
+	}
+	return lo == 0 ? NULL : &checkpoints[lo-1];
+}
+
+bool MovieData::fetchCheckpoint(Checkpoint& cp)
+{
+	if(cp.state.size() != 0)
+		return true;
+	if(checkpointFile.empty() || cp.size == 0)
+		return false;
+
+	EMUFILE_FILE fp(checkpointFile,"rb");
+	if(fp.fail())
+		return false;
+	cp.state.resize(cp.size);
+	fp.fseek(cp.offset,SEEK_SET);
+	if(fp.fread(&cp.state[0],cp.size) != cp.size)
+	{
+		cp.state.clear();
+		return false;
+	}
+	return true;
+}
+
+void MovieData::fetchAllCheckpoints()
+{
+	for(int i=0;i<(int)checkpoints.size();)
+	{
+		if(fetchCheckpoint(checkpoints[i]))
+			i++;
+		else
+			checkpoints.erase(checkpoints.begin()+i);
+	}
+	checkpointFile.clear();
+}
+
+void MovieData::adoptCheckpoints(MovieData& other)
+{
+	//other's checkpoints are only good up to the first frame where the two timelines part ways
+	int same = 0;
+	const int len = std::min(records.size(), other.records.size());
+	while(same < len && records[same].Compare(other.records[same]))
+		same++;
+
+	checkpointInterval = other.checkpointInterval;
+	checkpointFile = other.checkpointFile;
+	checkpoints.clear();
+	for(int i=0;i<(int)other.checkpoints.size() && other.checkpoints[i].frame <= same;i++)
+		checkpoints.push_back(other.checkpoints[i]);
+
+	//the hash of frame i only depends on the input up to frame i
+	stateHashes.assign(other.stateHashes.begin(), other.stateHashes.begin() + std::min<size_t>(same, other.stateHashes.size()));
+}
+
+//writes the current movie out in either format
+bool FCEUI_ExportMovie(const char *fname, bool binary)
+{
+	//the checkpoints may live in the very file we are about to overwrite
+	if(currMovieData.checkpointFile == fname)
+		currMovieData.fetchAllCheckpoints();
+
+	EMUFILE_FILE fp(fname,"wb");
+	if(fp.fail())
+		return false;
+
+	if(binary)
+		currMovieData.dumpBinaryMovie(&fp);
+	else
+		currMovieData.dump(&fp, false);
+
+	return !fp.fail();
+}
+
+//moves playback to the start of the given frame: at most one checkpoint load followed by
+//up to checkpointInterval frames of replay (or a replay from power-on, if there are no checkpoints yet)
+bool FCEUI_MovieSeek(int frame)
+{
+	if(movieMode != MOVIEMODE_PLAY && movieMode != MOVIEMODE_FINISHED)
+		return false;
+	if(frame < 0 || frame > currMovieData.getNumRecords())
+		return false;
+
+	MovieData::Checkpoint* cp = currMovieData.findCheckpoint(frame);
+
+	//playing forward from where we are beats loading a checkpoint which is behind us
+	bool fromHere = currFrameCounter <= frame && (!cp || cp->frame <= currFrameCounter);
+	if(!fromHere)
+	{
+		if(cp && currMovieData.fetchCheckpoint(*cp))
+		{
+			EMUFILE_MEMORY ms(&cp->state);
+			if(!savestate_load(&ms))
+				return false;
+		}
+		else
+		{
+			//same power-on sequence as FCEUI_LoadMovie
+			movieMode = MOVIEMODE_INACTIVE;
+			if (!CommonSettings.UseExtFirmware)
+				NDS_CreateDummyFirmware(&CommonSettings.fw_config);
+			_HACK_NO_BOOT_SNAPSHOT = true;
+			NDS_Reset();
+			_HACK_NO_BOOT_SNAPSHOT = false;
+			MMU_new.backupDevice.movie_mode();
+			if(currMovieData.sram.size() != 0)
+				MovieData::loadSramFrom(&currMovieData.sram);
+		}
+	}
+
+	movieMode = MOVIEMODE_PLAY;
+	while(currFrameCounter < frame)
+	{
+		NDS_beginProcessingInput();
+		FCEUMOV_HandlePlayback();
+		NDS_endProcessingInput();
+		NDS_SkipNextFrame();
+		NDS_exec<false>();
+	}
+
+	return true;
 }
 
 #include <sstream>
@@ -155,6 +155,26 @@ public:
 	//was the frame data stored in binary?
 	bool binaryFlag;
 
+	//a savestate taken at the start of a frame, before that frame's input was applied.
+	//checkpoints read from a binary movie keep only their location in checkpointFile
+	//and are pulled in by fetchCheckpoint() the first time they are needed.
+	struct Checkpoint
+	{
+		int frame;
+		u32 offset, size;
+		std::vector<u8> state;
+	};
+
+	//sorted by frame
+	std::vector<Checkpoint> checkpoints;
+	//a checkpoint is taken every this many frames (0 disables them)
+	int checkpointInterval;
+	std::string checkpointFile;
+
+	//the state hash at the end of each frame, while hashing was on (0 where it wasn't).
+	//only binary movies keep them
+	std::vector<u64> stateHashes;
+
 	int getNumRecords() { return records.size(); }
 
 	class TDictionary : public std::map<std::string,std::string>
@@ -188,6 +208,12 @@ public:
 	void truncateAt(int frame);
 	void installValue(std::string& key, std::string& val);
 	int dump(EMUFILE* fp, bool binary);
+	int dumpHeader(EMUFILE* fp, bool binary);
+	int dumpBinaryMovie(EMUFILE* fp);
+	Checkpoint* findCheckpoint(int frame);
+	bool fetchCheckpoint(Checkpoint& cp);
+	void fetchAllCheckpoints();
+	void adoptCheckpoints(MovieData& other);
 	void clearRecordRange(int start, int len);
 	void insertEmpty(int at, int frames);
 	
@@ -214,6 +240,9 @@ extern EMOVIEMODE movieMode;		//adelikat: main needs this for frame counter disp
 extern MovieData currMovieData;		//adelikat: main needs this for frame counter display
 
 extern bool movie_reset_command;
+extern int movieCheckpointInterval;
+//the first frame whose state hash didn't match the movie's during this playback, or -1
+extern int movieDesyncFrame;
 
 bool FCEUI_MovieGetInfo(EMUFILE* fp, MOVIE_INFO& info, bool skipFrameCount);
 void FCEUI_SaveMovie(const char *fname, std::wstring author, int flag, std::string sramfname, const DateTime &rtcstart);
@@ -222,10 +251,14 @@ void FCEUI_StopMovie();
 void FCEUMOV_AddInputState();
 void FCEUMOV_HandlePlayback();
 void FCEUMOV_HandleRecording();
+void FCEUMOV_HandleStateHash();
 void mov_savestate(EMUFILE* fp);
 bool mov_loadstate(EMUFILE* fp, int size);
 void LoadFM2_binarychunk(MovieData& movieData, EMUFILE* fp, int size);
 bool LoadFM2(MovieData& movieData, EMUFILE* fp, int size, bool stopAfterHeader);
+bool LoadDSMB(MovieData& movieData, EMUFILE* fp);
+bool FCEUI_ExportMovie(const char *fname, bool binary);
+bool FCEUI_MovieSeek(int frame);
 extern bool movie_readonly;
 extern bool ShowInputDisplay;
 void FCEUI_MakeBackupMovie(bool dispMessage);
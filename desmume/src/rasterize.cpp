@@ -29,6 +29,7 @@
 #include "rasterize.h"
 
 #include <algorithm>
+#include <new>
 #include <assert.h>
 #include <math.h>
 #include <string.h>
@@ -76,6 +77,16 @@ template<typename T> T _max(T a, T b, T c, T d) { return max(_max(a,b,d),c); }
 static u8 modulate_table[64][64];
 static u8 decal_table[32][64][64];
 
+//the ways a poly can be pushed through the rasterizer.
+//a run of fully opaque polys can be drawn twice: once to work out which poly ends up owning each pixel,
+//and once more to texture and shade just those pixels. see SoftRasterizerRenderer::getDeferredPolyCount()
+enum RasterizerPass
+{
+	RasterizerPass_Full,		// depth test, shading and framebuffer writes all at once
+	RasterizerPass_Visibility,	// depth test and attribute writes only, remembering which poly won each pixel
+	RasterizerPass_Shade		// shading and color writes for just the pixels this poly won
+};
+
 ////optimized float floor useful in limited cases
 ////from http://www.stereopsis.com/FPU.html#convert
 ////(unfortunately, it relies on certain FPU register settings)
@@ -555,13 +566,42 @@ public:
 		}
 	}
 	
-	template<bool ISSHADOWPOLYGON>
+	FORCEINLINE void shadeFragment(const PolygonAttributes &polyAttr, float r, float g, float b, const float invu, const float invv, const float w, FragmentColor &shaderOutput)
+	{
+		//perspective-correct the colors
+		r = (r * w) + 0.5f;
+		g = (g * w) + 0.5f;
+		b = (b * w) + 0.5f;
+		
+		//this is a HACK: 
+		//we are being very sloppy with our interpolation precision right now
+		//and rather than fix it, i just want to clamp it
+		const FragmentColor srcColor = MakeFragmentColor(max<u8>(0x00, min<u32>(0x3F,u32floor(r))),
+														 max<u8>(0x00, min<u32>(0x3F,u32floor(g))),
+														 max<u8>(0x00, min<u32>(0x3F,u32floor(b))),
+														 polyAttr.alpha);
+		
+		//pixel shader
+		shade(polyAttr.polygonMode, srcColor, shaderOutput, invu * w, invv * w);
+	}
+	
+	template<bool ISSHADOWPOLYGON, int PASS>
 	FORCEINLINE void pixel(const PolygonAttributes &polyAttr, const size_t fragmentIndex, FragmentColor &dstColor, float r, float g, float b, float invu, float invv, float w, float z)
 	{
-		FragmentColor srcColor;
 		FragmentColor shaderOutput;
 		bool isOpaquePixel;
 		
+		if (PASS == RasterizerPass_Shade)
+		{
+			//everything but the color was settled by the visibility pass
+			if (this->_softRender->_deferredPolyOwner[fragmentIndex] == polynum)
+			{
+				shadeFragment(polyAttr, r, g, b, invu, invv, w, shaderOutput);
+				dstColor = shaderOutput;
+			}
+			return;
+		}
+		
 		u32 &dstAttributeDepth				= this->_softRender->_framebufferAttributes->depth[fragmentIndex];
 		u8 &dstAttributeOpaquePolyID		= this->_softRender->_framebufferAttributes->opaquePolyID[fragmentIndex];
 		u8 &dstAttributeTranslucentPolyID	= this->_softRender->_framebufferAttributes->translucentPolyID[fragmentIndex];
@@ -619,21 +659,19 @@ public:
 			}
 		}
 		
-		//perspective-correct the colors
-		r = (r * w) + 0.5f;
-		g = (g * w) + 0.5f;
-		b = (b * w) + 0.5f;
-		
-		//this is a HACK: 
-		//we are being very sloppy with our interpolation precision right now
-		//and rather than fix it, i just want to clamp it
-		srcColor = MakeFragmentColor(max<u8>(0x00, min<u32>(0x3F,u32floor(r))),
-									 max<u8>(0x00, min<u32>(0x3F,u32floor(g))),
-									 max<u8>(0x00, min<u32>(0x3F,u32floor(b))),
-									 polyAttr.alpha);
+		if (PASS == RasterizerPass_Visibility)
+		{
+			//the polys in this pass can't come out translucent or alpha tested away (see getDeferredPolyCount()),
+			//so these are the same writes that a full pass would make for an opaque pixel.
+			dstAttributeOpaquePolyID = polyAttr.polygonID;
+			dstAttributeIsTranslucentPoly = polyAttr.isTranslucent;
+			dstAttributeIsFogged = polyAttr.enableRenderFog;
+			dstAttributeDepth = newDepth;
+			this->_softRender->_deferredPolyOwner[fragmentIndex] = (u16)polynum;
+			goto done;
+		}
 		
-		//pixel shader
-		shade(polyAttr.polygonMode, srcColor, shaderOutput, invu * w, invv * w);
+		shadeFragment(polyAttr, r, g, b, invu, invv, w, shaderOutput);
 		
 		// handle alpha test
 		if ( shaderOutput.a == 0 ||
@@ -692,7 +730,7 @@ public:
 	}
 
 	//draws a single scanline
-	template <bool ISSHADOWPOLYGON>
+	template <bool ISSHADOWPOLYGON, int PASS>
 	FORCEINLINE void drawscanline(const PolygonAttributes &polyAttr, FragmentColor *dstColor, const size_t framebufferWidth, const size_t framebufferHeight, edge_fx_fl *pLeft, edge_fx_fl *pRight, bool lineHack)
 	{
 		int XStart = pLeft->X;
@@ -777,9 +815,15 @@ public:
 			width = framebufferWidth - x;
 		}
 		
+		//the shade pass only ever revisits pixels that the visibility pass already touched
+		if (PASS != RasterizerPass_Shade && width > 0 && this->_softRender->_isClearPending)
+		{
+			this->_softRender->ResolvePendingClear(pLeft->Y, x, x + width);
+		}
+		
 		while (width-- > 0)
 		{
-			pixel<ISSHADOWPOLYGON>(polyAttr, adr, dstColor[adr], color[0], color[1], color[2], u, v, 1.0f/invw, z);
+			pixel<ISSHADOWPOLYGON, PASS>(polyAttr, adr, dstColor[adr], color[0], color[1], color[2], u, v, 1.0f/invw, z);
 			adr++;
 			x++;
 
@@ -794,7 +838,7 @@ public:
 	}
 
 	//runs several scanlines, until an edge is finished
-	template<bool SLI, bool ISSHADOWPOLYGON>
+	template<bool SLI, bool ISSHADOWPOLYGON, int PASS>
 	void runscanlines(const PolygonAttributes &polyAttr, FragmentColor *dstColor, const size_t framebufferWidth, const size_t framebufferHeight, edge_fx_fl *left, edge_fx_fl *right, bool horizontal, bool lineHack)
 	{
 		//oh lord, hack city for edge drawing
@@ -807,13 +851,13 @@ public:
 		if (lineHack && left->Height == 0 && right->Height == 0 && left->Y<framebufferHeight && left->Y>=0)
 		{
 			bool draw = (!SLI || (left->Y & SLI_MASK) == SLI_VALUE);
-			if(draw) drawscanline<ISSHADOWPOLYGON>(polyAttr, dstColor, framebufferWidth, framebufferHeight, left,right,lineHack);
+			if(draw) drawscanline<ISSHADOWPOLYGON, PASS>(polyAttr, dstColor, framebufferWidth, framebufferHeight, left,right,lineHack);
 		}
 
 		while(Height--)
 		{
 			bool draw = (!SLI || (left->Y & SLI_MASK) == SLI_VALUE);
-			if(draw) drawscanline<ISSHADOWPOLYGON>(polyAttr, dstColor, framebufferWidth, framebufferHeight, left,right,lineHack);
+			if(draw) drawscanline<ISSHADOWPOLYGON, PASS>(polyAttr, dstColor, framebufferWidth, framebufferHeight, left,right,lineHack);
 			const int xl = left->X;
 			const int xr = right->X;
 			const int y = left->Y;
@@ -933,7 +977,7 @@ public:
 	//verts must be clockwise.
 	//I didnt reference anything for this algorithm but it seems like I've seen it somewhere before.
 	//Maybe it is like crow's algorithm
-	template<bool SLI, bool ISSHADOWPOLYGON>
+	template<bool SLI, bool ISSHADOWPOLYGON, int PASS>
 	void shape_engine(const PolygonAttributes &polyAttr, FragmentColor *dstColor, const size_t framebufferWidth, const size_t framebufferHeight, int type, const bool backwards, bool lineHack)
 	{
 		bool failure = false;
@@ -974,7 +1018,7 @@ public:
 				return;
 
 			bool horizontal = left.Y == right.Y;
-			runscanlines<SLI, ISSHADOWPOLYGON>(polyAttr, dstColor, framebufferWidth, framebufferHeight, &left, &right, horizontal, lineHack);
+			runscanlines<SLI, ISSHADOWPOLYGON, PASS>(polyAttr, dstColor, framebufferWidth, framebufferHeight, &left, &right, horizontal, lineHack);
 
 			//if we ran out of an edge, step to the next one
 			if (right.Height == 0)
@@ -993,31 +1037,20 @@ public:
 		}
 	}
 	
-	template<bool SLI>
-	FORCEINLINE void mainLoop()
+	//draws the clipped polys from firstPoly up to (but not including) lastPoly
+	template<bool SLI, int PASS>
+	void drawPolys(const size_t firstPoly, const size_t lastPoly, FragmentColor *dstColor, const size_t dstWidth, const size_t dstHeight)
 	{
-		const size_t polyCount = this->_softRender->_clippedPolyCount;
-		if (polyCount == 0)
-		{
-			return;
-		}
-		
-		FragmentColor *dstColor = this->_softRender->GetFramebuffer();
-		const size_t dstWidth = this->_softRender->GetFramebufferWidth();
-		const size_t dstHeight = this->_softRender->GetFramebufferHeight();
-		
-		lastTexKey = NULL;
-		
-		const GFX3D_Clipper::TClippedPoly &firstClippedPoly = this->_softRender->clippedPolys[0];
-		const POLY &firstPoly = *firstClippedPoly.poly;
-		PolygonAttributes polyAttr = firstPoly.getAttributes();
-		u32 lastPolyAttr = firstPoly.polyAttr;
-		u32 lastTexParams = firstPoly.texParam;
-		u32 lastTexPalette = firstPoly.texPalette;
-		sampler.setup(firstPoly.texParam);
+		const GFX3D_Clipper::TClippedPoly &firstClippedPoly = this->_softRender->clippedPolys[firstPoly];
+		const POLY &firstPolyRef = *firstClippedPoly.poly;
+		PolygonAttributes polyAttr = firstPolyRef.getAttributes();
+		u32 lastPolyAttr = firstPolyRef.polyAttr;
+		u32 lastTexParams = firstPolyRef.texParam;
+		u32 lastTexPalette = firstPolyRef.texPalette;
+		sampler.setup(firstPolyRef.texParam);
 
 		//iterate over polys
-		for (size_t i = 0; i < polyCount; i++)
+		for (size_t i = firstPoly; i < lastPoly; i++)
 		{
 			if (!RENDERER) _debug_thisPoly = (i == this->_softRender->_debug_drawClippedUserPoly);
 			if (!this->_softRender->polyVisible[i]) continue;
@@ -1049,14 +1082,71 @@ public:
 			
 			if (polyAttr.polygonMode == POLYGON_MODE_SHADOW)
 			{
-				shape_engine<SLI, true>(polyAttr, dstColor, dstWidth, dstHeight, type, !this->_softRender->polyBackfacing[i], (thePoly.vtxFormat & 4) && CommonSettings.GFX3D_LineHack);
+				shape_engine<SLI, true, PASS>(polyAttr, dstColor, dstWidth, dstHeight, type, !this->_softRender->polyBackfacing[i], (thePoly.vtxFormat & 4) && CommonSettings.GFX3D_LineHack);
 			}
 			else
 			{
-				shape_engine<SLI, false>(polyAttr, dstColor, dstWidth, dstHeight, type, !this->_softRender->polyBackfacing[i], (thePoly.vtxFormat & 4) && CommonSettings.GFX3D_LineHack);
+				shape_engine<SLI, false, PASS>(polyAttr, dstColor, dstWidth, dstHeight, type, !this->_softRender->polyBackfacing[i], (thePoly.vtxFormat & 4) && CommonSettings.GFX3D_LineHack);
 			}
 		}
 	}
+	
+	template<bool SLI>
+	void resolvePendingClear(const size_t dstWidth, const size_t dstHeight)
+	{
+		if (!this->_softRender->_isClearPending)
+		{
+			return;
+		}
+		
+		//whatever the polygons didn't draw over still needs the clear values
+		for (size_t y = 0; y < dstHeight; y++)
+		{
+			if (SLI && (y & SLI_MASK) != SLI_VALUE) continue;
+			this->_softRender->ResolvePendingClear(y, 0, dstWidth);
+		}
+	}
+	
+	template<bool SLI>
+	FORCEINLINE void mainLoop()
+	{
+		FragmentColor *dstColor = this->_softRender->GetFramebuffer();
+		const size_t dstWidth = this->_softRender->GetFramebufferWidth();
+		const size_t dstHeight = this->_softRender->GetFramebufferHeight();
+		
+		const size_t polyCount = this->_softRender->_clippedPolyCount;
+		if (polyCount == 0)
+		{
+			this->resolvePendingClear<SLI>(dstWidth, dstHeight);
+			return;
+		}
+		
+		lastTexKey = NULL;
+		
+		//the debug viewer always draws everything in one go
+		const size_t deferredPolyCount = (RENDERER) ? this->_softRender->_deferredPolyCount : 0;
+		
+		if (deferredPolyCount > 0)
+		{
+			//forget who owned our lines last frame
+			u16 *polyOwner = this->_softRender->_deferredPolyOwner;
+			for (size_t y = 0; y < dstHeight; y++)
+			{
+				if (SLI && (y & SLI_MASK) != SLI_VALUE) continue;
+				memset(polyOwner + (y * dstWidth), 0xFF, dstWidth * sizeof(u16));
+			}
+			
+			this->drawPolys<SLI, RasterizerPass_Visibility>(0, deferredPolyCount, dstColor, dstWidth, dstHeight);
+			this->drawPolys<SLI, RasterizerPass_Shade>(0, deferredPolyCount, dstColor, dstWidth, dstHeight);
+		}
+		
+		if (deferredPolyCount < polyCount)
+		{
+			this->drawPolys<SLI, RasterizerPass_Full>(deferredPolyCount, polyCount, dstColor, dstWidth, dstHeight);
+		}
+		
+		this->resolvePendingClear<SLI>(dstWidth, dstHeight);
+	}
 
 
 }; //rasterizerUnit
@@ -1111,6 +1201,22 @@ static void* SoftRasterizer_RunClearFramebuffer(void *arg)
 	return NULL;
 }
 
+static void* SoftRasterizer_RunClipping(void *arg)
+{
+	SoftRasterizerClipParams *params = (SoftRasterizerClipParams *)arg;
+	
+	if (params->useHighResInterpolate)
+	{
+		SoftRasterizerRenderer::clipPolyRange<true>(params->clipper, params->vertList, params->polyList, params->indexList, params->firstPoly, params->lastPoly);
+	}
+	else
+	{
+		SoftRasterizerRenderer::clipPolyRange<false>(params->clipper, params->vertList, params->polyList, params->indexList, params->firstPoly, params->lastPoly);
+	}
+	
+	return NULL;
+}
+
 static void* SoftRasterizer_RunRenderEdgeMarkAndFog(void *arg)
 {
 	SoftRasterizerPostProcessParams *params = (SoftRasterizerPostProcessParams *)arg;
@@ -1166,10 +1272,16 @@ SoftRasterizerRenderer::SoftRasterizerRenderer()
 	
 	_debug_drawClippedUserPoly = -1;
 	clippedPolys = clipper.clippedPolys = new GFX3D_Clipper::TClippedPoly[POLYLIST_SIZE*2];
+	clipParam = NULL;
 	
 	_stateSetupNeedsFinish = false;
 	_renderGeometryNeedsFinish = false;
 	_framebufferAttributes = NULL;
+	_deferredPolyCount = 0;
+	_deferredPolyOwner = NULL;
+	_clearTilePending = NULL;
+	_clearTilesPerLine = 0;
+	_isClearPending = false;
 	
 	if (!rasterizerUnitTasksInited)
 	{
@@ -1203,6 +1315,11 @@ SoftRasterizerRenderer::SoftRasterizerRenderer()
 			const size_t linesPerThread = _framebufferHeight / rasterizerCores;
 			postprocessParam = new SoftRasterizerPostProcessParams[rasterizerCores];
 			
+			//the clippers hold CACHE_ALIGN verts, which plain new[] doesn't promise to align
+			clipParam = (SoftRasterizerClipParams *)malloc_alignedCacheLine(rasterizerCores * sizeof(SoftRasterizerClipParams));
+			for (size_t i = 0; i < rasterizerCores; i++)
+				new (&clipParam[i]) SoftRasterizerClipParams;
+			
 			for (size_t i = 0; i < rasterizerCores; i++)
 			{
 				rasterizerUnit[i]._debug_thisPoly = false;
@@ -1244,8 +1361,22 @@ SoftRasterizerRenderer::~SoftRasterizerRenderer()
 	delete[] postprocessParam;
 	postprocessParam = NULL;
 	
+	if (clipParam != NULL)
+	{
+		for (size_t i = 0; i < rasterizerCores; i++)
+			clipParam[i].~SoftRasterizerClipParams();
+		free_aligned(clipParam);
+		clipParam = NULL;
+	}
+	
 	delete _framebufferAttributes;
 	_framebufferAttributes = NULL;
+	
+	delete[] _deferredPolyOwner;
+	_deferredPolyOwner = NULL;
+	
+	delete[] _clearTilePending;
+	_clearTilePending = NULL;
 }
 
 Render3DError SoftRasterizerRenderer::InitTables()
@@ -1271,11 +1402,11 @@ Render3DError SoftRasterizerRenderer::InitTables()
 }
 
 template<bool USEHIRESINTERPOLATE>
-size_t SoftRasterizerRenderer::performClipping(const VERTLIST *vertList, const POLYLIST *polyList, const INDEXLIST *indexList)
+size_t SoftRasterizerRenderer::clipPolyRange(GFX3D_Clipper &theClipper, const VERTLIST *vertList, const POLYLIST *polyList, const INDEXLIST *indexList, size_t firstPoly, size_t lastPoly)
 {
-	//submit all polys to clipper
-	clipper.reset();
-	for (size_t i = 0; i < polyList->count; i++)
+	//submit the polys to the clipper
+	theClipper.reset();
+	for (size_t i = firstPoly; i < lastPoly; i++)
 	{
 		const POLY &poly = polyList->list[indexList->list[i]];
 		const VERT *clipVerts[4] = {
@@ -1287,10 +1418,65 @@ size_t SoftRasterizerRenderer::performClipping(const VERTLIST *vertList, const P
 			:NULL
 		};
 		
-		clipper.clipPoly<USEHIRESINTERPOLATE>(poly, clipVerts);
+		theClipper.clipPoly<USEHIRESINTERPOLATE>(poly, clipVerts);
+	}
+	
+	return theClipper.clippedPolyCounter;
+}
+
+template<bool USEHIRESINTERPOLATE>
+size_t SoftRasterizerRenderer::performClipping(const VERTLIST *vertList, const POLYLIST *polyList, const INDEXLIST *indexList)
+{
+	return clipPolyRange<USEHIRESINTERPOLATE>(this->clipper, vertList, polyList, indexList, 0, polyList->count);
+}
+
+size_t SoftRasterizerRenderer::performClippingParallel(const VERTLIST *vertList, const POLYLIST *polyList, const INDEXLIST *indexList, bool useHighResInterpolate)
+{
+	//handing out work to the threads isn't free, so small scenes are clipped right here
+	static const size_t CLIP_MIN_POLYS_PER_THREAD = 128;
+	
+	const size_t polyCount = polyList->count;
+	size_t clipThreads = polyCount / CLIP_MIN_POLYS_PER_THREAD;
+	if (clipThreads > rasterizerCores)
+		clipThreads = rasterizerCores;
+	
+	if (clipThreads < 2)
+	{
+		return (useHighResInterpolate) ? this->performClipping<true>(vertList, polyList, indexList) : this->performClipping<false>(vertList, polyList, indexList);
+	}
+	
+	//each poly clips to at most one output poly, so every thread can write straight into
+	//the part of clippedPolys that lines up with its own range of input polys
+	for (size_t i = 0; i < clipThreads; i++)
+	{
+		SoftRasterizerClipParams &param = this->clipParam[i];
+		param.vertList = vertList;
+		param.polyList = polyList;
+		param.indexList = indexList;
+		param.firstPoly = i * polyCount / clipThreads;
+		param.lastPoly = (i + 1) * polyCount / clipThreads;
+		param.useHighResInterpolate = useHighResInterpolate;
+		param.clipper.clippedPolys = this->clippedPolys + param.firstPoly;
+		
+		rasterizerUnitTask[i].execute(&SoftRasterizer_RunClipping, &param);
+	}
+	
+	//then close up the gaps left by the polys that got clipped away, keeping everything in order
+	size_t clippedPolyCount = 0;
+	for (size_t i = 0; i < clipThreads; i++)
+	{
+		rasterizerUnitTask[i].finish();
+		
+		const SoftRasterizerClipParams &param = this->clipParam[i];
+		if (param.firstPoly != clippedPolyCount)
+		{
+			memmove(this->clippedPolys + clippedPolyCount, this->clippedPolys + param.firstPoly, param.clipper.clippedPolyCounter * sizeof(GFX3D_Clipper::TClippedPoly));
+		}
+		
+		clippedPolyCount += param.clipper.clippedPolyCounter;
 	}
 	
-	return clipper.clippedPolyCounter;
+	return clippedPolyCount;
 }
 
 template<bool CUSTOM> void SoftRasterizerRenderer::performViewportTransforms()
@@ -1454,6 +1640,47 @@ void SoftRasterizerRenderer::performBackfaceTests()
 	}
 }
 
+//works out how many of the clipped polys, from the start of the list, can go through the deferred
+//visibility and shading passes. that only works while a poly can't observe the colors drawn before it
+//and always writes an opaque fragment when it passes the depth test, so the run stops at the first
+//visible poly which is a shadow poly, isn't fully opaque, or has a texture which might be transparent.
+//since translucent polys are sorted after the opaque ones, this is usually all of the opaque polys.
+size_t SoftRasterizerRenderer::getDeferredPolyCount() const
+{
+	if (!CommonSettings.GFX3D_Renderer_DeferredTexturing || this->_deferredPolyOwner == NULL)
+	{
+		return 0;
+	}
+	
+	for (size_t i = 0; i < this->_clippedPolyCount; i++)
+	{
+		if (!this->polyVisible[i]) continue;
+		
+		const POLY &thePoly = *this->clippedPolys[i].poly;
+		const PolygonAttributes polyAttr = thePoly.getAttributes();
+		
+		if (polyAttr.polygonMode == POLYGON_MODE_SHADOW || polyAttr.alpha != 31 || polyAttr.isTranslucent)
+		{
+			return i;
+		}
+		
+		//the texels have to be opaque too, or else the alpha test can throw out a fragment
+		const u32 texFormat = (thePoly.texParam >> 26) & 7;
+		if (this->currentRenderState->enableTexturing && texFormat != TEXMODE_NONE)
+		{
+			const bool isPaletteFormat = (texFormat == TEXMODE_I2 || texFormat == TEXMODE_I4 || texFormat == TEXMODE_I8);
+			const bool isPalZeroTransparent = ( ((thePoly.texParam >> 29) & 1) != 0 );
+			
+			if (!isPaletteFormat || isPalZeroTransparent)
+			{
+				return i;
+			}
+		}
+	}
+	
+	return this->_clippedPolyCount;
+}
+
 Render3DError SoftRasterizerRenderer::BeginRender(const GFX3D &engine)
 {
 	if (rasterizerCores > 1)
@@ -1468,7 +1695,11 @@ Render3DError SoftRasterizerRenderer::BeginRender(const GFX3D &engine)
 	// Keep the current render states for later use
 	this->currentRenderState = (GFX3D_State *)&engine.renderState;
 	
-	if (CommonSettings.GFX3D_HighResolutionInterpolateColor)
+	if (rasterizerCores > 1)
+	{
+		this->_clippedPolyCount = this->performClippingParallel(engine.vertlist, engine.polylist, &engine.indexlist, CommonSettings.GFX3D_HighResolutionInterpolateColor);
+	}
+	else if (CommonSettings.GFX3D_HighResolutionInterpolateColor)
 	{
 		this->_clippedPolyCount = this->performClipping<true>(engine.vertlist, engine.polylist, &engine.indexlist);
 	}
@@ -1523,6 +1754,8 @@ Render3DError SoftRasterizerRenderer::RenderGeometry(const GFX3D_State &renderSt
 		this->_stateSetupNeedsFinish = false;
 	}
 	
+	this->_deferredPolyCount = this->getDeferredPolyCount();
+	
 	// Render the geometry
 	if (rasterizerCores > 1)
 	{
@@ -1742,63 +1975,161 @@ Render3DError SoftRasterizerRenderer::RenderFog(const u8 *densityTable, const u3
 	return RENDER3DERROR_NOERR;
 }
 
+void SoftRasterizerRenderer::RenderEdgeMarkingPixel(const size_t x, const size_t y, const size_t i)
+{
+	// this looks ok although it's still pretty much a hack,
+	// it needs to be redone with low-level accuracy at some point,
+	// but that should probably wait until the shape renderer is more accurate.
+	// a good test case for edge marking is Sonic Rush:
+	// - the edges are completely sharp/opaque on the very brief title screen intro,
+	// - the level-start intro gets a pseudo-antialiasing effect around the silhouette,
+	// - the character edges in-level are clearly transparent, and also show well through shield powerups.
+	
+	FragmentColor &dstColor = this->_framebufferColor[i];
+	const u32 depth = this->_framebufferAttributes->depth[i];
+	const u8 polyID = this->_framebufferAttributes->opaquePolyID[i];
+	
+	if (this->edgeMarkDisabled[polyID>>3] || this->_framebufferAttributes->isTranslucentPoly[i] != 0)
+		return;
+	
+#define PIXOFFSET(dx,dy) ((dx)+(this->_framebufferWidth*(dy)))
+#define ISEDGE(dx,dy) ((x+(dx) < this->_framebufferWidth) && (y+(dy) < this->_framebufferHeight) && polyID != this->_framebufferAttributes->opaquePolyID[i+PIXOFFSET(dx,dy)] && depth >= this->_framebufferAttributes->depth[i+PIXOFFSET(dx,dy)])
+#define DRAWEDGE(dx,dy) alphaBlend(dstColor, this->edgeMarkTable[this->_framebufferAttributes->opaquePolyID[i+PIXOFFSET(dx,dy)] >> 3])
+	
+	const bool up		= ISEDGE( 0,-1);
+	const bool left		= ISEDGE(-1, 0);
+	const bool right	= ISEDGE( 1, 0);
+	const bool down		= ISEDGE( 0, 1);
+	
+	if (right)			DRAWEDGE( 1, 0);
+	else if (down)		DRAWEDGE( 0, 1);
+	else if (left)		DRAWEDGE(-1, 0);
+	else if (up)		DRAWEDGE( 0,-1);
+	
+#undef PIXOFFSET
+#undef ISEDGE
+#undef DRAWEDGE
+}
+
 Render3DError SoftRasterizerRenderer::RenderEdgeMarkingAndFog(const SoftRasterizerPostProcessParams &param)
 {
-	for (size_t i = param.startLine * this->_framebufferWidth, y = param.startLine; y < param.endLine; y++)
+	const size_t w = this->_framebufferWidth;
+	const size_t h = this->_framebufferHeight;
+	
+	FragmentColor fogColor;
+	fogColor.color = COLOR555TO6665( param.fogColor & 0x7FFF, (param.fogColor>>16) & 0x1F );
+	
+#ifdef ENABLE_SSE2
+	const __m128i zero_vec128 = _mm_setzero_si128();
+	const __m128i fogColor_vec128 = _mm_unpacklo_epi8(_mm_set1_epi32(fogColor.color), zero_vec128);
+	
+	// In alpha-only mode, a fog factor of 0 leaves the RGB channels untouched.
+	const __m128i fogChannelMask_vec128 = (param.fogAlphaOnly) ? _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0) : _mm_set1_epi16(-1);
+#endif
+	
+	// Edge marking only reads the attributes of the neighboring pixels, never their
+	// colors, so it can run over a whole line before the fog does.
+	for (size_t y = param.startLine; y < param.endLine; y++)
 	{
-		for (size_t x = 0; x < this->_framebufferWidth; x++, i++)
+		const size_t lineIndex = y * w;
+		
+		// TODO: New edge marking algorithm which tests both polyID and depth, but only checks 4 surrounding pixels. Can we keep this one?
+		if (param.enableEdgeMarking)
 		{
-			FragmentColor &dstColor = this->_framebufferColor[i];
-			const u32 depth = this->_framebufferAttributes->depth[i];
-			const u8 polyID = this->_framebufferAttributes->opaquePolyID[i];
+			size_t x = 0;
 			
-			// TODO: New edge marking algorithm which tests both polyID and depth, but only checks 4 surrounding pixels. Can we keep this one?
-			if (param.enableEdgeMarking)
+#ifdef ENABLE_SSE2
+			// A pixel can only become an edge if one of its neighbors has a different
+			// polygon ID, so skip 16 pixels at a time wherever that isn't the case.
+			// The loads stray onto the neighboring lines at the ends of a line, which
+			// is harmless since that only ever sends pixels down the full test.
+			if (y > 0 && y < h - 1)
 			{
-				// this looks ok although it's still pretty much a hack,
-				// it needs to be redone with low-level accuracy at some point,
-				// but that should probably wait until the shape renderer is more accurate.
-				// a good test case for edge marking is Sonic Rush:
-				// - the edges are completely sharp/opaque on the very brief title screen intro,
-				// - the level-start intro gets a pseudo-antialiasing effect around the silhouette,
-				// - the character edges in-level are clearly transparent, and also show well through shield powerups.
-				
-				bool up = false;
-				bool left = false;
-				bool right = false;
-				bool down = false;
+				const size_t sseWidth = w - (w % 16);
 				
-#define PIXOFFSET(dx,dy) ((dx)+(this->_framebufferWidth*(dy)))
-#define ISEDGE(dx,dy) ((x+(dx) < this->_framebufferWidth) && (y+(dy) < this->_framebufferHeight) && polyID != this->_framebufferAttributes->opaquePolyID[i+PIXOFFSET(dx,dy)] && depth >= this->_framebufferAttributes->depth[i+PIXOFFSET(dx,dy)])
-#define DRAWEDGE(dx,dy) alphaBlend(dstColor, this->edgeMarkTable[this->_framebufferAttributes->opaquePolyID[i+PIXOFFSET(dx,dy)] >> 3])
-				
-				if (this->edgeMarkDisabled[polyID>>3] || this->_framebufferAttributes->isTranslucentPoly[i] != 0)
-					goto END_EDGE_MARK;
-				
-				up		= ISEDGE( 0,-1);
-				left	= ISEDGE(-1, 0);
-				right	= ISEDGE( 1, 0);
-				down	= ISEDGE( 0, 1);
-				
-				if (right)			DRAWEDGE( 1, 0);
-				else if (down)		DRAWEDGE( 0, 1);
-				else if (left)		DRAWEDGE(-1, 0);
-				else if (up)		DRAWEDGE( 0,-1);
+				for (; x < sseWidth; x += 16)
+				{
+					const size_t i = lineIndex + x;
+					const u8 *polyID = this->_framebufferAttributes->opaquePolyID + i;
+					const __m128i polyID_vec128 = _mm_loadu_si128((__m128i *)polyID);
+					
+					__m128i sameID = _mm_cmpeq_epi8(polyID_vec128, _mm_loadu_si128((__m128i *)(polyID - 1)));
+					sameID = _mm_and_si128(sameID, _mm_cmpeq_epi8(polyID_vec128, _mm_loadu_si128((__m128i *)(polyID + 1))));
+					sameID = _mm_and_si128(sameID, _mm_cmpeq_epi8(polyID_vec128, _mm_loadu_si128((__m128i *)(polyID - w))));
+					sameID = _mm_and_si128(sameID, _mm_cmpeq_epi8(polyID_vec128, _mm_loadu_si128((__m128i *)(polyID + w))));
+					
+					if (_mm_movemask_epi8(sameID) == 0xFFFF)
+					{
+						continue;
+					}
+					
+					for (size_t j = 0; j < 16; j++)
+					{
+						this->RenderEdgeMarkingPixel(x + j, y, i + j);
+					}
+				}
+			}
+#endif
+			
+			for (; x < w; x++)
+			{
+				this->RenderEdgeMarkingPixel(x, y, lineIndex + x);
+			}
+		}
+		
+		if (param.enableFog)
+		{
+			size_t x = 0;
+			
+#ifdef ENABLE_SSE2
+			const size_t sseWidth = w - (w % 8);
+			
+			for (; x < sseWidth; x += 8)
+			{
+				const size_t i = lineIndex + x;
+				u8 fog[8];
 				
+				for (size_t j = 0; j < 8; j++)
+				{
+					const size_t fogIndex = this->_framebufferAttributes->depth[i+j] >> 9;
+					assert(fogIndex < 32768);
+					fog[j] = (this->_framebufferAttributes->isFogged[i+j] != 0) ? this->fogTable[fogIndex] : 0;
+				}
 				
-#undef PIXOFFSET
-#undef ISEDGE
-#undef DRAWEDGE
+				if ( (fog[0] | fog[1] | fog[2] | fog[3] | fog[4] | fog[5] | fog[6] | fog[7]) == 0 )
+				{
+					continue;
+				}
 				
-END_EDGE_MARK: ;
+				// Each 16-bit lane holds one channel, two pixels per register. The intermediate
+				// values fit in 16 bits, and masking to the low byte before packing keeps the
+				// same truncation as the scalar code for out-of-range fog densities.
+				for (size_t j = 0; j < 8; j += 4)
+				{
+					__m128i *dst = (__m128i *)(this->_framebufferColor + i + j);
+					const __m128i dst_vec128 = _mm_loadu_si128(dst);
+					
+					const __m128i fogLo = _mm_and_si128(_mm_set_epi16(fog[j+1], fog[j+1], fog[j+1], fog[j+1], fog[j+0], fog[j+0], fog[j+0], fog[j+0]), fogChannelMask_vec128);
+					const __m128i fogHi = _mm_and_si128(_mm_set_epi16(fog[j+3], fog[j+3], fog[j+3], fog[j+3], fog[j+2], fog[j+2], fog[j+2], fog[j+2]), fogChannelMask_vec128);
+					
+					__m128i outLo = _mm_mullo_epi16(_mm_sub_epi16(_mm_set1_epi16(128), fogLo), _mm_unpacklo_epi8(dst_vec128, zero_vec128));
+					__m128i outHi = _mm_mullo_epi16(_mm_sub_epi16(_mm_set1_epi16(128), fogHi), _mm_unpackhi_epi8(dst_vec128, zero_vec128));
+					outLo = _mm_srai_epi16(_mm_add_epi16(outLo, _mm_mullo_epi16(fogColor_vec128, fogLo)), 7);
+					outHi = _mm_srai_epi16(_mm_add_epi16(outHi, _mm_mullo_epi16(fogColor_vec128, fogHi)), 7);
+					
+					outLo = _mm_and_si128(outLo, _mm_set1_epi16(0x00FF));
+					outHi = _mm_and_si128(outHi, _mm_set1_epi16(0x00FF));
+					_mm_storeu_si128(dst, _mm_packus_epi16(outLo, outHi));
+				}
 			}
+#endif
 			
-			if (param.enableFog)
+			for (; x < w; x++)
 			{
-				FragmentColor fogColor;
-				fogColor.color = COLOR555TO6665( param.fogColor & 0x7FFF, (param.fogColor>>16) & 0x1F );
+				const size_t i = lineIndex + x;
+				FragmentColor &dstColor = this->_framebufferColor[i];
 				
-				const size_t fogIndex = depth >> 9;
+				const size_t fogIndex = this->_framebufferAttributes->depth[i] >> 9;
 				assert(fogIndex < 32768);
 				const u8 fog = (this->_framebufferAttributes->isFogged[i] != 0) ? this->fogTable[fogIndex] : 0;
 				
@@ -1851,18 +2182,62 @@ Render3DError SoftRasterizerRenderer::ClearUsingImage(const u16 *__restrict colo
 		}
 	}
 	
+	this->_isClearPending = false;
+	memset(this->_clearTilePending, 0, this->_clearTilesPerLine * this->_framebufferHeight);
+	
 	return RENDER3DERROR_NOERR;
 }
 
 Render3DError SoftRasterizerRenderer::ClearUsingValues(const FragmentColor &clearColor6665, const FragmentAttributes &clearAttributes) const
 {
-	for (size_t i = 0; i < (this->_framebufferWidth * this->_framebufferHeight); i++)
+	// Don't touch the framebuffer yet. The rasterizer units fill in each span of
+	// their own lines when they first draw into it, and the rest once they're done.
+	this->_pendingClearColor = clearColor6665;
+	this->_pendingClearAttributes = clearAttributes;
+	memset(this->_clearTilePending, 1, this->_clearTilesPerLine * this->_framebufferHeight);
+	this->_isClearPending = true;
+	
+	return RENDER3DERROR_NOERR;
+}
+
+void SoftRasterizerRenderer::ApplyClearValues(const size_t startIndex, const size_t pixCount)
+{
+	for (size_t i = startIndex; i < startIndex + pixCount; i++)
 	{
-		this->_framebufferAttributes->SetAtIndex(i, clearAttributes);
-		this->_framebufferColor[i] = clearColor6665;
+		this->_framebufferAttributes->SetAtIndex(i, this->_pendingClearAttributes);
+		this->_framebufferColor[i] = this->_pendingClearColor;
 	}
+}
+
+void SoftRasterizerRenderer::ResolvePendingClear(const size_t y, const size_t xStart, const size_t xEnd)
+{
+	u8 *linePending = this->_clearTilePending + (y * this->_clearTilesPerLine);
+	const size_t lastTile = (xEnd + SOFTRASTERIZER_CLEAR_TILE_WIDTH - 1) / SOFTRASTERIZER_CLEAR_TILE_WIDTH;
+	size_t tile = xStart / SOFTRASTERIZER_CLEAR_TILE_WIDTH;
 	
-	return RENDER3DERROR_NOERR;
+	while (tile < lastTile)
+	{
+		if (linePending[tile] == 0)
+		{
+			tile++;
+			continue;
+		}
+		
+		// Fill neighboring pending spans in one go.
+		size_t runEnd = tile + 1;
+		while (runEnd < lastTile && linePending[runEnd] != 0)
+		{
+			runEnd++;
+		}
+		
+		memset(linePending + tile, 0, runEnd - tile);
+		
+		const size_t pixStart = tile * SOFTRASTERIZER_CLEAR_TILE_WIDTH;
+		const size_t pixEnd = min<size_t>(runEnd * SOFTRASTERIZER_CLEAR_TILE_WIDTH, this->_framebufferWidth);
+		this->ApplyClearValues((y * this->_framebufferWidth) + pixStart, pixEnd - pixStart);
+		
+		tile = runEnd;
+	}
 }
 
 Render3DError SoftRasterizerRenderer::Reset()
@@ -1987,6 +2362,15 @@ Render3DError SoftRasterizerRenderer::SetFramebufferSize(size_t w, size_t h)
 	delete this->_framebufferAttributes;
 	this->_framebufferAttributes = new FragmentAttributesBuffer(w * h);
 	
+	delete[] this->_deferredPolyOwner;
+	this->_deferredPolyOwner = new u16[w * h];
+	
+	this->_clearTilesPerLine = (w + SOFTRASTERIZER_CLEAR_TILE_WIDTH - 1) / SOFTRASTERIZER_CLEAR_TILE_WIDTH;
+	delete[] this->_clearTilePending;
+	this->_clearTilePending = new u8[this->_clearTilesPerLine * h];
+	memset(this->_clearTilePending, 0, this->_clearTilesPerLine * h);
+	this->_isClearPending = false;
+	
 	if (rasterizerCores == 0 || rasterizerCores == 1)
 	{
 		postprocessParam[0].startLine = 0;
@@ -2008,8 +2392,11 @@ Render3DError SoftRasterizerRenderer::SetFramebufferSize(size_t w, size_t h)
 
 #ifdef ENABLE_SSE2
 
-Render3DError SoftRasterizerRenderer_SSE2::ClearUsingValues(const FragmentColor &clearColor6665, const FragmentAttributes &clearAttributes) const
+void SoftRasterizerRenderer_SSE2::ApplyClearValues(const size_t startIndex, const size_t pixCount)
 {
+	const FragmentColor &clearColor6665 = this->_pendingClearColor;
+	const FragmentAttributes &clearAttributes = this->_pendingClearAttributes;
+	
 	const __m128i color_vec128					= _mm_set1_epi32(clearColor6665.color);
 	const __m128i attrDepth_vec128				= _mm_set1_epi32(clearAttributes.depth);
 	const __m128i attrOpaquePolyID_vec128		= _mm_set1_epi8(clearAttributes.opaquePolyID);
@@ -2018,39 +2405,39 @@ Render3DError SoftRasterizerRenderer_SSE2::ClearUsingValues(const FragmentColor
 	const __m128i attrIsFogged_vec128			= _mm_set1_epi8(clearAttributes.isFogged);
 	const __m128i attrIsTranslucentPoly_vec128	= _mm_set1_epi8(clearAttributes.isTranslucentPoly);
 	
-	size_t i = 0;
-	const size_t pixCount = this->_framebufferWidth * this->_framebufferHeight;
-	const size_t ssePixCount = pixCount - (pixCount % 16);
+	// Use regular stores instead of streaming ones, since the span is usually about
+	// to be drawn into. Spans are only aligned if the framebuffer width is.
+	size_t i = startIndex;
+	const size_t endIndex = startIndex + pixCount;
+	const size_t sseEndIndex = endIndex - (pixCount % 16);
 	
-	for (; i < ssePixCount; i += 16)
+	for (; i < sseEndIndex; i += 16)
 	{
-		_mm_stream_si128((__m128i *)(this->_framebufferColor + i +  0), color_vec128);
-		_mm_stream_si128((__m128i *)(this->_framebufferColor + i +  4), color_vec128);
-		_mm_stream_si128((__m128i *)(this->_framebufferColor + i +  8), color_vec128);
-		_mm_stream_si128((__m128i *)(this->_framebufferColor + i + 12), color_vec128);
+		_mm_storeu_si128((__m128i *)(this->_framebufferColor + i +  0), color_vec128);
+		_mm_storeu_si128((__m128i *)(this->_framebufferColor + i +  4), color_vec128);
+		_mm_storeu_si128((__m128i *)(this->_framebufferColor + i +  8), color_vec128);
+		_mm_storeu_si128((__m128i *)(this->_framebufferColor + i + 12), color_vec128);
 		
-		_mm_stream_si128((__m128i *)(this->_framebufferAttributes->depth + i +  0), attrDepth_vec128);
-		_mm_stream_si128((__m128i *)(this->_framebufferAttributes->depth + i +  4), attrDepth_vec128);
-		_mm_stream_si128((__m128i *)(this->_framebufferAttributes->depth + i +  8), attrDepth_vec128);
-		_mm_stream_si128((__m128i *)(this->_framebufferAttributes->depth + i + 12), attrDepth_vec128);
+		_mm_storeu_si128((__m128i *)(this->_framebufferAttributes->depth + i +  0), attrDepth_vec128);
+		_mm_storeu_si128((__m128i *)(this->_framebufferAttributes->depth + i +  4), attrDepth_vec128);
+		_mm_storeu_si128((__m128i *)(this->_framebufferAttributes->depth + i +  8), attrDepth_vec128);
+		_mm_storeu_si128((__m128i *)(this->_framebufferAttributes->depth + i + 12), attrDepth_vec128);
 		
-		_mm_stream_si128((__m128i *)(this->_framebufferAttributes->opaquePolyID + i), attrOpaquePolyID_vec128);
-		_mm_stream_si128((__m128i *)(this->_framebufferAttributes->translucentPolyID + i), attrTranslucentPolyID_vec128);
-		_mm_stream_si128((__m128i *)(this->_framebufferAttributes->stencil + i), attrStencil_vec128);
-		_mm_stream_si128((__m128i *)(this->_framebufferAttributes->isFogged + i), attrIsFogged_vec128);
-		_mm_stream_si128((__m128i *)(this->_framebufferAttributes->isTranslucentPoly + i), attrIsTranslucentPoly_vec128);
+		_mm_storeu_si128((__m128i *)(this->_framebufferAttributes->opaquePolyID + i), attrOpaquePolyID_vec128);
+		_mm_storeu_si128((__m128i *)(this->_framebufferAttributes->translucentPolyID + i), attrTranslucentPolyID_vec128);
+		_mm_storeu_si128((__m128i *)(this->_framebufferAttributes->stencil + i), attrStencil_vec128);
+		_mm_storeu_si128((__m128i *)(this->_framebufferAttributes->isFogged + i), attrIsFogged_vec128);
+		_mm_storeu_si128((__m128i *)(this->_framebufferAttributes->isTranslucentPoly + i), attrIsTranslucentPoly_vec128);
 	}
 	
 #ifdef ENABLE_SSE2
 #pragma LOOPVECTORIZE_DISABLE
 #endif
-	for (; i < pixCount; i++)
+	for (; i < endIndex; i++)
 	{
 		this->_framebufferColor[i] = clearColor6665;
 		this->_framebufferAttributes->SetAtIndex(i, clearAttributes);
 	}
-	
-	return RENDER3DERROR_NOERR;
 }
 
 #endif // ENABLE_SSE2
@@ -23,6 +23,12 @@
 
 #define SOFTRASTERIZER_DEPTH_EQUAL_TEST_TOLERANCE 0x200
 
+// Clear values are applied lazily in spans of this many pixels on a single line,
+// either when a polygon first draws into the span or when the rasterizer unit
+// that owns the line finishes. Spans never straddle lines, so each one belongs
+// to exactly one rasterizer unit.
+#define SOFTRASTERIZER_CLEAR_TILE_WIDTH 32
+
 extern GPU3DInterface gpu3DRasterize;
 
 class TexCacheItem;
@@ -39,6 +45,17 @@ struct SoftRasterizerPostProcessParams
 	bool fogAlphaOnly;
 };
 
+struct SoftRasterizerClipParams
+{
+	GFX3D_Clipper clipper;
+	const VERTLIST *vertList;
+	const POLYLIST *polyList;
+	const INDEXLIST *indexList;
+	size_t firstPoly;
+	size_t lastPoly;
+	bool useHighResInterpolate;
+};
+
 #if defined(ENABLE_SSE2)
 class SoftRasterizerRenderer : public Render3D_SSE2
 #else
@@ -54,10 +71,17 @@ protected:
 	bool _stateSetupNeedsFinish;
 	bool _renderGeometryNeedsFinish;
 	
+	// The clear is only recorded here; ClearUsingValues() is const in the base class.
+	mutable FragmentColor _pendingClearColor;
+	mutable FragmentAttributes _pendingClearAttributes;
+	
 	// SoftRasterizer-specific methods
 	virtual Render3DError InitTables();
+	virtual void ApplyClearValues(const size_t startIndex, const size_t pixCount);
+	void RenderEdgeMarkingPixel(const size_t x, const size_t y, const size_t i);
 	
 	template<bool USEHIRESINTERPOLATE> size_t performClipping(const VERTLIST *vertList, const POLYLIST *polyList, const INDEXLIST *indexList);
+	size_t performClippingParallel(const VERTLIST *vertList, const POLYLIST *polyList, const INDEXLIST *indexList, bool useHighResInterpolate);
 	
 	// Base rendering methods
 	virtual Render3DError BeginRender(const GFX3D &engine);
@@ -72,6 +96,11 @@ protected:
 public:
 	int _debug_drawClippedUserPoly;
 	size_t _clippedPolyCount;
+	size_t _deferredPolyCount;
+	u16 *_deferredPolyOwner;
+	u8 *_clearTilePending;
+	size_t _clearTilesPerLine;
+	mutable bool _isClearPending;
 	FragmentColor toonColor32LUT[32];
 	GFX3D_Clipper::TClippedPoly *clippedPolys;
 	FragmentAttributesBuffer *_framebufferAttributes;
@@ -80,6 +109,7 @@ public:
 	bool polyBackfacing[POLYLIST_SIZE];
 	GFX3D_State *currentRenderState;
 	SoftRasterizerPostProcessParams *postprocessParam;
+	SoftRasterizerClipParams *clipParam;
 	
 	SoftRasterizerRenderer();
 	virtual ~SoftRasterizerRenderer();
@@ -88,9 +118,12 @@ public:
 	void performBackfaceTests();
 	void performCoordAdjustment();
 	void setupTextures();
+	size_t getDeferredPolyCount() const;
+	void ResolvePendingClear(const size_t y, const size_t xStart, const size_t xEnd);
 	Render3DError UpdateEdgeMarkColorTable(const u16 *edgeMarkColorTable);
 	Render3DError UpdateFogTable(const u8 *fogDensityTable);
 	Render3DError RenderEdgeMarkingAndFog(const SoftRasterizerPostProcessParams &param);
+	template<bool USEHIRESINTERPOLATE> static size_t clipPolyRange(GFX3D_Clipper &theClipper, const VERTLIST *vertList, const POLYLIST *polyList, const INDEXLIST *indexList, size_t firstPoly, size_t lastPoly);
 	
 	// Base rendering methods
 	virtual Render3DError UpdateToonTable(const u16 *toonTableBuffer);
@@ -104,7 +137,7 @@ public:
 
 class SoftRasterizerRenderer_SSE2 : public SoftRasterizerRenderer
 {
-	virtual Render3DError ClearUsingValues(const FragmentColor &clearColor6665, const FragmentAttributes &clearAttributes) const;
+	virtual void ApplyClearValues(const size_t startIndex, const size_t pixCount);
 };
 
 #endif
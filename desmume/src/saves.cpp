@@ -52,6 +52,7 @@
 #include "slot2.h"
 #include "SPU.h"
 #include "wifi.h"
+#include "statehash.h"
 
 #include "path.h"
 
@@ -457,14 +458,9 @@ static void s_slot2_savestate(EMUFILE* os)
 	os->writeMemoryStream(&temp);
 }
 
-static void mmu_savestate(EMUFILE* os)
+//the hardware half of mmu_savestate, which the state hasher also wants every frame
+static void mmu_savestate_hardware(EMUFILE* os, u32 version)
 {
-	u32 version = 8;
-	write32le(version,os);
-	
-	//version 2:
-	MMU_new.backupDevice.save_state(os);
-	
 	//version 3:
 	MMU_new.gxstat.savestate(os);
 	for(int i=0;i<2;i++)
@@ -484,6 +480,17 @@ static void mmu_savestate(EMUFILE* os)
 
 	//version 6:
 	MMU_new.dsi_tsc.save_state(os);
+}
+
+static void mmu_savestate(EMUFILE* os)
+{
+	u32 version = 8;
+	write32le(version,os);
+	
+	//version 2:
+	MMU_new.backupDevice.save_state(os);
+	
+	mmu_savestate_hardware(os, version);
 
 	//version 8:
 	os->write32le(MMU.fw.size);
@@ -1024,6 +1031,61 @@ bool savestate_save (const char *file_name)
 	} else return false;
 }
 
+//SubWrite without the chunk framing, leaving out anything statehash hashes by pages
+static void SubWriteUnpaged(EMUFILE* os, const SFORMAT *sf)
+{
+	for(;sf->v;sf++)
+	{
+		if(StateHash_IsPaged(sf->v))
+			continue;
+
+	#ifdef LOCAL_LE
+		os->fwrite((char *)sf->v,sf->size*sf->count);
+	#else
+		if(sf->size == 1)
+			os->fwrite((char *)sf->v,sf->count);
+		else
+		{
+			for(u32 i=0;i<sf->count;i++)
+			{
+				FlipByteOrder((u8*)sf->v + i*sf->size, sf->size);
+				os->fwrite((char*)sf->v + i*sf->size,sf->size);
+				FlipByteOrder((u8*)sf->v + i*sf->size, sf->size);
+			}
+		}
+	#endif
+	}
+}
+
+static void mmu_savestate_unpaged(EMUFILE* os)
+{
+	mmu_savestate_hardware(os, 8);
+}
+
+//the part of the state which statehash doesn't keep page hashes for, one chunk per index.
+//the render lists, the framebuffers and the backup memory are left out: the first two depend on the renderer
+//and the last would mean reading the save file every frame.
+//returns the chunk's name, or NULL past the last one
+const char* savestate_save_unpaged(int index, EMUFILE* os)
+{
+	switch(index)
+	{
+		case 0: SubWriteUnpaged(os,SF_ARM9); return "ARM9";
+		case 1: SubWriteUnpaged(os,SF_ARM7); return "ARM7";
+		case 2: cp15_savestate(os); return "CP15";
+		case 3: SubWriteUnpaged(os,SF_MEM); return "MEM";
+		case 4: SubWriteUnpaged(os,SF_NDS); return "NDS";
+		case 5: nds_savestate(os); return "sequencer";
+		case 6: SubWriteUnpaged(os,SF_MMU); return "MMU";
+		case 7: mmu_savestate_unpaged(os); return "MMU hardware";
+		case 8: spu_savestate(os); return "SPU";
+		case 9: SubWriteUnpaged(os,SF_GFX3D); return "GFX3D";
+		case 10: SubWriteUnpaged(os,SF_WIFI); return "WIFI";
+		case 11: SubWriteUnpaged(os,SF_RTC); return "RTC";
+	}
+	return NULL;
+}
+
 static void writechunks(EMUFILE* os) {
 
 	DateTime tm = DateTime::get_Now();
@@ -65,6 +65,7 @@ void loadstate_slot(int num);
 
 bool savestate_load(class EMUFILE* is);
 bool savestate_save(class EMUFILE* outstream, int compressionLevel);
+const char* savestate_save_unpaged(int index, class EMUFILE* os);
 
 void dorewind();
 void rewindsave();
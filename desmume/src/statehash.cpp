@@ -0,0 +1,265 @@
+/*
+	Copyright (C) 2016 DeSmuME team
+
+	This file is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the this software.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "statehash.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "MMU.h"
+#include "emufile.h"
+#include "saves.h"
+
+#define PAGES(bytes) (((bytes) + STATEHASH_PAGE_SIZE - 1) >> STATEHASH_PAGE_SHIFT)
+
+struct PagedRegion
+{
+	const char *name;
+	u8 *base;
+	u32 size;
+};
+
+//main memory and DTCM have to stay first, in this order, to match the page numbers in statehash.h
+static const PagedRegion regions[] = {
+	{ "MAIN_MEM",	MMU.MAIN_MEM,	sizeof(MMU.MAIN_MEM) },
+	{ "ARM9_DTCM",	MMU.ARM9_DTCM,	sizeof(MMU.ARM9_DTCM) },
+	{ "ARM9_ITCM",	MMU.ARM9_ITCM,	sizeof(MMU.ARM9_ITCM) },
+	//the same size as the savestate's; the rest is the blank memory for unmapped vram
+	{ "ARM9_LCD",	MMU.ARM9_LCD,	0xA4000 },
+	{ "SWIRAM",		MMU.SWIRAM,		sizeof(MMU.SWIRAM) },
+	{ "ARM7_ERAM",	MMU.ARM7_ERAM,	sizeof(MMU.ARM7_ERAM) },
+};
+static const int regionCount = ARRAY_SIZE(regions);
+
+static const u32 pageCount = PAGES(sizeof(MMU.MAIN_MEM)) + PAGES(sizeof(MMU.ARM9_DTCM)) + PAGES(sizeof(MMU.ARM9_ITCM))
+	+ PAGES(0xA4000) + PAGES(sizeof(MMU.SWIRAM)) + PAGES(sizeof(MMU.ARM7_ERAM));
+
+bool statehash_enabled = false;
+u8 statehash_dirty[pageCount];
+
+static std::vector<u64> pageHashes;
+static std::vector<const char*> chunkNames;
+static EMUFILE_MEMORY chunkBuffer;
+static std::vector<u64> hashBuffer;
+static u64 frameHash = 1;
+
+static const u64 PRIME1 = 0x9E3779B185EBCA87ULL;
+static const u64 PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+static const u64 PRIME3 = 0x165667B19E3779F9ULL;
+static const u64 PRIME4 = 0x85EBCA77C2B2AE63ULL;
+static const u64 PRIME5 = 0x27D4EB2F165667C5ULL;
+
+static FORCEINLINE u64 Rotl64(u64 x, int r) { return (x << r) | (x >> (64 - r)); }
+static FORCEINLINE u64 Round(u64 acc, u64 v) { return Rotl64(acc + v * PRIME2, 31) * PRIME1; }
+static FORCEINLINE u64 Read64(const u8 *p)
+{
+	u64 v;
+	memcpy(&v, p, sizeof(v));
+	return LE_TO_LOCAL_64(v);
+}
+static FORCEINLINE u32 Read32(const u8 *p)
+{
+	u32 v;
+	memcpy(&v, p, sizeof(v));
+	return LE_TO_LOCAL_32(v);
+}
+
+//xxHash64. it's four independent lanes, so a page goes by at several bytes per cycle
+u64 StateHash_HashBytes(const void *data, size_t len, u64 seed)
+{
+	const u8 *p = (const u8 *)data;
+	const u8 *const end = p + len;
+	u64 h;
+
+	if (len >= 32)
+	{
+		const u8 *const limit = end - 32;
+		u64 v1 = seed + PRIME1 + PRIME2;
+		u64 v2 = seed + PRIME2;
+		u64 v3 = seed;
+		u64 v4 = seed - PRIME1;
+		do
+		{
+			v1 = Round(v1, Read64(p));
+			v2 = Round(v2, Read64(p + 8));
+			v3 = Round(v3, Read64(p + 16));
+			v4 = Round(v4, Read64(p + 24));
+			p += 32;
+		} while (p <= limit);
+
+		h = Rotl64(v1, 1) + Rotl64(v2, 7) + Rotl64(v3, 12) + Rotl64(v4, 18);
+		h = (h ^ Round(0, v1)) * PRIME1 + PRIME4;
+		h = (h ^ Round(0, v2)) * PRIME1 + PRIME4;
+		h = (h ^ Round(0, v3)) * PRIME1 + PRIME4;
+		h = (h ^ Round(0, v4)) * PRIME1 + PRIME4;
+	}
+	else
+		h = seed + PRIME5;
+
+	h += len;
+	for (; p + 8 <= end; p += 8)
+		h = Rotl64(h ^ Round(0, Read64(p)), 27) * PRIME1 + PRIME4;
+	if (p + 4 <= end)
+	{
+		h = Rotl64(h ^ ((u64)Read32(p) * PRIME1), 23) * PRIME2 + PRIME3;
+		p += 4;
+	}
+	for (; p < end; p++)
+		h = Rotl64(h ^ (*p * PRIME5), 11) * PRIME1;
+
+	h ^= h >> 33;
+	h *= PRIME2;
+	h ^= h >> 29;
+	h *= PRIME3;
+	h ^= h >> 32;
+	return h;
+}
+
+void StateHash_MarkHostRange(const void *ptr, size_t len)
+{
+	if (!statehash_enabled || len == 0)
+		return;
+
+	const u8 *p = (const u8 *)ptr;
+	u32 firstPage = 0;
+	for (int i = 0; i < regionCount; i++)
+	{
+		const PagedRegion &r = regions[i];
+		if (p >= r.base && p < r.base + r.size)
+		{
+			const u32 ofs = (u32)(p - r.base);
+			const u32 last = std::min<u32>(r.size, ofs + (u32)len) - 1;
+			for (u32 page = ofs >> STATEHASH_PAGE_SHIFT; page <= (last >> STATEHASH_PAGE_SHIFT); page++)
+				statehash_dirty[firstPage + page] = 1;
+			return;
+		}
+		firstPage += PAGES(r.size);
+	}
+}
+
+bool StateHash_IsPaged(const void *ptr)
+{
+	const u8 *p = (const u8 *)ptr;
+	for (int i = 0; i < regionCount; i++)
+		if (p >= regions[i].base && p < regions[i].base + regions[i].size)
+			return true;
+	return false;
+}
+
+void StateHash_Enable(bool enable)
+{
+	statehash_enabled = enable;
+	if (enable)
+		StateHash_Invalidate();
+}
+
+void StateHash_Invalidate()
+{
+	memset(statehash_dirty, 1, sizeof(statehash_dirty));
+}
+
+void StateHash_EndFrame()
+{
+	if (!statehash_enabled)
+		return;
+
+	if (pageHashes.size() < pageCount)
+		pageHashes.resize(pageCount);
+
+	//the memory pages. only main memory changes size, with the console type
+	u32 index = 0;
+	for (int i = 0; i < regionCount; i++)
+	{
+		const PagedRegion &r = regions[i];
+		const u32 used = (r.base == MMU.MAIN_MEM) ? (_MMU_MAIN_MEM_MASK + 1) : r.size;
+		for (u32 ofs = 0; ofs < r.size; ofs += STATEHASH_PAGE_SIZE, index++)
+		{
+			if (!statehash_dirty[index])
+				continue;
+			statehash_dirty[index] = 0;
+			pageHashes[index] = (ofs < used) ? StateHash_HashBytes(r.base + ofs, std::min<u32>(STATEHASH_PAGE_SIZE, used - ofs), index) : 0;
+		}
+	}
+
+	//everything else, every time
+	pageHashes.resize(pageCount);
+	chunkNames.clear();
+	for (int i = 0; ; i++)
+	{
+		chunkBuffer.truncate(0);
+		const char *name = savestate_save_unpaged(i, &chunkBuffer);
+		if (name == NULL)
+			break;
+		chunkNames.push_back(name);
+		pageHashes.push_back(StateHash_HashBytes(chunkBuffer.buf(), chunkBuffer.size(), pageCount + i));
+	}
+
+	hashBuffer.resize(pageHashes.size());
+	for (size_t i = 0; i < pageHashes.size(); i++)
+		hashBuffer[i] = LOCAL_TO_LE_64(pageHashes[i]);
+	frameHash = StateHash_HashBytes(&hashBuffer[0], hashBuffer.size() * sizeof(u64), 0);
+	if (frameHash == 0)
+		frameHash = 1;
+}
+
+u64 StateHash_Get()
+{
+	return frameHash;
+}
+
+const std::vector<u64>& StateHash_GetPages()
+{
+	return pageHashes;
+}
+
+StateHashPage StateHash_DescribePage(size_t index)
+{
+	StateHashPage page = { "state", 0, 0 };
+
+	if (index >= pageCount)
+	{
+		if (index - pageCount < chunkNames.size())
+			page.region = chunkNames[index - pageCount];
+		return page;
+	}
+
+	for (int i = 0; i < regionCount; i++)
+	{
+		const u32 pages = PAGES(regions[i].size);
+		if (index < pages)
+		{
+			page.region = regions[i].name;
+			page.offset = (u32)index << STATEHASH_PAGE_SHIFT;
+			page.size = std::min<u32>(STATEHASH_PAGE_SIZE, regions[i].size - page.offset);
+			break;
+		}
+		index -= pages;
+	}
+	return page;
+}
+
+void StateHash_DiffPages(const std::vector<u64> &a, const std::vector<u64> &b, std::vector<StateHashPage> &out)
+{
+	out.clear();
+	const size_t count = std::max(a.size(), b.size());
+	for (size_t i = 0; i < count; i++)
+	{
+		if (i < a.size() && i < b.size() && a[i] == b[i])
+			continue;
+		out.push_back(StateHash_DescribePage(i));
+	}
+}
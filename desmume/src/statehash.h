@@ -0,0 +1,88 @@
+/*
+	Copyright (C) 2016 DeSmuME team
+
+	This file is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the this software.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//a running hash of the emulated state, taken at the end of every frame, for checking that two runs stay in sync.
+//the big memories are hashed a page at a time, and only the pages written since the last frame are rehashed;
+//everything else (cpu and peripheral registers, the sequencer, the small memories) goes through the savestate
+//serializers and is rehashed every frame. two runs which agree on every page and chunk have the same hash.
+//the save memory and the firmware aren't included.
+
+#ifndef _STATEHASH_H_
+#define _STATEHASH_H_
+
+#include <vector>
+#include "types.h"
+
+#define STATEHASH_PAGE_SHIFT 12
+#define STATEHASH_PAGE_SIZE (1 << STATEHASH_PAGE_SHIFT)
+
+//page numbers of the memories which the MMU marks inline. main memory always gets room for its
+//largest (DSi) size, and the pages past the size in use are left alone
+#define STATEHASH_MAIN_MEM_PAGE 0
+#define STATEHASH_DTCM_PAGE ((16*1024*1024) >> STATEHASH_PAGE_SHIFT)
+
+extern bool statehash_enabled;
+extern u8 statehash_dirty[];
+
+FORCEINLINE void StateHash_MarkMainMem(u32 ofs)
+{
+	if (statehash_enabled) statehash_dirty[STATEHASH_MAIN_MEM_PAGE + (ofs >> STATEHASH_PAGE_SHIFT)] = 1;
+}
+
+FORCEINLINE void StateHash_MarkDTCM(u32 ofs)
+{
+	if (statehash_enabled) statehash_dirty[STATEHASH_DTCM_PAGE + (ofs >> STATEHASH_PAGE_SHIFT)] = 1;
+}
+
+//for writes through a host pointer: marks whichever paged memory the range falls in, if any
+void StateHash_MarkHostRange(const void *ptr, size_t len);
+FORCEINLINE void StateHash_MarkHost(const void *ptr, size_t len = 1)
+{
+	if (statehash_enabled) StateHash_MarkHostRange(ptr, len);
+}
+
+//whether ptr is inside a memory which is hashed by pages (so the savestate chunks should leave it out)
+bool StateHash_IsPaged(const void *ptr);
+
+//xxHash64 of len bytes
+u64 StateHash_HashBytes(const void *data, size_t len, u64 seed);
+
+void StateHash_Enable(bool enable);
+//rehash everything at the end of this frame. for anything that rewrites memory behind the MMU's back
+void StateHash_Invalidate();
+//called by the core at the end of every frame
+void StateHash_EndFrame();
+
+//the hash taken at the end of the last frame. never 0, so 0 can stand for "unknown"
+u64 StateHash_Get();
+
+//the hashes which went into the last frame's hash: one per memory page, then one per savestate chunk.
+//comparing two of these pinpoints where two runs diverged
+const std::vector<u64>& StateHash_GetPages();
+
+struct StateHashPage
+{
+	const char *region;
+	u32 offset;		//within the region
+	u32 size;		//0 for a savestate chunk
+};
+
+StateHashPage StateHash_DescribePage(size_t index);
+//the pages which differ between two lists from StateHash_GetPages()
+void StateHash_DiffPages(const std::vector<u64> &a, const std::vector<u64> &b, std::vector<StateHashPage> &out);
+
+#endif
@@ -0,0 +1,105 @@
+/*
+	Copyright (C) 2016 DeSmuME team
+
+	This file is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the this software.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//runs the frame skipper the way NDS_Step drives it, over a random mix of batches, and checks that every
+//observed frame is the last frame of its batch: its 2D is that frame's, its 3D was rendered the frame
+//before it, and so it changes from one batch to the next.
+
+#include <stdio.h>
+
+#include "../frameskip.h"
+#include "../batchstep.h"
+
+//a stand-in for the emulator, which only tracks which frame each part of the picture comes from
+struct Emulator
+{
+	FrameSkipper skipper;
+	int frame;
+	int rendered3D;			//the frame whose 3D render is waiting to be shown
+	int shown2D, shown3D;	//where the picture in the framebuffer came from
+
+	Emulator() : frame(0), rendered3D(-1), shown2D(-1), shown3D(-1) {}
+
+	//the same order as NDS_exec: the 2D lines, then the 3D render at the end of vblank, then Advance()
+	void runFrame()
+	{
+		if (!skipper.ShouldSkip2D())
+		{
+			shown2D = frame;
+			shown3D = rendered3D;
+		}
+		if (!skipper.ShouldSkip3D())
+			rendered3D = frame;
+		skipper.Advance(false, NDSDisplayID_Main);
+		frame++;
+	}
+
+	void step(int frameCount, bool wantFrame)
+	{
+		for (int i = 0; i < frameCount; i++)
+		{
+			switch (BatchStep_SkipFor(i, frameCount, wantFrame))
+			{
+				case BatchStepSkip_Request: skipper.RequestSkip(); break;		//NDS_SkipNextFrame()
+				case BatchStepSkip_None: break;
+				case BatchStepSkip_Omit: skipper.OmitSkip(true, true); break;	//NDS_OmitFrameSkip(2)
+			}
+			runFrame();
+		}
+	}
+};
+
+static u32 rngState = 0x12345678;
+static u32 rng()
+{
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState;
+}
+
+int main()
+{
+	Emulator emu;
+	int failures = 0;
+	int lastObserved = -1;
+
+	for (int batch = 0; batch < 10000 && failures < 10; batch++)
+	{
+		const int frameCount = 1 + (int)(rng() % 8);
+		const bool wantFrame = (rng() % 4) != 0;
+		emu.step(frameCount, wantFrame);
+		if (!wantFrame)
+			continue;
+
+		const int last = emu.frame - 1;
+		bool ok = (emu.shown2D == last) && (emu.shown2D != lastObserved);
+		if (frameCount >= 2)
+			ok = ok && (emu.shown3D == last - 1);
+
+		if (!ok)
+		{
+			printf("batch %d of %d frames ending at frame %d: observed 2D from frame %d, 3D from frame %d (previous observation %d)\n",
+				batch, frameCount, last, emu.shown2D, emu.shown3D, lastObserved);
+			failures++;
+		}
+		lastObserved = emu.shown2D;
+	}
+
+	printf("%s\n", (failures == 0) ? "ok" : "FAILED");
+	return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+/*
+	Copyright (C) 2016 DeSmuME team
+
+	This file is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the this software.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//golden vectors for the fixed point matrix routines and the geometry engine's vertex transform and lighting
+//dot products. the expected results were made with the plain C versions, and this is built both with and without SSE4.1 (see Makefile.am), so both paths have to match them.
+//the inputs include products and sums which overflow 32bits, which the SIMD versions must wrap the same way.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../matrix.h"
+
+static const s32 testMatrices[6][16] = {
+	{ (s32)0x00001000, (s32)0x00000000, (s32)0x00000000, (s32)0x00000000, (s32)0x00000000, (s32)0x00001000, (s32)0x00000000, (s32)0x00000000, (s32)0x00000000, (s32)0x00000000, (s32)0x00001000, (s32)0x00000000, (s32)0x00000000, (s32)0x00000000, (s32)0x00000000, (s32)0x00001000 },
+	{ (s32)0x00000DDB, (s32)0xFFFFF800, (s32)0x00000000, (s32)0x00000000, (s32)0x00000800, (s32)0x00000DDB, (s32)0x00000000, (s32)0x00000000, (s32)0x00000000, (s32)0x00000000, (s32)0x00001000, (s32)0x00000000, (s32)0x00010000, (s32)0xFFFF8000, (s32)0x00020000, (s32)0x00001000 },
+	{ (s32)0xFFFEB63A, (s32)0xFFFE74AB, (s32)0x0001B3AC, (s32)0x00014626, (s32)0xFFFFBBAF, (s32)0xFFFF5123, (s32)0xFFFE501A, (s32)0x00011A71, (s32)0xFFFF3F6C, (s32)0x00007191, (s32)0x0000EA5D, (s32)0xFFFECF31, (s32)0xFFFF4E18, (s32)0xFFFFC23E, (s32)0x000056BC, (s32)0xFFFFF2D2 },
+	{ (s32)0xFC95B972, (s32)0x3CC0494F, (s32)0x88DFC4DB, (s32)0x78D703D9, (s32)0x8D219E6F, (s32)0x63680239, (s32)0x06CD666E, (s32)0xEA1E9EAE, (s32)0x00A30B2B, (s32)0x590D22C8, (s32)0x57DFD022, (s32)0x16A31F2F, (s32)0xDD9E740C, (s32)0x70E04DE3, (s32)0x52DE38ED, (s32)0x2DB9938C },
+	{ (s32)0x80000000, (s32)0x7FFFFFFF, (s32)0x80000000, (s32)0x7FFFFFFF, (s32)0x80000000, (s32)0x7FFFFFFF, (s32)0x80000000, (s32)0x7FFFFFFF, (s32)0x80000000, (s32)0x7FFFFFFF, (s32)0x80000000, (s32)0x7FFFFFFF, (s32)0x80000000, (s32)0x7FFFFFFF, (s32)0x80000000, (s32)0x7FFFFFFF },
+	{ (s32)0x7FFFFFFF, (s32)0x80000000, (s32)0x80000000, (s32)0x7FFFFFFF, (s32)0x80000000, (s32)0x80000000, (s32)0x7FFFFFFF, (s32)0x80000000, (s32)0x80000000, (s32)0x7FFFFFFF, (s32)0x80000000, (s32)0x80000000, (s32)0x7FFFFFFF, (s32)0x80000000, (s32)0x80000000, (s32)0x7FFFFFFF },
+};
+
+static const s32 testVectors[6][4] = {
+	{ (s32)0xFFFFE234, (s32)0xFFFFF468, (s32)0x0000069C, (s32)0x000018D0 },
+	{ (s32)0x00001000, (s32)0xFFFFD800, (s32)0x00000800, (s32)0x00001000 },
+	{ (s32)0xFFF81FEF, (s32)0x0004A751, (s32)0x0003E422, (s32)0xFFFDF49D },
+	{ (s32)0xE6CB9168, (s32)0x083DB87B, (s32)0x59627BA2, (s32)0xD4D02589 },
+	{ (s32)0x7FFFFFFF, (s32)0x80000000, (s32)0x7FFFFFFF, (s32)0x80000000 },
+	{ (s32)0x7FFFFFFF, (s32)0x7FFFFFFE, (s32)0x7FFFFFFD, (s32)0x7FFFFFFC },
+};
+
+//MatrixMultVec4x4(testMatrices[i], testVectors[i])
+static const s32 expectedVec4x4[6][4] = {
+	{ (s32)0xFFFFE234, (s32)0xFFFFF468, (s32)0x0000069C, (s32)0x000018D0 },
+	{ (s32)0x0000F9DB, (s32)0xFFFF555C, (s32)0x00020800, (s32)0x00001000 },
+	{ (s32)0x00765831, (s32)0x00B33C49, (s32)0xFED9DB63, (s32)0xFF692C06 },
+	{ (s32)0xC7FC70F6, (s32)0xB9021C12, (s32)0x73A92F30, (s32)0x293B86A4 },
+	{ (s32)0x00100000, (s32)0xFFF00000, (s32)0x00100000, (s32)0xFFF00000 },
+	{ (s32)0xFFF00000, (s32)0x00180000, (s32)0x00280000, (s32)0xFFF00000 },
+};
+
+//MatrixMultVec3x3_fixed(testMatrices[i], testVectors[i]); the 4th element is left alone
+static const s32 expectedVec3x3[6][4] = {
+	{ (s32)0xFFFFE234, (s32)0xFFFFF468, (s32)0x0000069C, (s32)0x000018D0 },
+	{ (s32)0xFFFFF9DB, (s32)0xFFFFD55C, (s32)0x00000800, (s32)0x00001000 },
+	{ (s32)0x005F9C94, (s32)0x00AB5815, (s32)0xFEE4F09D, (s32)0xFFFDF49D },
+	{ (s32)0xCBE0CBD8, (s32)0x2270A05A, (s32)0x84E973C5, (s32)0xD4D02589 },
+	{ (s32)0x00100000, (s32)0xFFE80000, (s32)0x00100000, (s32)0x80000000 },
+	{ (s32)0x00180000, (s32)0xFFF80000, (s32)0x00080000, (s32)0x7FFFFFFC },
+};
+
+//MatrixMultiply(testMatrices[i], testMatrices[(i + 1) % 6])
+static const s32 expectedMultiply[6][16] = {
+	{ (s32)0x00000DDB, (s32)0xFFFFF800, (s32)0x00000000, (s32)0x00000000, (s32)0x00000800, (s32)0x00000DDB, (s32)0x00000000, (s32)0x00000000, (s32)0x00000000, (s32)0x00000000, (s32)0x00001000, (s32)0x00000000, (s32)0x00010000, (s32)0xFFFF8000, (s32)0x00020000, (s32)0x00001000 },
+	{ (s32)0x00127F22, (s32)0xFFF51D5A, (s32)0x002A786C, (s32)0x00014626, (s32)0x00111478, (s32)0xFFF6B733, (s32)0x00219E3A, (s32)0x00011A71, (s32)0xFFEC8514, (s32)0x000A491A, (s32)0xFFDAD07D, (s32)0xFFFECF31, (s32)0xFFFE742F, (s32)0x00008CE9, (s32)0xFFFEB0FC, (s32)0xFFFFF2D2 },
+	{ (s32)0x9D2CB084, (s32)0x9C7771B1, (s32)0xF940AF3D, (s32)0x64AC1792, (s32)0x3883BDB2, (s32)0x5C88F9E5, (s32)0x39DF7A6D, (s32)0x45B2CD2D, (s32)0x59458446, (s32)0x3B5F43F0, (s32)0x2F646FBF, (s32)0x94450826, (s32)0x00D5649B, (s32)0x1B92EF61, (s32)0x2693F9BE, (s32)0xBB60CFAD },
+	{ (s32)0x6EF953FE, (s32)0x201ABB7A, (s32)0x52EA6546, (s32)0x798E827C, (s32)0x6EF953FE, (s32)0x201ABB7A, (s32)0x52EA6546, (s32)0x798E827C, (s32)0x6EF953FE, (s32)0x201ABB7A, (s32)0x52EA6546, (s32)0x798E827C, (s32)0x6EF953FE, (s32)0x201ABB7A, (s32)0x52EA6546, (s32)0x798E827C },
+	{ (s32)0x00100000, (s32)0xFFF00000, (s32)0x00100000, (s32)0xFFF00000, (s32)0x00080000, (s32)0x00080000, (s32)0x00080000, (s32)0x00080000, (s32)0x00080000, (s32)0x00080000, (s32)0x00080000, (s32)0x00080000, (s32)0x00100000, (s32)0xFFF00000, (s32)0x00100000, (s32)0xFFF00000 },
+	{ (s32)0x7FFFFFFF, (s32)0x80000000, (s32)0x80000000, (s32)0x7FFFFFFF, (s32)0x80000000, (s32)0x80000000, (s32)0x7FFFFFFF, (s32)0x80000000, (s32)0x80000000, (s32)0x7FFFFFFF, (s32)0x80000000, (s32)0x80000000, (s32)0x7FFFFFFF, (s32)0x80000000, (s32)0x80000000, (s32)0x7FFFFFFF },
+};
+
+//GEM_SaturateAndShiftdown36To32() right at and just past the edges of the 36bit range
+static const s64 saturateInputs[11] = {
+	0, 0xFFF, -1, 0x12345678ABCLL, -0x12345678ABCLL,
+	0x7FFFFFFFFFFLL, 0x80000000000LL, -0x80000000000LL, -0x80000000001LL,
+	0x7FFFFFFFFFFFFFFFLL, (s64)0x8000000000000000ULL,
+};
+
+static const s32 expectedSaturate[11] = {
+	(s32)0x00000000, (s32)0x00000000, (s32)0xFFFFFFFF, (s32)0x12345678, (s32)0xEDCBA987,
+	(s32)0x7FFFFFFF, (s32)0x7FFFFFFF, (s32)0x80000000, (s32)0x80000000,
+	(s32)0x7FFFFFFF, (s32)0x80000000,
+};
+
+//for GEM_TransformVertex(), on top of the ones above: sums 4096 either side of where the saturation kicks
+//in, where wrapping would give the opposite sign, and a huge translation like the one spectrobes uses to
+//push things offscreen
+static const s32 boundaryMatrices[2][16] = {
+	{ 0x2000, 0x2000, -0x2000, -0x2000, 0, 1, 0, -1, 0, 0, 0, 0, 0x1000, 0, -0x1000, 0 },
+	{ 0x1000, 0, 0, 0, 0, 0x1000, 0, 0, 0, 0, 0x1000, 0, 0x7FFF0000, 0x7FFFF000, (s32)0x80000000, 0 },
+};
+
+static const s32 boundaryVectors[2][4] = {
+	{ 0x40000000, 0x1000, 0, -1 },
+	{ 0x1000, 0x2000, -0x1000, 0x1000 },
+};
+
+//GEM_TransformVertex() with testMatrices/testVectors, then boundaryMatrices/boundaryVectors
+static const s32 expectedTransform[8][4] = {
+	{ (s32)0xFFFFE234, (s32)0xFFFFF468, (s32)0x0000069C, (s32)0x000018D0 },
+	{ (s32)0x0000F9DB, (s32)0xFFFF555C, (s32)0x00020800, (s32)0x00001000 },
+	{ (s32)0x00765831, (s32)0x00B33C49, (s32)0xFED9DB63, (s32)0xFF692C06 },
+	{ (s32)0x7FFFFFFF, (s32)0x7FFFFFFF, (s32)0x7FFFFFFF, (s32)0x80000000 },
+	{ (s32)0x00100000, (s32)0xFFF00000, (s32)0x00100000, (s32)0xFFF00000 },
+	{ (s32)0xFFF00000, (s32)0x80000000, (s32)0x80000000, (s32)0xFFF00000 },
+	{ (s32)0x7FFFFFFF, (s32)0x7FFFFFFF, (s32)0x80000001, (s32)0x80000000 },
+	{ (s32)0x7FFF1000, (s32)0x7FFFFFFF, (s32)0x80000000, (s32)0x00000000 },
+};
+
+//GEM_LightDotProducts() inputs. the 4th elements are never used. half vectors of 0x80000000 negate to themselves
+static const s32 lightDirections[4][4] = {
+	{ (s32)0xFFFFF000, 0, 0, 0 },
+	{ 0x0000093D, (s32)0xFFFFF6C3, 0x0000093D, 0 },
+	{ 0x7FFFFFFF, (s32)0x80000000, 0x7FFFFFFF, 0 },
+	{ 0x12345678, (s32)0x9ABCDEF0, 0x0FEDCBA9, 0 },
+};
+
+static const s32 halfVectors[4][4] = {
+	{ 0, 0, -0x800, 0 },
+	{ (s32)0x80000000, 0x7FFFFFFF, (s32)0x80000000, 0 },
+	{ 0x00000C00, (s32)0xFFFFF400, 0x00000400, 0 },
+	{ (s32)0xDEADBEEF, 0x0BADF00D, (s32)0xCAFEBABE, 0 },
+};
+
+static const s32 testNormals[4][4] = {
+	{ 0, 0, 0x1000, 0x1000 },
+	{ (s32)0xFFFFE000, 0x00000FF8, (s32)0xFFFFF008, 0x1000 },
+	{ 0x7FFFFFFF, 0x7FFFFFFF, 0x7FFFFFFF, 0x1000 },
+	{ (s32)0x80000000, (s32)0x80000000, 0x7FFFFFFF, 0x1000 },
+};
+
+//GEM_LightDotProducts(testNormals[i], ...): the light direction dot products, then the half vector ones
+static const s32 expectedLightDot[4][2][4] = {
+	{ { (s32)0x00000000, (s32)0x0000093D, (s32)0x7FFFFFFF, (s32)0x0FEDCBA9 }, { (s32)0x00000800, (s32)0x80000000, (s32)0xFFFFFC00, (s32)0x35014542 } },
+	{ { (s32)0x00002000, (s32)0xFFFFDB15, (s32)0x00800002, (s32)0x66A0FECD }, { (s32)0xFFFFF804, (s32)0x00000000, (s32)0x000027F8, (s32)0x7CCCA029 } },
+	{ { (s32)0x80000001, (s32)0x49E7FFFF, (s32)0xFFE80000, (s32)0x088C320F }, { (s32)0x3FFFFFFF, (s32)0x001FFFFF, (s32)0xE0000000, (s32)0xB22B55A6 } },
+	{ { (s32)0x80000000, (s32)0x49E7FFFF, (s32)0xFFF80000, (s32)0xB2070123 }, { (s32)0x3FFFFFFF, (s32)0x00000000, (s32)0xE0000000, (s32)0xA1ECAFEB } },
+};
+
+static int failures = 0;
+
+static void check(const char *name, int index, const s32 *result, const s32 *expected, int count)
+{
+	if (memcmp(result, expected, count * sizeof(s32)) == 0)
+		return;
+
+	printf("%s #%d: mismatch\n", name, index);
+	for (int i = 0; i < count; i++)
+		printf("  [%2d] got %08X, expected %08X\n", i, (u32)result[i], (u32)expected[i]);
+	failures++;
+}
+
+int main()
+{
+#ifdef ENABLE_SSE4_1
+#ifdef __GNUC__
+	if (!__builtin_cpu_supports("sse4.1"))
+	{
+		printf("this cpu doesn't have SSE4.1\n");
+		return 77;
+	}
+#endif
+	printf("testing the SSE4.1 matrix routines\n");
+#else
+	printf("testing the plain C matrix routines\n");
+#endif
+
+	const int count = ARRAY_SIZE(testMatrices);
+	for (int i = 0; i < count; i++)
+	{
+		s32 vec[4];
+		memcpy(vec, testVectors[i], sizeof(vec));
+		MatrixMultVec4x4(testMatrices[i], vec);
+		check("MatrixMultVec4x4", i, vec, expectedVec4x4[i], 4);
+
+		memcpy(vec, testVectors[i], sizeof(vec));
+		MatrixMultVec3x3_fixed(testMatrices[i], vec);
+		check("MatrixMultVec3x3_fixed", i, vec, expectedVec3x3[i], 4);
+
+		s32 mtx[16];
+		memcpy(mtx, testMatrices[i], sizeof(mtx));
+		MatrixMultiply(mtx, testMatrices[(i + 1) % count]);
+		check("MatrixMultiply", i, mtx, expectedMultiply[i], 16);
+
+		memcpy(vec, testVectors[i], sizeof(vec));
+		GEM_TransformVertex(testMatrices[i], vec);
+		check("GEM_TransformVertex", i, vec, expectedTransform[i], 4);
+	}
+
+	for (int i = 0; i < (int)ARRAY_SIZE(boundaryMatrices); i++)
+	{
+		s32 vec[4];
+		memcpy(vec, boundaryVectors[i], sizeof(vec));
+		GEM_TransformVertex(boundaryMatrices[i], vec);
+		check("GEM_TransformVertex", count + i, vec, expectedTransform[count + i], 4);
+	}
+
+	for (int i = 0; i < (int)ARRAY_SIZE(saturateInputs); i++)
+	{
+		const s32 result = GEM_SaturateAndShiftdown36To32(saturateInputs[i]);
+		check("GEM_SaturateAndShiftdown36To32", i, &result, &expectedSaturate[i], 1);
+	}
+
+	for (int i = 0; i < (int)ARRAY_SIZE(testNormals); i++)
+	{
+		CACHE_ALIGN s32 lightDot[4];
+		CACHE_ALIGN s32 halfDot[4];
+		GEM_LightDotProducts(testNormals[i], lightDirections, halfVectors, lightDot, halfDot);
+		check("GEM_LightDotProducts (light directions)", i, lightDot, expectedLightDot[i][0], 4);
+		check("GEM_LightDotProducts (half vectors)", i, halfDot, expectedLightDot[i][1], 4);
+	}
+
+	printf("%s\n", (failures == 0) ? "ok" : "FAILED");
+	return (failures == 0) ? 0 : 1;
+}
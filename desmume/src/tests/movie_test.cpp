@@ -0,0 +1,283 @@
+/*
+	Copyright (C) 2016 DeSmuME team
+
+	This file is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the this software.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//records a movie with checkpoints, saves it as .dsmb and as a text movie with a binary input chunk, loads both
+//back, and seeks around in the .dsmb one. the emulator is stood in for by a fake core whose whole state is a
+//running hash of the input it was fed, so any input which doesn't survive the round trip, or a seek which
+//lands on the wrong frame, shows up as a different state.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../movie.h"
+#include "../NDSSystem.h"
+#include "../MMU.h"
+#include "../GPU_osd.h"
+#include "../driver.h"
+#include "../path.h"
+#include "../saves.h"
+#include "../readwrite.h"
+#include "../emufile.h"
+#include "../statehash.h"
+#include "../version.h"
+
+//---------------------------------------------------------------------------------------------------
+//the fake core
+
+static u32 fakeState = 0;
+static UserInput rawInput, processingInput, finalInput;
+
+//the buttons as the movie records them, which NDS_applyFinalInput leaves in nds.pad: fRLDUTSBAYXWEg, the same
+//order as UserButtons, where the lid and debug buttons aren't part of the pad
+static u16 moviePad(const UserInput &input)
+{
+	u16 pad = 0;
+	for (int i = 1; i <= 12; i++)
+		pad |= (input.buttons.array[i] ? 1 : 0) << i;
+	return pad;
+}
+
+void NDS_Reset()
+{
+	fakeState = 0;
+}
+
+template<bool FORCE> void NDS_exec(s32 nb)
+{
+	const u32 touch = finalInput.touch.isTouch ? (finalInput.touch.touchX << 16) | finalInput.touch.touchY : 0;
+	fakeState = (fakeState ^ moviePad(finalInput)) * 0x01000193;
+	fakeState = (fakeState ^ touch) * 0x01000193;
+	currFrameCounter++;
+}
+template void NDS_exec<false>(s32 nb);
+
+void NDS_beginProcessingInput() { processingInput = rawInput; }
+void NDS_endProcessingInput()
+{
+	finalInput = processingInput;
+	nds.pad = moviePad(finalInput);
+}
+UserInput& NDS_getProcessingUserInput() { return processingInput; }
+const UserInput& NDS_getFinalUserInput() { return finalInput; }
+void NDS_SkipNextFrame() {}
+void ClearAutoHold() {}
+int NDS_CreateDummyFirmware(NDS_fw_config_data *user_settings) { return TRUE; }
+int NDS_GetCPUCoreCount() { return 1; }
+void NDS_SetupDefaultFirmware() {}
+
+static int savestateLoads = 0;
+
+bool savestate_save(EMUFILE* outstream, int compressionLevel)
+{
+	write32le(fakeState, outstream);
+	write32le((u32)currFrameCounter, outstream);
+	return true;
+}
+
+bool savestate_load(EMUFILE* is)
+{
+	u32 frame;
+	if (read32le(&fakeState, is) != 1 || read32le(&frame, is) != 1)
+		return false;
+	currFrameCounter = (int)frame;
+	savestateLoads++;
+	return true;
+}
+
+u64 StateHash_Get() { return 1; }
+void StateHash_Enable(bool enable) {}
+u32 EMU_DESMUME_VERSION_NUMERIC() { return 0; }
+
+//MMU_new is only here for its backup device, which a movie switches into movie mode
+BackupDevice::BackupDevice() {}
+BackupDevice::~BackupDevice() {}
+void BackupDevice::movie_mode() {}
+bool BackupDevice::load_movie(EMUFILE* is) { return true; }
+MMU_struct_new::MMU_struct_new() {}
+u32 TGXSTAT::read32() { return 0; }
+void TGXSTAT::write32(const u32 val) {}
+u32 DmaController::read32() { return 0; }
+void DmaController::write32(const u32 val) {}
+DSI_TSC::DSI_TSC() {}
+RomBanner::RomBanner(bool defaultInit) {}
+
+BaseDriver::BaseDriver() {}
+BaseDriver::~BaseDriver() {}
+void BaseDriver::USR_InfoMessage(const char *message) {}
+
+void GameInfo::closeROM() {}
+
+void OSDCLASS::addLine(const char *fmt, ...) {}
+void OSDCLASS::setLineColor(u8 r, u8 b, u8 g) {}
+
+TCommonSettings CommonSettings;
+MMU_struct_new MMU_new;
+GameInfo gameInfo;
+PathInfo path;
+NDSSystem nds;
+OSDCLASS *osd = NULL;
+static BaseDriver baseDriver;
+BaseDriver *driver = &baseDriver;
+int lagframecounter, LagFrameFlag, lastLag, TotalLagFrames;
+bool _HACK_NO_BOOT_SNAPSHOT = false;
+
+//---------------------------------------------------------------------------------------------------
+
+static const int FRAMES = 100;
+static const int INTERVAL = 16;
+
+//the state at the start of each frame, and at the end of the last one
+static u32 recordedStates[FRAMES+1];
+
+static int failures = 0;
+
+static void fail(const char *what)
+{
+	printf("%s\n", what);
+	failures++;
+}
+
+//a different mix of buttons (including the ones in the pad's upper byte) and touches on every frame
+static void setInput(int frame)
+{
+	memset(&rawInput, 0, sizeof(rawInput));
+	for (int i = 1; i <= 12; i++)
+		rawInput.buttons.array[i] = ((frame * 0x9E3779B1u) >> (i + 7)) & 1;
+	if (frame % 3 == 0)
+	{
+		rawInput.touch.isTouch = true;
+		rawInput.touch.touchX = (u16)((frame * 37) & 0xFF) << 4;
+		rawInput.touch.touchY = (u16)((frame * 11) % 192) << 4;
+	}
+}
+
+//in the same order as the windows frontend's StepRunLoop_Core
+static void runFrame()
+{
+	NDS_beginProcessingInput();
+	FCEUMOV_HandlePlayback();
+	NDS_endProcessingInput();
+	FCEUMOV_HandleRecording();
+	NDS_exec<false>();
+}
+
+static void checkRecords(const char *what)
+{
+	if (currMovieData.getNumRecords() != FRAMES)
+	{
+		printf("%s: %d records, expected %d\n", what, currMovieData.getNumRecords(), FRAMES);
+		failures++;
+		return;
+	}
+
+	for (int i = 0; i < FRAMES; i++)
+	{
+		MovieRecord expected;
+		expected.clear();
+		setInput(i);
+		nds.pad = moviePad(rawInput);
+		DesmumeInputToReplayRec(rawInput, &expected);
+		if (!currMovieData.records[i].Compare(expected) || currMovieData.records[i].pad != expected.pad)
+		{
+			printf("%s: frame %d has pad %04X and touch %08X, expected %04X and %08X\n", what, i, currMovieData.records[i].pad, currMovieData.records[i].touch.padding, expected.pad, expected.touch.padding);
+			failures++;
+			return;
+		}
+	}
+}
+
+static void checkSeek(int frame, bool expectCheckpoint)
+{
+	const int loadsBefore = savestateLoads;
+	if (!FCEUI_MovieSeek(frame))
+	{
+		printf("seek to %d failed\n", frame);
+		failures++;
+		return;
+	}
+	if (currFrameCounter != frame || fakeState != recordedStates[frame])
+	{
+		printf("seek to %d landed on frame %d with state %08X, expected %08X\n", frame, currFrameCounter, fakeState, recordedStates[frame]);
+		failures++;
+	}
+	if ((savestateLoads != loadsBefore) != expectCheckpoint)
+	{
+		printf("seek to %d %s a checkpoint\n", frame, expectCheckpoint ? "didn't load" : "loaded");
+		failures++;
+	}
+}
+
+int main()
+{
+	const char *dsmPath = "movie_test.dsm";
+	const char *dsmbPath = "movie_test.dsmb";
+	const char *textPath = "movie_test_binary.dsm";
+
+	//record
+	movieCheckpointInterval = INTERVAL;
+	FCEUI_SaveMovie(dsmPath, L"", 0, "", FCEUI_MovieGetRTCDefault());
+	for (int i = 0; i < FRAMES; i++)
+	{
+		recordedStates[i] = fakeState;
+		setInput(i);
+		runFrame();
+	}
+	recordedStates[FRAMES] = fakeState;
+	FCEUI_StopMovie();
+
+	checkRecords("recorded");
+	if ((int)currMovieData.checkpoints.size() != (FRAMES + INTERVAL - 1) / INTERVAL)
+		fail("the recording didn't take a checkpoint every interval");
+
+	//save it both ways
+	if (!FCEUI_ExportMovie(dsmbPath, true))
+		fail("couldn't write the .dsmb");
+	{
+		EMUFILE_FILE fp(textPath, "wb");
+		currMovieData.binaryFlag = true;
+		currMovieData.dump(&fp, true);
+	}
+
+	//the text movie's binary chunk
+	memset(&rawInput, 0, sizeof(rawInput));
+	if (FCEUI_LoadMovie(textPath, true, false, -1) != NULL)
+		fail("couldn't load the text movie");
+	checkRecords("binary chunk");
+	FCEUI_StopMovie();
+
+	//the .dsmb, then seeks around in it
+	memset(&rawInput, 0, sizeof(rawInput));
+	if (FCEUI_LoadMovie(dsmbPath, true, false, -1) != NULL)
+		fail("couldn't load the .dsmb");
+	checkRecords(".dsmb");
+	if ((int)currMovieData.checkpoints.size() != (FRAMES + INTERVAL - 1) / INTERVAL)
+		fail("the .dsmb lost checkpoints");
+
+	checkSeek(70, true);
+	checkSeek(75, false);			//forward from where we are
+	checkSeek(20, true);			//back to the checkpoint at 16
+	checkSeek(5, true);				//the one at 0
+	checkSeek(FRAMES, true);
+
+	FCEUI_StopMovie();
+	remove(dsmPath);
+	remove(dsmbPath);
+	remove(textPath);
+
+	printf("%s\n", (failures == 0) ? "ok" : "FAILED");
+	return (failures == 0) ? 0 : 1;
+}
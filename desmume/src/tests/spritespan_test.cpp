@@ -0,0 +1,160 @@
+/*
+	Copyright (C) 2016 DeSmuME team
+
+	This file is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the this software.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//checks the sprite span merge, which goes 16 pixels at a time with SSE2, against the one pixel at a time merge
+//on random sprite lines, and the affine sprite clipping against bounds checking every pixel of the line the way
+//the renderer used to, on random texture coordinates.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../GPU_spritespan.h"
+
+static u32 rngState = 0x12345678;
+static u32 rng()
+{
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState;
+}
+
+static s32 rngRange(s32 lo, s32 hi)
+{
+	return lo + (s32)(rng() % (u32)(hi - lo + 1));
+}
+
+//everything a sprite span writes to
+struct SpriteLine
+{
+	u16 color[GPU_FRAMEBUFFER_NATIVE_WIDTH];
+	u8 alpha[GPU_FRAMEBUFFER_NATIVE_WIDTH];
+	u8 type[GPU_FRAMEBUFFER_NATIVE_WIDTH];
+	u8 prio[GPU_FRAMEBUFFER_NATIVE_WIDTH];
+	u8 num[GPU_FRAMEBUFFER_NATIVE_WIDTH];
+};
+
+static int failures = 0;
+
+static void checkMerge(int iteration)
+{
+	static const u8 prioValues[] = { 0, 1, 2, 3, 0x7F };
+
+	u16 pal[256];
+	for (size_t i = 0; i < ARRAY_SIZE(pal); i++)
+		pal[i] = (u16)rng();
+
+	//about a third of the pixels transparent, and every span width from nothing to a whole 64 pixel sprite
+	u8 palIndex[64];
+	for (size_t i = 0; i < ARRAY_SIZE(palIndex); i++)
+		palIndex[i] = (rng() % 3 == 0) ? 0 : (u8)rng();
+	const size_t lg = rng() % 65;
+	const size_t sprX = rng() % (GPU_FRAMEBUFFER_NATIVE_WIDTH - lg + 1);
+
+	//a line some other sprites have already been drawn into
+	SpriteLine before;
+	for (size_t x = 0; x < GPU_FRAMEBUFFER_NATIVE_WIDTH; x++)
+	{
+		before.color[x] = (u16)rng();
+		before.alpha[x] = (u8)rng();
+		before.type[x] = (u8)(rng() % 3);
+		before.prio[x] = prioValues[rng() % ARRAY_SIZE(prioValues)];
+		before.num[x] = (u8)(rng() % 128);
+	}
+
+	const u8 spriteNum = (u8)(rng() % 128);
+	const u8 prio = (u8)(rng() % 4);
+	const u8 objMode = (rng() & 1) ? OBJMode_Transparent : OBJMode_Normal;
+	const bool isDebugRender = (rng() % 4) == 0;
+
+	SpriteLine span = before;
+	SpriteLine scalar = before;
+	if (isDebugRender)
+	{
+		SpriteSpan_Merge<true>(spriteNum, span.color, palIndex, pal, span.alpha, span.type, span.prio, span.num, prio, lg, sprX, objMode);
+		SpriteSpan_MergeScalar<true>(spriteNum, scalar.color, palIndex, pal, scalar.alpha, scalar.type, scalar.prio, scalar.num, prio, lg, sprX, objMode);
+	}
+	else
+	{
+		SpriteSpan_Merge<false>(spriteNum, span.color, palIndex, pal, span.alpha, span.type, span.prio, span.num, prio, lg, sprX, objMode);
+		SpriteSpan_MergeScalar<false>(spriteNum, scalar.color, palIndex, pal, scalar.alpha, scalar.type, scalar.prio, scalar.num, prio, lg, sprX, objMode);
+	}
+
+	for (size_t x = 0; x < GPU_FRAMEBUFFER_NATIVE_WIDTH; x++)
+	{
+		if (span.color[x] == scalar.color[x] && span.alpha[x] == scalar.alpha[x] && span.type[x] == scalar.type[x] &&
+		    span.prio[x] == scalar.prio[x] && span.num[x] == scalar.num[x])
+			continue;
+
+		printf("merge %d (%d pixels at %d, priority %d%s): pixel %d is color %04X alpha %02X type %d priority %02X sprite %d, expected %04X %02X %d %02X %d\n",
+			iteration, (int)lg, (int)sprX, prio, isDebugRender ? ", debug render" : "", (int)x,
+			span.color[x], span.alpha[x], span.type[x], span.prio[x], span.num[x],
+			scalar.color[x], scalar.alpha[x], scalar.type[x], scalar.prio[x], scalar.num[x]);
+		failures++;
+		return;
+	}
+}
+
+static bool inside(s32 start, s32 step, s32 limit, s32 j)
+{
+	const s32 coord = start + j*step;
+	return (coord >= 0) && (coord < limit);
+}
+
+static void checkClip(int iteration)
+{
+	static const s32 sizes[] = { 8, 16, 32, 64 };
+
+	//8.8 texture coordinates, stepping by the whole range of the s16 matrix parameters, with some steps of 0
+	const s32 limitX = sizes[rng() % ARRAY_SIZE(sizes)] << 8;
+	const s32 limitY = sizes[rng() % ARRAY_SIZE(sizes)] << 8;
+	const s32 dx = (rng() % 8 == 0) ? 0 : rngRange(-32768, 32767);
+	const s32 dy = (rng() % 8 == 0) ? 0 : rngRange(-32768, 32767);
+	const s32 realX = (rng() & 1) ? rngRange(-4*limitX, 5*limitX) : rngRange(-(1 << 22), 1 << 22);
+	const s32 realY = (rng() & 1) ? rngRange(-4*limitY, 5*limitY) : rngRange(-(1 << 22), 1 << 22);
+	const s32 lg = rngRange(1, GPU_FRAMEBUFFER_NATIVE_WIDTH);
+
+	s32 jBegin = 0;
+	s32 jEnd = lg;
+	SpriteSpan_ClipAffine(realX, dx, limitX, jBegin, jEnd);
+	SpriteSpan_ClipAffine(realY, dy, limitY, jBegin, jEnd);
+
+	for (s32 j = 0; j < lg; j++)
+	{
+		const bool expected = inside(realX, dx, limitX, j) && inside(realY, dy, limitY, j);
+		const bool clipped = (j >= jBegin) && (j < jEnd);
+		if (expected == clipped)
+			continue;
+
+		printf("clip %d (x %d by %d in %d, y %d by %d in %d, %d pixels): pixel %d is %s, but clipped to [%d, %d)\n",
+			iteration, realX, dx, limitX, realY, dy, limitY, lg, j, expected ? "inside" : "outside", jBegin, jEnd);
+		failures++;
+		return;
+	}
+}
+
+int main()
+{
+	for (int i = 0; i < 100000 && failures < 10; i++)
+		checkMerge(i);
+
+	for (int i = 0; i < 100000 && failures < 10; i++)
+		checkClip(i);
+
+	printf("%s\n", (failures == 0) ? "ok" : "FAILED");
+	return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+/*
+	Copyright (C) 2016 DeSmuME team
+
+	This file is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the this software.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//checks the state hash against the published xxHash64 vectors (and a few more covering every tail length
+//and a seed), then that a write to one page shows up as that page, and only that page, in StateHash_DiffPages.
+//the rest of the emulator is stood in for by a bare MMU and two fake savestate chunks.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../statehash.h"
+#include "../MMU.h"
+#include "../emufile.h"
+
+MMU_struct MMU;
+u32 _MMU_MAIN_MEM_MASK = 0x3FFFFF;
+
+static u32 fakeRegister = 0;
+
+const char* savestate_save_unpaged(int index, EMUFILE* os)
+{
+	switch (index)
+	{
+		case 0: os->write32le(fakeRegister); return "ARM9";
+		case 1: os->write32le(0x12345678); return "ARM7";
+	}
+	return NULL;
+}
+
+struct HashVector
+{
+	const char *data;
+	size_t len;
+	u64 seed;
+	u64 expected;
+};
+
+static const HashVector stringVectors[] = {
+	{ "", 0, 0, 0xEF46DB3751D8E999ULL },
+	{ "a", 1, 0, 0xD24EC4F1A98C6E5BULL },
+	{ "abc", 3, 0, 0x44BC2CF5AD770999ULL },
+	{ "Nobody inspects the spammish repetition", 39, 0, 0xFBCEA83C8A378BF1ULL },
+};
+
+//over bytes (i*7+3)&255
+static const HashVector patternVectors[] = {
+	{ NULL, 37, 1, 0x7CE0C310363F3B05ULL },
+	{ NULL, 101, 0, 0xBAD4D3BF033BDA4CULL },
+	{ NULL, 101, 0x9E3779B97F4A7C15ULL, 0x9A5F95077EAECB78ULL },
+	{ NULL, 4096, 12345, 0x14809C3FB9B3F221ULL },
+};
+
+static int failures = 0;
+
+static void checkHash(const HashVector &v, const u8 *data)
+{
+	const u64 result = StateHash_HashBytes(data, v.len, v.seed);
+	if (result == v.expected)
+		return;
+
+	printf("StateHash_HashBytes, %d bytes with seed %016llX: got %016llX, expected %016llX\n",
+		(int)v.len, (unsigned long long)v.seed, (unsigned long long)result, (unsigned long long)v.expected);
+	failures++;
+}
+
+//the pages which differ between a and b must be exactly the one given
+static void checkDiff(const char *what, const std::vector<u64> &a, const std::vector<u64> &b, const char *region, u32 offset, u32 size)
+{
+	std::vector<StateHashPage> diff;
+	StateHash_DiffPages(a, b, diff);
+	if (diff.size() == 1 && strcmp(diff[0].region, region) == 0 && diff[0].offset == offset && diff[0].size == size)
+		return;
+
+	printf("%s: expected %s+%X (%X bytes), got %d pages\n", what, region, offset, size, (int)diff.size());
+	for (size_t i = 0; i < diff.size(); i++)
+		printf("  %s+%X (%X bytes)\n", diff[i].region, diff[i].offset, diff[i].size);
+	failures++;
+}
+
+int main()
+{
+	for (size_t i = 0; i < ARRAY_SIZE(stringVectors); i++)
+		checkHash(stringVectors[i], (const u8 *)stringVectors[i].data);
+
+	static u8 pattern[4096];
+	for (size_t i = 0; i < sizeof(pattern); i++)
+		pattern[i] = (u8)(i*7 + 3);
+	for (size_t i = 0; i < ARRAY_SIZE(patternVectors); i++)
+		checkHash(patternVectors[i], pattern);
+
+	StateHash_Enable(true);
+	StateHash_EndFrame();
+	const std::vector<u64> first = StateHash_GetPages();
+	const u64 firstHash = StateHash_Get();
+
+	//nothing written: nothing differs, even though every page was rehashed the first time
+	StateHash_EndFrame();
+	std::vector<StateHashPage> diff;
+	StateHash_DiffPages(first, StateHash_GetPages(), diff);
+	if (!diff.empty() || StateHash_Get() != firstHash)
+	{
+		printf("an idle frame changed %d pages\n", (int)diff.size());
+		failures++;
+	}
+
+	//a write through the MMU's inline marking
+	MMU.MAIN_MEM[0x3456] ^= 0xFF;
+	StateHash_MarkMainMem(0x3456);
+	StateHash_EndFrame();
+	const std::vector<u64> second = StateHash_GetPages();
+	checkDiff("main memory write", first, second, "MAIN_MEM", 0x3000, STATEHASH_PAGE_SIZE);
+	if (StateHash_Get() == firstHash)
+	{
+		printf("the frame hash didn't change with main memory\n");
+		failures++;
+	}
+
+	//one through a host pointer, into the last page of the LCD memory
+	MMU.ARM9_LCD[0xA3FFF] ^= 0xFF;
+	StateHash_MarkHost(&MMU.ARM9_LCD[0xA3FFF]);
+	StateHash_EndFrame();
+	const std::vector<u64> third = StateHash_GetPages();
+	checkDiff("LCD write", second, third, "ARM9_LCD", 0xA3000, 0x1000);
+
+	//and a register, which lands in its savestate chunk
+	fakeRegister = 1;
+	StateHash_EndFrame();
+	checkDiff("register write", third, StateHash_GetPages(), "ARM9", 0, 0);
+
+	//pages only one side has count as different
+	std::vector<u64> shorter(third.begin(), third.end() - 1);
+	checkDiff("missing chunk", shorter, third, "ARM7", 0, 0);
+
+	printf("%s\n", (failures == 0) ? "ok" : "FAILED");
+	return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+/*
+	Copyright (C) 2016 DeSmuME team
+
+	This file is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the this software.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//checks that the radix sort gfx3d_doFlush uses for the poly list gives exactly the order of the
+//std::stable_sort with gfx3d_ysort_compare which it replaced, on random poly lists full of ties,
+//and times the two against each other.
+
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+#include <algorithm>
+
+#include "../utils/radixsort.h"
+
+#define MAX_POLYS 20000		//POLYLIST_SIZE
+
+static float polyMinY[MAX_POLYS];
+static float polyMaxY[MAX_POLYS];
+static u64 polyKeys[MAX_POLYS];
+static u64 keyScratch[2 * MAX_POLYS];
+static int indexScratch[MAX_POLYS];
+
+//the same ordering as gfx3d_ysort_compare
+static bool ysort_compare(int num1, int num2)
+{
+	if (polyMaxY[num1] < polyMaxY[num2]) return true;
+	if (polyMaxY[num1] > polyMaxY[num2]) return false;
+	if (polyMinY[num1] < polyMinY[num2]) return true;
+	if (polyMinY[num1] > polyMinY[num2]) return false;
+	return (num1 < num2);
+}
+
+static u32 rngState = 0x12345678;
+static u32 rng()
+{
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState;
+}
+
+//y values like the ones gfx3d_doFlush makes, drawn from a few distinct values so that there are lots of
+//ties, and with both signs of zero, which compare equal
+static float randomY(const u32 distinct)
+{
+	const u32 r = rng() % distinct;
+	if (r == 0) return -0.0f;
+	if (r == 1) return 0.0f;
+	return ((float)r / (float)distinct) * 2.5f - 0.75f;
+}
+
+static void makePolys(const size_t count, const u32 distinct)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		const float a = randomY(distinct);
+		const float b = randomY(distinct);
+		polyMinY[i] = std::min(a, b);
+		polyMaxY[i] = std::max(a, b);
+		polyKeys[i] = ((u64)RadixSort_FloatKey(polyMaxY[i]) << 32) | RadixSort_FloatKey(polyMinY[i]);
+	}
+}
+
+//gfx3d_doFlush sorts runs which start out in ascending poly order
+static void makeList(std::vector<int> &list, const size_t count)
+{
+	list.resize(count);
+	for (size_t i = 0; i < count; i++)
+		list[i] = (int)i;
+}
+
+static void radixSort(std::vector<int> &list)
+{
+	if (!list.empty())
+		RadixSort_Indexes64(&list[0], list.size(), polyKeys, keyScratch, indexScratch);
+}
+
+int main()
+{
+	static const size_t sizes[] = { 0, 1, 2, 3, 17, 255, 256, 257, 1000, 4096, MAX_POLYS };
+	static const u32 distincts[] = { 2, 3, 16, 1000, 0x7FFFFFFF };
+	int failures = 0;
+
+	for (size_t s = 0; s < ARRAY_SIZE(sizes); s++)
+	{
+		for (size_t d = 0; d < ARRAY_SIZE(distincts); d++)
+		{
+			const size_t count = sizes[s];
+			makePolys(count, distincts[d]);
+
+			std::vector<int> expected, result;
+			makeList(expected, count);
+			makeList(result, count);
+			std::stable_sort(expected.begin(), expected.end(), ysort_compare);
+			radixSort(result);
+
+			if (result != expected)
+			{
+				size_t i = 0;
+				while (result[i] == expected[i]) i++;
+				printf("%u polys, %u distinct y values: first difference at %u (got poly %d, expected %d)\n",
+					(u32)count, distincts[d], (u32)i, result[i], expected[i]);
+				failures++;
+			}
+		}
+	}
+
+	//a rough benchmark with a full poly list. it doesn't pass or fail anything
+	static const int runs = 50;
+	makePolys(MAX_POLYS, 1000);
+	std::vector<int> list;
+
+	clock_t start = clock();
+	for (int i = 0; i < runs; i++)
+	{
+		makeList(list, MAX_POLYS);
+		std::stable_sort(list.begin(), list.end(), ysort_compare);
+	}
+	const double stableTime = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	start = clock();
+	for (int i = 0; i < runs; i++)
+	{
+		makeList(list, MAX_POLYS);
+		radixSort(list);
+	}
+	const double radixTime = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	printf("%d polys, %d runs: std::stable_sort %.2fms per sort, radix sort %.2fms per sort\n",
+		MAX_POLYS, runs, stableTime * 1000.0 / runs, radixTime * 1000.0 / runs);
+
+	printf("%s\n", (failures == 0) ? "ok" : "FAILED");
+	return (failures == 0) ? 0 : 1;
+}
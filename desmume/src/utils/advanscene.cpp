@@ -17,6 +17,8 @@
 
 #include <stdio.h>
 #include <time.h>
+#include <sys/stat.h>
+#include <algorithm>
 
 #define TIXML_USE_STL
 #include "tinyxml/tinyxml.h"
@@ -33,58 +35,185 @@ ADVANsCEne advsc;
 #define _ADVANsCEne_BASE_VERSION_MINOR 0
 #define _ADVANsCEne_BASE_NAME "ADVANsCEne Nintendo DS Collection"
 
+// serial(8) + crc32(4) + save_type(1) = 13 + reserved(8) = 21
+#define _ADVANsCEne_RECORD_SIZE 21
+
+// the index saved next to the database: the size and modification time of the database it was built from,
+// the record count, then the (serial, record) and the (crc, record) pairs of every record, each list sorted
+#define _ADVANsCEne_INDEX_ID "DeSmuME database index\x1A"
+#define _ADVANsCEne_INDEX_VERSION 1
+#define _ADVANsCEne_INDEX_HEADER_SIZE (strlen(_ADVANsCEne_INDEX_ID) + 4 + 8 + 8 + 4)
+#define _ADVANsCEne_INDEX_ENTRY_SIZE 8
+
+EMUFILE* ADVANsCEne::openIndex(const std::string &indexPath, u64 dbSize, u64 dbTime, u32 &count)
+{
+	EMUFILE_FILE *idx = new EMUFILE_FILE(indexPath, "rb");
+	if (idx->fail())
+	{
+		delete idx;
+		return NULL;
+	}
+
+	char buf[64];
+	memset(buf, 0, sizeof(buf));
+	u32 version = 0;
+	u64 size = 0, mtime = 0;
+	if (idx->fread(buf, strlen(_ADVANsCEne_INDEX_ID)) == strlen(_ADVANsCEne_INDEX_ID)
+		&& strcmp(buf, _ADVANsCEne_INDEX_ID) == 0
+		&& idx->read32le(&version) && version == _ADVANsCEne_INDEX_VERSION
+		&& idx->read64le(&size) && size == dbSize
+		&& idx->read64le(&mtime) && mtime == dbTime
+		&& idx->read32le(&count)
+		&& (u64)idx->size() == _ADVANsCEne_INDEX_HEADER_SIZE + (u64)count * 2 * _ADVANsCEne_INDEX_ENTRY_SIZE)
+		return idx;
+
+	delete idx;
+	return NULL;
+}
+
+EMUFILE* ADVANsCEne::buildIndex(FILE *fp, long start, const std::string &indexPath, u64 dbSize, u64 dbTime, u32 &count)
+{
+	fseek(fp, 0, SEEK_END);
+	long end = ftell(fp);
+	fseek(fp, start, SEEK_SET);
+
+	// a trailing partial record is ignored, just like the old record by record scan did
+	count = (end > start) ? (u32)((end - start) / _ADVANsCEne_RECORD_SIZE) : 0;
+	std::vector<IndexEntry> serialIndex(count);
+	std::vector<IndexEntry> crcIndex(count);
+	for (u32 i = 0; i < count; i++)
+	{
+		u8 rec[_ADVANsCEne_RECORD_SIZE];
+		if (fread(rec, 1, _ADVANsCEne_RECORD_SIZE, fp) != _ADVANsCEne_RECORD_SIZE)
+			return NULL;
+		memcpy(&serialIndex[i].key, rec + 4, 4);
+		serialIndex[i].key = LE_TO_LOCAL_32(serialIndex[i].key);
+		serialIndex[i].record = i;
+		memcpy(&crcIndex[i].key, rec + 8, 4);
+		crcIndex[i].key = LE_TO_LOCAL_32(crcIndex[i].key);
+		crcIndex[i].record = i;
+	}
+	std::sort(serialIndex.begin(), serialIndex.end());
+	std::sort(crcIndex.begin(), crcIndex.end());
+
+	EMUFILE_MEMORY *idx = new EMUFILE_MEMORY();
+	idx->fwrite(_ADVANsCEne_INDEX_ID, strlen(_ADVANsCEne_INDEX_ID));
+	idx->write32le((u32)_ADVANsCEne_INDEX_VERSION);
+	idx->write64le(dbSize);
+	idx->write64le(dbTime);
+	idx->write32le(count);
+	for (u32 i = 0; i < count; i++)
+	{
+		idx->write32le(serialIndex[i].key);
+		idx->write32le(serialIndex[i].record);
+	}
+	for (u32 i = 0; i < count; i++)
+	{
+		idx->write32le(crcIndex[i].key);
+		idx->write32le(crcIndex[i].record);
+	}
+
+	// if the index can't be saved (say the database is somewhere read only), this lookup still goes through it,
+	// and the next one builds it again. a partly written index is thrown out by openIndex, since its size is off
+	EMUFILE_FILE out(indexPath, "wb");
+	if (!out.fail())
+		out.fwrite(&(*idx->get_vec())[0], idx->size());
+
+	return idx;
+}
+
+// finds the first (lowest record) entry for key in one of the index's sorted lists
+bool ADVANsCEne::searchIndex(EMUFILE *idx, int table, u32 count, u32 key, u32 &record)
+{
+	u32 lo = 0;
+	u32 hi = count;
+	while (lo < hi)
+	{
+		const u32 mid = lo + (hi - lo) / 2;
+		idx->fseek(table + mid * _ADVANsCEne_INDEX_ENTRY_SIZE, SEEK_SET);
+		if (idx->read32le() < key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == count)
+		return false;
+
+	u32 found = 0;
+	idx->fseek(table + lo * _ADVANsCEne_INDEX_ENTRY_SIZE, SEEK_SET);
+	if (!idx->read32le(&found) || found != key)
+		return false;
+	return idx->read32le(&record) != 0;
+}
+
 u8 ADVANsCEne::checkDB(const char *ROMserial, u32 crc)
 {
 	loaded = false;
 	FILE *fp = fopen(database_path.c_str(), "rb");
-	if (fp)
+	if (!fp) return false;
+
+	struct stat sb;
+	char buf[64];
+	memset(buf, 0, sizeof(buf));
+	if (stat(database_path.c_str(), &sb) == -1
+		|| fread(buf, 1, strlen(_ADVANsCEne_BASE_ID), fp) != strlen(_ADVANsCEne_BASE_ID)
+		|| strcmp(buf, _ADVANsCEne_BASE_ID) != 0
+		|| fread(&versionBase[0], 1, 2, fp) != 2
+		|| fread(&version[0], 1, 4, fp) != 4
+		|| fread(&createTime, 1, sizeof(time_t), fp) != sizeof(time_t))
 	{
-		char buf[64];
-		memset(buf, 0, sizeof(buf));
-		if (fread(buf, 1, strlen(_ADVANsCEne_BASE_ID), fp) == strlen(_ADVANsCEne_BASE_ID))
-		{
-			//printf("ID: %s\n", buf);
-			if (strcmp(buf, _ADVANsCEne_BASE_ID) == 0)
-			{
-				if (fread(&versionBase[0], 1, 2, fp) == 2)
-				{
-					//printf("Version base: %i.%i\n", versionBase[0], versionBase[1]);
-					if (fread(&version[0], 1, 4, fp) == 4)
-					{
-						//printf("Version: %c%c%c%c\n", version[3], version[2], version[1], version[0]);
-						if (fread(&createTime, 1, sizeof(time_t), fp) == sizeof(time_t))
-						{
-							memset(buf, 0,sizeof(buf));
-							// serial(8) + crc32(4) + save_type(1) = 13 + reserved(8) = 21
-							while (true)
-							{
-								if (fread(buf, 1, 21, fp) != 21) break;
-
-								bool serialFound = (memcmp(&buf[4], ROMserial, 4) == 0);
-								u32 dbcrc = LE_TO_LOCAL_32(*(u32*)(buf+8));
-								bool crcFound = (crc == dbcrc);
-
-								if(serialFound || crcFound)
-								{
-									foundAsCrc = crcFound;
-									foundAsSerial = serialFound;
-									memcpy(&crc32, &buf[8], 4);
-									memcpy(&serial[0], &buf[4], 4);
-									//printf("%s founded: crc32=%04X, save type %02X\n", ROMserial, crc32, buf[12]);
-									saveType = buf[12];
-									fclose(fp);
-									loaded = true;
-									return true;
-								}
-							}
-						}
-					}
-				}
-			}
-		}
 		fclose(fp);
+		return false;
 	}
-	return false;
+	//printf("Version base: %i.%i\n", versionBase[0], versionBase[1]);
+	//printf("Version: %c%c%c%c\n", version[3], version[2], version[1], version[0]);
+	const long start = ftell(fp);
+
+	// the database is only read in full when its index has to be (re)built
+	const std::string indexPath = database_path + ".idx";
+	u32 count = 0;
+	EMUFILE *idx = openIndex(indexPath, (u64)sb.st_size, (u64)sb.st_mtime, count);
+	if (!idx)
+		idx = buildIndex(fp, start, indexPath, (u64)sb.st_size, (u64)sb.st_mtime, count);
+	if (!idx)
+	{
+		fclose(fp);
+		return false;
+	}
+
+	// the earliest record matching either the serial or the crc
+	u32 serialKey;
+	memcpy(&serialKey, ROMserial, 4);
+	serialKey = LE_TO_LOCAL_32(serialKey);
+	const int serialTable = (int)_ADVANsCEne_INDEX_HEADER_SIZE;
+	const int crcTable = serialTable + (int)(count * _ADVANsCEne_INDEX_ENTRY_SIZE);
+	u32 found = 0xFFFFFFFF;
+	u32 record;
+	if (searchIndex(idx, serialTable, count, serialKey, record))
+		found = record;
+	if (searchIndex(idx, crcTable, count, crc, record) && record < found)
+		found = record;
+	delete idx;
+
+	if (found == 0xFFFFFFFF
+		|| fseek(fp, start + (long)found * _ADVANsCEne_RECORD_SIZE, SEEK_SET) != 0
+		|| fread(buf, 1, _ADVANsCEne_RECORD_SIZE, fp) != _ADVANsCEne_RECORD_SIZE)
+	{
+		fclose(fp);
+		return false;
+	}
+	fclose(fp);
+
+	u32 dbcrc;
+	memcpy(&dbcrc, buf + 8, 4);
+	foundAsSerial = (memcmp(&buf[4], ROMserial, 4) == 0);
+	foundAsCrc = (crc == LE_TO_LOCAL_32(dbcrc));
+	memcpy(&crc32, &buf[8], 4);
+	memcpy(&serial[0], &buf[4], 4);
+	//printf("%s founded: crc32=%04X, save type %02X\n", ROMserial, crc32, buf[12]);
+	saveType = buf[12];
+	loaded = true;
+	return true;
 }
 
  
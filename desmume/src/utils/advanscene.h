@@ -16,6 +16,7 @@
 */
 
 #include <string>
+#include <vector>
 #include "../types.h"
 
 class EMUFILE;
@@ -34,6 +35,20 @@ private:
 	bool			loaded;
 	bool foundAsCrc, foundAsSerial;
 
+	// the database is looked up through an index saved next to it, <database>.idx, which holds two sorted
+	// lists of (serial or crc, record number), so a lookup binary searches those on disk and reads just the
+	// record it finds. the first record in the file still wins. the index is rebuilt whenever the database's
+	// size or modification time differ from the ones it was built from
+	struct IndexEntry
+	{
+		u32 key;
+		u32 record;
+		bool operator<(const IndexEntry &other) const { return key < other.key || (key == other.key && record < other.record); }
+	};
+	static EMUFILE* openIndex(const std::string &indexPath, u64 dbSize, u64 dbTime, u32 &count);
+	static EMUFILE* buildIndex(FILE *fp, long start, const std::string &indexPath, u64 dbSize, u64 dbTime, u32 &count);
+	static bool searchIndex(EMUFILE *idx, int table, u32 count, u32 key, u32 &record);
+
 	// XML
 	std::string datName;
 	std::string datVersion;
@@ -779,13 +779,18 @@ data_t r4_dldi[2276] =
 	0x00, 0x00, 0x00, 0x00
 };
 
-bool tryPatch(void* data, size_t size, unsigned int device)
+//returns the offset of the DLDI reserved space in the file, or -1 if there is none.
+//this only reads the data, so it can run alongside anything else that only reads it
+int findPatch(const void* data, size_t size)
 {
-	// Find the DSDI reserved space in the file
-	addr_t patchOffset = quickFind ((data_t*)data, dldiMagicString, size, sizeof(dldiMagicString)/sizeof(char));
+	return quickFind ((const data_t*)data, dldiMagicString, size, sizeof(dldiMagicString)/sizeof(char));
+}
 
+//patchOffset is whatever findPatch() returned for this data
+bool tryPatch(void* data, size_t size, unsigned int device, int patchOffset)
+{
 	//no DLDI section
-	if (patchOffset < 0)
+	if (patchOffset < 0 || (size_t)patchOffset >= size)
 		return false;
 
 	data_t *pDH = device == 0?mpcf_dldi:r4_dldi;
@@ -892,4 +897,9 @@ bool tryPatch(void* data, size_t size, unsigned int device)
 	return true;
 }
 
+bool tryPatch(void* data, size_t size, unsigned int device)
+{
+	return tryPatch(data, size, device, findPatch(data, size));
+}
+
 } //namespace DLDI
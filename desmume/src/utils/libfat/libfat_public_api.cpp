@@ -6,11 +6,14 @@
 #include "common.h"
 #include "disc_io.h"
 #include "fatfile.h"
+#include "file_allocation_table.h"
+#include "../../emufile.h"
 
 
 struct Instance
 {
 	void* buffer;
+	EMUFILE* device;
 	int size_bytes;
 	devoptab_t* devops;
 };
@@ -33,6 +36,17 @@ bool MEDIUM_io(bool write, sec_t sector, sec_t numSectors, void* buffer)
 	int have = gInstance->size_bytes - loc;
 	if(todo>have) 
 		return false;
+	if(gInstance->device)
+	{
+		//sparse devices (see VFAT) do their own bookkeeping
+		EMUFILE* dev = gInstance->device;
+		dev->fseek(loc,SEEK_SET);
+		if(write)
+			dev->fwrite(buffer,todo);
+		else
+			dev->fread(buffer,todo);
+		return !dev->fail(true);
+	}
 	if(write)
 		memcpy((u8*)gInstance->buffer + loc,buffer,todo);
 	else
@@ -79,6 +93,7 @@ namespace LIBFAT
 	{
 		gInstance = &sInstance;
 		gInstance->buffer = buffer;
+		gInstance->device = NULL;
 		gInstance->size_bytes = size_bytes;
 		fatMountSimple("fat",&discio);
 		gInstance->devops = GetDeviceOpTab(NULL);
@@ -87,6 +102,16 @@ namespace LIBFAT
 		int zzz=9;
 	}
 
+	void Init(EMUFILE* device)
+	{
+		gInstance = &sInstance;
+		gInstance->buffer = NULL;
+		gInstance->device = device;
+		gInstance->size_bytes = device->size();
+		fatMountSimple("fat",&discio);
+		gInstance->devops = GetDeviceOpTab(NULL);
+	}
+
 	bool MkDir(const char *path)
 	{
 		_reent r;
@@ -108,6 +133,56 @@ namespace LIBFAT
 		return false;
 	}
 
+	bool AllocFile(const char *path, u32 len, std::vector<Extent>& extents)
+	{
+		_reent r;
+		FILE_STRUCT file;
+		intptr_t fd = gInstance->devops->open_r(&r,&file,path,O_CREAT | O_RDWR,0);
+		if(fd == -1)
+			return false;
+
+		//link up a cluster chain for the file without writing any data to it.
+		//this touches nothing but the FAT, so it costs the same no matter how big the file is
+		PARTITION* partition = file.partition;
+		u32 clusters = (len + partition->bytesPerCluster - 1) / partition->bytesPerCluster;
+		u32 cluster = CLUSTER_FREE;
+		bool ok = true;
+		for(u32 i=0;i<clusters;i++)
+		{
+			cluster = _FAT_fat_linkFreeCluster(partition, cluster);
+			if(!_FAT_fat_isValidCluster(partition, cluster))
+			{
+				ok = false;
+				break;
+			}
+			if(i == 0)
+				file.startCluster = cluster;
+
+			//coalesce contiguous clusters into one run
+			u32 sector = (u32)_FAT_fat_clusterToSector(partition, cluster);
+			if(!extents.empty() && extents.back().sector + extents.back().sectors == sector)
+				extents.back().sectors += partition->sectorsPerCluster;
+			else
+			{
+				Extent ext = { sector, partition->sectorsPerCluster };
+				extents.push_back(ext);
+			}
+		}
+
+		if(ok)
+			file.filesize = len;
+		else
+		{
+			if(file.startCluster != CLUSTER_FREE)
+				_FAT_fat_clearLinks(partition, file.startCluster);
+			file.startCluster = CLUSTER_FREE;
+			extents.clear();
+		}
+		file.modified = true;
+		gInstance->devops->close_r(&r, fd);
+		return ok;
+	}
+
 	void Shutdown()
 	{
 		fatUnmountDirect(gInstance->devops);
@@ -1,12 +1,29 @@
 #ifndef _LIBFAT_PUBLIC_API_H_
 #define _LIBFAT_PUBLIC_API_H_
 
+#include <vector>
+
+#include "../../types.h"
+
+class EMUFILE;
+
 namespace LIBFAT
 {
+	//a run of consecutive sectors on the medium
+	struct Extent
+	{
+		u32 sector, sectors;
+	};
+
 	void Init(void* buffer, int size_bytes);
+	void Init(EMUFILE* device);
 	void Shutdown();
 	bool MkDir(const char *path);
 	bool WriteFile(const char *path, const void* data, int len);
+
+	//creates a file of the given size and allocates its clusters, but doesn't write its contents.
+	//the sectors backing the file are returned in file order.
+	bool AllocFile(const char *path, u32 len, std::vector<Extent>& extents);
 };
 
 #endif //_LIBFAT_PUBLIC_API_H_
@@ -0,0 +1,85 @@
+/*
+	Copyright (C) 2016 DeSmuME team
+
+	This file is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 2 of the License, or
+	(at your option) any later version.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the this software.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _RADIXSORT_H_
+#define _RADIXSORT_H_
+
+#include <string.h>
+#include <algorithm>
+
+#include "../types.h"
+
+//maps a float to a u32 which orders the same way the float compares do
+FORCEINLINE u32 RadixSort_FloatKey(float f)
+{
+	//-0 and +0 compare equal, so they need the same key
+	if (f == 0.0f) f = 0.0f;
+
+	u32 bits;
+	memcpy(&bits, &f, sizeof(bits));
+	return (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+}
+
+//sorts a list of indexes by keys[index] with a stable 8bit LSD radix sort, so indexes with equal keys
+//stay in the order they came in. keyScratch needs room for 2*count keys and indexScratch for count indexes.
+inline void RadixSort_Indexes64(int *list, const size_t count, const u64 *keys, u64 *keyScratch, int *indexScratch)
+{
+	if (count < 2)
+		return;
+
+	u64 *srcKeys = keyScratch;
+	u64 *dstKeys = keyScratch + count;
+	int *srcIndexes = list;
+	int *dstIndexes = indexScratch;
+
+	for (size_t i = 0; i < count; i++)
+		srcKeys[i] = keys[list[i]];
+
+	for (u32 shift = 0; shift < 64; shift += 8)
+	{
+		u32 offsets[256] = {0};
+		for (size_t i = 0; i < count; i++)
+			offsets[(srcKeys[i] >> shift) & 0xFF]++;
+
+		//skip the pass if every key has the same byte here. this is the usual case for the high bytes
+		if (offsets[(srcKeys[0] >> shift) & 0xFF] == count)
+			continue;
+
+		u32 total = 0;
+		for (size_t i = 0; i < 256; i++)
+		{
+			const u32 n = offsets[i];
+			offsets[i] = total;
+			total += n;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			const u32 dst = offsets[(srcKeys[i] >> shift) & 0xFF]++;
+			dstKeys[dst] = srcKeys[i];
+			dstIndexes[dst] = srcIndexes[i];
+		}
+
+		std::swap(srcKeys, dstKeys);
+		std::swap(srcIndexes, dstIndexes);
+	}
+
+	if (srcIndexes != list)
+		memcpy(list, srcIndexes, count * sizeof(int));
+}
+
+#endif
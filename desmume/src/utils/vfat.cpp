@@ -22,7 +22,11 @@
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <stack>
+#include <map>
+#include <vector>
+#include <algorithm>
 
 #include "../types.h"
 #include "../debug.h"
@@ -35,12 +39,264 @@
 #include "vfat.h"
 #include "libfat/libfat_public_api.h"
 
+//a disk image which only stores the sectors that have been written to it.
+//every other sector is either blank, or belongs to a host file and gets read from that file when somebody asks for it.
+//this lets us present a directory as a disk without reading (or holding in memory) any of the file contents up front.
+//writes go to the stored sectors and are never written back to the host files.
+class EMUFILE_VFAT : public EMUFILE
+{
+public:
+	EMUFILE_VFAT(u32 sectors)
+		: pos(0)
+		, len(sectors*512)
+		, hostFp(NULL)
+		, hostFile(-1)
+	{}
+
+	virtual ~EMUFILE_VFAT()
+	{
+		truncate(0);
+		if(hostFp) ::fclose(hostFp);
+	}
+
+	//backs the given sectors, in order, with the contents of a host file
+	void addHostFile(const std::string& path, const std::vector<LIBFAT::Extent>& runs)
+	{
+		u32 file = (u32)hostFiles.size();
+		hostFiles.push_back(path);
+		u32 fileSector = 0;
+		for(size_t i=0;i<runs.size();i++)
+		{
+			HostExtent ext = { runs[i].sector, runs[i].sectors, file, fileSector };
+			extents.insert(std::upper_bound(extents.begin(),extents.end(),ext),ext);
+			fileSector += runs[i].sectors;
+		}
+	}
+
+	virtual EMUFILE* memwrap()
+	{
+		EMUFILE_MEMORY* mem = new EMUFILE_MEMORY(size());
+		if(size()==0) return mem;
+		s32 oldpos = pos;
+		pos = 0;
+		_fread(mem->buf(),size());
+		pos = oldpos;
+		return mem;
+	}
+
+	virtual FILE *get_fp() { return NULL; }
+
+	virtual int fprintf(const char *format, ...) {
+		va_list argptr;
+		va_start(argptr, format);
+		int amt = vsnprintf(0,0,format,argptr);
+		char* tempbuf = new char[amt+1];
+		va_end(argptr);
+		va_start(argptr, format);
+		vsprintf(tempbuf,format,argptr);
+		fwrite(tempbuf,amt);
+		delete[] tempbuf;
+		va_end(argptr);
+		return amt;
+	}
+
+	virtual int fgetc() {
+		u8 temp = 0;
+		if(_fread(&temp,1) != 1)
+			return EOF;
+		return temp;
+	}
+	virtual int fputc(int c) {
+		u8 temp = (u8)c;
+		if(fwrite(&temp,1) != 1)
+			return EOF;
+		return 0;
+	}
+
+	virtual size_t _fread(const void *ptr, size_t bytes)
+	{
+		u32 remain = pos<len ? (u32)(len-pos) : 0;
+		u32 todo = std::min<u32>(remain,(u32)bytes);
+		u8* dst = (u8*)ptr;
+		u8 temp[512];
+		for(u32 done=0;done<todo;)
+		{
+			u32 ofs = (u32)pos & 511;
+			u32 chunk = std::min<u32>(512-ofs,todo-done);
+			if(chunk == 512)
+				readSector((u32)pos>>9,dst+done);
+			else
+			{
+				readSector((u32)pos>>9,temp);
+				memcpy(dst+done,temp+ofs,chunk);
+			}
+			pos += chunk;
+			done += chunk;
+		}
+		if(todo<bytes)
+			failbit = true;
+		return todo;
+	}
+
+	virtual size_t fwrite(const void *ptr, size_t bytes)
+	{
+		//the disk can't grow; writes off the end are dropped
+		u32 remain = pos<len ? (u32)(len-pos) : 0;
+		u32 todo = std::min<u32>(remain,(u32)bytes);
+		const u8* src = (const u8*)ptr;
+		for(u32 done=0;done<todo;)
+		{
+			u32 ofs = (u32)pos & 511;
+			u32 chunk = std::min<u32>(512-ofs,todo-done);
+			writeSector((u32)pos>>9,src+done,ofs,chunk);
+			pos += chunk;
+			done += chunk;
+		}
+		if(todo<bytes)
+			failbit = true;
+		return todo;
+	}
+
+	virtual int fseek(int offset, int origin)
+	{
+		switch(origin) {
+			case SEEK_SET:
+				pos = offset;
+				break;
+			case SEEK_CUR:
+				pos += offset;
+				break;
+			case SEEK_END:
+				pos = size()+offset;
+				break;
+			default:
+				assert(false);
+		}
+		return 0;
+	}
+
+	virtual int ftell() { return pos; }
+	virtual int size() { return len; }
+	virtual void fflush() {}
+
+	virtual void truncate(s32 length)
+	{
+		//anything past the new end is gone for good, even if the disk grows again later
+		const u32 keep = ((u32)length+511)>>9;
+		SectorMap::iterator it = sectors.lower_bound(keep);
+		for(SectorMap::iterator jt=it;jt!=sectors.end();++jt)
+			delete[] jt->second;
+		sectors.erase(it,sectors.end());
+
+		//that goes for the host files too
+		while(!extents.empty() && extents.back().sector >= keep)
+			extents.pop_back();
+		if(!extents.empty() && extents.back().sector + extents.back().sectors > keep)
+			extents.back().sectors = keep - extents.back().sector;
+
+		//and for the part of the last sector past the end
+		const u32 tail = (u32)length & 511;
+		if(tail != 0)
+		{
+			static const u8 blank[512] = {0};
+			writeSector((u32)length>>9,blank,tail,512-tail);
+		}
+
+		len = length;
+		if(pos>len) pos = len;
+	}
+
+private:
+	struct HostExtent
+	{
+		u32 sector, sectors;
+		u32 file, fileSector;
+		bool operator<(const HostExtent& other) const { return sector < other.sector; }
+	};
+
+	typedef std::map<u32,u8*> SectorMap;
+
+	s32 pos, len;
+	SectorMap sectors;
+	std::vector<HostExtent> extents;
+	std::vector<std::string> hostFiles;
+
+	//the host file we read from last. files are usually read front to back, so one is plenty
+	FILE* hostFp;
+	s32 hostFile;
+
+	const HostExtent* findExtent(u32 sector) const
+	{
+		HostExtent key = { sector, 0, 0, 0 };
+		std::vector<HostExtent>::const_iterator it = std::upper_bound(extents.begin(),extents.end(),key);
+		if(it == extents.begin()) return NULL;
+		--it;
+		if(sector - it->sector >= it->sectors) return NULL;
+		return &*it;
+	}
+
+	void readSector(u32 sector, u8* dst)
+	{
+		SectorMap::iterator it = sectors.find(sector);
+		if(it != sectors.end())
+		{
+			memcpy(dst,it->second,512);
+			return;
+		}
+
+		size_t got = 0;
+		const HostExtent* ext = findExtent(sector);
+		if(ext)
+		{
+			if(hostFile != (s32)ext->file)
+			{
+				if(hostFp) ::fclose(hostFp);
+				hostFp = ::fopen(hostFiles[ext->file].c_str(),"rb");
+				hostFile = ext->file;
+				if(!hostFp)
+					printf("ERROR opening file for fat: %s\n",hostFiles[ext->file].c_str());
+			}
+			long ofs = (long)(ext->fileSector + sector - ext->sector) * 512;
+			if(hostFp && ::fseek(hostFp,ofs,SEEK_SET) == 0)
+				got = ::fread(dst,1,512,hostFp);
+		}
+
+		//the tail of a file's last cluster is blank
+		memset(dst+got,0,512-got);
+	}
+
+	void writeSector(u32 sector, const u8* src, u32 ofs, u32 count)
+	{
+		u8* data;
+		SectorMap::iterator it = sectors.find(sector);
+		if(it != sectors.end())
+			data = it->second;
+		else
+		{
+			//blanking a blank sector changes nothing, and formatting the disk does plenty of that
+			if(!findExtent(sector))
+			{
+				bool blank = true;
+				for(u32 i=0;i<count && blank;i++)
+					blank = (src[i] == 0);
+				if(blank) return;
+			}
+
+			data = new u8[512];
+			if(count != 512)
+				readSector(sector,data);
+			sectors[sector] = data;
+		}
+		memcpy(data+ofs,src,count);
+	}
+};
+
 
 enum EListCallbackArg {
 	EListCallbackArg_Item, EListCallbackArg_Pop
 };
 
-typedef void (*ListCallback)(RDIR* rdir, EListCallbackArg);
+typedef void (*ListCallback)(RDIR* rdir, const char* dirpath, EListCallbackArg);
 
 // List all files and subdirectories recursively
 static void list_files(const char *filepath, ListCallback list_callback)
@@ -63,13 +319,13 @@ static void list_files(const char *filepath, ListCallback list_callback)
 			break;
 
 		const char* fname = retro_dirent_get_name(rdir);
-		list_callback(rdir,EListCallbackArg_Item);
+		list_callback(rdir,filepath,EListCallbackArg_Item);
 
 		if(retro_dirent_is_dir(rdir) && (strcmp(fname, ".")) && (strcmp(fname, ".."))) 
 		{
 			std::string subdir = (std::string)filepath + path_default_slash() + fname;
 			list_files(subdir.c_str(), list_callback);
-			list_callback(rdir, EListCallbackArg_Pop);
+			list_callback(rdir, filepath, EListCallbackArg_Pop);
 		}
 	}
 
@@ -77,7 +333,7 @@ static void list_files(const char *filepath, ListCallback list_callback)
 }
 
 static u64 dataSectors = 0;
-void count_ListCallback(RDIR* rdir, EListCallbackArg arg)
+void count_ListCallback(RDIR* rdir, const char* dirpath, EListCallbackArg arg)
 {
 	if(arg == EListCallbackArg_Pop) return;
 	u32 sectors = 1;
@@ -87,24 +343,23 @@ void count_ListCallback(RDIR* rdir, EListCallbackArg arg)
 	else
 	{
 		//allocate sectors for file
-		int32_t fileSize = path_get_size(retro_dirent_get_name(rdir));
-		sectors += (fileSize+511)/512 + 1;
+		std::string path = (std::string)dirpath + path_default_slash() + retro_dirent_get_name(rdir);
+		int32_t fileSize = path_get_size(path.c_str());
+		if(fileSize > 0)
+			sectors += (fileSize+511)/512 + 1;
 	}
 	dataSectors += sectors; 
 }
 
-static std::string currPath;
-static std::stack<std::string> pathStack;
 static std::stack<std::string> virtPathStack;
 static std::string currVirtPath;
-void build_ListCallback(RDIR* rdir, EListCallbackArg arg)
+static EMUFILE_VFAT* currDevice;
+void build_ListCallback(RDIR* rdir, const char* dirpath, EListCallbackArg arg)
 {
 	const char* fname = retro_dirent_get_name(rdir);
 
 	if(arg == EListCallbackArg_Pop) 
 	{
-		currPath = pathStack.top();
-		pathStack.pop();
 		currVirtPath = virtPathStack.top();
 		virtPathStack.pop();
 		return;
@@ -115,7 +370,6 @@ void build_ListCallback(RDIR* rdir, EListCallbackArg arg)
 		if(!strcmp(fname,".")) return;
 		if(!strcmp(fname,"..")) return;
 
-		pathStack.push(currPath);
 		virtPathStack.push(currVirtPath);
 
 		currVirtPath = currVirtPath + "/" + fname;
@@ -123,30 +377,24 @@ void build_ListCallback(RDIR* rdir, EListCallbackArg arg)
 
 		if(!ok)
 			printf("ERROR adding dir %s via libfat\n",currVirtPath.c_str());
-
-		currPath = currPath + path_default_slash() + fname;
 		return;
 	}
 	else
 	{
-		std::string path = currPath + path_default_slash() + fname;
+		std::string path = (std::string)dirpath + path_default_slash() + fname;
 
-		FILE* inf = fopen(path.c_str(),"rb");
-		if(inf)
+		int32_t len = path_get_size(path.c_str());
+		if(len >= 0)
 		{
-			fseek(inf,0,SEEK_END);
-			long len = ftell(inf);
-			fseek(inf,0,SEEK_SET);
-			u8 *buf = new u8[len];
-			fread(buf,1,len,inf);
-			fclose(inf);
-
-			std::string path = currVirtPath + "/" + fname;
-			printf("FAT + (%10.2f KB) %s \n",len/1024.f,path.c_str());
-			bool ok = LIBFAT::WriteFile(path.c_str(),buf,len);
-			if(!ok) 
+			//only the directory entry and cluster chain are made now. the contents are read from the host file on demand
+			std::string virtPath = currVirtPath + "/" + fname;
+			printf("FAT + (%10.2f KB) %s \n",len/1024.f,virtPath.c_str());
+			std::vector<LIBFAT::Extent> extents;
+			bool ok = LIBFAT::AllocFile(virtPath.c_str(),(u32)len,extents);
+			if(ok)
+				currDevice->addHostFile(path,extents);
+			else
 				printf("ERROR adding file to fat\n");
-			delete[] buf;
 		} else printf("ERROR opening file for fat\n");
 	}
 		
@@ -158,7 +406,6 @@ bool VFAT::build(const char* path, int extra_MB)
 {
 	dataSectors = 0;
 	currVirtPath = "";
-	currPath = path;
 	list_files(path, count_ListCallback);
 
 	dataSectors += 8; //a few for reserved sectors, etc.
@@ -175,40 +422,27 @@ bool VFAT::build(const char* path, int extra_MB)
 	{
 		printf("error allocating memory for fat (%d KBytes)\n",(dataSectors*512)/1024);
 		printf("total fat sizes > 2GB are never going to work\n");
+		return false;
 	}
 	
+	//the image is sparse, so its size costs nothing until the sectors get written
 	delete file;
-	try 
-	{
-		file = new EMUFILE_MEMORY(dataSectors*512);
-	}
-	catch(std::bad_alloc)
-	{
-		printf("error allocating memory for fat (%d KBytes)\n",(dataSectors*512)/1024);
-		printf("(out of memory)\n");
-		return false;
-	}
+	currDevice = new EMUFILE_VFAT((u32)dataSectors);
+	file = currDevice;
 
-	//debug..
-	//file = new EMUFILE_FILE("c:\\temp.ima","rb+");
-	
 	//format the disk
 	{
 		EmuFat fat(file);
 		EmuFatVolume vol;
 		u8 ok = vol.init(&fat);
 		vol.formatNew(dataSectors);
-
-		//ensure we are working in memory, just in case we were testing with a disk file.
-		//libfat will need to go straight to memory (for now; we could easily change it to work with the disk)
-		file = file->memwrap();
 	}
-	EMUFILE_MEMORY* memf = (EMUFILE_MEMORY*)file;
 
-	//setup libfat and write all the files through it
-	LIBFAT::Init(memf->buf(),memf->size());
+	//setup libfat and lay out all the files through it
+	LIBFAT::Init(file);
 	list_files(path, build_ListCallback);
 	LIBFAT::Shutdown();
+	currDevice = NULL;
 
 	return true;
 }
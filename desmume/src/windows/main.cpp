@@ -65,6 +65,7 @@
 #include "../lua-engine.h"
 #include "../path.h"
 #include "../utils/advanscene.h"
+#include "../frontend/modules/ImageOut.h"
 
 //other random stuff
 #include "rthreads/rthreads.h"
@@ -3424,6 +3425,7 @@ int _main()
     gdbstub_mutex_destroy();
 #endif
 	
+	NDS_ShutdownScreenshots();
 	NDS_DeInit();
 
 #ifdef DEBUG
@@ -0,0 +1,106 @@
+/* 	vram cache test
+
+	Copyright 2016 DeSmuME team
+
+    This file is part of DeSmuME
+
+    DeSmuME is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    DeSmuME is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with DeSmuME; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+//a BG tile rewritten by the BIOS decompressor must show up on the very next frame.
+//the emulator reuses rendered lines and decoded tiles while VRAM is unchanged, so this
+//catches VRAM writes which bypass the usual bus handlers.
+#include <nds.h>
+
+#include <stdio.h>
+
+#define RED   RGB15(31,0,0)
+#define GREEN RGB15(0,31,0)
+
+//LZ77 stream for one 16-color tile where every pixel is color 2: two literal bytes,
+//then two back references 2 bytes back, of 18 and 12 bytes.
+static const u8 greenTileLZ77[12] __attribute__((aligned(4))) = {
+	0x10, 0x20, 0x00, 0x00,
+	0x30, 0x22, 0x22, 0xF0, 0x01, 0x90, 0x01, 0x00
+};
+
+//SWI 0x12 (LZ77UnCompVram) without libnds' callback stream. the real BIOS wants one here,
+//which is why this test is meant for the HLE BIOS.
+static void biosLZ77UnCompVram(const void* src, void* dst)
+{
+	register const void* r0 asm("r0") = src;
+	register void* r1 asm("r1") = dst;
+#ifdef __thumb__
+	asm volatile("swi 0x12" : "+r"(r0), "+r"(r1) : : "r2", "r3", "memory");
+#else
+	asm volatile("swi 0x120000" : "+r"(r0), "+r"(r1) : : "r2", "r3", "memory");
+#endif
+}
+
+//capture the main engine's BG/OBJ output, 256x192, into VRAM bank D
+static void captureFrame()
+{
+	REG_DISPCAPCNT = BIT(31) | (3<<20) | (3<<16);
+	while(REG_DISPCAPCNT & BIT(31)) {}
+}
+
+static int countPixels(u16 color)
+{
+	int count = 0;
+	for(int i=0;i<256*192;i++)
+		if((VRAM_D[i] & 0x7FFF) == color)
+			count++;
+	return count;
+}
+
+int main(void) {
+	consoleDemoInit();
+
+	videoSetMode(MODE_0_2D | DISPLAY_BG0_ACTIVE);
+	vramSetBankA(VRAM_A_MAIN_BG);
+	vramSetBankD(VRAM_D_LCD);
+	REG_BG0CNT = BG_32x32 | BG_COLOR_16 | BG_MAP_BASE(0) | BG_TILE_BASE(1);
+
+	BG_PALETTE[0] = 0;
+	BG_PALETTE[1] = RED;
+	BG_PALETTE[2] = GREEN;
+
+	//every map entry points at tile 1, which starts out all red
+	u16* const map = (u16*)BG_MAP_RAM(0);
+	u16* const tile1 = (u16*)BG_TILE_RAM(1) + 16;
+	for(int i=0;i<32*32;i++) map[i] = 1;
+	for(int i=0;i<16;i++) tile1[i] = 0x1111;
+
+	//render a few identical frames, so that every line is cached
+	for(int i=0;i<3;i++) swiWaitForVBlank();
+	captureFrame();
+	int red = countPixels(RED);
+	iprintf("before: %d red pixels\n", red);
+
+	swiWaitForVBlank();
+	biosLZ77UnCompVram(greenTileLZ77, tile1);
+
+	captureFrame();
+	int green = countPixels(GREEN);
+	iprintf("after: %d green pixels\n", green);
+
+	if(red == 256*192 && green == 256*192)
+		iprintf("ok\n");
+	else
+		iprintf("FAILED\n");
+
+	for(;;) swiWaitForVBlank();
+	return 0;
+}